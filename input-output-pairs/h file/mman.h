@@ -0,0 +1,27 @@
+/**
+ * Contracts for read-only file mappings (see mmap(2)).
+ *
+ * Only the read-only, private, whole-file form is supported: the mapping is
+ * handed out as a fraction of its bytes, so it can be read but not written.
+ */
+
+#ifndef MMAN_H
+#define MMAN_H
+
+#include "stddef.h"
+
+#define PROT_READ 0x1
+#define MAP_PRIVATE 0x02
+#define MAP_FAILED ((void *)-1)
+
+//@ predicate mmap_block(void *addr, size_t length);
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, /*off_t*/ long offset);
+    //@ requires addr == 0 &*& 0 < length &*& prot == PROT_READ &*& flags == MAP_PRIVATE &*& 0 <= fd &*& offset == 0;
+    //@ ensures result == MAP_FAILED ? true : mmap_block(result, length) &*& [1/2]chars(result, length, _);
+
+int munmap(void *addr, size_t length);
+    //@ requires mmap_block(addr, length) &*& [1/2]chars(addr, length, _);
+    //@ ensures true;
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * Contracts for recv(2).
+ *
+ * Only the blocking form without flags is supported. The received bytes are
+ * written to a buffer owned by the caller.
+ */
+
+#ifndef RECV_H
+#define RECV_H
+
+#include "stddef.h"
+
+/*ssize_t*/ long recv(int socket, void *buffer, size_t length, int flags);
+    //@ requires 0 <= socket &*& chars_(buffer, length, _) &*& flags == 0;
+    //@ ensures -1 <= result &*& result <= length &*& 0 < result ? chars(buffer, result, _) &*& chars_(buffer + result, length - result, _) : chars_(buffer, length, _);
+
+#endif
@@ -0,0 +1,16 @@
+/**
+ * Contracts for sendfile(2).
+ *
+ * Only the form that uses and advances the input file offset is supported.
+ */
+
+#ifndef SENDFILE_H
+#define SENDFILE_H
+
+#include "stddef.h"
+
+/*ssize_t*/ long sendfile(int out_fd, int in_fd, /*off_t*/ long *offset, size_t count);
+    //@ requires 0 <= out_fd &*& 0 <= in_fd &*& offset == 0;
+    //@ ensures -1 <= result &*& result <= count;
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * Contracts for the C11 atomic operations on ints.
+ *
+ * VeriFast has no type-generic functions, so each operation is declared for
+ * int objects only. An int that several threads access at once is owned by
+ * an atomic space: an invariant that an atomic operation opens for the one
+ * step in which it accesses the int. The caller passes a ghost operation
+ * (ghop) that runs during that step. The ghop receives the invariant and
+ * P(), and turns P() into Q(value) by calling the op it is handed; the op
+ * stands for the access itself.
+ */
+
+#ifndef STDATOMIC_H
+#define STDATOMIC_H
+
+#include <stdbool.h>
+
+// The memory orders of C11 7.17.3. The contracts do not depend on them: VeriFast reasons as if every atomic operation
+// were sequentially consistent, so a program must itself choose orders that are strong enough for the data it
+// publishes through an atomic operation.
+typedef enum memory_order {
+    memory_order_relaxed,
+    memory_order_consume,
+    memory_order_acquire,
+    memory_order_release,
+    memory_order_acq_rel,
+    memory_order_seq_cst
+} memory_order;
+
+/*@
+
+predicate atomic_space(predicate() inv);
+
+lemma void create_atomic_space(predicate() inv);
+    requires inv();
+    ensures atomic_space(inv);
+
+lemma void dispose_atomic_space(predicate() inv);
+    requires atomic_space(inv);
+    ensures inv();
+
+typedef lemma void atomic_load_op(int *object, predicate() P, predicate(int) Q)();
+    requires [?f]*object |-> ?value &*& P();
+    ensures [f]*object |-> value &*& Q(value);
+
+typedef lemma void atomic_load_ghop(int *object, predicate() inv, predicate() pre, predicate(int) post)();
+    requires inv() &*& is_atomic_load_op(?op, object, ?P, ?Q) &*& P() &*& pre();
+    ensures inv() &*& is_atomic_load_op(op, object, P, Q) &*& Q(?value) &*& post(value);
+
+typedef lemma void atomic_store_op(int *object, int desired, predicate() P, predicate() Q)();
+    requires *object |-> _ &*& P();
+    ensures *object |-> desired &*& Q();
+
+typedef lemma void atomic_store_ghop(int *object, int desired, predicate() inv, predicate() pre, predicate() post)();
+    requires inv() &*& is_atomic_store_op(?op, object, desired, ?P, ?Q) &*& P() &*& pre();
+    ensures inv() &*& is_atomic_store_op(op, object, desired, P, Q) &*& Q() &*& post();
+
+typedef lemma void atomic_fetch_add_op(int *object, int operand, predicate() P, predicate(int) Q)();
+    requires *object |-> ?value &*& P();
+    ensures *object |-> value + operand &*& Q(value);
+
+typedef lemma void atomic_fetch_add_ghop(int *object, int operand, predicate() inv, predicate() pre, predicate(int) post)();
+    requires inv() &*& is_atomic_fetch_add_op(?op, object, operand, ?P, ?Q) &*& P() &*& pre();
+    ensures inv() &*& is_atomic_fetch_add_op(op, object, operand, P, Q) &*& Q(?value) &*& post(value);
+
+typedef lemma void atomic_exchange_op(int *object, int desired, predicate() P, predicate(int) Q)();
+    requires *object |-> ?value &*& P();
+    ensures *object |-> desired &*& Q(value);
+
+typedef lemma void atomic_exchange_ghop(int *object, int desired, predicate() inv, predicate() pre, predicate(int) post)();
+    requires inv() &*& is_atomic_exchange_op(?op, object, desired, ?P, ?Q) &*& P() &*& pre();
+    ensures inv() &*& is_atomic_exchange_op(op, object, desired, P, Q) &*& Q(?value) &*& post(value);
+
+typedef lemma void atomic_compare_exchange_op(int *object, int expected, int desired, predicate() P, predicate(int) Q)();
+    requires *object |-> ?value &*& P();
+    ensures *object |-> (value == expected ? desired : value) &*& Q(value);
+
+typedef lemma void atomic_compare_exchange_ghop(int *object, int expected, int desired, predicate() inv, predicate() pre, predicate(int) post)();
+    requires inv() &*& is_atomic_compare_exchange_op(?op, object, expected, desired, ?P, ?Q) &*& P() &*& pre();
+    ensures inv() &*& is_atomic_compare_exchange_op(op, object, expected, desired, P, Q) &*& Q(?value) &*& post(value);
+
+@*/
+
+// See atomic_load(3).
+int atomic_load(int *object);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_load_ghop(?ghop, object, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_load_ghop(ghop, object, inv, pre, post) &*& post(result);
+
+// See atomic_load_explicit(3).
+int atomic_load_explicit(int *object, memory_order order);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_load_ghop(?ghop, object, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_load_ghop(ghop, object, inv, pre, post) &*& post(result);
+
+// See atomic_store(3).
+void atomic_store(int *object, int desired);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_store_ghop(?ghop, object, desired, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_store_ghop(ghop, object, desired, inv, pre, post) &*& post();
+
+// See atomic_store_explicit(3).
+void atomic_store_explicit(int *object, int desired, memory_order order);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_store_ghop(?ghop, object, desired, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_store_ghop(ghop, object, desired, inv, pre, post) &*& post();
+
+// See atomic_fetch_add(3). Returns the value the object held before the addition.
+int atomic_fetch_add(int *object, int operand);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_fetch_add_ghop(?ghop, object, operand, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_fetch_add_ghop(ghop, object, operand, inv, pre, post) &*& post(result);
+
+// See atomic_fetch_add_explicit(3).
+int atomic_fetch_add_explicit(int *object, int operand, memory_order order);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_fetch_add_ghop(?ghop, object, operand, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_fetch_add_ghop(ghop, object, operand, inv, pre, post) &*& post(result);
+
+// See atomic_exchange(3). Returns the value the object held before the exchange.
+int atomic_exchange(int *object, int desired);
+    //@ requires [?f]atomic_space(?inv) &*& is_atomic_exchange_ghop(?ghop, object, desired, inv, ?pre, ?post) &*& pre();
+    //@ ensures [f]atomic_space(inv) &*& is_atomic_exchange_ghop(ghop, object, desired, inv, pre, post) &*& post(result);
+
+// See atomic_compare_exchange_strong(3). Stores desired if the object holds *expected; otherwise stores the value the
+// object holds in *expected. Returns whether the exchange took place.
+bool atomic_compare_exchange_strong(int *object, int *expected, int desired);
+    /*@
+    requires
+        [?f]atomic_space(?inv) &*& *expected |-> ?e &*&
+        is_atomic_compare_exchange_ghop(?ghop, object, e, desired, inv, ?pre, ?post) &*& pre();
+    @*/
+    /*@
+    ensures
+        [f]atomic_space(inv) &*& is_atomic_compare_exchange_ghop(ghop, object, e, desired, inv, pre, post) &*&
+        post(?value) &*& *expected |-> value &*& result == (value == e);
+    @*/
+
+#endif
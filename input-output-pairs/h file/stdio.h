@@ -95,6 +95,10 @@ int fclose(FILE* fp);
     //@ requires file(fp);
     //@ ensures true;
 
+int fileno(FILE* fp);
+    //@ requires [?f]file(fp);
+    //@ ensures [f]file(fp) &*& -1 <= result;
+
 int getchar();
     //@ requires true;
     //@ ensures true;
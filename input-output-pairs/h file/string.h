@@ -0,0 +1,51 @@
+/**
+ * Contracts for C standard library's string and memory functions.
+ */
+
+#ifndef STRING_H
+#define STRING_H
+
+#include "stddef.h"
+
+void *memcpy(void *array, void *array0, size_t count);
+    //@ requires chars_(array, count, _) &*& [?f]chars(array0, count, ?cs0);
+    //@ ensures chars(array, count, cs0) &*& [f]chars(array0, count, cs0) &*& result == array;
+
+void *memmove(void *dest, void *src, size_t count);
+    /*@
+    requires
+        chars(src, count, ?cs) &*&
+        dest <= src ?
+            chars_(dest, src - dest, _)
+        :
+            chars_(src + count, dest - src, _);
+    @*/
+    /*@
+    ensures
+        dest <= src ?
+            chars(dest, count, cs) &*& chars_(dest + count, src - dest, _)
+        :
+            chars(dest, count, cs) &*& chars_(src, dest - src, _);
+    @*/
+
+void *memset(void *array, char value, size_t size);
+    //@ requires chars_(array, ?length, _) &*& size <= length;
+    //@ ensures chars(array, size, ?cs) &*& all_eq(cs, value) == true &*& chars_(array + size, length - size, _) &*& result == array;
+
+int memcmp(void *array, void *array0, size_t count);
+    //@ requires [?f]chars(array, ?n, ?cs) &*& [?f0]chars(array0, ?n0, ?cs0) &*& count <= n &*& count <= n0;
+    //@ ensures [f]chars(array, n, cs) &*& [f0]chars(array0, n0, cs0) &*& (result == 0) == (take(count, cs) == take(count, cs0));
+
+void *memchr(void *array, char c, size_t count);
+    //@ requires [?f]chars(array, count, ?cs);
+    //@ ensures [f]chars(array, count, cs) &*& result == 0 ? mem(c, cs) == false : mem(c, cs) == true &*& result == array + index_of(c, cs);
+
+size_t strlen(char *string);
+    //@ requires [?f]string(string, ?cs);
+    //@ ensures [f]string(string, cs) &*& result == length(cs);
+
+int strcmp(char *s1, char *s2);
+    //@ requires [?f1]string(s1, ?cs1) &*& [?f2]string(s2, ?cs2);
+    //@ ensures [f1]string(s1, cs1) &*& [f2]string(s2, cs2) &*& (result == 0) == (cs1 == cs2);
+
+#endif
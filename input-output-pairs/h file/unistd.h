@@ -0,0 +1,19 @@
+/**
+ * Contracts for file-descriptor-level primitives.
+ *
+ * File descriptors are plain ints, so these contracts only constrain the
+ * arguments and the range of the result. The data moved by copy_file_range
+ * never enters the program's heap.
+ */
+
+#ifndef UNISTD_H
+#define UNISTD_H
+
+#include "stddef.h"
+
+// See copy_file_range(2). Only the form that uses and advances the file offsets is supported.
+/*ssize_t*/ long copy_file_range(int fd_in, /*off_t*/ long *off_in, int fd_out, /*off_t*/ long *off_out, size_t len, unsigned int flags);
+    //@ requires 0 <= fd_in &*& 0 <= fd_out &*& off_in == 0 &*& off_out == 0 &*& flags == 0;
+    //@ ensures -1 <= result &*& result <= len;
+
+#endif
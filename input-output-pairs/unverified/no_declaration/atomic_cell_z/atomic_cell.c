@@ -0,0 +1,588 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// The cell of concurrent_cell, without its mutex: every operation is a single C11 atomic operation on x, and the
+// trace_extension box records it in the same atomic step.
+
+struct cell {
+  int x;
+  //@ box id;
+};
+
+/*@
+
+fixpoint bool is_prefix(trace pref, trace trace) {
+  switch(trace) {
+    case zero: return pref == zero;
+    case inc(trace0): return pref == trace || is_prefix(pref, trace0);
+    case dec(trace0): return pref == trace || is_prefix(pref, trace0);
+    case cas_(old, new, trace0): return pref == trace || is_prefix(pref, trace0);
+  }
+}
+
+lemma void is_prefix_refl(trace t)
+  requires true;
+  ensures is_prefix(t, t) == true;
+{
+  switch(t) {
+    case zero:
+    case inc(trace0):
+    case dec(trace0):
+    case cas_(old, new, trace0):
+  }
+}
+
+box_class trace_extension(trace trace) {
+  invariant true;
+
+  action inc();
+    requires true;
+    ensures trace == inc(old_trace);
+
+  action dec();
+    requires true;
+    ensures trace == dec(old_trace);
+
+  action cas(int old, int new);
+    requires true;
+    ensures trace == cas_(old, new, old_trace);
+
+  action read();
+    requires true;
+    ensures trace == old_trace;
+
+  handle_predicate is_prefix_handle(trace prefix) {
+        invariant is_prefix(prefix, trace) == true;
+
+        preserved_by inc() {
+        }
+        preserved_by dec() {
+        }
+        preserved_by cas(old, new) {
+        }
+        preserved_by read() {
+        }
+  }
+}
+
+inductive trace = zero | inc(trace) | dec(trace) | cas_(int, int, trace);
+
+@*/
+
+/*@
+//predicate exists<t>(t x;) = true;
+
+// The atomic space of a cell. Unlike the lock invariant of concurrent_cell, it is only ever open for the one atomic
+// step of an operation.
+predicate_ctor cell_space(struct cell* c, fixpoint(trace, bool) allowed)() =
+  c->x |-> ?v &*& [_]c->id |-> ?id &*& exists(?trace) &*& trace_extension(id, trace) &*& execute_trace(trace) == v &*& allowed(trace) == true;
+
+fixpoint int execute_trace(trace trace) {
+  switch(trace) {
+    case zero: return 0;
+    case inc(trace0): return execute_trace(trace0) + 1;
+    case dec(trace0): return execute_trace(trace0) - 1;
+    case cas_(old, new, trace0): return execute_trace(trace0) == old ? new : execute_trace(trace0);
+  }
+}
+
+predicate cell(struct cell* c, fixpoint(trace, bool) allowed;) =
+  atomic_space(cell_space(c, allowed)) &*& malloc_block_cell(c);
+
+predicate observed(struct cell* c, trace trace) =
+  [_]c->id |-> ?id &*& is_prefix_handle(?h, id, trace);
+@*/
+
+struct cell* cell_create()
+  //@ requires exists<fixpoint(trace, bool)>(?allowed) &*& allowed(zero) == true;
+  //@ ensures result == 0 ? true : cell(result, allowed) &*& observed(result, zero);
+{
+  //@ open exists(_);
+  struct cell* c = malloc(sizeof(struct cell));
+  if(c == 0) return 0;
+  c->x = 0;
+  //@ close exists(zero);
+  //@ create_box boxId = trace_extension(zero) and_handle h = is_prefix_handle(zero);
+  //@ c->id = boxId;
+  //@ leak c->id |-> _;
+  //@ close observed(c, zero);
+  //@ close cell_space(c, allowed)();
+  //@ create_atomic_space(cell_space(c, allowed));
+  return c;
+}
+
+void cell_dispose(struct cell* c)
+  //@ requires cell(c, ?allowed);
+  //@ ensures true;
+{
+  //@ open cell(c, allowed);
+  //@ dispose_atomic_space(cell_space(c, allowed));
+  //@ open cell_space(c, allowed)();
+  //@ leak exists(_) &*& trace_extension(_, _);
+  free(c);
+}
+
+/*@
+typedef lemma void inc_allowed(fixpoint(trace, bool) allowed)(trace t);
+  requires allowed(t) == true;
+  ensures allowed(inc(t)) == true;
+
+predicate_ctor increment_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)() =
+  observed(c, trace0) &*& is_inc_allowed(lem, allowed);
+
+predicate_ctor increment_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)(int value) =
+  observed(c, ?trace) &*& is_prefix(trace0, trace) == true &*& is_inc_allowed(lem, allowed);
+@*/
+
+void increment(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& is_inc_allowed(?lem, allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_inc_allowed(lem, allowed) &*& observed(c, ?trace) &*& is_prefix(trace0, trace) == true;
+{
+  //@ open [f]cell(c, allowed);
+  //@ close increment_pre(c, allowed, lem, trace0)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_fetch_add_ghop(&c->x, 1, cell_space(c, allowed), increment_pre(c, allowed, lem, trace0), increment_post(c, allowed, lem, trace0))() {
+    assert is_atomic_fetch_add_op(?op, _, _, ?P, ?Q);
+    open cell_space(c, allowed)();
+    open exists(?trace);
+    open increment_pre(c, allowed, lem, trace0)();
+    open observed(c, trace0);
+    assert is_prefix_handle(?h, ?id, trace0);
+    op();
+    assert Q(?value);
+    consuming_box_predicate trace_extension(id, trace)
+    consuming_handle_predicate is_prefix_handle(h, trace0)
+    perform_action inc() {
+    }
+    producing_box_predicate trace_extension(inc(trace))
+    producing_handle_predicate is_prefix_handle(inc(trace));
+    lem(trace);
+    close exists(inc(trace));
+    close cell_space(c, allowed)();
+    close observed(c, inc(trace));
+    close increment_post(c, allowed, lem, trace0)(value);
+  }
+  @*/
+  atomic_fetch_add(&c->x, 1);
+  //@ open increment_post(c, allowed, lem, trace0)(_);
+  //@ close [f]cell(c, allowed);
+}
+
+/*@
+typedef lemma void dec_allowed(fixpoint(trace, bool) allowed)(trace t);
+  requires allowed(t) == true;
+  ensures allowed(dec(t)) == true;
+
+predicate_ctor decrement_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)() =
+  observed(c, trace0) &*& is_dec_allowed(lem, allowed);
+
+predicate_ctor decrement_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)(int value) =
+  observed(c, ?trace) &*& is_prefix(trace0, trace) == true &*& is_dec_allowed(lem, allowed);
+@*/
+
+void decrement(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& is_dec_allowed(?lem, allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_dec_allowed(lem, allowed) &*& observed(c, ?trace) &*& is_prefix(trace0, trace) == true;
+{
+  //@ open [f]cell(c, allowed);
+  //@ close decrement_pre(c, allowed, lem, trace0)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_fetch_add_ghop(&c->x, -1, cell_space(c, allowed), decrement_pre(c, allowed, lem, trace0), decrement_post(c, allowed, lem, trace0))() {
+    assert is_atomic_fetch_add_op(?op, _, _, ?P, ?Q);
+    open cell_space(c, allowed)();
+    open exists(?trace);
+    open decrement_pre(c, allowed, lem, trace0)();
+    open observed(c, trace0);
+    assert is_prefix_handle(?h, ?id, trace0);
+    op();
+    assert Q(?value);
+    consuming_box_predicate trace_extension(id, trace)
+    consuming_handle_predicate is_prefix_handle(h, trace0)
+    perform_action dec() {
+    }
+    producing_box_predicate trace_extension(dec(trace))
+    producing_handle_predicate is_prefix_handle(dec(trace));
+    lem(trace);
+    close exists(dec(trace));
+    close cell_space(c, allowed)();
+    close observed(c, dec(trace));
+    close decrement_post(c, allowed, lem, trace0)(value);
+  }
+  @*/
+  atomic_fetch_add(&c->x, -1);
+  //@ open decrement_post(c, allowed, lem, trace0)(_);
+  //@ close [f]cell(c, allowed);
+}
+
+/*@
+predicate_ctor cas_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, int old, int new, trace trace0)() =
+  observed(c, trace0) &*& is_cas_allowed(lem, allowed, old, new);
+
+predicate_ctor cas_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, int old, int new, trace trace0)(int value) =
+  observed(c, ?trace) &*& allowed(trace) == true &*& is_prefix(trace0, trace) == true &*& is_cas_allowed(lem, allowed, old, new);
+@*/
+
+int cas(struct cell* c, int old, int new)
+  //@ requires [?f]cell(c, ?allowed) &*& is_cas_allowed(?lem, allowed, old, new) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_cas_allowed(lem, allowed, old, new) &*& observed(c, ?trace) &*& allowed(trace) == true &*& is_prefix(trace0, trace) == true;
+{
+  // On failure, atomic_compare_exchange_strong stores the value it found in expected; on success that value is old.
+  // Either way, expected ends up holding the value of x before the operation, which is what cas returns.
+  int expected = old;
+  //@ open [f]cell(c, allowed);
+  //@ close cas_pre(c, allowed, lem, old, new, trace0)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_compare_exchange_ghop(&c->x, old, new, cell_space(c, allowed), cas_pre(c, allowed, lem, old, new, trace0), cas_post(c, allowed, lem, old, new, trace0))() {
+    assert is_atomic_compare_exchange_op(?op, _, _, _, ?P, ?Q);
+    open cell_space(c, allowed)();
+    open exists(?trace);
+    open cas_pre(c, allowed, lem, old, new, trace0)();
+    open observed(c, trace0);
+    assert is_prefix_handle(?h, ?id, trace0);
+    op();
+    assert Q(?value);
+    consuming_box_predicate trace_extension(id, trace)
+    consuming_handle_predicate is_prefix_handle(h, trace0)
+    perform_action cas(old, new) {
+    }
+    producing_box_predicate trace_extension(cas_(old, new, trace))
+    producing_handle_predicate is_prefix_handle(cas_(old, new, trace));
+    lem(trace);
+    close exists(cas_(old, new, trace));
+    close cell_space(c, allowed)();
+    close observed(c, cas_(old, new, trace));
+    close cas_post(c, allowed, lem, old, new, trace0)(value);
+  }
+  @*/
+  atomic_compare_exchange_strong(&c->x, &expected, new);
+  //@ open cas_post(c, allowed, lem, old, new, trace0)(_);
+  //@ close [f]cell(c, allowed);
+  return expected;
+}
+
+/*@
+predicate_ctor get_pre(struct cell* c, trace trace0)() =
+  observed(c, trace0);
+
+predicate_ctor get_post(struct cell* c, fixpoint(trace, bool) allowed, trace trace0)(int value) =
+  observed(c, ?trace) &*& allowed(trace) == true &*& execute_trace(trace) == value &*& is_prefix(trace0, trace) == true;
+@*/
+
+int get(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& observed(c, ?trace) &*& allowed(trace) == true &*& execute_trace(trace) == result &*& is_prefix(trace0, trace) == true;
+{
+  //@ open [f]cell(c, allowed);
+  //@ close get_pre(c, trace0)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_load_ghop(&c->x, cell_space(c, allowed), get_pre(c, trace0), get_post(c, allowed, trace0))() {
+    assert is_atomic_load_op(?op, _, ?P, ?Q);
+    open cell_space(c, allowed)();
+    assert exists(?trace);
+    open get_pre(c, trace0)();
+    open observed(c, trace0);
+    assert is_prefix_handle(?h, ?id, trace0);
+    op();
+    assert Q(?value);
+    consuming_box_predicate trace_extension(id, trace)
+    consuming_handle_predicate is_prefix_handle(h, trace0)
+    perform_action read() {
+      is_prefix_refl(trace);
+    }
+    producing_box_predicate trace_extension(trace)
+    producing_handle_predicate is_prefix_handle(trace);
+    close cell_space(c, allowed)();
+    close observed(c, trace);
+    close get_post(c, allowed, trace0)(value);
+  }
+  @*/
+  int res = atomic_load(&c->x);
+  //@ open get_post(c, allowed, trace0)(res);
+  //@ close [f]cell(c, allowed);
+  return res;
+}
+
+/*@
+predicate observe_pre() = true;
+
+predicate_ctor observe_post(struct cell* c)(int value) =
+  observed(c, _);
+@*/
+
+/*
+Gives the calling thread a prefix handle of its own, so that several threads can operate on the same cell.
+*/
+void observe(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed);
+  //@ ensures [f]cell(c, allowed) &*& observed(c, _);
+{
+  //@ open [f]cell(c, allowed);
+  //@ close observe_pre();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_load_ghop(&c->x, cell_space(c, allowed), observe_pre, observe_post(c))() {
+    assert is_atomic_load_op(?op, _, ?P, ?Q);
+    open cell_space(c, allowed)();
+    assert exists(?trace) &*& [_]c->id |-> ?id;
+    open observe_pre();
+    op();
+    assert Q(?value);
+    consuming_box_predicate trace_extension(id, trace)
+    perform_action read() {
+      is_prefix_refl(trace);
+    }
+    producing_box_predicate trace_extension(trace)
+    producing_fresh_handle_predicate is_prefix_handle(trace);
+    close cell_space(c, allowed)();
+    close observed(c, trace);
+    close observe_post(c)(value);
+  }
+  @*/
+  atomic_load(&c->x);
+  //@ open observe_post(c)(_);
+  //@ close [f]cell(c, allowed);
+}
+
+/*@
+fixpoint bool incr_only(trace trace) {
+  switch(trace) {
+    case zero: return true;
+    case inc(trace0): return incr_only(trace0);
+    case dec(trace0): return false;
+    case cas_(old, new, trace0): return old <= new && incr_only(trace0);
+  }
+}
+@*/
+
+/*@
+lemma void prefix_smaller(trace t1, trace t2)
+  requires incr_only(t1) == true &*& incr_only(t2) == true &*& is_prefix(t1, t2) == true;
+  ensures execute_trace(t1) <= execute_trace(t2);
+{
+  switch(t2) {
+    case zero:
+    case inc(t0): if(t1 != t2) prefix_smaller(t1, t0);
+    case dec(t0):
+    case cas_(old, new, t0): if(t1 != t2) prefix_smaller(t1, t0);
+  }
+}
+@*/
+
+void only_allow_incrementing(struct cell* c)
+  //@ requires [?f]cell(c, incr_only) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, incr_only);
+{
+  int x1 = get(c);
+  //@ assert observed(c, ?trace1);
+  int x2 = get(c);
+  //@ assert observed(c, ?trace2);
+  //@ prefix_smaller(trace1, trace2);
+  assert(x1 <= x2);
+  //@ leak observed(c, _);
+}
+
+// The mutex version of the benchmark's operation: the lock acquisition of concurrent_cell's increment, around the same
+// increment of x.
+
+struct locked_cell {
+  int x;
+  struct mutex* mutex;
+};
+
+/*@
+predicate_ctor locked_cell_invariant(struct locked_cell* c)() =
+  c->x |-> _;
+
+predicate locked_cell(struct locked_cell* c;) =
+  c->mutex |-> ?mutex &*& mutex(mutex, locked_cell_invariant(c)) &*& malloc_block_locked_cell(c);
+@*/
+
+struct locked_cell* locked_cell_create()
+  //@ requires true;
+  //@ ensures locked_cell(result);
+{
+  struct locked_cell* c = malloc(sizeof(struct locked_cell));
+  if(c == 0) abort();
+  c->x = 0;
+  //@ close locked_cell_invariant(c)();
+  //@ close create_mutex_ghost_arg(locked_cell_invariant(c));
+  c->mutex = create_mutex();
+  return c;
+}
+
+void locked_cell_increment(struct locked_cell* c)
+  //@ requires [?f]locked_cell(c);
+  //@ ensures [f]locked_cell(c);
+{
+  mutex_acquire(c->mutex);
+  //@ open locked_cell_invariant(c)();
+  c->x++;
+  //@ close locked_cell_invariant(c)();
+  mutex_release(c->mutex);
+}
+
+int locked_cell_dispose(struct locked_cell* c)
+  //@ requires locked_cell(c);
+  //@ ensures true;
+{
+  mutex_dispose(c->mutex);
+  //@ open locked_cell_invariant(c)();
+  int x = c->x;
+  free(c);
+  return x;
+}
+
+#define MAX_THREADS 64
+#define TOTAL_OPS 2097152
+
+struct bench_thread {
+  struct cell* cell;
+  struct locked_cell* locked_cell;
+  int count;
+  struct thread* thread;
+  //@ real frac;
+};
+
+/*@
+fixpoint bool any_trace(trace trace) { return true; }
+
+lemma void any_trace_inc_allowed(trace t) : inc_allowed(any_trace)
+  requires any_trace(t) == true;
+  ensures any_trace(inc(t)) == true;
+{
+}
+
+predicate_family_instance thread_run_pre(atomic_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->cell |-> ?c &*& ((struct bench_thread *)data)->count |-> ?count &*& 0 <= count &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]cell(c, any_trace) &*& observed(c, _);
+predicate_family_instance thread_run_post(atomic_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->cell |-> ?c &*& ((struct bench_thread *)data)->count |-> _ &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]cell(c, any_trace);
+
+predicate_family_instance thread_run_pre(locked_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->locked_cell |-> ?c &*& ((struct bench_thread *)data)->count |-> ?count &*& 0 <= count &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]locked_cell(c);
+predicate_family_instance thread_run_post(locked_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->locked_cell |-> ?c &*& ((struct bench_thread *)data)->count |-> _ &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]locked_cell(c);
+@*/
+
+void atomic_bench_run(void* data) //@ : thread_run_joinable
+  //@ requires thread_run_pre(atomic_bench_run)(data, ?info) &*& lockset(currentThread, nil);
+  //@ ensures thread_run_post(atomic_bench_run)(data, info) &*& lockset(currentThread, nil);
+{
+  //@ open thread_run_pre(atomic_bench_run)(data, info);
+  struct bench_thread* t = data;
+  struct cell* c = t->cell;
+  //@ produce_lemma_function_pointer_chunk(any_trace_inc_allowed) : inc_allowed(any_trace)(t0) { call(); };
+  for (int i = 0; i < t->count; i++)
+    //@ invariant [?f]cell(c, any_trace) &*& observed(c, _) &*& is_inc_allowed(any_trace_inc_allowed, any_trace) &*& t->count |-> ?count;
+  {
+    increment(c);
+  }
+  //@ leak observed(c, _) &*& is_inc_allowed(_, _);
+  //@ close thread_run_post(atomic_bench_run)(data, info);
+}
+
+void locked_bench_run(void* data) //@ : thread_run_joinable
+  //@ requires thread_run_pre(locked_bench_run)(data, ?info) &*& lockset(currentThread, nil);
+  //@ ensures thread_run_post(locked_bench_run)(data, info) &*& lockset(currentThread, nil);
+{
+  //@ open thread_run_pre(locked_bench_run)(data, info);
+  struct bench_thread* t = data;
+  struct locked_cell* c = t->locked_cell;
+  for (int i = 0; i < t->count; i++)
+    //@ invariant [?f]locked_cell(c) &*& t->count |-> ?count;
+  {
+    locked_cell_increment(c);
+  }
+  //@ close thread_run_post(locked_bench_run)(data, info);
+}
+
+/*
+Runs TOTAL_OPS increments, split evenly over threadCount threads, on a fresh cell of each kind, and prints the
+average time per increment of each. Returns whether both cells counted every increment.
+*/
+bool bench(struct bench_thread* threads, int threadCount)
+  //@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& threads[..MAX_THREADS] |-> _;
+  //@ ensures threads[..MAX_THREADS] |-> _;
+{
+  int count = TOTAL_OPS / threadCount;
+  struct locked_cell* locked = locked_cell_create();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+    //@ invariant [?r]locked_cell(locked) &*& 0 <= i;
+  {
+    threads[i].locked_cell = locked;
+    threads[i].count = count;
+    //@ threads[i].frac = r / 2;
+    //@ close thread_run_pre(locked_bench_run)(&threads[i], unit);
+    threads[i].thread = thread_start_joinable(locked_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+    //@ invariant 0 <= i;
+  {
+    thread_join(threads[i].thread);
+    //@ open thread_run_post(locked_bench_run)(&threads[i], unit);
+  }
+  long long lockedNanos = clock_now_nanos() - start;
+  int lockedTotal = locked_cell_dispose(locked);
+
+  //@ close exists<fixpoint(trace, bool)>(any_trace);
+  struct cell* c = cell_create();
+  if (c == 0) abort();
+  start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+    //@ invariant [?r]cell(c, any_trace) &*& 0 <= i;
+  {
+    threads[i].cell = c;
+    threads[i].count = count;
+    observe(c);
+    //@ threads[i].frac = r / 2;
+    //@ close thread_run_pre(atomic_bench_run)(&threads[i], unit);
+    threads[i].thread = thread_start_joinable(atomic_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+    //@ invariant 0 <= i;
+  {
+    thread_join(threads[i].thread);
+    //@ open thread_run_post(atomic_bench_run)(&threads[i], unit);
+  }
+  long long atomicNanos = clock_now_nanos() - start;
+  int atomicTotal = get(c);
+  //@ leak observed(c, _);
+  cell_dispose(c);
+
+  int ops = count * threadCount;
+  printf("%2d threads: mutex %4d ns per increment, atomic %4d ns per increment\n",
+    threadCount, (int)(lockedNanos / ops), (int)(atomicNanos / ops));
+  return lockedTotal == ops && atomicTotal == ops;
+}
+
+int main() //@ : main
+  //@ requires true;
+  //@ ensures true;
+{
+  struct bench_thread* threads = malloc(MAX_THREADS * sizeof(struct bench_thread));
+  if (threads == 0) abort();
+  bool ok = true;
+  for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+    //@ invariant threads[..MAX_THREADS] |-> _ &*& 1 <= threadCount;
+  {
+    ok = bench(threads, threadCount) && ok;
+  }
+  free(threads);
+  if (!ok) {
+    printf("lost increments\n");
+    return 1;
+  }
+  return 0;
+}
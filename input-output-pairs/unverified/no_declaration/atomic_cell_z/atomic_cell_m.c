@@ -0,0 +1,378 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// The cell of concurrent_cell, without its mutex: every operation is a single C11 atomic operation on x, and the
+// trace_extension box records it in the same atomic step.
+
+struct cell {
+  int x;
+  //@ box id;
+};
+
+/*@
+
+fixpoint bool is_prefix(trace pref, trace trace) {
+  switch(trace) {
+    case zero: return pref == zero;
+    case inc(trace0): return pref == trace || is_prefix(pref, trace0);
+    case dec(trace0): return pref == trace || is_prefix(pref, trace0);
+    case cas_(old, new, trace0): return pref == trace || is_prefix(pref, trace0);
+  }
+}
+
+box_class trace_extension(trace trace) {
+  invariant true;
+
+  action inc();
+    requires true;
+    ensures trace == inc(old_trace);
+
+  action dec();
+    requires true;
+    ensures trace == dec(old_trace);
+
+  action cas(int old, int new);
+    requires true;
+    ensures trace == cas_(old, new, old_trace);
+
+  action read();
+    requires true;
+    ensures trace == old_trace;
+
+  handle_predicate is_prefix_handle(trace prefix) {
+        invariant is_prefix(prefix, trace) == true;
+
+        preserved_by inc() {
+        }
+        preserved_by dec() {
+        }
+        preserved_by cas(old, new) {
+        }
+        preserved_by read() {
+        }
+  }
+}
+
+inductive trace = zero | inc(trace) | dec(trace) | cas_(int, int, trace);
+@*/
+
+/*@
+//predicate exists<t>(t x;) = true;
+
+// The atomic space of a cell. Unlike the lock invariant of concurrent_cell, it is only ever open for the one atomic
+// step of an operation.
+predicate_ctor cell_space(struct cell* c, fixpoint(trace, bool) allowed)() =
+  c->x |-> ?v &*& [_]c->id |-> ?id &*& exists(?trace) &*& trace_extension(id, trace) &*& execute_trace(trace) == v &*& allowed(trace) == true;
+
+fixpoint int execute_trace(trace trace) {
+  switch(trace) {
+    case zero: return 0;
+    case inc(trace0): return execute_trace(trace0) + 1;
+    case dec(trace0): return execute_trace(trace0) - 1;
+    case cas_(old, new, trace0): return execute_trace(trace0) == old ? new : execute_trace(trace0);
+  }
+}
+
+predicate cell(struct cell* c, fixpoint(trace, bool) allowed;) =
+  atomic_space(cell_space(c, allowed)) &*& malloc_block_cell(c);
+
+predicate observed(struct cell* c, trace trace) =
+  [_]c->id |-> ?id &*& is_prefix_handle(?h, id, trace);
+@*/
+
+struct cell* cell_create()
+  //@ requires exists<fixpoint(trace, bool)>(?allowed) &*& allowed(zero) == true;
+  //@ ensures result == 0 ? true : cell(result, allowed) &*& observed(result, zero);
+{
+  struct cell* c = malloc(sizeof(struct cell));
+  if(c == 0) return 0;
+  c->x = 0;
+  return c;
+}
+
+void cell_dispose(struct cell* c)
+  //@ requires cell(c, ?allowed);
+  //@ ensures true;
+{
+  free(c);
+}
+
+/*@
+typedef lemma void inc_allowed(fixpoint(trace, bool) allowed)(trace t);
+  requires allowed(t) == true;
+  ensures allowed(inc(t)) == true;
+
+predicate_ctor increment_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)() =
+  observed(c, trace0) &*& is_inc_allowed(lem, allowed);
+
+predicate_ctor increment_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)(int value) =
+  observed(c, ?trace) &*& is_prefix(trace0, trace) == true &*& is_inc_allowed(lem, allowed);
+@*/
+
+void increment(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& is_inc_allowed(?lem, allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_inc_allowed(lem, allowed) &*& observed(c, ?trace) &*& is_prefix(trace0, trace) == true;
+{
+  atomic_fetch_add(&c->x, 1);
+}
+
+/*@
+typedef lemma void dec_allowed(fixpoint(trace, bool) allowed)(trace t);
+  requires allowed(t) == true;
+  ensures allowed(dec(t)) == true;
+
+predicate_ctor decrement_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)() =
+  observed(c, trace0) &*& is_dec_allowed(lem, allowed);
+
+predicate_ctor decrement_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, trace trace0)(int value) =
+  observed(c, ?trace) &*& is_prefix(trace0, trace) == true &*& is_dec_allowed(lem, allowed);
+@*/
+
+void decrement(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& is_dec_allowed(?lem, allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_dec_allowed(lem, allowed) &*& observed(c, ?trace) &*& is_prefix(trace0, trace) == true;
+{
+  atomic_fetch_add(&c->x, -1);
+}
+
+/*@
+predicate_ctor cas_pre(struct cell* c, fixpoint(trace, bool) allowed, void* lem, int old, int new, trace trace0)() =
+  observed(c, trace0) &*& is_cas_allowed(lem, allowed, old, new);
+
+predicate_ctor cas_post(struct cell* c, fixpoint(trace, bool) allowed, void* lem, int old, int new, trace trace0)(int value) =
+  observed(c, ?trace) &*& allowed(trace) == true &*& is_prefix(trace0, trace) == true &*& is_cas_allowed(lem, allowed, old, new);
+@*/
+
+int cas(struct cell* c, int old, int new)
+  //@ requires [?f]cell(c, ?allowed) &*& is_cas_allowed(?lem, allowed, old, new) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& is_cas_allowed(lem, allowed, old, new) &*& observed(c, ?trace) &*& allowed(trace) == true &*& is_prefix(trace0, trace) == true;
+{
+  // On failure, atomic_compare_exchange_strong stores the value it found in expected; on success that value is old.
+  // Either way, expected ends up holding the value of x before the operation, which is what cas returns.
+  int expected = old;
+  atomic_compare_exchange_strong(&c->x, &expected, new);
+  return expected;
+}
+
+/*@
+predicate_ctor get_pre(struct cell* c, trace trace0)() =
+  observed(c, trace0);
+
+predicate_ctor get_post(struct cell* c, fixpoint(trace, bool) allowed, trace trace0)(int value) =
+  observed(c, ?trace) &*& allowed(trace) == true &*& execute_trace(trace) == value &*& is_prefix(trace0, trace) == true;
+@*/
+
+int get(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, allowed) &*& observed(c, ?trace) &*& allowed(trace) == true &*& execute_trace(trace) == result &*& is_prefix(trace0, trace) == true;
+{
+  int res = atomic_load(&c->x);
+  return res;
+}
+
+/*@
+predicate observe_pre() = true;
+
+predicate_ctor observe_post(struct cell* c)(int value) =
+  observed(c, _);
+@*/
+
+/*
+Gives the calling thread a prefix handle of its own, so that several threads can operate on the same cell.
+*/
+void observe(struct cell* c)
+  //@ requires [?f]cell(c, ?allowed);
+  //@ ensures [f]cell(c, allowed) &*& observed(c, _);
+{
+  atomic_load(&c->x);
+}
+
+/*@
+fixpoint bool incr_only(trace trace) {
+  switch(trace) {
+    case zero: return true;
+    case inc(trace0): return incr_only(trace0);
+    case dec(trace0): return false;
+    case cas_(old, new, trace0): return old <= new && incr_only(trace0);
+  }
+}
+@*/
+
+void only_allow_incrementing(struct cell* c)
+  //@ requires [?f]cell(c, incr_only) &*& observed(c, ?trace0);
+  //@ ensures [f]cell(c, incr_only);
+{
+  int x1 = get(c);
+  int x2 = get(c);
+  assert(x1 <= x2);
+}
+
+// The mutex version of the benchmark's operation: the lock acquisition of concurrent_cell's increment, around the same
+// increment of x.
+
+struct locked_cell {
+  int x;
+  struct mutex* mutex;
+};
+
+/*@
+predicate_ctor locked_cell_invariant(struct locked_cell* c)() =
+  c->x |-> _;
+
+predicate locked_cell(struct locked_cell* c;) =
+  c->mutex |-> ?mutex &*& mutex(mutex, locked_cell_invariant(c)) &*& malloc_block_locked_cell(c);
+@*/
+
+struct locked_cell* locked_cell_create()
+  //@ requires true;
+  //@ ensures locked_cell(result);
+{
+  struct locked_cell* c = malloc(sizeof(struct locked_cell));
+  if(c == 0) abort();
+  c->x = 0;
+  c->mutex = create_mutex();
+  return c;
+}
+
+void locked_cell_increment(struct locked_cell* c)
+  //@ requires [?f]locked_cell(c);
+  //@ ensures [f]locked_cell(c);
+{
+  mutex_acquire(c->mutex);
+  c->x++;
+  mutex_release(c->mutex);
+}
+
+int locked_cell_dispose(struct locked_cell* c)
+  //@ requires locked_cell(c);
+  //@ ensures true;
+{
+  mutex_dispose(c->mutex);
+  int x = c->x;
+  free(c);
+  return x;
+}
+
+#define MAX_THREADS 64
+#define TOTAL_OPS 2097152
+
+struct bench_thread {
+  struct cell* cell;
+  struct locked_cell* locked_cell;
+  int count;
+  struct thread* thread;
+  //@ real frac;
+};
+
+/*@
+fixpoint bool any_trace(trace trace) { return true; }
+
+predicate_family_instance thread_run_pre(atomic_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->cell |-> ?c &*& ((struct bench_thread *)data)->count |-> ?count &*& 0 <= count &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]cell(c, any_trace) &*& observed(c, _);
+predicate_family_instance thread_run_post(atomic_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->cell |-> ?c &*& ((struct bench_thread *)data)->count |-> _ &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]cell(c, any_trace);
+
+predicate_family_instance thread_run_pre(locked_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->locked_cell |-> ?c &*& ((struct bench_thread *)data)->count |-> ?count &*& 0 <= count &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]locked_cell(c);
+predicate_family_instance thread_run_post(locked_bench_run)(void* data, any info) =
+  [1/2]((struct bench_thread *)data)->locked_cell |-> ?c &*& ((struct bench_thread *)data)->count |-> _ &*&
+  [1/2]((struct bench_thread *)data)->frac |-> ?f &*& [f]locked_cell(c);
+@*/
+
+void atomic_bench_run(void* data) //@ : thread_run_joinable
+  //@ requires thread_run_pre(atomic_bench_run)(data, ?info) &*& lockset(currentThread, nil);
+  //@ ensures thread_run_post(atomic_bench_run)(data, info) &*& lockset(currentThread, nil);
+{
+  struct bench_thread* t = data;
+  struct cell* c = t->cell;
+  for (int i = 0; i < t->count; i++)
+  {
+    increment(c);
+  }
+}
+
+void locked_bench_run(void* data) //@ : thread_run_joinable
+  //@ requires thread_run_pre(locked_bench_run)(data, ?info) &*& lockset(currentThread, nil);
+  //@ ensures thread_run_post(locked_bench_run)(data, info) &*& lockset(currentThread, nil);
+{
+  struct bench_thread* t = data;
+  struct locked_cell* c = t->locked_cell;
+  for (int i = 0; i < t->count; i++)
+  {
+    locked_cell_increment(c);
+  }
+}
+
+/*
+Runs TOTAL_OPS increments, split evenly over threadCount threads, on a fresh cell of each kind, and prints the
+average time per increment of each. Returns whether both cells counted every increment.
+*/
+bool bench(struct bench_thread* threads, int threadCount)
+  //@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& threads[..MAX_THREADS] |-> _;
+  //@ ensures threads[..MAX_THREADS] |-> _;
+{
+  int count = TOTAL_OPS / threadCount;
+  struct locked_cell* locked = locked_cell_create();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].locked_cell = locked;
+    threads[i].count = count;
+    threads[i].thread = thread_start_joinable(locked_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long lockedNanos = clock_now_nanos() - start;
+  int lockedTotal = locked_cell_dispose(locked);
+
+  struct cell* c = cell_create();
+  if (c == 0) abort();
+  start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].cell = c;
+    threads[i].count = count;
+    observe(c);
+    threads[i].thread = thread_start_joinable(atomic_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long atomicNanos = clock_now_nanos() - start;
+  int atomicTotal = get(c);
+  cell_dispose(c);
+
+  int ops = count * threadCount;
+  printf("%2d threads: mutex %4d ns per increment, atomic %4d ns per increment\n",
+    threadCount, (int)(lockedNanos / ops), (int)(atomicNanos / ops));
+  return lockedTotal == ops && atomicTotal == ops;
+}
+
+int main() //@ : main
+  //@ requires true;
+  //@ ensures true;
+{
+  struct bench_thread* threads = malloc(MAX_THREADS * sizeof(struct bench_thread));
+  if (threads == 0) abort();
+  bool ok = true;
+  for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+  {
+    ok = bench(threads, threadCount) && ok;
+  }
+  free(threads);
+  if (!ok) {
+    printf("lost increments\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,286 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// The cell of concurrent_cell, without its mutex: every operation is a single C11 atomic operation on x, and the
+// trace_extension box records it in the same atomic step.
+
+struct cell {
+  int x;
+};
+
+/**
+ * Description:
+ * The cell_create function allocates a new cell with value 0. It creates the trace_extension box that records the operations on the cell, and an atomic space that owns the cell's value.
+ * If memory allocation fails, it returns a null pointer.
+ *
+ * @return A pointer to the new cell, or 0 if memory allocation fails.
+ */
+struct cell* cell_create()
+{
+  struct cell* c = malloc(sizeof(struct cell));
+  if(c == 0) return 0;
+  c->x = 0;
+  return c;
+}
+
+/**
+ * Description:
+ * The cell_dispose function frees a cell. No other thread may still use the cell.
+ *
+ * @param c A pointer to the cell.
+ */
+void cell_dispose(struct cell* c)
+{
+  free(c);
+}
+
+/**
+ * Description:
+ * The increment function atomically increments the value of a cell with a single atomic_fetch_add. It takes no lock.
+ *
+ * @param c A pointer to the cell. The pointer must not be NULL.
+ */
+void increment(struct cell* c)
+{
+  atomic_fetch_add(&c->x, 1);
+}
+
+/**
+ * Description:
+ * The decrement function atomically decrements the value of a cell by adding -1 with a single atomic_fetch_add. It takes no lock.
+ *
+ * @param c A pointer to the cell. The pointer must not be NULL.
+ */
+void decrement(struct cell* c)
+{
+  atomic_fetch_add(&c->x, -1);
+}
+
+/**
+ * Description:
+ * The cas function atomically replaces the value of a cell with new if the value equals old, using atomic_compare_exchange_strong.
+ *
+ * @param c A pointer to the cell. The pointer must not be NULL.
+ * @param old The value the cell must hold for the exchange to take place.
+ * @param new The value to store.
+ *
+ * @return The value of the cell before the operation.
+ */
+int cas(struct cell* c, int old, int new)
+{
+  // On failure, atomic_compare_exchange_strong stores the value it found in expected; on success that value is old.
+  // Either way, expected ends up holding the value of x before the operation, which is what cas returns.
+  int expected = old;
+  atomic_compare_exchange_strong(&c->x, &expected, new);
+  return expected;
+}
+
+/**
+ * Description:
+ * The get function atomically loads the value of a cell.
+ *
+ * @param c A pointer to the cell. The pointer must not be NULL.
+ *
+ * @return The current value of the cell.
+ */
+int get(struct cell* c)
+{
+  int res = atomic_load(&c->x);
+  return res;
+}
+
+/**
+ * Description:
+ * The observe function atomically loads the value of a cell and discards it. It lets another thread start operating on the same cell.
+ *
+ * @param c A pointer to the cell. The pointer must not be NULL.
+ */
+void observe(struct cell* c)
+{
+  atomic_load(&c->x);
+}
+
+/**
+ * Description:
+ * The only_allow_incrementing function reads a cell twice and asserts that the second value is not smaller than the first. This holds for a cell on which only increments and increasing compare-and-swaps are allowed.
+ *
+ * @param c A pointer to the cell.
+ */
+void only_allow_incrementing(struct cell* c)
+{
+  int x1 = get(c);
+  int x2 = get(c);
+  assert(x1 <= x2);
+}
+
+// The mutex version of the benchmark's operation: the lock acquisition of concurrent_cell's increment, around the same
+// increment of x.
+
+struct locked_cell {
+  int x;
+  struct mutex* mutex;
+};
+
+/**
+ * Description:
+ * The locked_cell_create function allocates a mutex-protected cell with value 0 for the benchmark's baseline. If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the new locked cell.
+ */
+struct locked_cell* locked_cell_create()
+{
+  struct locked_cell* c = malloc(sizeof(struct locked_cell));
+  if(c == 0) abort();
+  c->x = 0;
+  c->mutex = create_mutex();
+  return c;
+}
+
+/**
+ * Description:
+ * The locked_cell_increment function increments the value of a locked cell while holding its mutex, the way the mutex version of the cell does.
+ *
+ * @param c A pointer to the locked cell.
+ */
+void locked_cell_increment(struct locked_cell* c)
+{
+  mutex_acquire(c->mutex);
+  c->x++;
+  mutex_release(c->mutex);
+}
+
+/**
+ * Description:
+ * The locked_cell_dispose function disposes of the mutex of a locked cell and frees the cell.
+ *
+ * @param c A pointer to the locked cell.
+ *
+ * @return The final value of the cell.
+ */
+int locked_cell_dispose(struct locked_cell* c)
+{
+  mutex_dispose(c->mutex);
+  int x = c->x;
+  free(c);
+  return x;
+}
+
+#define MAX_THREADS 64
+#define TOTAL_OPS 2097152
+
+struct bench_thread {
+  struct cell* cell;
+  struct locked_cell* locked_cell;
+  int count;
+  struct thread* thread;
+};
+
+/**
+ * Description:
+ * The atomic_bench_run function is the body of an atomic benchmark thread. It increments the thread's cell count times.
+ *
+ * @param data A pointer to the bench_thread.
+ */
+void atomic_bench_run(void* data)
+{
+  struct bench_thread* t = data;
+  struct cell* c = t->cell;
+  for (int i = 0; i < t->count; i++)
+  {
+    increment(c);
+  }
+}
+
+/**
+ * Description:
+ * The locked_bench_run function is the body of a mutex benchmark thread. It increments the thread's locked cell count times.
+ *
+ * @param data A pointer to the bench_thread.
+ */
+void locked_bench_run(void* data)
+{
+  struct bench_thread* t = data;
+  struct locked_cell* c = t->locked_cell;
+  for (int i = 0; i < t->count; i++)
+  {
+    locked_cell_increment(c);
+  }
+}
+
+/**
+ * Description:
+ * The bench function runs TOTAL_OPS increments, split evenly over threadCount threads, first on a fresh locked cell and then on a fresh atomic cell. It prints the average time per increment for each.
+ *
+ * @param threads An array of MAX_THREADS bench_thread structures.
+ * @param threadCount The number of threads, between 1 and MAX_THREADS.
+ *
+ * @return True if both cells counted every increment, false otherwise.
+ */
+bool bench(struct bench_thread* threads, int threadCount)
+{
+  int count = TOTAL_OPS / threadCount;
+  struct locked_cell* locked = locked_cell_create();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].locked_cell = locked;
+    threads[i].count = count;
+    threads[i].thread = thread_start_joinable(locked_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long lockedNanos = clock_now_nanos() - start;
+  int lockedTotal = locked_cell_dispose(locked);
+
+  struct cell* c = cell_create();
+  if (c == 0) abort();
+  start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].cell = c;
+    threads[i].count = count;
+    observe(c);
+    threads[i].thread = thread_start_joinable(atomic_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long atomicNanos = clock_now_nanos() - start;
+  int atomicTotal = get(c);
+  cell_dispose(c);
+
+  int ops = count * threadCount;
+  printf("%2d threads: mutex %4d ns per increment, atomic %4d ns per increment\n",
+    threadCount, (int)(lockedNanos / ops), (int)(atomicNanos / ops));
+  return lockedTotal == ops && atomicTotal == ops;
+}
+
+/**
+ * Description:
+ * The main function runs the benchmark with 1, 2, 4, and so on up to MAX_THREADS threads.
+ *
+ * @return 0 if no increment was lost, 1 otherwise.
+ */
+int main()
+{
+  struct bench_thread* threads = malloc(MAX_THREADS * sizeof(struct bench_thread));
+  if (threads == 0) abort();
+  bool ok = true;
+  for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+  {
+    ok = bench(threads, threadCount) && ok;
+  }
+  free(threads);
+  if (!ok) {
+    printf("lost increments\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "stdio.h"
+#include "malloc.h"
+#include "stdlib.h"
+#include "mman.h"
+
+#define STREAM_BUFFER_SIZE (128 * 1024)
+#define MAP_WRITE_CHUNK (1024 * 1024)
+
+/*
+Copies the rest of the given file to stdout through a buffer of the given size.
+Returns 0 on success and -1 if a write came up short.
+*/
+int stream_copy(FILE* fp, char* buffer, int size)
+//@ requires [?f]file(fp) &*& buffer[..size] |-> _ &*& 0 < size;
+//@ ensures [f]file(fp) &*& buffer[..size] |-> _ &*& result == 0 || result == -1;
+{
+  int nb_read = fread(buffer, 1, (size_t)size, fp);
+  while(0 < nb_read)
+  //@ invariant [f]file(fp) &*& buffer[..nb_read] |-> ?_ &*& 0 <= nb_read &*& nb_read <= size &*& buffer[nb_read..size] |-> _;
+  {
+    int nb_written = fwrite(buffer, 1, (size_t)nb_read, stdout);
+    //@ chars_chars__join(buffer);
+    if(nb_written != nb_read) { return -1; }
+    nb_read = fread(buffer, 1, (size_t)size, fp);
+  }
+  //@ chars_chars__join(buffer);
+  return 0;
+}
+
+/*
+Copies a regular file to stdout through a read-only mapping of the whole file.
+Returns 1 without writing anything if the file cannot be mapped (e.g. a pipe or an empty file),
+otherwise 0 on success and -1 if a write came up short.
+*/
+int map_copy(FILE* fp)
+//@ requires [?f]file(fp);
+//@ ensures [f]file(fp) &*& result == 0 || result == 1 || result == -1;
+{
+  int fd = 0; long size = 0; char* data = 0; size_t offset = 0; int status = 0;
+  if(fseek(fp, 0, 2) != 0) { return 1; }
+  size = ftell(fp);
+  rewind(fp);
+  fd = fileno(fp);
+  if(size <= 0 || fd < 0) { return 1; }
+  data = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(data == MAP_FAILED) { return 1; }
+  //@ assert [1/2]chars(data, size, ?cs);
+  //@ close [1/2]chars(data, 0, nil);
+  while(offset < (size_t)size && status == 0)
+  //@ invariant [f]file(fp) &*& [1/2]chars(data, offset, _) &*& [1/2]chars(data + offset, size - offset, _) &*& offset <= size;
+  {
+    size_t chunk = (size_t)size - offset < MAP_WRITE_CHUNK ? (size_t)size - offset : MAP_WRITE_CHUNK;
+    //@ chars_split(data + offset, chunk);
+    int nb_written = fwrite(data + offset, 1, chunk, stdout);
+    if(nb_written != (int)chunk) { status = -1; }
+    //@ chars_join(data);
+    offset = offset + chunk;
+  }
+  //@ chars_join(data);
+  munmap(data, (size_t)size);
+  return status;
+}
+
+/*
+Prints the contents of given file to stdout.
+Regular files are mapped and written in large chunks; anything else is streamed through a large buffer.
+Unlike cat, the output is byte-for-byte the input: no newline is added per chunk.
+*/
+int main(int argc, char** argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+  FILE* fp = 0; char* buffer = 0; int status = 0;
+  if(argc < 2) { fputs("Enter a file name.", stderr); return -1; }
+  //@ open [_]argv(argv, argc, _);
+  //@ open [_]argv(argv + 1, argc - 1, _);
+  fp = fopen(argv[1], "r");
+  if(fp == 0) { abort(); }
+  status = map_copy(fp);
+  if(status == 1) {
+    buffer = malloc(STREAM_BUFFER_SIZE);
+    if(buffer == 0) { abort(); }
+    status = stream_copy(fp, buffer, STREAM_BUFFER_SIZE);
+    free((void *)buffer);
+  }
+  fclose(fp);
+  return status;
+}
@@ -0,0 +1,86 @@
+#include "stdio.h"
+#include "malloc.h"
+#include "stdlib.h"
+#include "mman.h"
+
+#define STREAM_BUFFER_SIZE (128 * 1024)
+#define MAP_WRITE_CHUNK (1024 * 1024)
+
+/***
+ * Description:
+The `stream_copy` function copies the rest of the given file to stdout through a caller-provided buffer, using one `fread` and one `fwrite` per buffer-full.
+
+@param fp - the file to read from.
+@param buffer - the buffer used to hold each chunk.
+@param size - the positive size of the buffer.
+
+It returns 0 when the whole file was copied and -1 if a write came up short.
+*/
+int stream_copy(FILE* fp, char* buffer, int size)
+{
+  int nb_read = fread(buffer, 1, (size_t)size, fp);
+  while(0 < nb_read)
+  {
+    int nb_written = fwrite(buffer, 1, (size_t)nb_read, stdout);
+    if(nb_written != nb_read) { return -1; }
+    nb_read = fread(buffer, 1, (size_t)size, fp);
+  }
+  return 0;
+}
+
+/***
+ * Description:
+The `map_copy` function copies a regular file to stdout through a read-only mapping of the whole file.
+The mapping is written in chunks of at most MAP_WRITE_CHUNK bytes and unmapped afterwards.
+
+@param fp - the file to copy, positioned at its start.
+
+It returns 1 without writing anything if the file cannot be mapped (e.g. a pipe or an empty file),
+otherwise 0 on success and -1 if a write came up short.
+*/
+int map_copy(FILE* fp)
+{
+  int fd = 0; long size = 0; char* data = 0; size_t offset = 0; int status = 0;
+  if(fseek(fp, 0, 2) != 0) { return 1; }
+  size = ftell(fp);
+  rewind(fp);
+  fd = fileno(fp);
+  if(size <= 0 || fd < 0) { return 1; }
+  data = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(data == MAP_FAILED) { return 1; }
+  while(offset < (size_t)size && status == 0)
+  {
+    size_t chunk = (size_t)size - offset < MAP_WRITE_CHUNK ? (size_t)size - offset : MAP_WRITE_CHUNK;
+    int nb_written = fwrite(data + offset, 1, chunk, stdout);
+    if(nb_written != (int)chunk) { status = -1; }
+    offset = offset + chunk;
+  }
+  munmap(data, (size_t)size);
+  return status;
+}
+
+/***
+ * Description:
+The main function prints the contents of the file named by the first command-line argument to stdout.
+Regular files are mapped and written in large chunks; anything else is streamed through a STREAM_BUFFER_SIZE buffer.
+Unlike cat, the output is byte-for-byte the input: no newline is added per chunk.
+
+@param argc - the number of command-line arguments passed to the program.
+@param argv - the array of command-line arguments provided to the program.
+*/
+int main(int argc, char** argv)
+{
+  FILE* fp = 0; char* buffer = 0; int status = 0;
+  if(argc < 2) { fputs("Enter a file name.", stderr); return -1; }
+  fp = fopen(argv[1], "r");
+  if(fp == 0) { abort(); }
+  status = map_copy(fp);
+  if(status == 1) {
+    buffer = malloc(STREAM_BUFFER_SIZE);
+    if(buffer == 0) { abort(); }
+    status = stream_copy(fp, buffer, STREAM_BUFFER_SIZE);
+    free((void *)buffer);
+  }
+  fclose(fp);
+  return status;
+}
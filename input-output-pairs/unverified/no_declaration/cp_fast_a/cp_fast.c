@@ -0,0 +1,149 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "unistd.h"
+#include "sendfile.h"
+
+#define KERNEL_COPY_CHUNK (1024 * 1024 * 1024)
+#define COPY_BUFFER_SIZE (128 * 1024)
+
+/*@
+lemma void append_take_drop_take<t>(int n1, int n2, list<t> xs)
+  requires 0 <= n1 &*& 0 <= n2 &*& n1 + n2 <= length(xs);
+  ensures append(take(n1, xs), take(n2, drop(n1, xs))) == take(n1 + n2, xs) &*& drop(n2, drop(n1, xs)) == drop(n1 + n2, xs);
+{
+  switch (xs) {
+    case nil:
+    case cons(x0, xs0):
+      if (n1 != 0) {
+        append_take_drop_take(n1 - 1, n2, xs0);
+      }
+  }
+}
+@*/
+
+/*
+Copies from one file descriptor to another with copy_file_range, without the data entering user space.
+Returns 0 when the end of the input was reached and 1 as soon as the call fails,
+in which case the file offsets tell the next stage where to continue.
+Some special files (e.g. in /proc) report a size but make copy_file_range return 0 at once;
+a first call that copies nothing therefore also returns 1, so that the next stage retries.
+For a really empty input, the next stage then finds the end of the input at once.
+*/
+int copy_with_copy_file_range(int from, int to)
+//@ requires 0 <= from &*& 0 <= to;
+//@ ensures result == 0 || result == 1;
+{
+  long nb_copied = copy_file_range(from, 0, to, 0, KERNEL_COPY_CHUNK, 0);
+  if(nb_copied == 0) { return 1; }
+  while(0 < nb_copied)
+  //@ invariant -1 <= nb_copied;
+  {
+    nb_copied = copy_file_range(from, 0, to, 0, KERNEL_COPY_CHUNK, 0);
+  }
+  return nb_copied == 0 ? 0 : 1;
+}
+
+/*
+Copies from one file descriptor to another with sendfile, without the data entering user space.
+Returns 0 when the end of the input was reached and 1 as soon as the call fails.
+*/
+int copy_with_sendfile(int from, int to)
+//@ requires 0 <= from &*& 0 <= to;
+//@ ensures result == 0 || result == 1;
+{
+  long nb_copied = sendfile(to, from, 0, KERNEL_COPY_CHUNK);
+  while(0 < nb_copied)
+  //@ invariant -1 <= nb_copied;
+  {
+    nb_copied = sendfile(to, from, 0, KERNEL_COPY_CHUNK);
+  }
+  return nb_copied == 0 ? 0 : 1;
+}
+
+/*
+Writes the first count bytes of buffer to the given file, retrying after short writes.
+Returns 0 on success and -1 if a write made no progress.
+*/
+int write_all(FILE* to, char* buffer, int count)
+//@ requires [?f]file(to) &*& [?fb]buffer[..count] |-> ?cs &*& 0 <= count;
+//@ ensures [f]file(to) &*& [fb]buffer[..count] |-> cs &*& result == 0 || result == -1;
+{
+  int nb_written = 0;
+  //@ close [fb]chars(buffer, 0, nil);
+  while(nb_written < count)
+  //@ invariant [f]file(to) &*& [fb]chars(buffer, nb_written, take(nb_written, cs)) &*& [fb]chars(buffer + nb_written, count - nb_written, drop(nb_written, cs)) &*& 0 <= nb_written &*& nb_written <= count;
+  {
+    int n = fwrite(buffer + nb_written, 1, (size_t)(count - nb_written), to);
+    if(n == 0) {
+      //@ append_take_drop_n(cs, nb_written);
+      //@ chars_join(buffer);
+      return -1;
+    }
+    //@ chars_split(buffer + nb_written, n);
+    //@ chars_join(buffer);
+    //@ append_take_drop_take(nb_written, n, cs);
+    nb_written = nb_written + n;
+  }
+  //@ append_take_drop_n(cs, nb_written);
+  //@ chars_join(buffer);
+  return 0;
+}
+
+/*
+Copies the rest of one file to another through a buffer of the given size.
+Returns 0 on success and -1 if a write failed.
+*/
+int copy_with_buffer(FILE* from, FILE* to, char* buffer, int size)
+//@ requires [?ff]file(from) &*& [?ft]file(to) &*& buffer[..size] |-> _ &*& 0 < size;
+//@ ensures [ff]file(from) &*& [ft]file(to) &*& buffer[..size] |-> _ &*& result == 0 || result == -1;
+{
+  int nb_read = fread(buffer, 1, (size_t)size, from);
+  while(0 < nb_read)
+  //@ invariant [ff]file(from) &*& [ft]file(to) &*& buffer[..nb_read] |-> ?_ &*& 0 <= nb_read &*& nb_read <= size &*& buffer[nb_read..size] |-> _;
+  {
+    int status = write_all(to, buffer, nb_read);
+    //@ chars_chars__join(buffer);
+    if(status != 0) { return -1; }
+    nb_read = fread(buffer, 1, (size_t)size, from);
+  }
+  //@ chars_chars__join(buffer);
+  return 0;
+}
+
+/*
+Copies the file named by the first argument to the file named by the second argument.
+The copy is done by the kernel when possible (copy_file_range, then sendfile);
+otherwise it goes through a large user-space buffer.
+*/
+int main(int argc, char** argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+  FILE* from = 0; FILE* to = 0; char* buffer = 0; int from_fd = 0; int to_fd = 0; int status = 1;
+  if(argc < 3) { puts("Not enough parameters."); return -1; }
+  //@ open [_]argv(argv, argc, _);
+  //@ open [_]argv(argv + 1, argc - 1, _);
+  //@ open [_]argv(argv + 2, argc - 2, _);
+  from = fopen(argv[1], "r");
+  to = fopen(argv[2], "w");
+  if(from == 0 || to == 0) { abort(); }
+  from_fd = fileno(from);
+  to_fd = fileno(to);
+  if(0 <= from_fd && 0 <= to_fd) {
+    status = copy_with_copy_file_range(from_fd, to_fd);
+    if(status == 1) {
+      status = copy_with_sendfile(from_fd, to_fd);
+    }
+  }
+  if(status == 1) {
+    buffer = malloc(COPY_BUFFER_SIZE);
+    if(buffer == 0) { abort(); }
+    status = copy_with_buffer(from, to, buffer, COPY_BUFFER_SIZE);
+    free(buffer);
+  }
+  fclose(from);
+  // The last buffered bytes of the copy are written by fclose, so a failure there means the copy is incomplete.
+  if(fclose(to) != 0) { status = -1; }
+  return status;
+}
@@ -0,0 +1,139 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "unistd.h"
+#include "sendfile.h"
+
+#define KERNEL_COPY_CHUNK (1024 * 1024 * 1024)
+#define COPY_BUFFER_SIZE (128 * 1024)
+
+/***
+ * Description:
+The `copy_with_copy_file_range` function copies from one file descriptor to another with `copy_file_range`,
+in chunks of KERNEL_COPY_CHUNK bytes, without the data entering user space.
+
+@param from - a valid file descriptor to read from.
+@param to - a valid file descriptor to write to.
+
+It returns 0 when the end of the input was reached and 1 as soon as the call fails,
+in which case the file offsets tell the next stage where to continue.
+It also returns 1 if the first call copies nothing, because some special files report a size
+but cannot be copied this way; the next stage then retries.
+*/
+int copy_with_copy_file_range(int from, int to)
+{
+  long nb_copied = copy_file_range(from, 0, to, 0, KERNEL_COPY_CHUNK, 0);
+  if(nb_copied == 0) { return 1; }
+  while(0 < nb_copied)
+  {
+    nb_copied = copy_file_range(from, 0, to, 0, KERNEL_COPY_CHUNK, 0);
+  }
+  return nb_copied == 0 ? 0 : 1;
+}
+
+/***
+ * Description:
+The `copy_with_sendfile` function copies from one file descriptor to another with `sendfile`,
+in chunks of KERNEL_COPY_CHUNK bytes, without the data entering user space.
+
+@param from - a valid file descriptor to read from.
+@param to - a valid file descriptor to write to.
+
+It returns 0 when the end of the input was reached and 1 as soon as the call fails.
+*/
+int copy_with_sendfile(int from, int to)
+{
+  long nb_copied = sendfile(to, from, 0, KERNEL_COPY_CHUNK);
+  while(0 < nb_copied)
+  {
+    nb_copied = sendfile(to, from, 0, KERNEL_COPY_CHUNK);
+  }
+  return nb_copied == 0 ? 0 : 1;
+}
+
+/***
+ * Description:
+The `write_all` function writes the first `count` bytes of `buffer` to the given file.
+After a short write it retries with the bytes that were not written yet.
+
+@param to - the file to write to.
+@param buffer - the bytes to write, which are only read.
+@param count - the non-negative number of bytes to write.
+
+It returns 0 on success and -1 if a write made no progress.
+*/
+int write_all(FILE* to, char* buffer, int count)
+{
+  int nb_written = 0;
+  while(nb_written < count)
+  {
+    int n = fwrite(buffer + nb_written, 1, (size_t)(count - nb_written), to);
+    if(n == 0) {
+      return -1;
+    }
+    nb_written = nb_written + n;
+  }
+  return 0;
+}
+
+/***
+ * Description:
+The `copy_with_buffer` function copies the rest of one file to another through a buffer of the given size,
+using `write_all` so that short writes are not lost.
+
+@param from - the file to read from.
+@param to - the file to write to.
+@param buffer - the buffer used to hold each chunk.
+@param size - the positive size of the buffer.
+
+It returns 0 on success and -1 if a write failed.
+*/
+int copy_with_buffer(FILE* from, FILE* to, char* buffer, int size)
+{
+  int nb_read = fread(buffer, 1, (size_t)size, from);
+  while(0 < nb_read)
+  {
+    int status = write_all(to, buffer, nb_read);
+    if(status != 0) { return -1; }
+    nb_read = fread(buffer, 1, (size_t)size, from);
+  }
+  return 0;
+}
+
+/***
+ * Description:
+The main function copies the file named by the first command-line argument to the file named by the second one.
+The copy is done by the kernel when possible (`copy_file_range`, then `sendfile`);
+otherwise it goes through a COPY_BUFFER_SIZE user-space buffer.
+
+@param argc - the number of command-line arguments passed to the program.
+@param argv - the array of command-line arguments provided to the program.
+
+It returns 0 on success and -1 if the copy is incomplete, including when closing the copy fails.
+*/
+int main(int argc, char** argv)
+{
+  FILE* from = 0; FILE* to = 0; char* buffer = 0; int from_fd = 0; int to_fd = 0; int status = 1;
+  if(argc < 3) { puts("Not enough parameters."); return -1; }
+  from = fopen(argv[1], "r");
+  to = fopen(argv[2], "w");
+  if(from == 0 || to == 0) { abort(); }
+  from_fd = fileno(from);
+  to_fd = fileno(to);
+  if(0 <= from_fd && 0 <= to_fd) {
+    status = copy_with_copy_file_range(from_fd, to_fd);
+    if(status == 1) {
+      status = copy_with_sendfile(from_fd, to_fd);
+    }
+  }
+  if(status == 1) {
+    buffer = malloc(COPY_BUFFER_SIZE);
+    if(buffer == 0) { abort(); }
+    status = copy_with_buffer(from, to, buffer, COPY_BUFFER_SIZE);
+    free(buffer);
+  }
+  fclose(from);
+  // The last buffered bytes of the copy are written by fclose, so a failure there means the copy is incomplete.
+  if(fclose(to) != 0) { status = -1; }
+  return status;
+}
@@ -0,0 +1,497 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A bounded queue that many producer threads enqueue to and one consumer thread dequeues from, without a lock. It
+// keeps the shape of llist: the messages form a list from first to last, and first is a sentinel whose successor
+// holds the oldest message. A producer appends by exchanging last for its node and then linking the old last to it
+// (Vyukov's queue). The consumer moves first to its successor, which becomes the new sentinel, so dequeue takes a
+// fixed number of steps.
+//
+// The nodes live in a pool of slotCount slots, as in treiber_stack: slot i holds nexts[i] and values[i], a link is a
+// slot number plus one, and link 0 ends a list. The consumer hands each old sentinel back through a second list of
+// the same shape, the free list, which it appends to without waiting. The producers take the sentinel of the free
+// list with a compare-exchange on freeFirst, which holds the sentinel's slot and a tag against the ABA problem: the
+// tag wraps around after QUEUE_TAG_LIMIT updates. The sentinels of both lists are never handed out, so a queue of
+// capacity messages needs capacity + 2 slots.
+
+#define QUEUE_SLOT_LIMIT 4096
+#define QUEUE_TAG_LIMIT 524288
+
+struct queue {
+  int last;
+  int freeFirst;
+  int first;
+  int freeLast;
+  int slotCount;
+  int *nexts;
+  int *values;
+};
+
+/*@
+fixpoint bool link_within(int slotCount, int link) { return 0 <= link && link <= slotCount; }
+
+// last and freeFirst are updated by several threads at once, and any slot's next link may be read by a producer that
+// has fallen behind, so they live in an atomic space. The invariant only keeps every slot number and link inside the
+// pool. That a slot is on at most one list at a time follows from the algorithm and the tags and is not proved here.
+predicate_ctor queue_inv(struct queue *queue, int slotCount, int *nexts, int *values)() =
+  queue->last |-> ?last &*& 0 <= last &*& last < slotCount &*&
+  queue->freeFirst |-> ?freeFirst &*& 0 <= freeFirst &*& freeFirst % QUEUE_SLOT_LIMIT < slotCount &*&
+  nexts[0..slotCount] |-> ?links &*& forall(links, (link_within)(slotCount)) == true &*&
+  values[0..slotCount] |-> _;
+
+// The part of the queue that the producers share; each producer holds a fraction of it.
+predicate queue(struct queue *queue, int slotCount) =
+  queue->slotCount |-> slotCount &*& queue->nexts |-> ?nexts &*& queue->values |-> ?values &*&
+  2 < slotCount &*& slotCount <= QUEUE_SLOT_LIMIT &*&
+  atomic_space(queue_inv(queue, slotCount, nexts, values)) &*&
+  malloc_block_ints(nexts, slotCount) &*& malloc_block_ints(values, slotCount) &*& malloc_block_queue(queue);
+
+// The part of the queue that only the consumer uses.
+predicate queue_consumer(struct queue *queue, int slotCount) =
+  queue->first |-> ?first &*& 0 <= first &*& first < slotCount &*&
+  queue->freeLast |-> ?freeLast &*& 0 <= freeLast &*& freeLast < slotCount;
+
+predicate queue_nothing() = true;
+
+predicate queue_ignored(int value) = true;
+
+predicate_ctor queue_link_loaded(int slotCount)(int value) =
+  link_within(slotCount, value) == true;
+
+predicate_ctor queue_link_stored(int slotCount, int link)() =
+  link_within(slotCount, link) == true;
+
+predicate_ctor queue_slot_stored(int slotCount, int slot)() =
+  0 <= slot &*& slot < slotCount;
+
+predicate_ctor queue_slot_loaded(int slotCount)(int value) =
+  0 <= value &*& value < slotCount;
+
+predicate_ctor queue_free_first_loaded(int slotCount)(int value) =
+  0 <= value &*& value % QUEUE_SLOT_LIMIT < slotCount;
+
+predicate_ctor queue_free_first_stored(int slotCount, int freeFirst)() =
+  0 <= freeFirst &*& freeFirst % QUEUE_SLOT_LIMIT < slotCount;
+@*/
+
+/*
+Creates a queue for up to capacity messages. Slot 0 is the sentinel of the message list, and slot 1 is the sentinel
+of the free list, which holds all other slots.
+*/
+struct queue *create_queue(int capacity)
+//@ requires 0 < capacity &*& capacity + 2 <= QUEUE_SLOT_LIMIT;
+//@ ensures queue(result, capacity + 2) &*& queue_consumer(result, capacity + 2);
+{
+  int slotCount = capacity + 2;
+  struct queue *queue = malloc(sizeof(struct queue));
+  int *nexts = malloc((size_t)slotCount * sizeof(int));
+  int *values = malloc((size_t)slotCount * sizeof(int));
+  if (queue == 0 || nexts == 0 || values == 0) abort();
+  nexts[0] = 0;
+  values[0] = 0;
+  for (int i = 1; i < slotCount; i++)
+  {
+    // Slot i links to slot i + 1; the last slot ends the free list.
+    nexts[i] = i + 1 < slotCount ? i + 2 : 0;
+    values[i] = 0;
+  }
+  queue->last = 0;
+  queue->freeFirst = 1;
+  queue->first = 0;
+  queue->freeLast = slotCount - 1;
+  queue->slotCount = slotCount;
+  queue->nexts = nexts;
+  queue->values = values;
+  return queue;
+}
+
+/*
+Returns the next link of the given slot.
+*/
+int queue_load_next(struct queue *queue, int slot)
+//@ requires [?f]queue(queue, ?slotCount) &*& 0 <= slot &*& slot < slotCount;
+//@ ensures [f]queue(queue, slotCount) &*& link_within(slotCount, result) == true;
+{
+  int *nexts = queue->nexts;
+  int next = atomic_load(&nexts[slot]);
+  return next;
+}
+
+/*
+Sets the next link of the given slot. A producer that has fallen behind may read the link at the same time, so it
+is stored atomically.
+*/
+void queue_store_next(struct queue *queue, int slot, int link)
+//@ requires [?f]queue(queue, ?slotCount) &*& 0 <= slot &*& slot < slotCount &*& link_within(slotCount, link) == true;
+//@ ensures [f]queue(queue, slotCount);
+{
+  int *nexts = queue->nexts;
+  atomic_store(&nexts[slot], link);
+}
+
+/*
+Returns a freeFirst that holds the given slot and the next tag after the one in the given freeFirst.
+*/
+int queue_tagged(int freeFirst, int slot)
+//@ requires 0 <= freeFirst &*& 0 <= slot &*& slot < QUEUE_SLOT_LIMIT;
+//@ ensures 0 <= result &*& result % QUEUE_SLOT_LIMIT == slot;
+{
+  return (freeFirst / QUEUE_SLOT_LIMIT + 1) % QUEUE_TAG_LIMIT * QUEUE_SLOT_LIMIT + slot;
+}
+
+/*
+Takes the sentinel of the free list, and makes its successor the new sentinel. Returns -1 if the sentinel has no
+successor, that is, if all capacity slots hold messages.
+*/
+int queue_take_free_slot(struct queue *queue)
+//@ requires [?f]queue(queue, ?slotCount);
+//@ ensures [f]queue(queue, slotCount) &*& -1 <= result &*& result < slotCount;
+{
+  for (;;)
+  {
+    int freeFirst = atomic_load(&queue->freeFirst);
+    int slot = freeFirst % QUEUE_SLOT_LIMIT;
+    // Another producer may take this slot, and the consumer may hand it back, before we read its next link. Then the
+    // link is stale, but it is still inside the pool, and the compare-exchange below fails because the tag has
+    // moved on.
+    int next = queue_load_next(queue, slot);
+    if (next == 0) return -1;
+    int expected = freeFirst;
+    int desired = queue_tagged(freeFirst, next - 1);
+    bool taken = atomic_compare_exchange_strong(&queue->freeFirst, &expected, desired);
+    if (taken) return slot;
+  }
+}
+
+/*
+Enqueues a message. Returns false, and leaves the queue unchanged, if the queue already holds capacity messages.
+Any number of producers may enqueue at once.
+*/
+bool queue_enqueue(struct queue *queue, int value)
+//@ requires [?f]queue(queue, ?slotCount);
+//@ ensures [f]queue(queue, slotCount);
+{
+  int slot = queue_take_free_slot(queue);
+  if (slot < 0) return false;
+  int *values = queue->values;
+  atomic_store(&values[slot], value);
+  queue_store_next(queue, slot, 0);
+  int last = atomic_exchange(&queue->last, slot);
+  // Until the old last links to slot, the consumer does not see this message, nor any message enqueued after it.
+  queue_store_next(queue, last, slot + 1);
+  return true;
+}
+
+/*
+Dequeues the oldest message into *value. Returns false, and leaves *value unchanged, if the queue is empty. Only the
+consumer may dequeue.
+*/
+bool queue_dequeue(struct queue *queue, int *value)
+//@ requires [?f]queue(queue, ?slotCount) &*& queue_consumer(queue, slotCount) &*& *value |-> _;
+//@ ensures [f]queue(queue, slotCount) &*& queue_consumer(queue, slotCount) &*& *value |-> _;
+{
+  int first = queue->first;
+  int next = queue_load_next(queue, first);
+  if (next == 0) {
+    return false;
+  }
+  int *values = queue->values;
+  *value = atomic_load(&values[next - 1]);
+  queue->first = next - 1;
+  // The old sentinel is no longer on the message list; append it to the free list.
+  queue_store_next(queue, first, 0);
+  queue_store_next(queue, queue->freeLast, first + 1);
+  queue->freeLast = first;
+  return true;
+}
+
+void queue_dispose(struct queue *queue)
+//@ requires queue(queue, ?slotCount) &*& queue_consumer(queue, slotCount);
+//@ ensures emp;
+{
+  free(queue->nexts);
+  free(queue->values);
+  free(queue);
+}
+
+// The channel the benchmark compares the queue with: the llist of iter_with_auto, under a mutex.
+
+struct node {
+  struct node *next;
+  int value;
+};
+
+struct llist {
+  struct node *first;
+  struct node *last;
+};
+
+/*@
+predicate node(struct node *node; struct node *next, int value) =
+  node->next |-> next &*& node->value |-> value &*& malloc_block_node(node);
+
+predicate lseg(struct node *n1, struct node *n2; list<int> v) =
+  n1 == n2 ? emp &*& v == nil : node(n1, ?_n, ?h) &*& lseg(_n, n2, ?t) &*& v == cons(h, t);
+
+predicate llist(struct llist *list; list<int> v) =
+  list->first |-> ?_f &*& list->last |-> ?_l &*& lseg(_f, _l, v) &*& node(_l, _, _) &*& malloc_block_llist(list);
+@*/
+
+struct llist *create_llist()
+//@ requires emp;
+//@ ensures llist(result, nil);
+{
+  struct llist *l = malloc(sizeof(struct llist));
+  if (l == 0) abort();
+  struct node *n = calloc(1, sizeof(struct node));
+  if (n == 0) abort();
+  l->first = n;
+  l->last = n;
+  return l;
+}
+
+void llist_add(struct llist *list, int x)
+//@ requires llist(list, ?_v);
+//@ ensures llist(list, append(_v, cons(x, nil)));
+{
+  struct node *l = 0;
+  struct node *n = calloc(1, sizeof(struct node));
+  if (n == 0) {
+    abort();
+  }
+  l = list->last;
+  l->next = n;
+  l->value = x;
+  list->last = n;
+}
+
+int llist_remove_first(struct llist *list)
+//@ requires llist(list, ?_v) &*& _v != nil;
+//@ ensures llist(list, tail(_v)) &*& result == head(_v);
+{
+  struct node *f = list->first;
+  struct node *next = f->next;
+  int value = f->value;
+  list->first = next;
+  free(f);
+  return value;
+}
+
+void llist_dispose(struct llist *list)
+//@ requires llist(list, _);
+//@ ensures emp;
+{
+  struct node *n = list->first;
+  struct node *l = list->last;
+  while (n != l)
+  {
+    struct node *next = n->next;
+    free(n);
+    n = next;
+  }
+  free(l);
+  free(list);
+}
+
+struct locked_queue {
+  struct llist *list;
+  struct mutex *mutex;
+};
+
+/*@
+predicate_ctor locked_queue_inv(struct locked_queue *queue)() =
+  queue->list |-> ?list &*& llist(list, _);
+
+predicate locked_queue(struct locked_queue *queue) =
+  queue->mutex |-> ?mutex &*& mutex(mutex, locked_queue_inv(queue)) &*& malloc_block_locked_queue(queue);
+@*/
+
+struct locked_queue *create_locked_queue()
+//@ requires emp;
+//@ ensures locked_queue(result);
+{
+  struct locked_queue *queue = malloc(sizeof(struct locked_queue));
+  if (queue == 0) abort();
+  queue->list = create_llist();
+  queue->mutex = create_mutex();
+  return queue;
+}
+
+void locked_queue_enqueue(struct locked_queue *queue, int value)
+//@ requires [?f]locked_queue(queue);
+//@ ensures [f]locked_queue(queue);
+{
+  mutex_acquire(queue->mutex);
+  llist_add(queue->list, value);
+  mutex_release(queue->mutex);
+}
+
+bool locked_queue_dequeue(struct locked_queue *queue, int *value)
+//@ requires [?f]locked_queue(queue) &*& *value |-> _;
+//@ ensures [f]locked_queue(queue) &*& *value |-> _;
+{
+  mutex_acquire(queue->mutex);
+  struct llist *list = queue->list;
+  bool nonempty = list->first != list->last;
+  if (nonempty) {
+    *value = llist_remove_first(list);
+  }
+  mutex_release(queue->mutex);
+  return nonempty;
+}
+
+void locked_queue_dispose(struct locked_queue *queue)
+//@ requires locked_queue(queue);
+//@ ensures emp;
+{
+  mutex_dispose(queue->mutex);
+  llist_dispose(queue->list);
+  free(queue);
+}
+
+#define PRODUCER_COUNT 3
+#define MESSAGES_PER_PRODUCER 262144
+#define QUEUE_CAPACITY 4000
+#define CHECKSUM_MODULUS 1000000007
+
+// Each producer enqueues the values 1 up to MESSAGES_PER_PRODUCER, retrying while the queue is full, and the main
+// thread dequeues them all. The main thread adds up what it dequeues modulo CHECKSUM_MODULUS, so that the benchmark
+// can tell whether a message was lost or delivered twice.
+
+struct producer {
+  struct queue *queue;
+  struct locked_queue *locked_queue;
+  struct thread *thread;
+};
+
+/*@
+// The fraction of its queue that each producer holds. The benchmark keeps the rest while its PRODUCER_COUNT
+// producers run, and has all of the queue back once it has joined them, so that it can dispose of it.
+fixpoint real thread_share() { return 1/8; }
+
+predicate_family_instance thread_run_pre(produce)(struct producer *p, any info) =
+  p->queue |-> ?queue &*& [thread_share()]queue(queue, QUEUE_CAPACITY + 2);
+predicate_family_instance thread_run_post(produce)(struct producer *p, any info) =
+  p->queue |-> ?queue &*& [thread_share()]queue(queue, QUEUE_CAPACITY + 2);
+
+predicate_family_instance thread_run_pre(locked_produce)(struct producer *p, any info) =
+  p->locked_queue |-> ?queue &*& [thread_share()]locked_queue(queue);
+predicate_family_instance thread_run_post(locked_produce)(struct producer *p, any info) =
+  p->locked_queue |-> ?queue &*& [thread_share()]locked_queue(queue);
+@*/
+
+void produce(struct producer *p) //@ : thread_run_joinable
+//@ requires thread_run_pre(produce)(p, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(produce)(p, info) &*& lockset(currentThread, nil);
+{
+  struct queue *queue = p->queue;
+  for (int i = 1; i <= MESSAGES_PER_PRODUCER; )
+  {
+    if (queue_enqueue(queue, i)) i++;
+  }
+}
+
+void locked_produce(struct producer *p) //@ : thread_run_joinable
+//@ requires thread_run_pre(locked_produce)(p, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(locked_produce)(p, info) &*& lockset(currentThread, nil);
+{
+  struct locked_queue *queue = p->locked_queue;
+  for (int i = 1; i <= MESSAGES_PER_PRODUCER; i++)
+  {
+    locked_queue_enqueue(queue, i);
+  }
+}
+
+/*
+Runs the producers against a lock-free queue while the calling thread consumes, and returns the elapsed time in
+nanoseconds. Stores the checksum of the dequeued messages in sum.
+*/
+long long bench_queue(struct producer *producers, long long *sum)
+//@ requires producers[..PRODUCER_COUNT] |-> _ &*& *sum |-> _;
+//@ ensures producers[..PRODUCER_COUNT] |-> _ &*& *sum |-> _;
+{
+  struct queue *queue = create_queue(QUEUE_CAPACITY);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i].queue = queue;
+    producers[i].thread = thread_start_joinable(produce, &producers[i]);
+  }
+  long long total = 0;
+  int value = 0;
+  for (int i = 0; i < PRODUCER_COUNT * MESSAGES_PER_PRODUCER; )
+  {
+    if (queue_dequeue(queue, &value)) {
+      total = (total + value) % CHECKSUM_MODULUS;
+      i++;
+    }
+  }
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    thread_join(producers[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *sum = total;
+  queue_dispose(queue);
+  return nanos;
+}
+
+/*
+Runs the producers against a mutex-protected llist while the calling thread consumes, and returns the elapsed time
+in nanoseconds. Stores the checksum of the dequeued messages in sum.
+*/
+long long bench_locked(struct producer *producers, long long *sum)
+//@ requires producers[..PRODUCER_COUNT] |-> _ &*& *sum |-> _;
+//@ ensures producers[..PRODUCER_COUNT] |-> _ &*& *sum |-> _;
+{
+  struct locked_queue *queue = create_locked_queue();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i].locked_queue = queue;
+    producers[i].thread = thread_start_joinable(locked_produce, &producers[i]);
+  }
+  long long total = 0;
+  int value = 0;
+  for (int i = 0; i < PRODUCER_COUNT * MESSAGES_PER_PRODUCER; )
+  {
+    if (locked_queue_dequeue(queue, &value)) {
+      total = (total + value) % CHECKSUM_MODULUS;
+      i++;
+    }
+  }
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    thread_join(producers[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *sum = total;
+  locked_queue_dispose(queue);
+  return nanos;
+}
+
+/*
+Passes PRODUCER_COUNT * MESSAGES_PER_PRODUCER messages through each kind of channel and prints the average time per
+message. Checks that the main thread received exactly the messages that were sent.
+*/
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+  struct producer *producers = malloc(PRODUCER_COUNT * sizeof(struct producer));
+  if (producers == 0) abort();
+  long long expected = (long long)PRODUCER_COUNT * MESSAGES_PER_PRODUCER * (MESSAGES_PER_PRODUCER + 1) / 2 % CHECKSUM_MODULUS;
+  long long messages = (long long)PRODUCER_COUNT * MESSAGES_PER_PRODUCER;
+  long long sum = 0;
+  long long nanos = bench_locked(producers, &sum);
+  printf("locked llist: %d ns per message (%s)\n", (int)(nanos / messages), sum == expected ? "ok" : "lost messages");
+  bool ok = sum == expected;
+  nanos = bench_queue(producers, &sum);
+  printf("mpsc queue:   %d ns per message (%s)\n", (int)(nanos / messages), sum == expected ? "ok" : "lost messages");
+  ok = ok && sum == expected;
+  free(producers);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,502 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A bounded queue that many producer threads enqueue to and one consumer thread dequeues from, without a lock. It
+// keeps the shape of llist: the messages form a list from first to last, and first is a sentinel whose successor
+// holds the oldest message. A producer appends by exchanging last for its node and then linking the old last to it
+// (Vyukov's queue). The consumer moves first to its successor, which becomes the new sentinel, so dequeue takes a
+// fixed number of steps.
+//
+// The nodes live in a pool of slotCount slots, as in treiber_stack: slot i holds nexts[i] and values[i], a link is a
+// slot number plus one, and link 0 ends a list. The consumer hands each old sentinel back through a second list of
+// the same shape, the free list, which it appends to without waiting. The producers take the sentinel of the free
+// list with a compare-exchange on freeFirst, which holds the sentinel's slot and a tag against the ABA problem: the
+// tag wraps around after QUEUE_TAG_LIMIT updates. The sentinels of both lists are never handed out, so a queue of
+// capacity messages needs capacity + 2 slots.
+
+#define QUEUE_SLOT_LIMIT 4096
+#define QUEUE_TAG_LIMIT 524288
+
+struct queue {
+  int last;
+  int freeFirst;
+  int first;
+  int freeLast;
+  int slotCount;
+  int *nexts;
+  int *values;
+};
+
+/**
+ * Description:
+ * The `create_queue` function creates an empty lock-free multi-producer single-consumer queue for up to capacity
+ * messages, with a pool of capacity + 2 slots. Slot 0 is the sentinel of the message list and the other slots form
+ * the free list. Aborts if memory allocation fails.
+ *
+ * @param capacity the number of messages the queue can hold at once.
+ *
+ * @return the new queue.
+ */
+struct queue *create_queue(int capacity)
+{
+  int slotCount = capacity + 2;
+  struct queue *queue = malloc(sizeof(struct queue));
+  int *nexts = malloc((size_t)slotCount * sizeof(int));
+  int *values = malloc((size_t)slotCount * sizeof(int));
+  if (queue == 0 || nexts == 0 || values == 0) abort();
+  nexts[0] = 0;
+  values[0] = 0;
+  for (int i = 1; i < slotCount; i++)
+  {
+    // Slot i links to slot i + 1; the last slot ends the free list.
+    nexts[i] = i + 1 < slotCount ? i + 2 : 0;
+    values[i] = 0;
+  }
+  queue->last = 0;
+  queue->freeFirst = 1;
+  queue->first = 0;
+  queue->freeLast = slotCount - 1;
+  queue->slotCount = slotCount;
+  queue->nexts = nexts;
+  queue->values = values;
+  return queue;
+}
+
+/**
+ * Description:
+ * The `queue_load_next` function atomically reads the next link of a slot.
+ *
+ * @param queue the queue that owns the slot pool.
+ * @param slot the slot whose link is read.
+ *
+ * @return the link: the next slot plus one, or 0 at the end of a list.
+ */
+int queue_load_next(struct queue *queue, int slot)
+{
+  int *nexts = queue->nexts;
+  int next = atomic_load(&nexts[slot]);
+  return next;
+}
+
+/**
+ * Description:
+ * The `queue_store_next` function atomically sets the next link of a slot.
+ *
+ * @param queue the queue that owns the slot pool.
+ * @param slot the slot whose link is set.
+ * @param link the next slot plus one, or 0 to end the list.
+ */
+void queue_store_next(struct queue *queue, int slot, int link)
+{
+  int *nexts = queue->nexts;
+  atomic_store(&nexts[slot], link);
+}
+
+/**
+ * Description:
+ * The `queue_tagged` function builds a freeFirst value that holds the given slot and the tag that follows the tag of
+ * the given freeFirst, wrapping around after QUEUE_TAG_LIMIT.
+ *
+ * @param freeFirst the value whose tag is incremented.
+ * @param slot the slot the new value holds.
+ *
+ * @return the new freeFirst value.
+ */
+int queue_tagged(int freeFirst, int slot)
+{
+  return (freeFirst / QUEUE_SLOT_LIMIT + 1) % QUEUE_TAG_LIMIT * QUEUE_SLOT_LIMIT + slot;
+}
+
+/**
+ * Description:
+ * The `queue_take_free_slot` function takes the sentinel of the free list with a compare-exchange loop, making its
+ * successor the new sentinel. Many producers may call it at once.
+ *
+ * @param queue the queue to take a slot from.
+ *
+ * @return the slot taken, or -1 if the queue is full.
+ */
+int queue_take_free_slot(struct queue *queue)
+{
+  for (;;)
+  {
+    int freeFirst = atomic_load(&queue->freeFirst);
+    int slot = freeFirst % QUEUE_SLOT_LIMIT;
+    // Another producer may take this slot, and the consumer may hand it back, before we read its next link. Then the
+    // link is stale, but it is still inside the pool, and the compare-exchange below fails because the tag has
+    // moved on.
+    int next = queue_load_next(queue, slot);
+    if (next == 0) return -1;
+    int expected = freeFirst;
+    int desired = queue_tagged(freeFirst, next - 1);
+    bool taken = atomic_compare_exchange_strong(&queue->freeFirst, &expected, desired);
+    if (taken) return slot;
+  }
+}
+
+/**
+ * Description:
+ * The `queue_enqueue` function appends a message to the queue: it takes a free slot, stores the value in it,
+ * atomically exchanges the last slot for it and links the old last slot to it. Many producers may call it at once.
+ *
+ * @param queue the queue to enqueue to.
+ * @param value the message.
+ *
+ * @return false if the queue is full, true otherwise.
+ */
+bool queue_enqueue(struct queue *queue, int value)
+{
+  int slot = queue_take_free_slot(queue);
+  if (slot < 0) return false;
+  int *values = queue->values;
+  atomic_store(&values[slot], value);
+  queue_store_next(queue, slot, 0);
+  int last = atomic_exchange(&queue->last, slot);
+  // Until the old last links to slot, the consumer does not see this message, nor any message enqueued after it.
+  queue_store_next(queue, last, slot + 1);
+  return true;
+}
+
+/**
+ * Description:
+ * The `queue_dequeue` function removes the oldest message into *value in a fixed number of steps, and appends the old
+ * sentinel slot to the free list. Only the single consumer may call it.
+ *
+ * @param queue the queue to dequeue from.
+ * @param value where the message is stored.
+ *
+ * @return false if the queue is empty, true otherwise.
+ */
+bool queue_dequeue(struct queue *queue, int *value)
+{
+  int first = queue->first;
+  int next = queue_load_next(queue, first);
+  if (next == 0) {
+    return false;
+  }
+  int *values = queue->values;
+  *value = atomic_load(&values[next - 1]);
+  queue->first = next - 1;
+  // The old sentinel is no longer on the message list; append it to the free list.
+  queue_store_next(queue, first, 0);
+  queue_store_next(queue, queue->freeLast, first + 1);
+  queue->freeLast = first;
+  return true;
+}
+
+/**
+ * Description:
+ * The `queue_dispose` function frees the queue and its slot pool. No other thread may use the queue anymore.
+ *
+ * @param queue the queue to free.
+ */
+void queue_dispose(struct queue *queue)
+{
+  free(queue->nexts);
+  free(queue->values);
+  free(queue);
+}
+
+// The channel the benchmark compares the queue with: the llist of iter_with_auto, under a mutex.
+
+struct node {
+  struct node *next;
+  int value;
+};
+
+struct llist {
+  struct node *first;
+  struct node *last;
+};
+
+/**
+ * Description:
+ * The `create_llist` function creates an empty linked list with a sentinel last node.
+ *
+ * @return the new list.
+ */
+struct llist *create_llist()
+{
+  struct llist *l = malloc(sizeof(struct llist));
+  if (l == 0) abort();
+  struct node *n = calloc(1, sizeof(struct node));
+  if (n == 0) abort();
+  l->first = n;
+  l->last = n;
+  return l;
+}
+
+/**
+ * Description:
+ * The `llist_add` function appends a value to the end of the list.
+ *
+ * @param list the list.
+ * @param x the value to append.
+ */
+void llist_add(struct llist *list, int x)
+{
+  struct node *l = 0;
+  struct node *n = calloc(1, sizeof(struct node));
+  if (n == 0) {
+    abort();
+  }
+  l = list->last;
+  l->next = n;
+  l->value = x;
+  list->last = n;
+}
+
+/**
+ * Description:
+ * The `llist_remove_first` function removes the first value of a non-empty list and returns it.
+ *
+ * @param list the list.
+ *
+ * @return the removed value.
+ */
+int llist_remove_first(struct llist *list)
+{
+  struct node *f = list->first;
+  struct node *next = f->next;
+  int value = f->value;
+  list->first = next;
+  free(f);
+  return value;
+}
+
+/**
+ * Description:
+ * The `llist_dispose` function frees all nodes of the list and the list itself.
+ *
+ * @param list the list.
+ */
+void llist_dispose(struct llist *list)
+{
+  struct node *n = list->first;
+  struct node *l = list->last;
+  while (n != l)
+  {
+    struct node *next = n->next;
+    free(n);
+    n = next;
+  }
+  free(l);
+  free(list);
+}
+
+struct locked_queue {
+  struct llist *list;
+  struct mutex *mutex;
+};
+
+/**
+ * Description:
+ * The `create_locked_queue` function creates an empty llist protected by a mutex.
+ *
+ * @return the new queue.
+ */
+struct locked_queue *create_locked_queue()
+{
+  struct locked_queue *queue = malloc(sizeof(struct locked_queue));
+  if (queue == 0) abort();
+  queue->list = create_llist();
+  queue->mutex = create_mutex();
+  return queue;
+}
+
+/**
+ * Description:
+ * The `locked_queue_enqueue` function appends a message to the list under the mutex.
+ *
+ * @param queue the queue.
+ * @param value the message.
+ */
+void locked_queue_enqueue(struct locked_queue *queue, int value)
+{
+  mutex_acquire(queue->mutex);
+  llist_add(queue->list, value);
+  mutex_release(queue->mutex);
+}
+
+/**
+ * Description:
+ * The `locked_queue_dequeue` function removes the first message of the list under the mutex into *value.
+ *
+ * @param queue the queue.
+ * @param value where the message is stored.
+ *
+ * @return false if the list is empty, true otherwise.
+ */
+bool locked_queue_dequeue(struct locked_queue *queue, int *value)
+{
+  mutex_acquire(queue->mutex);
+  struct llist *list = queue->list;
+  bool nonempty = list->first != list->last;
+  if (nonempty) {
+    *value = llist_remove_first(list);
+  }
+  mutex_release(queue->mutex);
+  return nonempty;
+}
+
+/**
+ * Description:
+ * The `locked_queue_dispose` function disposes the mutex, the list and the queue.
+ *
+ * @param queue the queue.
+ */
+void locked_queue_dispose(struct locked_queue *queue)
+{
+  mutex_dispose(queue->mutex);
+  llist_dispose(queue->list);
+  free(queue);
+}
+
+#define PRODUCER_COUNT 3
+#define MESSAGES_PER_PRODUCER 262144
+#define QUEUE_CAPACITY 4000
+#define CHECKSUM_MODULUS 1000000007
+
+// Each producer enqueues the values 1 up to MESSAGES_PER_PRODUCER, retrying while the queue is full, and the main
+// thread dequeues them all. The main thread adds up what it dequeues modulo CHECKSUM_MODULUS, so that the benchmark
+// can tell whether a message was lost or delivered twice.
+
+struct producer {
+  struct queue *queue;
+  struct locked_queue *locked_queue;
+  struct thread *thread;
+};
+
+/**
+ * Description:
+ * The `produce` function enqueues the values 1 up to MESSAGES_PER_PRODUCER on the producer's queue, retrying while the
+ * queue is full.
+ *
+ * @param p the producer.
+ */
+void produce(struct producer *p)
+{
+  struct queue *queue = p->queue;
+  for (int i = 1; i <= MESSAGES_PER_PRODUCER; )
+  {
+    if (queue_enqueue(queue, i)) i++;
+  }
+}
+
+/**
+ * Description:
+ * The `locked_produce` function enqueues the values 1 up to MESSAGES_PER_PRODUCER on the producer's locked queue.
+ *
+ * @param p the producer.
+ */
+void locked_produce(struct producer *p)
+{
+  struct locked_queue *queue = p->locked_queue;
+  for (int i = 1; i <= MESSAGES_PER_PRODUCER; i++)
+  {
+    locked_queue_enqueue(queue, i);
+  }
+}
+
+/**
+ * Description:
+ * The `bench_queue` function runs the producers against one lock-free queue while the calling thread dequeues all
+ * messages, and stores the checksum of the dequeued messages in *sum.
+ *
+ * @param producers the producers.
+ * @param sum where the checksum is stored.
+ *
+ * @return the elapsed time in nanoseconds.
+ */
+long long bench_queue(struct producer *producers, long long *sum)
+{
+  struct queue *queue = create_queue(QUEUE_CAPACITY);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i].queue = queue;
+    producers[i].thread = thread_start_joinable(produce, &producers[i]);
+  }
+  long long total = 0;
+  int value = 0;
+  for (int i = 0; i < PRODUCER_COUNT * MESSAGES_PER_PRODUCER; )
+  {
+    if (queue_dequeue(queue, &value)) {
+      total = (total + value) % CHECKSUM_MODULUS;
+      i++;
+    }
+  }
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    thread_join(producers[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *sum = total;
+  queue_dispose(queue);
+  return nanos;
+}
+
+/**
+ * Description:
+ * The `bench_locked` function runs the producers against one locked llist while the calling thread dequeues all
+ * messages, and stores the checksum of the dequeued messages in *sum.
+ *
+ * @param producers the producers.
+ * @param sum where the checksum is stored.
+ *
+ * @return the elapsed time in nanoseconds.
+ */
+long long bench_locked(struct producer *producers, long long *sum)
+{
+  struct locked_queue *queue = create_locked_queue();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    producers[i].locked_queue = queue;
+    producers[i].thread = thread_start_joinable(locked_produce, &producers[i]);
+  }
+  long long total = 0;
+  int value = 0;
+  for (int i = 0; i < PRODUCER_COUNT * MESSAGES_PER_PRODUCER; )
+  {
+    if (locked_queue_dequeue(queue, &value)) {
+      total = (total + value) % CHECKSUM_MODULUS;
+      i++;
+    }
+  }
+  for (int i = 0; i < PRODUCER_COUNT; i++)
+  {
+    thread_join(producers[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *sum = total;
+  locked_queue_dispose(queue);
+  return nanos;
+}
+
+/**
+ * Description:
+ * The `main` function benchmarks the locked llist and the lock-free queue as message channels, printing the average
+ * time per message, and checks that every message was delivered exactly once.
+ *
+ * @return 0 if both checksums are right, 1 otherwise.
+ */
+int main()
+{
+  struct producer *producers = malloc(PRODUCER_COUNT * sizeof(struct producer));
+  if (producers == 0) abort();
+  long long expected = (long long)PRODUCER_COUNT * MESSAGES_PER_PRODUCER * (MESSAGES_PER_PRODUCER + 1) / 2 % CHECKSUM_MODULUS;
+  long long messages = (long long)PRODUCER_COUNT * MESSAGES_PER_PRODUCER;
+  long long sum = 0;
+  long long nanos = bench_locked(producers, &sum);
+  printf("locked llist: %d ns per message (%s)\n", (int)(nanos / messages), sum == expected ? "ok" : "lost messages");
+  bool ok = sum == expected;
+  nanos = bench_queue(producers, &sum);
+  printf("mpsc queue:   %d ns per message (%s)\n", (int)(nanos / messages), sum == expected ? "ok" : "lost messages");
+  ok = ok && sum == expected;
+  free(producers);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A counter that many threads increment at once. Each thread has a slot of its own and is the only one that writes
+// it, so the threads do not write to a shared location. A slot is written with a relaxed atomic store and read by get
+// with a relaxed atomic load, so get can add up the slots while threads are incrementing them; since only the owner
+// writes a slot, the store needs no read-modify-write instruction. Slots are stride ints apart: with
+// COUNTER_PADDED_STRIDE, two slots are at least a cache line (64 bytes) apart, so they never share one.
+
+#define COUNTER_PADDED_STRIDE 16
+
+struct Counter {
+  int *slots;
+  int slotCount;
+  int stride;
+};
+
+/*@
+fixpoint bool all_eq(list<int> values, int v) {
+  switch (values) {
+    case nil: return true;
+    case cons(value, values0): return value == v && all_eq(values0, v);
+  }
+}
+
+// The atomic space of the slot at p. It holds half of the slot; the thread that owns the slot holds the other half,
+// so the owner knows the slot's value and no other thread can change it.
+predicate_ctor counter_slot_space(int *p)() =
+  [1/2]integer(p, ?value) &*& 0 <= value;
+
+// The halves of the atomic spaces of slots i up to n that the slots' owners do not hold.
+predicate counter_spaces(int *slots, int stride, int i, int n;) =
+  i == n ?
+    true
+  :
+    [1/2]atomic_space(counter_slot_space(slots + i * stride)) &*& counter_spaces(slots, stride, i + 1, n);
+
+predicate Counter(struct Counter *c; int *slots, int slotCount, int stride) =
+  c->slots |-> slots &*& c->slotCount |-> slotCount &*& c->stride |-> stride &*& 0 < slotCount &*& 0 < stride &*&
+  slotCount * stride <= INT_MAX &*& malloc_block_ints(slots, slotCount * stride) &*& malloc_block_Counter(c) &*&
+  counter_spaces(slots, stride, 0, slotCount);
+
+// The owner's part of slot i: half of the slot and of its atomic space, followed by the padding that separates it
+// from slot i + 1.
+predicate counter_slot(int *slots, int stride, int i; int value) =
+  [1/2]integer(slots + i * stride, value) &*& 0 <= value &*& ints_(slots + i * stride + 1, stride - 1, _) &*&
+  [1/2]atomic_space(counter_slot_space(slots + i * stride));
+
+predicate counter_slots(int *slots, int stride, int i, int n; list<int> values) =
+  i == n ?
+    values == nil
+  :
+    counter_slot(slots, stride, i, ?value) &*& counter_slots(slots, stride, i + 1, n, ?values0) &*& values == cons(value, values0);
+
+predicate_ctor counter_slot_half(int *p, int value)() =
+  [1/2]integer(p, value) &*& 0 <= value;
+
+predicate counter_slot_read_pre() = emp;
+
+predicate counter_slot_read_post(int value) = 0 <= value;
+@*/
+
+struct Counter *init(int slotCount, int stride)
+//@ requires 0 < slotCount &*& 0 < stride &*& slotCount * stride <= INT_MAX;
+//@ ensures Counter(result, ?slots, slotCount, stride) &*& counter_slots(slots, stride, 0, slotCount, ?values) &*& all_eq(values, 0) == true;
+{
+  struct Counter *c = malloc(sizeof(struct Counter));
+  int *slots = malloc((size_t)(slotCount * stride) * sizeof(int));
+  if (c == 0 || slots == 0) {
+    abort();
+  }
+  c->slots = slots;
+  c->slotCount = slotCount;
+  c->stride = stride;
+  for (int i = slotCount; 0 < i; i--)
+  {
+    slots[(i - 1) * stride] = 0;
+  }
+  return c;
+}
+
+/*
+Increments the given slot. Only the thread that owns the slot may call this, but any number of threads may
+increment their own slots at the same time, and get may read the slot meanwhile.
+*/
+void increment(struct Counter *c, int slot)
+//@ requires [?f]Counter(c, ?slots, ?slotCount, ?stride) &*& counter_slot(slots, stride, slot, ?v) &*& v < INT_MAX;
+//@ ensures [f]Counter(c, slots, slotCount, stride) &*& counter_slot(slots, stride, slot, v + 1);
+{
+  int *p = c->slots + slot * c->stride;
+  // Only this thread writes the slot, so a plain read sees the value it stored last.
+  int value = *p;
+  atomic_store_explicit(p, value + 1, memory_order_relaxed);
+}
+
+/*
+Adds up slots i up to n, reading each with one relaxed atomic load. Reading a slot needs only a fraction of its
+atomic space, so several threads may aggregate at once, while the owners increment their slots.
+*/
+long long counter_slots_sum(int *slots, int stride, int i, int n)
+//@ requires [?f]counter_spaces(slots, stride, i, n) &*& 0 <= i &*& i <= n;
+//@ ensures [f]counter_spaces(slots, stride, i, n) &*& 0 <= result &*& result <= (n - i) * INT_MAX;
+{
+  if (i == n) {
+    return 0;
+  }
+  int *p = slots + i * stride;
+  int value = atomic_load_explicit(p, memory_order_relaxed);
+  long long rest = counter_slots_sum(slots, stride, i + 1, n);
+  return value + rest;
+}
+
+/*
+Returns the sum of the slots. get may run while threads increment their slots; since slots only grow, the result then
+lies between the count when get was called and the count when it returned.
+*/
+long long get(struct Counter *c)
+//@ requires [?f]Counter(c, ?slots, ?slotCount, ?stride);
+//@ ensures [f]Counter(c, slots, slotCount, stride) &*& 0 <= result;
+{
+  return counter_slots_sum(c->slots, c->stride, 0, c->slotCount);
+}
+
+void dispose(struct Counter *c)
+//@ requires Counter(c, ?slots, ?slotCount, ?stride) &*& counter_slots(slots, stride, 0, slotCount, _);
+//@ ensures emp;
+{
+  free(c->slots);
+  free(c);
+}
+
+// The counters the benchmark compares the sharded counter with: a single int under a mutex, and a single int that
+// the threads increment with atomic_fetch_add.
+
+struct LockedCounter {
+  int value;
+  struct mutex *mutex;
+};
+
+/*@
+predicate_ctor locked_counter_inv(struct LockedCounter *c)() =
+  c->value |-> _;
+
+predicate LockedCounter(struct LockedCounter *c;) =
+  c->mutex |-> ?mutex &*& mutex(mutex, locked_counter_inv(c)) &*& malloc_block_LockedCounter(c);
+@*/
+
+struct LockedCounter *locked_counter_init()
+//@ requires emp;
+//@ ensures LockedCounter(result);
+{
+  struct LockedCounter *c = malloc(sizeof(struct LockedCounter));
+  if (c == 0) {
+    abort();
+  }
+  c->value = 0;
+  c->mutex = create_mutex();
+  return c;
+}
+
+void locked_counter_increment(struct LockedCounter *c)
+//@ requires [?f]LockedCounter(c);
+//@ ensures [f]LockedCounter(c);
+{
+  mutex_acquire(c->mutex);
+  c->value++;
+  mutex_release(c->mutex);
+}
+
+int locked_counter_dispose(struct LockedCounter *c)
+//@ requires LockedCounter(c);
+//@ ensures emp;
+{
+  mutex_dispose(c->mutex);
+  int value = c->value;
+  free(c);
+  return value;
+}
+
+struct AtomicCounter {
+  int value;
+};
+
+/*@
+predicate_ctor atomic_counter_inv(struct AtomicCounter *c)() =
+  c->value |-> _;
+
+predicate AtomicCounter(struct AtomicCounter *c;) =
+  atomic_space(atomic_counter_inv(c)) &*& malloc_block_AtomicCounter(c);
+
+predicate atomic_counter_pre() = emp;
+
+predicate atomic_counter_post(int value) = emp;
+@*/
+
+struct AtomicCounter *atomic_counter_init()
+//@ requires emp;
+//@ ensures AtomicCounter(result);
+{
+  struct AtomicCounter *c = malloc(sizeof(struct AtomicCounter));
+  if (c == 0) {
+    abort();
+  }
+  c->value = 0;
+  return c;
+}
+
+void atomic_counter_increment(struct AtomicCounter *c)
+//@ requires [?f]AtomicCounter(c);
+//@ ensures [f]AtomicCounter(c);
+{
+  atomic_fetch_add(&c->value, 1);
+}
+
+int atomic_counter_dispose(struct AtomicCounter *c)
+//@ requires AtomicCounter(c);
+//@ ensures emp;
+{
+  int value = c->value;
+  free(c);
+  return value;
+}
+
+#define MAX_THREADS 16
+#define INCREMENTS_PER_THREAD 1048576
+
+struct bench_thread {
+  struct Counter *counter;
+  struct LockedCounter *locked_counter;
+  struct AtomicCounter *atomic_counter;
+  int slot;
+  struct thread *thread;
+};
+
+/*@
+// The fraction of its counter that each benchmark thread holds. There are at most MAX_THREADS threads, so the
+// benchmark keeps at least half of the counter while they run, and has all of it back once it has joined them.
+fixpoint real thread_share() { return 1/32; }
+
+predicate_family_instance thread_run_pre(sharded_bench_run)(struct bench_thread *t, any info) =
+  t->counter |-> ?c &*& t->slot |-> ?slot &*&
+  [thread_share()]Counter(c, ?slots, _, ?stride) &*& counter_slot(slots, stride, slot, 0);
+predicate_family_instance thread_run_post(sharded_bench_run)(struct bench_thread *t, any info) =
+  t->counter |-> ?c &*& t->slot |-> ?slot &*&
+  [thread_share()]Counter(c, ?slots, _, ?stride) &*& counter_slot(slots, stride, slot, INCREMENTS_PER_THREAD);
+
+predicate_family_instance thread_run_pre(locked_bench_run)(struct bench_thread *t, any info) =
+  t->locked_counter |-> ?c &*& [thread_share()]LockedCounter(c);
+predicate_family_instance thread_run_post(locked_bench_run)(struct bench_thread *t, any info) =
+  t->locked_counter |-> ?c &*& [thread_share()]LockedCounter(c);
+
+predicate_family_instance thread_run_pre(atomic_bench_run)(struct bench_thread *t, any info) =
+  t->atomic_counter |-> ?c &*& [thread_share()]AtomicCounter(c);
+predicate_family_instance thread_run_post(atomic_bench_run)(struct bench_thread *t, any info) =
+  t->atomic_counter |-> ?c &*& [thread_share()]AtomicCounter(c);
+@*/
+
+void sharded_bench_run(struct bench_thread *t) //@ : thread_run_joinable
+//@ requires thread_run_pre(sharded_bench_run)(t, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(sharded_bench_run)(t, info) &*& lockset(currentThread, nil);
+{
+  struct Counter *c = t->counter;
+  int slot = t->slot;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    increment(c, slot);
+  }
+}
+
+void locked_bench_run(struct bench_thread *t) //@ : thread_run_joinable
+//@ requires thread_run_pre(locked_bench_run)(t, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(locked_bench_run)(t, info) &*& lockset(currentThread, nil);
+{
+  struct LockedCounter *c = t->locked_counter;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    locked_counter_increment(c);
+  }
+}
+
+void atomic_bench_run(struct bench_thread *t) //@ : thread_run_joinable
+//@ requires thread_run_pre(atomic_bench_run)(t, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(atomic_bench_run)(t, info) &*& lockset(currentThread, nil);
+{
+  struct AtomicCounter *c = t->atomic_counter;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    atomic_counter_increment(c);
+  }
+}
+
+/*
+Lets threadCount threads increment one mutex-protected int, and returns the elapsed time in nanoseconds. Stores the
+final count in counted.
+*/
+long long bench_locked(struct bench_thread *threads, int threadCount, int *counted)
+//@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+//@ ensures threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+{
+  struct LockedCounter *c = locked_counter_init();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].locked_counter = c;
+    threads[i].thread = thread_start_joinable(locked_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = locked_counter_dispose(c);
+  return nanos;
+}
+
+/*
+Lets threadCount threads increment one int with atomic_fetch_add, and returns the elapsed time in nanoseconds.
+Stores the final count in counted.
+*/
+long long bench_atomic(struct bench_thread *threads, int threadCount, int *counted)
+//@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+//@ ensures threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+{
+  struct AtomicCounter *c = atomic_counter_init();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].atomic_counter = c;
+    threads[i].thread = thread_start_joinable(atomic_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = atomic_counter_dispose(c);
+  return nanos;
+}
+
+/*
+Lets threadCount threads each increment their own slot of a sharded counter whose slots are stride ints apart, and
+returns the elapsed time in nanoseconds. Stores the sum of the slots in counted.
+*/
+long long bench_sharded(struct bench_thread *threads, int threadCount, int stride, long long *counted)
+//@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& 0 < stride &*& stride <= COUNTER_PADDED_STRIDE &*& threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+//@ ensures threads[..MAX_THREADS] |-> _ &*& *counted |-> _;
+{
+  struct Counter *c = init(threadCount, stride);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].counter = c;
+    threads[i].slot = i;
+    threads[i].thread = thread_start_joinable(sharded_bench_run, &threads[i]);
+  }
+  // Join the threads last to first, so that their slots can be put back in order.
+  for (int i = threadCount; 0 < i; i--)
+  {
+    thread_join(threads[i - 1].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = get(c);
+  dispose(c);
+  return nanos;
+}
+
+/*
+Lets threadCount threads increment each kind of counter INCREMENTS_PER_THREAD times and prints the average time
+per increment for each. Returns whether every counter counted every increment.
+*/
+bool bench(struct bench_thread *threads, int threadCount)
+//@ requires 0 < threadCount &*& threadCount <= MAX_THREADS &*& threads[..MAX_THREADS] |-> _;
+//@ ensures threads[..MAX_THREADS] |-> _;
+{
+  int total = threadCount * INCREMENTS_PER_THREAD;
+  int lockedTotal;
+  long long lockedNanos = bench_locked(threads, threadCount, &lockedTotal);
+  int atomicTotal;
+  long long atomicNanos = bench_atomic(threads, threadCount, &atomicTotal);
+  // Adjacent slots, which share cache lines.
+  long long unpaddedTotal;
+  long long unpaddedNanos = bench_sharded(threads, threadCount, 1, &unpaddedTotal);
+  long long paddedTotal;
+  long long paddedNanos = bench_sharded(threads, threadCount, COUNTER_PADDED_STRIDE, &paddedTotal);
+  printf("%2d threads, ns per increment: mutex %d, atomic %d, sharded %d, sharded and padded %d\n", threadCount,
+    (int)(lockedNanos / total), (int)(atomicNanos / total), (int)(unpaddedNanos / total), (int)(paddedNanos / total));
+  return lockedTotal == total && atomicTotal == total && unpaddedTotal == total && paddedTotal == total;
+}
+
+int main() //@ : main
+//@ requires emp;
+//@ ensures emp;
+{
+  struct bench_thread *threads = malloc(MAX_THREADS * sizeof(struct bench_thread));
+  if (threads == 0) {
+    abort();
+  }
+  bool ok = true;
+  for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+  {
+    ok = bench(threads, threadCount) && ok;
+  }
+  free(threads);
+  if (!ok) {
+    printf("lost increments\n");
+    return 1;
+  }
+  return 0;
+}
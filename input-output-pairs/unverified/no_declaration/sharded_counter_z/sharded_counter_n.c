@@ -0,0 +1,404 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A counter that many threads increment at once. Each thread has a slot of its own and is the only one that writes
+// it, so the threads do not write to a shared location. A slot is written with a relaxed atomic store and read by get
+// with a relaxed atomic load, so get can add up the slots while threads are incrementing them; since only the owner
+// writes a slot, the store needs no read-modify-write instruction. Slots are stride ints apart: with
+// COUNTER_PADDED_STRIDE, two slots are at least a cache line (64 bytes) apart, so they never share one.
+
+#define COUNTER_PADDED_STRIDE 16
+
+struct Counter {
+  int *slots;
+  int slotCount;
+  int stride;
+};
+
+/**
+ * Description:
+ * The init function creates a sharded counter with slotCount slots, placed stride ints apart, and sets every slot to 0. With a stride of COUNTER_PADDED_STRIDE, no two slots share a cache line.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param slotCount The number of slots, one for each thread that will increment the counter.
+ * @param stride The distance between consecutive slots, in ints.
+ *
+ * @return A pointer to the new counter.
+ */
+struct Counter *init(int slotCount, int stride)
+{
+  struct Counter *c = malloc(sizeof(struct Counter));
+  int *slots = malloc((size_t)(slotCount * stride) * sizeof(int));
+  if (c == 0 || slots == 0) {
+    abort();
+  }
+  c->slots = slots;
+  c->slotCount = slotCount;
+  c->stride = stride;
+  for (int i = slotCount; 0 < i; i--)
+  {
+    slots[(i - 1) * stride] = 0;
+  }
+  return c;
+}
+
+/**
+ * Description:
+ * The increment function increments one slot of the counter. It writes only that slot, so threads that increment different slots do not write to a shared location. Since only the owning thread writes the slot, it reads the slot plainly and stores the new value with a relaxed atomic store, so that get may read the slot at the same time.
+ *
+ * @param c A pointer to the counter.
+ * @param slot The index of the slot, which must be owned by the calling thread.
+ */
+void increment(struct Counter *c, int slot)
+{
+  int *p = c->slots + slot * c->stride;
+  // Only this thread writes the slot, so a plain read sees the value it stored last.
+  int value = *p;
+  atomic_store_explicit(p, value + 1, memory_order_relaxed);
+}
+
+/**
+ * Description:
+ * The counter_slots_sum function adds up the values of slots i up to n. It reads each slot with one relaxed atomic load, so the owners of the slots may increment them meanwhile.
+ *
+ * @param slots A pointer to the first slot.
+ * @param stride The distance between consecutive slots, in ints.
+ * @param i The index of the first slot to add.
+ * @param n The index just past the last slot to add.
+ *
+ * @return The sum of the values of the slots.
+ */
+long long counter_slots_sum(int *slots, int stride, int i, int n)
+{
+  if (i == n) {
+    return 0;
+  }
+  int *p = slots + i * stride;
+  int value = atomic_load_explicit(p, memory_order_relaxed);
+  long long rest = counter_slots_sum(slots, stride, i + 1, n);
+  return value + rest;
+}
+
+/**
+ * Description:
+ * The get function aggregates the counter on demand by adding up all its slots. It may run while threads increment their slots; since the slots only grow, the result then lies between the count when get was called and the count when it returned.
+ *
+ * @param c A pointer to the counter.
+ *
+ * @return The sum of the slots.
+ */
+long long get(struct Counter *c)
+{
+  return counter_slots_sum(c->slots, c->stride, 0, c->slotCount);
+}
+
+/**
+ * Description:
+ * The dispose function frees the counter and its slots.
+ *
+ * @param c A pointer to the counter.
+ */
+void dispose(struct Counter *c)
+{
+  free(c->slots);
+  free(c);
+}
+
+// The counters the benchmark compares the sharded counter with: a single int under a mutex, and a single int that
+// the threads increment with atomic_fetch_add.
+
+struct LockedCounter {
+  int value;
+  struct mutex *mutex;
+};
+
+/**
+ * Description:
+ * The locked_counter_init function creates a counter that consists of a single int protected by a mutex, with value 0. If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the new counter.
+ */
+struct LockedCounter *locked_counter_init()
+{
+  struct LockedCounter *c = malloc(sizeof(struct LockedCounter));
+  if (c == 0) {
+    abort();
+  }
+  c->value = 0;
+  c->mutex = create_mutex();
+  return c;
+}
+
+/**
+ * Description:
+ * The locked_counter_increment function increments the counter while holding its mutex.
+ *
+ * @param c A pointer to the counter.
+ */
+void locked_counter_increment(struct LockedCounter *c)
+{
+  mutex_acquire(c->mutex);
+  c->value++;
+  mutex_release(c->mutex);
+}
+
+/**
+ * Description:
+ * The locked_counter_dispose function disposes of the counter's mutex and frees the counter.
+ *
+ * @param c A pointer to the counter.
+ *
+ * @return The final value of the counter.
+ */
+int locked_counter_dispose(struct LockedCounter *c)
+{
+  mutex_dispose(c->mutex);
+  int value = c->value;
+  free(c);
+  return value;
+}
+
+struct AtomicCounter {
+  int value;
+};
+
+/**
+ * Description:
+ * The atomic_counter_init function creates a counter that consists of a single int, which threads increment atomically. Its value is 0. If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the new counter.
+ */
+struct AtomicCounter *atomic_counter_init()
+{
+  struct AtomicCounter *c = malloc(sizeof(struct AtomicCounter));
+  if (c == 0) {
+    abort();
+  }
+  c->value = 0;
+  return c;
+}
+
+/**
+ * Description:
+ * The atomic_counter_increment function increments the counter with atomic_fetch_add.
+ *
+ * @param c A pointer to the counter.
+ */
+void atomic_counter_increment(struct AtomicCounter *c)
+{
+  atomic_fetch_add(&c->value, 1);
+}
+
+/**
+ * Description:
+ * The atomic_counter_dispose function frees the counter.
+ *
+ * @param c A pointer to the counter.
+ *
+ * @return The final value of the counter.
+ */
+int atomic_counter_dispose(struct AtomicCounter *c)
+{
+  int value = c->value;
+  free(c);
+  return value;
+}
+
+#define MAX_THREADS 16
+#define INCREMENTS_PER_THREAD 1048576
+
+struct bench_thread {
+  struct Counter *counter;
+  struct LockedCounter *locked_counter;
+  struct AtomicCounter *atomic_counter;
+  int slot;
+  struct thread *thread;
+};
+
+/**
+ * Description:
+ * The sharded_bench_run function is the body of a sharded benchmark thread. It increments the thread's slot of the sharded counter INCREMENTS_PER_THREAD times.
+ *
+ * @param t A pointer to the bench_thread.
+ */
+void sharded_bench_run(struct bench_thread *t)
+{
+  struct Counter *c = t->counter;
+  int slot = t->slot;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    increment(c, slot);
+  }
+}
+
+/**
+ * Description:
+ * The locked_bench_run function is the body of a mutex benchmark thread. It increments the locked counter INCREMENTS_PER_THREAD times.
+ *
+ * @param t A pointer to the bench_thread.
+ */
+void locked_bench_run(struct bench_thread *t)
+{
+  struct LockedCounter *c = t->locked_counter;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    locked_counter_increment(c);
+  }
+}
+
+/**
+ * Description:
+ * The atomic_bench_run function is the body of an atomic benchmark thread. It increments the atomic counter INCREMENTS_PER_THREAD times.
+ *
+ * @param t A pointer to the bench_thread.
+ */
+void atomic_bench_run(struct bench_thread *t)
+{
+  struct AtomicCounter *c = t->atomic_counter;
+  for (int i = 0; i < INCREMENTS_PER_THREAD; i++)
+  {
+    atomic_counter_increment(c);
+  }
+}
+
+/**
+ * Description:
+ * The bench_locked function lets threadCount threads increment one mutex-protected counter, and measures how long that takes.
+ *
+ * @param threads An array of MAX_THREADS bench_thread structures.
+ * @param threadCount The number of threads, between 1 and MAX_THREADS.
+ * @param counted Receives the final value of the counter.
+ *
+ * @return The elapsed time in nanoseconds.
+ */
+long long bench_locked(struct bench_thread *threads, int threadCount, int *counted)
+{
+  struct LockedCounter *c = locked_counter_init();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].locked_counter = c;
+    threads[i].thread = thread_start_joinable(locked_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = locked_counter_dispose(c);
+  return nanos;
+}
+
+/**
+ * Description:
+ * The bench_atomic function lets threadCount threads increment one atomic counter, and measures how long that takes.
+ *
+ * @param threads An array of MAX_THREADS bench_thread structures.
+ * @param threadCount The number of threads, between 1 and MAX_THREADS.
+ * @param counted Receives the final value of the counter.
+ *
+ * @return The elapsed time in nanoseconds.
+ */
+long long bench_atomic(struct bench_thread *threads, int threadCount, int *counted)
+{
+  struct AtomicCounter *c = atomic_counter_init();
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].atomic_counter = c;
+    threads[i].thread = thread_start_joinable(atomic_bench_run, &threads[i]);
+  }
+  for (int i = 0; i < threadCount; i++)
+  {
+    thread_join(threads[i].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = atomic_counter_dispose(c);
+  return nanos;
+}
+
+/**
+ * Description:
+ * The bench_sharded function lets threadCount threads each increment their own slot of a sharded counter, and measures how long that takes. The threads are joined last to first.
+ *
+ * @param threads An array of MAX_THREADS bench_thread structures.
+ * @param threadCount The number of threads, between 1 and MAX_THREADS.
+ * @param stride The distance between the counter's slots, in ints.
+ * @param counted Receives the sum of the slots.
+ *
+ * @return The elapsed time in nanoseconds.
+ */
+long long bench_sharded(struct bench_thread *threads, int threadCount, int stride, long long *counted)
+{
+  struct Counter *c = init(threadCount, stride);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < threadCount; i++)
+  {
+    threads[i].counter = c;
+    threads[i].slot = i;
+    threads[i].thread = thread_start_joinable(sharded_bench_run, &threads[i]);
+  }
+  // Join the threads last to first, so that their slots can be put back in order.
+  for (int i = threadCount; 0 < i; i--)
+  {
+    thread_join(threads[i - 1].thread);
+  }
+  long long nanos = clock_now_nanos() - start;
+  *counted = get(c);
+  dispose(c);
+  return nanos;
+}
+
+/**
+ * Description:
+ * The bench function lets threadCount threads increment each kind of counter: mutex, atomic, sharded with adjacent slots, and sharded with padded slots. It prints the average time per increment for each kind.
+ *
+ * @param threads An array of MAX_THREADS bench_thread structures.
+ * @param threadCount The number of threads, between 1 and MAX_THREADS.
+ *
+ * @return True if every counter counted every increment, false otherwise.
+ */
+bool bench(struct bench_thread *threads, int threadCount)
+{
+  int total = threadCount * INCREMENTS_PER_THREAD;
+  int lockedTotal;
+  long long lockedNanos = bench_locked(threads, threadCount, &lockedTotal);
+  int atomicTotal;
+  long long atomicNanos = bench_atomic(threads, threadCount, &atomicTotal);
+  // Adjacent slots, which share cache lines.
+  long long unpaddedTotal;
+  long long unpaddedNanos = bench_sharded(threads, threadCount, 1, &unpaddedTotal);
+  long long paddedTotal;
+  long long paddedNanos = bench_sharded(threads, threadCount, COUNTER_PADDED_STRIDE, &paddedTotal);
+  printf("%2d threads, ns per increment: mutex %d, atomic %d, sharded %d, sharded and padded %d\n", threadCount,
+    (int)(lockedNanos / total), (int)(atomicNanos / total), (int)(unpaddedNanos / total), (int)(paddedNanos / total));
+  return lockedTotal == total && atomicTotal == total && unpaddedTotal == total && paddedTotal == total;
+}
+
+/**
+ * Description:
+ * The main function runs the benchmark with 1, 2, 4, and so on up to MAX_THREADS threads.
+ *
+ * @return 0 if no increment was lost, 1 otherwise.
+ */
+int main()
+{
+  struct bench_thread *threads = malloc(MAX_THREADS * sizeof(struct bench_thread));
+  if (threads == 0) {
+    abort();
+  }
+  bool ok = true;
+  for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+  {
+    ok = bench(threads, threadCount) && ok;
+  }
+  free(threads);
+  if (!ok) {
+    printf("lost increments\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,328 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+//@ #include "ghostlist.gh"
+
+// An immutable buffer that threads share without a lock. Each reference is a ticket, as in fractions-counting: the
+// buffer counts its tickets, and the holder of a ticket may read the buffer. The count is updated with atomic
+// operations, and the thread that drops the last ticket frees the buffer.
+
+struct shared_buffer {
+  int refs;
+  int length;
+  char *chars;
+  //@ int ghost_list_id;
+};
+
+/*@
+fixpoint real real_sum(list<real> fracs) {
+  switch (fracs) {
+    case nil: return 0;
+    case cons(frac, fracs0): return frac + real_sum(fracs0);
+  }
+}
+
+fixpoint bool all_pos(list<real> fracs) {
+  switch (fracs) {
+    case nil: return true;
+    case cons(frac, fracs0): return 0 < frac && all_pos(fracs0);
+  }
+}
+
+predicate shared_buffer_contents(struct shared_buffer *b; list<char> cs) =
+  b->length |-> ?length &*& b->chars |-> ?chars &*& chars(chars, length, cs) &*& malloc_block_chars(chars, length) &*&
+  malloc_block_shared_buffer(b);
+
+// The counter of a buffer lives in its atomic space. It records the fraction of the contents that each ticket holds,
+// and keeps the count and the rest of the contents. Once the last ticket is dropped, it keeps nothing else: the
+// thread that dropped it took the count and the whole contents away to free them.
+predicate counter(struct shared_buffer *b, list<char> cs, int nbTickets) =
+  [_]b->ghost_list_id |-> ?id &*& ghost_list<real>(id, ?fracs) &*& nbTickets == length(fracs) &*& all_pos(fracs) == true &*&
+  nbTickets == 0 ?
+    true
+  :
+    b->refs |-> nbTickets &*& 0 < real_sum(fracs) &*& real_sum(fracs) < 1 &*& [1 - real_sum(fracs)]shared_buffer_contents(b, cs);
+
+predicate_ctor shared_buffer_inv(struct shared_buffer *b, list<char> cs)() =
+  counter(b, cs, _);
+
+predicate ticket(struct shared_buffer *b, list<char> cs, real frac) =
+  [_]atomic_space(shared_buffer_inv(b, cs)) &*& [_]b->ghost_list_id |-> ?id &*& ghost_list_member_handle<real>(id, frac) &*&
+  [frac]shared_buffer_contents(b, cs);
+@*/
+
+/*
+Creates a buffer that holds a copy of the given chars, and returns the first ticket for it.
+*/
+struct shared_buffer *create_shared_buffer(char *chars, int length)
+//@ requires [?f]chars(chars, length, ?cs) &*& 0 <= length;
+//@ ensures [f]chars(chars, length, cs) &*& ticket(result, cs, _);
+{
+  struct shared_buffer *b = malloc(sizeof(struct shared_buffer));
+  char *copy = malloc((size_t)length);
+  if (b == 0 || copy == 0) {
+    abort();
+  }
+  memcpy(copy, chars, (size_t)length);
+  b->refs = 1;
+  b->length = length;
+  b->chars = copy;
+  //@ int id = create_ghost_list<real>();
+  //@ b->ghost_list_id = id;
+  //@ leak b->ghost_list_id |-> id;
+  //@ ghost_list_add(id, 1/2);
+  //@ close counter(b, cs, 1);
+  //@ close shared_buffer_inv(b, cs)();
+  //@ create_atomic_space(shared_buffer_inv(b, cs));
+  //@ leak atomic_space(shared_buffer_inv(b, cs));
+  //@ close ticket(b, cs, 1/2);
+  return b;
+}
+
+/*@
+predicate_ctor acquire_pre(struct shared_buffer *b, list<char> cs, real frac)() =
+  [_]b->ghost_list_id |-> ?id &*& ghost_list_member_handle<real>(id, frac);
+
+predicate_ctor acquire_post(struct shared_buffer *b, list<char> cs, real frac)(int value) =
+  [_]b->ghost_list_id |-> ?id &*& ghost_list_member_handle<real>(id, frac / 2) &*& ghost_list_member_handle<real>(id, frac / 2);
+@*/
+
+/*
+Adds a ticket for a buffer, for the caller to hand to another thread. The caller must hold a ticket, so the count
+is at least one and cannot drop to zero meanwhile; the increment therefore publishes nothing and can be relaxed.
+*/
+void shared_buffer_acquire(struct shared_buffer *b)
+//@ requires ticket(b, ?cs, ?frac);
+//@ ensures ticket(b, cs, frac / 2) &*& ticket(b, cs, frac / 2);
+{
+  //@ open ticket(b, cs, frac);
+  //@ close acquire_pre(b, cs, frac)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_fetch_add_ghop(&b->refs, 1, shared_buffer_inv(b, cs), acquire_pre(b, cs, frac), acquire_post(b, cs, frac))() {
+    assert is_atomic_fetch_add_op(?op, _, _, ?P, ?Q);
+    open shared_buffer_inv(b, cs)();
+    open counter(b, cs, ?n);
+    open acquire_pre(b, cs, frac)();
+    assert [_]b->ghost_list_id |-> ?id &*& ghost_list<real>(id, ?fracs);
+    ghost_list_member_handle_lemma(id, frac);
+    op();
+    assert Q(?value);
+    ghost_list_remove(id, frac);
+    real_sum_remove(fracs, frac);
+    all_pos_mem(fracs, frac);
+    all_pos_remove(fracs, frac);
+    ghost_list_add(id, frac / 2);
+    ghost_list_add(id, frac / 2);
+    close counter(b, cs, n + 1);
+    close shared_buffer_inv(b, cs)();
+    close acquire_post(b, cs, frac)(value);
+  }
+  @*/
+  atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+  //@ open acquire_post(b, cs, frac)(_);
+  //@ close ticket(b, cs, frac / 2);
+  //@ close ticket(b, cs, frac / 2);
+}
+
+/*@
+predicate_ctor release_pre(struct shared_buffer *b, list<char> cs, real frac)() =
+  [_]b->ghost_list_id |-> ?id &*& ghost_list_member_handle<real>(id, frac) &*& [frac]shared_buffer_contents(b, cs);
+
+predicate_ctor release_post(struct shared_buffer *b, list<char> cs)(int value) =
+  value == 1 ? b->refs |-> 0 &*& shared_buffer_contents(b, cs) : true;
+@*/
+
+/*
+Drops a ticket. The thread that drops the last one frees the buffer. The decrement is a release, so that every
+thread's reads of the buffer happen before the free, and an acquire, so that the thread that frees the buffer sees
+the other threads' decrements.
+*/
+void shared_buffer_release(struct shared_buffer *b)
+//@ requires ticket(b, ?cs, ?frac);
+//@ ensures true;
+{
+  //@ open ticket(b, cs, frac);
+  //@ close release_pre(b, cs, frac)();
+  /*@
+  produce_lemma_function_pointer_chunk
+    atomic_fetch_add_ghop(&b->refs, -1, shared_buffer_inv(b, cs), release_pre(b, cs, frac), release_post(b, cs))() {
+    assert is_atomic_fetch_add_op(?op, _, _, ?P, ?Q);
+    open shared_buffer_inv(b, cs)();
+    open counter(b, cs, ?n);
+    open release_pre(b, cs, frac)();
+    assert [_]b->ghost_list_id |-> ?id &*& ghost_list<real>(id, ?fracs);
+    ghost_list_member_handle_lemma(id, frac);
+    op();
+    assert Q(?value);
+    ghost_list_remove(id, frac);
+    real_sum_remove(fracs, frac);
+    all_pos_remove(fracs, frac);
+    if (n != 1) {
+      all_pos_sum(remove(frac, fracs));
+    }
+    // If the caller held the only ticket, the fractions of the counter and the ticket make up the whole contents.
+    close release_post(b, cs)(value);
+    close counter(b, cs, n - 1);
+    close shared_buffer_inv(b, cs)();
+  }
+  @*/
+  int refs = atomic_fetch_add_explicit(&b->refs, -1, memory_order_acq_rel);
+  //@ open release_post(b, cs)(refs);
+  if (refs == 1) {
+    //@ open shared_buffer_contents(b, cs);
+    free(b->chars);
+    free(b);
+  }
+}
+
+/*@
+lemma void real_sum_remove(list<real> fracs, real frac)
+  requires mem(frac, fracs) == true;
+  ensures real_sum(remove(frac, fracs)) == real_sum(fracs) - frac;
+{
+  switch (fracs) {
+    case nil:
+    case cons(frac0, fracs0): if (frac0 != frac) real_sum_remove(fracs0, frac);
+  }
+}
+
+lemma void all_pos_mem(list<real> fracs, real frac)
+  requires all_pos(fracs) == true &*& mem(frac, fracs) == true;
+  ensures 0 < frac;
+{
+  switch (fracs) {
+    case nil:
+    case cons(frac0, fracs0): if (frac0 != frac) all_pos_mem(fracs0, frac);
+  }
+}
+
+lemma void all_pos_remove(list<real> fracs, real frac)
+  requires all_pos(fracs) == true;
+  ensures all_pos(remove(frac, fracs)) == true;
+{
+  switch (fracs) {
+    case nil:
+    case cons(frac0, fracs0): if (frac0 != frac) all_pos_remove(fracs0, frac);
+  }
+}
+
+// The tickets that remain hold some of the contents, so the counter's share stays below one.
+lemma void all_pos_sum(list<real> fracs)
+  requires all_pos(fracs) == true &*& fracs != nil;
+  ensures 0 < real_sum(fracs);
+{
+  switch (fracs) {
+    case nil:
+    case cons(frac0, fracs0): if (fracs0 != nil) all_pos_sum(fracs0);
+  }
+}
+@*/
+
+/*
+Returns the sum of the chars of a buffer. The caller only needs a ticket.
+*/
+int shared_buffer_checksum(struct shared_buffer *b)
+//@ requires ticket(b, ?cs, ?frac);
+//@ ensures ticket(b, cs, frac);
+{
+  //@ open ticket(b, cs, frac);
+  //@ open [frac]shared_buffer_contents(b, cs);
+  int sum = 0;
+  char *chars = b->chars;
+  for (int i = 0; i < b->length; i++)
+  //@ invariant [frac]b->length |-> ?length &*& [frac]chars(chars, length, cs) &*& 0 <= i;
+  {
+    sum = (sum + (unsigned char)chars[i]) % 65521;
+  }
+  //@ close [frac]shared_buffer_contents(b, cs);
+  //@ close ticket(b, cs, frac);
+  return sum;
+}
+
+#define THREAD_COUNT 8
+#define BUFFER_LENGTH 65536
+#define ROUNDS 1000000
+
+struct reader {
+  struct shared_buffer *buffer;
+  int checksum;
+  struct thread *thread;
+};
+
+/*@
+predicate_family_instance thread_run_pre(reader_run)(struct reader *reader, any info) =
+  reader->buffer |-> ?b &*& ticket(b, _, _) &*& reader->checksum |-> _;
+predicate_family_instance thread_run_post(reader_run)(struct reader *reader, any info) =
+  reader->buffer |-> _ &*& reader->checksum |-> _;
+@*/
+
+/*
+Takes and drops ROUNDS extra tickets for the reader's buffer, as a thread would when it passes the buffer on, then
+computes the buffer's checksum and drops the reader's own ticket.
+*/
+void reader_run(struct reader *reader) //@ : thread_run_joinable
+//@ requires thread_run_pre(reader_run)(reader, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(reader_run)(reader, info) &*& lockset(currentThread, nil);
+{
+  //@ open thread_run_pre(reader_run)(reader, info);
+  struct shared_buffer *b = reader->buffer;
+  for (int i = 0; i < ROUNDS; i++)
+  //@ invariant ticket(b, ?cs, ?frac);
+  {
+    shared_buffer_acquire(b);
+    shared_buffer_release(b);
+  }
+  reader->checksum = shared_buffer_checksum(b);
+  shared_buffer_release(b);
+  //@ close thread_run_post(reader_run)(reader, info);
+}
+
+/*
+Shares one buffer among THREAD_COUNT readers and drops the main thread's ticket while they run, so that the last
+reader to finish frees the buffer. Prints the average time of a ticket acquire and release.
+*/
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+  char *chars = malloc(BUFFER_LENGTH);
+  struct reader *readers = malloc(THREAD_COUNT * sizeof(struct reader));
+  if (chars == 0 || readers == 0) {
+    abort();
+  }
+  for (int i = 0; i < BUFFER_LENGTH; i++)
+  //@ invariant chars[..i] |-> _ &*& chars[i..BUFFER_LENGTH] |-> _;
+  {
+    chars[i] = (char)('a' + i % 26);
+  }
+  struct shared_buffer *b = create_shared_buffer(chars, BUFFER_LENGTH);
+  free(chars);
+  int expected = shared_buffer_checksum(b);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < THREAD_COUNT; i++)
+  //@ invariant ticket(b, ?cs, ?frac) &*& readers[i..THREAD_COUNT] |-> _;
+  {
+    shared_buffer_acquire(b);
+    readers[i].buffer = b;
+    //@ close thread_run_pre(reader_run)(&readers[i], unit);
+    readers[i].thread = thread_start_joinable(reader_run, &readers[i]);
+  }
+  shared_buffer_release(b);
+  bool ok = true;
+  for (int i = 0; i < THREAD_COUNT; i++)
+  //@ invariant 0 <= i;
+  {
+    thread_join(readers[i].thread);
+    //@ open thread_run_post(reader_run)(&readers[i], unit);
+    ok = ok && readers[i].checksum == expected;
+  }
+  long long nanos = clock_now_nanos() - start;
+  free(readers);
+  printf("%d threads: %d ns per acquire and release (checksums %s)\n", THREAD_COUNT,
+    (int)(nanos / ((long long)THREAD_COUNT * ROUNDS)), ok ? "agree" : "differ");
+  return ok ? 0 : 1;
+}
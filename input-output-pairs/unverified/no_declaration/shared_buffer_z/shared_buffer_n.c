@@ -0,0 +1,159 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// An immutable buffer that threads share without a lock. Each reference is a ticket, as in fractions-counting: the
+// buffer counts its tickets, and the holder of a ticket may read the buffer. The count is updated with atomic
+// operations, and the thread that drops the last ticket frees the buffer.
+
+struct shared_buffer {
+  int refs;
+  int length;
+  char *chars;
+};
+
+/**
+ * Description:
+ * The `create_shared_buffer` function creates a buffer that holds a copy of the given chars,
+ * and returns it with the first reference to it held by the caller.
+ *
+ * @param chars the chars to copy into the buffer.
+ * @param length the number of chars to copy.
+ *
+ * @return the new buffer.
+ */
+struct shared_buffer *create_shared_buffer(char *chars, int length)
+{
+  struct shared_buffer *b = malloc(sizeof(struct shared_buffer));
+  char *copy = malloc((size_t)length);
+  if (b == 0 || copy == 0) {
+    abort();
+  }
+  memcpy(copy, chars, (size_t)length);
+  b->refs = 1;
+  b->length = length;
+  b->chars = copy;
+  return b;
+}
+
+/**
+ * Description:
+ * The `shared_buffer_acquire` function atomically increments the reference count of the buffer,
+ * so that the caller can hand the new reference to another thread. The caller must hold a reference.
+ *
+ * @param b the buffer to take another reference to.
+ */
+void shared_buffer_acquire(struct shared_buffer *b)
+{
+  atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+}
+
+/**
+ * Description:
+ * The `shared_buffer_release` function atomically decrements the reference count of the buffer,
+ * and frees the buffer if the caller held the last reference.
+ *
+ * @param b the buffer whose reference is dropped.
+ */
+void shared_buffer_release(struct shared_buffer *b)
+{
+  int refs = atomic_fetch_add_explicit(&b->refs, -1, memory_order_acq_rel);
+  if (refs == 1) {
+    free(b->chars);
+    free(b);
+  }
+}
+
+/**
+ * Description:
+ * The `shared_buffer_checksum` function computes the sum of the chars of the buffer modulo 65521.
+ * The caller must hold a reference to the buffer.
+ *
+ * @param b the buffer to read.
+ *
+ * @return the checksum of the buffer.
+ */
+int shared_buffer_checksum(struct shared_buffer *b)
+{
+  int sum = 0;
+  char *chars = b->chars;
+  for (int i = 0; i < b->length; i++)
+  {
+    sum = (sum + (unsigned char)chars[i]) % 65521;
+  }
+  return sum;
+}
+
+#define THREAD_COUNT 8
+#define BUFFER_LENGTH 65536
+#define ROUNDS 1000000
+
+struct reader {
+  struct shared_buffer *buffer;
+  int checksum;
+  struct thread *thread;
+};
+
+/**
+ * Description:
+ * The `reader_run` function takes and drops ROUNDS extra references to the reader's buffer,
+ * then stores the buffer's checksum in the reader and drops the reader's own reference.
+ *
+ * @param reader the reader that holds a reference to the buffer.
+ */
+void reader_run(struct reader *reader)
+{
+  struct shared_buffer *b = reader->buffer;
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    shared_buffer_acquire(b);
+    shared_buffer_release(b);
+  }
+  reader->checksum = shared_buffer_checksum(b);
+  shared_buffer_release(b);
+}
+
+/**
+ * Description:
+ * The `main` function shares one buffer among THREAD_COUNT reader threads, drops its own reference
+ * while they run, and prints the average time of an acquire and release.
+ *
+ * @return 0 if all readers computed the same checksum, 1 otherwise.
+ */
+int main()
+{
+  char *chars = malloc(BUFFER_LENGTH);
+  struct reader *readers = malloc(THREAD_COUNT * sizeof(struct reader));
+  if (chars == 0 || readers == 0) {
+    abort();
+  }
+  for (int i = 0; i < BUFFER_LENGTH; i++)
+  {
+    chars[i] = (char)('a' + i % 26);
+  }
+  struct shared_buffer *b = create_shared_buffer(chars, BUFFER_LENGTH);
+  free(chars);
+  int expected = shared_buffer_checksum(b);
+  long long start = clock_now_nanos();
+  for (int i = 0; i < THREAD_COUNT; i++)
+  {
+    shared_buffer_acquire(b);
+    readers[i].buffer = b;
+    readers[i].thread = thread_start_joinable(reader_run, &readers[i]);
+  }
+  shared_buffer_release(b);
+  bool ok = true;
+  for (int i = 0; i < THREAD_COUNT; i++)
+  {
+    thread_join(readers[i].thread);
+    ok = ok && readers[i].checksum == expected;
+  }
+  long long nanos = clock_now_nanos() - start;
+  free(readers);
+  printf("%d threads: %d ns per acquire and release (checksums %s)\n", THREAD_COUNT,
+    (int)(nanos / ((long long)THREAD_COUNT * ROUNDS)), ok ? "agree" : "differ");
+  return ok ? 0 : 1;
+}
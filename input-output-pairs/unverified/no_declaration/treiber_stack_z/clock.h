@@ -0,0 +1,14 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+// Reads the monotonic clock, in nanoseconds (see clock_gettime(2) with CLOCK_MONOTONIC).
+long long clock_now_nanos();
+    //@ requires true;
+    //@ ensures 0 <= result;
+
+// Sleeps until the monotonic clock reads at least deadline (see clock_nanosleep(2) with TIMER_ABSTIME).
+void clock_sleep_until_nanos(long long deadline);
+    //@ requires true;
+    //@ ensures true;
+
+#endif
@@ -0,0 +1,433 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A stack that many threads push to and pop from at once, without a lock (Treiber's stack). The nodes live in a pool
+// of capacity slots that is allocated once: slot i holds nexts[i] and values[i]. A link is a slot number plus one,
+// and link 0 ends a list. The free slots form a second stack of the same kind, so push takes a slot from the free
+// stack and pop gives one back, and neither calls malloc or free.
+//
+// A top (head or free) holds a link and a tag: top % STACK_LINK_LIMIT is the link, and top / STACK_LINK_LIMIT is the
+// tag. Every successful compare-exchange on a top increments its tag. So if a thread reads a top and its next link,
+// and meanwhile other threads pop that slot and push it back, the thread's compare-exchange fails even though the
+// link is the same (the ABA problem). The tag wraps around after STACK_TAG_LIMIT updates, so a thread that is
+// suspended for that many updates between its read and its compare-exchange can still be fooled.
+
+#define STACK_LINK_LIMIT 4096
+#define STACK_TAG_LIMIT 524288
+
+struct stack
+{
+    int head;
+    int free;
+    int capacity;
+    int *nexts;
+    int *values;
+};
+
+/*@
+fixpoint bool link_within(int capacity, int link) { return 0 <= link && link <= capacity; }
+
+// The tops and the pool are accessed only with atomic operations, so they live in an atomic space. The invariant only
+// keeps every link inside the pool. That a slot is on at most one list at a time follows from the tags and is not
+// proved here.
+predicate_ctor stack_inv(struct stack *stack, int capacity, int *nexts, int *values)() =
+    stack->head |-> ?head &*& 0 <= head &*& link_within(capacity, head % STACK_LINK_LIMIT) == true &*&
+    stack->free |-> ?free &*& 0 <= free &*& link_within(capacity, free % STACK_LINK_LIMIT) == true &*&
+    nexts[0..capacity] |-> ?links &*& forall(links, (link_within)(capacity)) == true &*&
+    values[0..capacity] |-> _;
+
+predicate stack(struct stack *stack, int capacity) =
+    stack->capacity |-> capacity &*& stack->nexts |-> ?nexts &*& stack->values |-> ?values &*&
+    0 < capacity &*& capacity < STACK_LINK_LIMIT &*&
+    atomic_space(stack_inv(stack, capacity, nexts, values)) &*&
+    malloc_block_ints(nexts, capacity) &*& malloc_block_ints(values, capacity) &*& malloc_block_stack(stack);
+
+predicate stack_nothing() = true;
+
+predicate stack_ignored(int value) = true;
+
+predicate_ctor stack_top_loaded(int capacity)(int value) =
+    0 <= value &*& link_within(capacity, value % STACK_LINK_LIMIT) == true;
+
+predicate_ctor stack_link_loaded(int capacity)(int value) =
+    link_within(capacity, value) == true;
+
+predicate_ctor stack_link_stored(int capacity, int link)() =
+    link_within(capacity, link) == true;
+
+predicate_ctor stack_top_stored(int capacity, int top)() =
+    0 <= top &*& link_within(capacity, top % STACK_LINK_LIMIT) == true;
+@*/
+
+struct stack *create_stack(int capacity)
+//@ requires 0 < capacity &*& capacity < STACK_LINK_LIMIT;
+//@ ensures stack(result, capacity);
+{
+    struct stack *stack = malloc(sizeof(struct stack));
+    int *nexts = malloc((size_t)capacity * sizeof(int));
+    int *values = malloc((size_t)capacity * sizeof(int));
+    if (stack == 0 || nexts == 0 || values == 0)
+    {
+        abort();
+    }
+    // All slots start on the free stack, in order: slot i links to slot i - 1.
+    for (int i = 0; i < capacity; i++)
+    {
+        nexts[i] = i;
+        values[i] = 0;
+    }
+    stack->head = 0;
+    stack->free = capacity;
+    stack->capacity = capacity;
+    stack->nexts = nexts;
+    stack->values = values;
+    return stack;
+}
+
+/*
+Returns a top that holds the given link and the next tag after the one in the given top.
+*/
+int stack_tagged(int top, int link)
+//@ requires 0 <= top &*& 0 <= link &*& link < STACK_LINK_LIMIT;
+//@ ensures 0 <= result &*& result % STACK_LINK_LIMIT == link;
+{
+    return (top / STACK_LINK_LIMIT + 1) % STACK_TAG_LIMIT * STACK_LINK_LIMIT + link;
+}
+
+/*
+Pops the top slot of the list at top, which is the head or the free top of the stack. Returns -1 if the list is
+empty. The caller then owns the slot: no other thread reads its value until the caller pushes it back.
+*/
+int links_pop(struct stack *stack, int *top)
+//@ requires [?f]stack(stack, ?capacity) &*& top == &stack->head || top == &stack->free;
+//@ ensures [f]stack(stack, capacity) &*& -1 <= result &*& result < capacity;
+{
+    int *nexts = stack->nexts;
+    for (;;)
+    {
+        int top0 = atomic_load(top);
+        int link = top0 % STACK_LINK_LIMIT;
+        if (link == 0)
+        {
+            return -1;
+        }
+        // Another thread may pop this slot and reuse it before we read its next link. Then the link is stale, but it
+        // is still inside the pool, and the compare-exchange below fails because the tag has moved on.
+        int next = atomic_load(&nexts[link - 1]);
+        int expected = top0;
+        int desired = stack_tagged(top0, next);
+        bool popped = atomic_compare_exchange_strong(top, &expected, desired);
+        if (popped)
+        {
+            return link - 1;
+        }
+    }
+}
+
+/*
+Pushes the given slot, which the caller owns, onto the list at top, which is the head or the free top of the stack.
+*/
+void links_push(struct stack *stack, int *top, int slot)
+//@ requires [?f]stack(stack, ?capacity) &*& top == &stack->head || top == &stack->free &*& 0 <= slot &*& slot < capacity;
+//@ ensures [f]stack(stack, capacity);
+{
+    int *nexts = stack->nexts;
+    for (;;)
+    {
+        int top0 = atomic_load(top);
+        int link = top0 % STACK_LINK_LIMIT;
+        // A thread that popped this slot earlier may still be reading its next link, so the link is stored atomically.
+        atomic_store(&nexts[slot], link);
+        int expected = top0;
+        int desired = stack_tagged(top0, slot + 1);
+        bool pushed = atomic_compare_exchange_strong(top, &expected, desired);
+        if (pushed)
+        {
+            return;
+        }
+    }
+}
+
+/*
+Pushes a value. Returns false, and leaves the stack unchanged, if all capacity slots are in use.
+*/
+bool stack_push(struct stack *stack, int value)
+//@ requires [?f]stack(stack, ?capacity);
+//@ ensures [f]stack(stack, capacity);
+{
+    int slot = links_pop(stack, &stack->free);
+    if (slot < 0)
+    {
+        return false;
+    }
+    int *values = stack->values;
+    atomic_store(&values[slot], value);
+    links_push(stack, &stack->head, slot);
+    return true;
+}
+
+/*
+Pops a value into *value. Returns false, and leaves *value unchanged, if the stack is empty.
+*/
+bool stack_pop(struct stack *stack, int *value)
+//@ requires [?f]stack(stack, ?capacity) &*& *value |-> _;
+//@ ensures [f]stack(stack, capacity) &*& *value |-> _;
+{
+    int slot = links_pop(stack, &stack->head);
+    if (slot < 0)
+    {
+        return false;
+    }
+    int *values = stack->values;
+    *value = atomic_load(&values[slot]);
+    links_push(stack, &stack->free, slot);
+    return true;
+}
+
+void stack_dispose(struct stack *stack)
+//@ requires stack(stack, _);
+//@ ensures true;
+{
+    free(stack->nexts);
+    free(stack->values);
+    free(stack);
+}
+
+// The stack the benchmark compares the Treiber stack with: the node-per-push stack of filter_stack, under a mutex.
+
+struct node
+{
+    struct node *next;
+    int value;
+};
+
+struct locked_stack
+{
+    struct node *head;
+    struct mutex *mutex;
+};
+
+/*@
+predicate nodes(struct node *node, int count) =
+node == 0 ?
+count == 0
+:
+0 < count &*& node->next |-> ?next &*& node->value |-> ?value &*&
+malloc_block_node(node) &*& nodes(next, count - 1);
+
+predicate_ctor locked_stack_inv(struct locked_stack *stack)() =
+    stack->head |-> ?head &*& nodes(head, _);
+
+predicate locked_stack(struct locked_stack *stack) =
+    stack->mutex |-> ?mutex &*& mutex(mutex, locked_stack_inv(stack)) &*& malloc_block_locked_stack(stack);
+@*/
+
+struct locked_stack *create_locked_stack()
+//@ requires true;
+//@ ensures locked_stack(result);
+{
+    struct locked_stack *stack = malloc(sizeof(struct locked_stack));
+    if (stack == 0)
+    {
+        abort();
+    }
+    stack->head = 0;
+    stack->mutex = create_mutex();
+    return stack;
+}
+
+void locked_stack_push(struct locked_stack *stack, int value)
+//@ requires [?f]locked_stack(stack);
+//@ ensures [f]locked_stack(stack);
+{
+    struct node *n = malloc(sizeof(struct node));
+    if (n == 0)
+    {
+        abort();
+    }
+    n->value = value;
+    mutex_acquire(stack->mutex);
+    n->next = stack->head;
+    stack->head = n;
+    mutex_release(stack->mutex);
+}
+
+bool locked_stack_pop(struct locked_stack *stack, int *value)
+//@ requires [?f]locked_stack(stack) &*& *value |-> _;
+//@ ensures [f]locked_stack(stack) &*& *value |-> _;
+{
+    mutex_acquire(stack->mutex);
+    struct node *head = stack->head;
+    if (head == 0)
+    {
+        mutex_release(stack->mutex);
+        return false;
+    }
+    stack->head = head->next;
+    mutex_release(stack->mutex);
+    *value = head->value;
+    free(head);
+    return true;
+}
+
+void locked_stack_dispose(struct locked_stack *stack)
+//@ requires locked_stack(stack);
+//@ ensures true;
+{
+    mutex_dispose(stack->mutex);
+    free(stack);
+}
+
+#define THREAD_COUNT 8
+#define ROUNDS 262144
+#define STACK_CAPACITY 64
+#define CHECKSUM_MODULUS 1000000007
+
+// Every thread pushes the values 1 up to ROUNDS, and pops a value after each push. Since each thread has pushed at
+// least as often as it has popped, a pop never finds the stack empty, and a stack of THREAD_COUNT slots never fills
+// up. The threads add up what they pop modulo CHECKSUM_MODULUS, so that the benchmark can tell whether a value was lost
+// or popped twice.
+
+struct bench_thread
+{
+    struct stack *stack;
+    struct locked_stack *locked_stack;
+    long long sum;
+    struct thread *thread;
+};
+
+/*@
+// The fraction of its stack that each thread holds. The benchmark keeps at least half of the stack while its
+// THREAD_COUNT threads run, and has all of it back once it has joined them, so that it can dispose of the stack.
+fixpoint real thread_share() { return 1/16; }
+
+predicate_family_instance thread_run_pre(treiber_run)(struct bench_thread *t, any info) =
+    t->stack |-> ?stack &*& [thread_share()]stack(stack, STACK_CAPACITY) &*& t->sum |-> _;
+predicate_family_instance thread_run_post(treiber_run)(struct bench_thread *t, any info) =
+    t->stack |-> ?stack &*& [thread_share()]stack(stack, STACK_CAPACITY) &*& t->sum |-> ?sum &*& -CHECKSUM_MODULUS < sum &*& sum < CHECKSUM_MODULUS;
+
+predicate_family_instance thread_run_pre(locked_run)(struct bench_thread *t, any info) =
+    t->locked_stack |-> ?stack &*& [thread_share()]locked_stack(stack) &*& t->sum |-> _;
+predicate_family_instance thread_run_post(locked_run)(struct bench_thread *t, any info) =
+    t->locked_stack |-> ?stack &*& [thread_share()]locked_stack(stack) &*& t->sum |-> ?sum &*& -CHECKSUM_MODULUS < sum &*& sum < CHECKSUM_MODULUS;
+@*/
+
+void treiber_run(struct bench_thread *t) //@ : thread_run_joinable
+//@ requires thread_run_pre(treiber_run)(t, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(treiber_run)(t, info) &*& lockset(currentThread, nil);
+{
+    struct stack *stack = t->stack;
+    long long sum = 0;
+    int value = 0;
+    for (int i = 1; i <= ROUNDS; i++)
+    {
+        if (!stack_push(stack, i) || !stack_pop(stack, &value))
+        {
+            abort();
+        }
+        sum = (sum + value) % CHECKSUM_MODULUS;
+    }
+    t->sum = sum;
+}
+
+void locked_run(struct bench_thread *t) //@ : thread_run_joinable
+//@ requires thread_run_pre(locked_run)(t, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(locked_run)(t, info) &*& lockset(currentThread, nil);
+{
+    struct locked_stack *stack = t->locked_stack;
+    long long sum = 0;
+    int value = 0;
+    for (int i = 1; i <= ROUNDS; i++)
+    {
+        locked_stack_push(stack, i);
+        if (!locked_stack_pop(stack, &value))
+        {
+            abort();
+        }
+        sum = (sum + value) % CHECKSUM_MODULUS;
+    }
+    t->sum = sum;
+}
+
+/*
+Runs the threads on a Treiber stack, and returns the elapsed time in nanoseconds. Stores the checksum of the values
+the threads popped in sum.
+*/
+long long bench_treiber(struct bench_thread *threads, long long *sum)
+//@ requires threads[..THREAD_COUNT] |-> _ &*& *sum |-> _;
+//@ ensures threads[..THREAD_COUNT] |-> _ &*& *sum |-> _;
+{
+    struct stack *stack = create_stack(STACK_CAPACITY);
+    long long start = clock_now_nanos();
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        threads[i].stack = stack;
+        threads[i].thread = thread_start_joinable(treiber_run, &threads[i]);
+    }
+    long long total = 0;
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        thread_join(threads[i].thread);
+        total = (total + threads[i].sum) % CHECKSUM_MODULUS;
+    }
+    long long nanos = clock_now_nanos() - start;
+    *sum = total;
+    stack_dispose(stack);
+    return nanos;
+}
+
+/*
+Runs the threads on a mutex-protected node stack, and returns the elapsed time in nanoseconds. Stores the checksum of
+the values the threads popped in sum.
+*/
+long long bench_locked(struct bench_thread *threads, long long *sum)
+//@ requires threads[..THREAD_COUNT] |-> _ &*& *sum |-> _;
+//@ ensures threads[..THREAD_COUNT] |-> _ &*& *sum |-> _;
+{
+    struct locked_stack *stack = create_locked_stack();
+    long long start = clock_now_nanos();
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        threads[i].locked_stack = stack;
+        threads[i].thread = thread_start_joinable(locked_run, &threads[i]);
+    }
+    long long total = 0;
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        thread_join(threads[i].thread);
+        total = (total + threads[i].sum) % CHECKSUM_MODULUS;
+    }
+    long long nanos = clock_now_nanos() - start;
+    *sum = total;
+    locked_stack_dispose(stack);
+    return nanos;
+}
+
+/*
+Runs THREAD_COUNT threads on each kind of stack and prints the average time per push and pop. Checks that the
+threads popped exactly the values that they pushed.
+*/
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+    struct bench_thread *threads = malloc(THREAD_COUNT * sizeof(struct bench_thread));
+    if (threads == 0)
+    {
+        abort();
+    }
+    long long expected = (long long)THREAD_COUNT * ROUNDS * (ROUNDS + 1) / 2 % CHECKSUM_MODULUS;
+    long long sum = 0;
+    long long pairs = (long long)THREAD_COUNT * ROUNDS;
+    long long nanos = bench_locked(threads, &sum);
+    printf("locked:  %d ns per push and pop (%s)\n", (int)(nanos / pairs), sum == expected ? "ok" : "lost values");
+    bool ok = sum == expected;
+    nanos = bench_treiber(threads, &sum);
+    printf("treiber: %d ns per push and pop (%s)\n", (int)(nanos / pairs), sum == expected ? "ok" : "lost values");
+    ok = ok && sum == expected;
+    free(threads);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,440 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdatomic.h"
+#include "threading.h"
+#include "clock.h"
+
+// A stack that many threads push to and pop from at once, without a lock (Treiber's stack). The nodes live in a pool
+// of capacity slots that is allocated once: slot i holds nexts[i] and values[i]. A link is a slot number plus one,
+// and link 0 ends a list. The free slots form a second stack of the same kind, so push takes a slot from the free
+// stack and pop gives one back, and neither calls malloc or free.
+//
+// A top (head or free) holds a link and a tag: top % STACK_LINK_LIMIT is the link, and top / STACK_LINK_LIMIT is the
+// tag. Every successful compare-exchange on a top increments its tag. So if a thread reads a top and its next link,
+// and meanwhile other threads pop that slot and push it back, the thread's compare-exchange fails even though the
+// link is the same (the ABA problem). The tag wraps around after STACK_TAG_LIMIT updates, so a thread that is
+// suspended for that many updates between its read and its compare-exchange can still be fooled.
+
+#define STACK_LINK_LIMIT 4096
+#define STACK_TAG_LIMIT 524288
+
+struct stack
+{
+    int head;
+    int free;
+    int capacity;
+    int *nexts;
+    int *values;
+};
+
+/**
+ * Description:
+ * The `create_stack` function creates an empty lock-free stack with a pool of capacity slots.
+ * All slots start on the free list. Aborts if memory allocation fails.
+ *
+ * @param capacity the number of values the stack can hold at once; less than STACK_LINK_LIMIT.
+ *
+ * @return the new stack.
+ */
+struct stack *create_stack(int capacity)
+{
+    struct stack *stack = malloc(sizeof(struct stack));
+    int *nexts = malloc((size_t)capacity * sizeof(int));
+    int *values = malloc((size_t)capacity * sizeof(int));
+    if (stack == 0 || nexts == 0 || values == 0)
+    {
+        abort();
+    }
+    // All slots start on the free stack, in order: slot i links to slot i - 1.
+    for (int i = 0; i < capacity; i++)
+    {
+        nexts[i] = i;
+        values[i] = 0;
+    }
+    stack->head = 0;
+    stack->free = capacity;
+    stack->capacity = capacity;
+    stack->nexts = nexts;
+    stack->values = values;
+    return stack;
+}
+
+/**
+ * Description:
+ * The `stack_tagged` function builds a top that holds the given link and the tag that follows the tag of the given top,
+ * wrapping around after STACK_TAG_LIMIT.
+ *
+ * @param top the top whose tag is incremented.
+ * @param link the link the new top holds.
+ *
+ * @return the new top.
+ */
+int stack_tagged(int top, int link)
+{
+    return (top / STACK_LINK_LIMIT + 1) % STACK_TAG_LIMIT * STACK_LINK_LIMIT + link;
+}
+
+/**
+ * Description:
+ * The `links_pop` function atomically pops the first slot of the list at top, which is the head or the free list
+ * of the stack, using a compare-exchange loop on the tagged top.
+ *
+ * @param stack the stack that owns the slot pool.
+ * @param top the top of the list to pop from.
+ *
+ * @return the popped slot, or -1 if the list is empty.
+ */
+int links_pop(struct stack *stack, int *top)
+{
+    int *nexts = stack->nexts;
+    for (;;)
+    {
+        int top0 = atomic_load(top);
+        int link = top0 % STACK_LINK_LIMIT;
+        if (link == 0)
+        {
+            return -1;
+        }
+        // Another thread may pop this slot and reuse it before we read its next link. Then the link is stale, but it
+        // is still inside the pool, and the compare-exchange below fails because the tag has moved on.
+        int next = atomic_load(&nexts[link - 1]);
+        int expected = top0;
+        int desired = stack_tagged(top0, next);
+        bool popped = atomic_compare_exchange_strong(top, &expected, desired);
+        if (popped)
+        {
+            return link - 1;
+        }
+    }
+}
+
+/**
+ * Description:
+ * The `links_push` function atomically pushes a slot that the caller owns onto the list at top, which is the head
+ * or the free list of the stack, using a compare-exchange loop on the tagged top.
+ *
+ * @param stack the stack that owns the slot pool.
+ * @param top the top of the list to push onto.
+ * @param slot the slot to push.
+ */
+void links_push(struct stack *stack, int *top, int slot)
+{
+    int *nexts = stack->nexts;
+    for (;;)
+    {
+        int top0 = atomic_load(top);
+        int link = top0 % STACK_LINK_LIMIT;
+        // A thread that popped this slot earlier may still be reading its next link, so the link is stored atomically.
+        atomic_store(&nexts[slot], link);
+        int expected = top0;
+        int desired = stack_tagged(top0, slot + 1);
+        bool pushed = atomic_compare_exchange_strong(top, &expected, desired);
+        if (pushed)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * Description:
+ * The `stack_push` function pushes a value onto the stack. It takes a slot from the free list, stores the value
+ * in it and pushes the slot onto the stack. It may be called by many threads at once.
+ *
+ * @param stack the stack to push onto.
+ * @param value the value to push.
+ *
+ * @return false if all slots are in use, true otherwise.
+ */
+bool stack_push(struct stack *stack, int value)
+{
+    int slot = links_pop(stack, &stack->free);
+    if (slot < 0)
+    {
+        return false;
+    }
+    int *values = stack->values;
+    atomic_store(&values[slot], value);
+    links_push(stack, &stack->head, slot);
+    return true;
+}
+
+/**
+ * Description:
+ * The `stack_pop` function pops a value from the stack into *value and gives the slot back to the free list.
+ * It may be called by many threads at once.
+ *
+ * @param stack the stack to pop from.
+ * @param value where the popped value is stored.
+ *
+ * @return false if the stack is empty, true otherwise.
+ */
+bool stack_pop(struct stack *stack, int *value)
+{
+    int slot = links_pop(stack, &stack->head);
+    if (slot < 0)
+    {
+        return false;
+    }
+    int *values = stack->values;
+    *value = atomic_load(&values[slot]);
+    links_push(stack, &stack->free, slot);
+    return true;
+}
+
+/**
+ * Description:
+ * The `stack_dispose` function frees the stack and its slot pool. No other thread may use the stack anymore.
+ *
+ * @param stack the stack to free.
+ */
+void stack_dispose(struct stack *stack)
+{
+    free(stack->nexts);
+    free(stack->values);
+    free(stack);
+}
+
+// The stack the benchmark compares the Treiber stack with: the node-per-push stack of filter_stack, under a mutex.
+
+struct node
+{
+    struct node *next;
+    int value;
+};
+
+struct locked_stack
+{
+    struct node *head;
+    struct mutex *mutex;
+};
+
+/**
+ * Description:
+ * The `create_locked_stack` function creates an empty node stack protected by a mutex.
+ *
+ * @return the new stack.
+ */
+struct locked_stack *create_locked_stack()
+{
+    struct locked_stack *stack = malloc(sizeof(struct locked_stack));
+    if (stack == 0)
+    {
+        abort();
+    }
+    stack->head = 0;
+    stack->mutex = create_mutex();
+    return stack;
+}
+
+/**
+ * Description:
+ * The `locked_stack_push` function allocates a node for the value and pushes it onto the stack under the mutex.
+ *
+ * @param stack the stack to push onto.
+ * @param value the value to push.
+ */
+void locked_stack_push(struct locked_stack *stack, int value)
+{
+    struct node *n = malloc(sizeof(struct node));
+    if (n == 0)
+    {
+        abort();
+    }
+    n->value = value;
+    mutex_acquire(stack->mutex);
+    n->next = stack->head;
+    stack->head = n;
+    mutex_release(stack->mutex);
+}
+
+/**
+ * Description:
+ * The `locked_stack_pop` function pops a value from the stack under the mutex into *value and frees its node.
+ *
+ * @param stack the stack to pop from.
+ * @param value where the popped value is stored.
+ *
+ * @return false if the stack is empty, true otherwise.
+ */
+bool locked_stack_pop(struct locked_stack *stack, int *value)
+{
+    mutex_acquire(stack->mutex);
+    struct node *head = stack->head;
+    if (head == 0)
+    {
+        mutex_release(stack->mutex);
+        return false;
+    }
+    stack->head = head->next;
+    mutex_release(stack->mutex);
+    *value = head->value;
+    free(head);
+    return true;
+}
+
+/**
+ * Description:
+ * The `locked_stack_dispose` function disposes the mutex and frees the stack.
+ *
+ * @param stack the stack to free.
+ */
+void locked_stack_dispose(struct locked_stack *stack)
+{
+    mutex_dispose(stack->mutex);
+    free(stack);
+}
+
+#define THREAD_COUNT 8
+#define ROUNDS 262144
+#define STACK_CAPACITY 64
+#define CHECKSUM_MODULUS 1000000007
+
+// Every thread pushes the values 1 up to ROUNDS, and pops a value after each push. Since each thread has pushed at
+// least as often as it has popped, a pop never finds the stack empty, and a stack of THREAD_COUNT slots never fills
+// up. The threads add up what they pop modulo CHECKSUM_MODULUS, so that the benchmark can tell whether a value was lost
+// or popped twice.
+
+struct bench_thread
+{
+    struct stack *stack;
+    struct locked_stack *locked_stack;
+    long long sum;
+    struct thread *thread;
+};
+
+/**
+ * Description:
+ * The `treiber_run` function pushes the values 1 up to ROUNDS onto the thread's Treiber stack, popping a value after
+ * each push, and stores the sum of the popped values modulo CHECKSUM_MODULUS in the thread.
+ *
+ * @param t the benchmark thread.
+ */
+void treiber_run(struct bench_thread *t)
+{
+    struct stack *stack = t->stack;
+    long long sum = 0;
+    int value = 0;
+    for (int i = 1; i <= ROUNDS; i++)
+    {
+        if (!stack_push(stack, i) || !stack_pop(stack, &value))
+        {
+            abort();
+        }
+        sum = (sum + value) % CHECKSUM_MODULUS;
+    }
+    t->sum = sum;
+}
+
+/**
+ * Description:
+ * The `locked_run` function pushes the values 1 up to ROUNDS onto the thread's locked stack, popping a value after
+ * each push, and stores the sum of the popped values modulo CHECKSUM_MODULUS in the thread.
+ *
+ * @param t the benchmark thread.
+ */
+void locked_run(struct bench_thread *t)
+{
+    struct locked_stack *stack = t->locked_stack;
+    long long sum = 0;
+    int value = 0;
+    for (int i = 1; i <= ROUNDS; i++)
+    {
+        locked_stack_push(stack, i);
+        if (!locked_stack_pop(stack, &value))
+        {
+            abort();
+        }
+        sum = (sum + value) % CHECKSUM_MODULUS;
+    }
+    t->sum = sum;
+}
+
+/**
+ * Description:
+ * The `bench_treiber` function runs THREAD_COUNT threads on one Treiber stack and stores the checksum of the values
+ * they popped in *sum.
+ *
+ * @param threads the benchmark threads.
+ * @param sum where the checksum is stored.
+ *
+ * @return the elapsed time in nanoseconds.
+ */
+long long bench_treiber(struct bench_thread *threads, long long *sum)
+{
+    struct stack *stack = create_stack(STACK_CAPACITY);
+    long long start = clock_now_nanos();
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        threads[i].stack = stack;
+        threads[i].thread = thread_start_joinable(treiber_run, &threads[i]);
+    }
+    long long total = 0;
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        thread_join(threads[i].thread);
+        total = (total + threads[i].sum) % CHECKSUM_MODULUS;
+    }
+    long long nanos = clock_now_nanos() - start;
+    *sum = total;
+    stack_dispose(stack);
+    return nanos;
+}
+
+/**
+ * Description:
+ * The `bench_locked` function runs THREAD_COUNT threads on one locked stack and stores the checksum of the values
+ * they popped in *sum.
+ *
+ * @param threads the benchmark threads.
+ * @param sum where the checksum is stored.
+ *
+ * @return the elapsed time in nanoseconds.
+ */
+long long bench_locked(struct bench_thread *threads, long long *sum)
+{
+    struct locked_stack *stack = create_locked_stack();
+    long long start = clock_now_nanos();
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        threads[i].locked_stack = stack;
+        threads[i].thread = thread_start_joinable(locked_run, &threads[i]);
+    }
+    long long total = 0;
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        thread_join(threads[i].thread);
+        total = (total + threads[i].sum) % CHECKSUM_MODULUS;
+    }
+    long long nanos = clock_now_nanos() - start;
+    *sum = total;
+    locked_stack_dispose(stack);
+    return nanos;
+}
+
+/**
+ * Description:
+ * The `main` function benchmarks the locked stack and the Treiber stack, printing the average time per push and pop,
+ * and checks that the threads popped exactly the values they pushed.
+ *
+ * @return 0 if both checksums are right, 1 otherwise.
+ */
+int main()
+{
+    struct bench_thread *threads = malloc(THREAD_COUNT * sizeof(struct bench_thread));
+    if (threads == 0)
+    {
+        abort();
+    }
+    long long expected = (long long)THREAD_COUNT * ROUNDS * (ROUNDS + 1) / 2 % CHECKSUM_MODULUS;
+    long long sum = 0;
+    long long pairs = (long long)THREAD_COUNT * ROUNDS;
+    long long nanos = bench_locked(threads, &sum);
+    printf("locked:  %d ns per push and pop (%s)\n", (int)(nanos / pairs), sum == expected ? "ok" : "lost values");
+    bool ok = sum == expected;
+    nanos = bench_treiber(threads, &sum);
+    printf("treiber: %d ns per push and pop (%s)\n", (int)(nanos / pairs), sum == expected ? "ok" : "lost values");
+    ok = ok && sum == expected;
+    free(threads);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "threading.h"
+
+// A thread pool runs tasks on a fixed set of worker threads, so that a short task does not pay for creating and
+// joining a thread. A task is a thread_run_joinable function with its data: pool_submit takes the function's
+// thread_run_pre and pool_join hands back its thread_run_post, just like thread_start_joinable and thread_join.
+// Each worker has a deque of tasks. A worker runs the tasks of its own deque newest first and, once that is empty,
+// steals the oldest task of another worker's deque.
+// Finishing and joining a task only take the mutex of the worker the task was submitted to, not a pool-wide one.
+// A task must not call pool_join: while it waits, it keeps its worker from running other tasks.
+
+struct pool;
+struct pool_task;
+
+/*@
+
+predicate pool(struct pool *pool; int workerCount);
+
+// A submitted task that has not been joined yet. It holds the fraction frac of the pool that pool_submit kept back.
+predicate pool_task(struct pool_task *task, struct pool *pool, real frac, void *run, void *data, any info);
+
+@*/
+
+struct pool *create_pool(int workerCount);
+    //@ requires 0 < workerCount;
+    //@ ensures pool(result, workerCount);
+
+struct pool_task *pool_submit(struct pool *pool, void *run, void *data);
+    //@ requires [?f]pool(pool, ?workerCount) &*& is_thread_run_joinable(run) == true &*& thread_run_pre(run)(data, ?info);
+    //@ ensures [f/2]pool(pool, workerCount) &*& pool_task(result, pool, f/2, run, data, info);
+
+void pool_join(struct pool_task *task);
+    //@ requires pool_task(task, ?pool, ?f, ?run, ?data, ?info);
+    //@ ensures [f]pool(pool, _) &*& thread_run_post(run)(data, info);
+
+void pool_dispose(struct pool *pool);
+    //@ requires pool(pool, _);
+    //@ ensures emp;
+
+#endif
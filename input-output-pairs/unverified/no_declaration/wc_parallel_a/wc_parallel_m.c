@@ -0,0 +1,246 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "mman.h"
+#include "threading.h"
+#include "thread_pool.h"
+
+#define WC_WORKERS 8
+#define WC_MAX_JOB (1024 * 1024 * 1024)
+#define WC_CHUNK_SIZE (64 * 1024)
+
+struct wc_job {
+  struct wc_job *next;
+  char *data;
+  int length;
+  struct pool_task *task;
+  int closed_out;
+  int closed_in;
+  bool open_out;
+  bool open_in;
+};
+
+/*@
+// Spaces, line breaks, tabs and carriage returns separate words, as for `wc -w`.
+fixpoint bool separator(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+
+fixpoint int wcount(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return inword ? 1 : 0;
+    case cons(h, t): return 0 == h ? (inword ? 1 : 0) : (separator(h) ? ((inword ? 1 : 0) + wcount(t, false)) : wcount(t, true));
+  }
+}
+
+// The number of words that a chunk closes, i.e. words followed by a separator inside the chunk.
+fixpoint int wcompleted(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return 0;
+    case cons(h, t): return separator(h) ? ((inword ? 1 : 0) + wcompleted(t, false)) : wcompleted(t, true);
+  }
+}
+
+// Whether a word is still open at the end of a chunk.
+fixpoint bool wstate(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return inword;
+    case cons(h, t): return wstate(t, !separator(h));
+  }
+}
+
+// What a worker knows about its chunk without knowing whether a word is open before it:
+// the closed words and the final state, for both possible starting states.
+inductive wc_summary = wc_summary(int closed_out, int closed_in, bool open_out, bool open_in);
+
+fixpoint wc_summary summarize(list<char> cs) {
+  return wc_summary(wcompleted(cs, false), wcompleted(cs, true), wstate(cs, false), wstate(cs, true));
+}
+
+// The monoid operation on summaries. summarize(nil) is its unit and summarize_append shows that
+// summarize maps append to wc_merge, so chunks can be summarized independently and merged in order.
+fixpoint wc_summary wc_merge(wc_summary a, wc_summary b) {
+  switch(a) {
+    case wc_summary(ao, ai, aso, asi): return
+      switch(b) {
+        case wc_summary(bo, bi, bso, bsi): return
+          wc_summary(ao + (aso ? bi : bo), ai + (asi ? bi : bo), aso ? bsi : bso, asi ? bsi : bso);
+      };
+  }
+}
+
+// The worker gets a quarter of its chunk; main keeps another quarter, which pins down the chunk's contents.
+predicate wc_job_input(struct wc_job *job) =
+  [1/2]job->data |-> ?data &*& [1/2]job->length |-> ?length &*& 0 <= length &*& [1/4]chars(data, length, _) &*&
+  job->closed_out |-> _ &*& job->closed_in |-> _ &*& job->open_out |-> _ &*& job->open_in |-> _;
+
+predicate wc_job_output(struct wc_job *job) =
+  [1/2]job->data |-> ?data &*& [1/2]job->length |-> ?length &*& [1/4]chars(data, length, ?cs) &*&
+  job->closed_out |-> wcompleted(cs, false) &*& job->closed_in |-> wcompleted(cs, true) &*&
+  job->open_out |-> wstate(cs, false) &*& job->open_in |-> wstate(cs, true);
+
+predicate_family_instance thread_run_pre(wc_worker)(void *data, any info) = wc_job_input(data);
+predicate_family_instance thread_run_post(wc_worker)(void *data, any info) = wc_job_output(data);
+
+// The submitted jobs, in file order. Together they cover the length bytes cs from start, and hold the fraction frac of the pool.
+predicate wc_jobs(struct wc_job *job, char *start, int length, list<char> cs, struct pool *pool, real frac) =
+  job == 0 ?
+    length == 0 &*& cs == nil &*& frac == 0
+  :
+    job->next |-> ?next &*& [1/2]job->data |-> start &*& [1/2]job->length |-> ?n &*& 0 <= n &*&
+    [1/4]chars(start, n, ?chunk) &*&
+    job->task |-> ?task &*& pool_task(task, pool, ?taskFrac, wc_worker, job, _) &*& malloc_block_wc_job(job) &*&
+    wc_jobs(next, start + n, length - n, ?rest, pool, ?restFrac) &*& cs == append(chunk, rest) &*& frac == taskFrac + restFrac;
+@*/
+
+/*
+Tells whether c separates words: a space, a line break, a tab or a carriage return.
+*/
+bool wc_separator(char c)
+//@ requires true;
+//@ ensures result == separator(c);
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/*
+Counts the words that the first n characters of buf close, given whether a word is open before buf[0].
+A word is closed by a separator that follows a non-separator character, so every position is classified
+from itself and its predecessor only, and the loop vectorizes.
+*/
+int wc_chunk(char* buf, int n, bool inword)
+//@ requires [?f]buf[..n] |-> ?cs &*& 0 <= n;
+//@ ensures [f]buf[..n] |-> cs &*& result == wcompleted(cs, inword) &*& 0 <= result &*& result <= n;
+{
+  if(n == 0) { return 0; }
+  int count = wc_separator(buf[0]) && inword ? 1 : 0;
+  for(int i = 1; i < n; i++)
+  {
+    char prev = buf[i - 1];
+    char c = buf[i];
+    count += wc_separator(c) && !wc_separator(prev) ? 1 : 0;
+  }
+  return count;
+}
+
+/*
+Tells whether a word is still open after the first n characters of buf.
+*/
+bool wc_state(char* buf, int n, bool inword)
+//@ requires [?f]buf[..n] |-> ?cs &*& 0 <= n;
+//@ ensures [f]buf[..n] |-> cs &*& result == wstate(cs, inword);
+{
+  return n == 0 ? inword : !wc_separator(buf[n - 1]);
+}
+
+/*
+The worker thread. It summarizes its chunk for both starting states, so that it does not
+depend on the chunks before it.
+*/
+void wc_worker(void *data) //@ : thread_run_joinable
+//@ requires thread_run_pre(wc_worker)(data, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(wc_worker)(data, info) &*& lockset(currentThread, nil);
+{
+  struct wc_job *job = data;
+  char *chunk = job->data;
+  int length = job->length;
+  int closed = wc_chunk(chunk, length, false);
+  job->closed_out = closed;
+  job->closed_in = closed + (0 < length && wc_separator(chunk[0]) ? 1 : 0);
+  job->open_out = wc_state(chunk, length, false);
+  job->open_in = wc_state(chunk, length, true);
+}
+
+/*
+Counts the words in the rest of the given file, one buffer at a time.
+Used when the file cannot be mapped, e.g. when it is a pipe.
+*/
+long long wc_stream(FILE* fp, char* buffer, int size)
+//@ requires [?f]file(fp) &*& buffer[..size] |-> _ &*& 0 < size;
+//@ ensures [f]file(fp) &*& buffer[..size] |-> _ &*& 0 <= result;
+{
+  long long total = 0; bool inword = false;
+  int nb_read = fread(buffer, 1, (size_t)size, fp);
+  while(0 < nb_read && total <= LLONG_MAX - INT_MAX)
+  {
+    total = total + wc_chunk(buffer, nb_read, inword);
+    inword = wc_state(buffer, nb_read, inword);
+    nb_read = fread(buffer, 1, (size_t)size, fp);
+  }
+  return inword ? total + 1 : total;
+}
+
+/*
+Counts the words in the given mapping. The mapping is cut into at most WC_MAX_JOB-byte chunks,
+about one per worker, and every chunk is summarized by a task on the pool.
+The summaries are then merged in file order, starting outside a word.
+*/
+long long wc_parallel(struct pool *pool, char* data, size_t size)
+//@ requires [?f]pool(pool, ?workerCount) &*& [1/2]chars(data, size, ?cs) &*& size < LLONG_MAX;
+//@ ensures [f]pool(pool, _) &*& [1/2]chars(data, size, cs) &*& result == wcompleted(cs, false) + (wstate(cs, false) ? 1 : 0) &*& mem((char)0, cs) ? true : result == wcount(cs, false);
+{
+  size_t chunk = size / WC_WORKERS + 1;
+  if(chunk > WC_MAX_JOB) { chunk = WC_MAX_JOB; }
+  struct wc_job *jobs = 0;
+  size_t end = size;
+  while(0 < end)
+  {
+    size_t start = end < chunk ? 0 : end - chunk;
+    struct wc_job *job = malloc(sizeof(struct wc_job));
+    if(job == 0) { abort(); }
+    job->data = data + start;
+    job->length = (int)(end - start);
+    job->task = pool_submit(pool, wc_worker, job);
+    job->next = jobs;
+    jobs = job;
+    end = start;
+  }
+
+  long long closed = 0; bool open = false; size_t consumed = 0;
+  while(jobs != 0)
+  {
+    struct wc_job *job = jobs;
+    pool_join(job->task);
+    closed = closed + (open ? job->closed_in : job->closed_out);
+    open = open ? job->open_in : job->open_out;
+    consumed = consumed + (size_t)job->length;
+    jobs = job->next;
+    free(job);
+  }
+  return open ? closed + 1 : closed;
+}
+
+/*
+Counts the words in the file named by the first argument on a pool of WC_WORKERS threads.
+Words that straddle two chunks are counted once. Like wcount, spaces, line breaks, tabs and
+carriage returns separate words, as for `wc -w`.
+*/
+int main(int argc, char** argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+  FILE* fp = 0; char* data = 0; long size = 0; int fd = 0; long long total = 0;
+  if(argc < 2) { puts("No input file specified."); return -1; }
+  fp = fopen(argv[1], "r");
+  if(fp == 0) { abort(); }
+  if(fseek(fp, 0, 2) == 0) {
+    size = ftell(fp);
+    rewind(fp);
+  }
+  fd = fileno(fp);
+  if(0 < size && 0 <= fd) {
+    data = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  if(data != 0 && data != MAP_FAILED) {
+    struct pool *pool = create_pool(WC_WORKERS);
+    total = wc_parallel(pool, data, (size_t)size);
+    pool_dispose(pool);
+    munmap(data, (size_t)size);
+  } else {
+    char* buffer = malloc(WC_CHUNK_SIZE);
+    if(buffer == 0) { abort(); }
+    total = wc_stream(fp, buffer, WC_CHUNK_SIZE);
+    free(buffer);
+  }
+  printf("%lld", total);
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "mman.h"
+#include "threading.h"
+#include "thread_pool.h"
+
+#define WC_WORKERS 8
+#define WC_MAX_JOB (1024 * 1024 * 1024)
+#define WC_CHUNK_SIZE (64 * 1024)
+
+struct wc_job {
+  struct wc_job *next;
+  char *data;
+  int length;
+  struct pool_task *task;
+  int closed_out;
+  int closed_in;
+  bool open_out;
+  bool open_in;
+};
+
+/***
+ * Description:
+The `wc_separator` function tells whether `c` separates words: a space, a line break, a tab or a carriage return.
+
+@param `c` - The character to classify.
+*/
+bool wc_separator(char c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/***
+ * Description:
+The `wc_chunk` function counts the words that the first `n` characters of `buf` close.
+A word is closed by a separator that follows a non-separator character (or, at position 0, by a separator while a word is open),
+so every position is classified from itself and its predecessor only, and the loop vectorizes.
+
+@param `buf` - A pointer to a character buffer, which is only read. It does not need to be zero-terminated.
+@param `n` - The non-negative number of characters to examine.
+@param `inword` - A boolean flag indicating whether a word is open before `buf[0]`.
+
+It ensures: the result is between 0 and `n`.
+*/
+int wc_chunk(char* buf, int n, bool inword)
+{
+  if(n == 0) { return 0; }
+  int count = wc_separator(buf[0]) && inword ? 1 : 0;
+  for(int i = 1; i < n; i++)
+  {
+    char prev = buf[i - 1];
+    char c = buf[i];
+    count += wc_separator(c) && !wc_separator(prev) ? 1 : 0;
+  }
+  return count;
+}
+
+/***
+ * Description:
+The `wc_state` function tells whether a word is still open after the first `n` characters of `buf`.
+
+@param `buf` - A pointer to a character buffer, which is only read.
+@param `n` - The non-negative number of characters in the chunk.
+@param `inword` - A boolean flag indicating whether a word is open before `buf[0]`.
+
+It returns `inword` for an empty chunk and otherwise whether the last character is not a separator.
+*/
+bool wc_state(char* buf, int n, bool inword)
+{
+  return n == 0 ? inword : !wc_separator(buf[n - 1]);
+}
+
+/***
+ * Description:
+The `wc_worker` function is the task that a pool worker runs for a job. It summarizes the chunk of its job for both starting states,
+so that it does not depend on the chunks before it: `closed_out`/`open_out` hold the closed words and the final state
+when no word is open before the chunk, and `closed_in`/`open_in` when a word is open.
+
+@param `data` - A pointer to the job. The worker only reads the chunk and writes the four summary fields.
+*/
+void wc_worker(void *data)
+{
+  struct wc_job *job = data;
+  char *chunk = job->data;
+  int length = job->length;
+  int closed = wc_chunk(chunk, length, false);
+  job->closed_out = closed;
+  job->closed_in = closed + (0 < length && wc_separator(chunk[0]) ? 1 : 0);
+  job->open_out = wc_state(chunk, length, false);
+  job->open_in = wc_state(chunk, length, true);
+}
+
+/***
+ * Description:
+The `wc_stream` function counts the words in the rest of the given file, one buffer at a time,
+carrying the open-word state from one buffer to the next. It is used when the file cannot be mapped, e.g. when it is a pipe.
+
+@param `fp` - The file to read from.
+@param `buffer` - A buffer of `size` bytes used for reading.
+@param `size` - The positive size of the buffer.
+
+It returns the non-negative number of words.
+*/
+long long wc_stream(FILE* fp, char* buffer, int size)
+{
+  long long total = 0; bool inword = false;
+  int nb_read = fread(buffer, 1, (size_t)size, fp);
+  while(0 < nb_read && total <= LLONG_MAX - INT_MAX)
+  {
+    total = total + wc_chunk(buffer, nb_read, inword);
+    inword = wc_state(buffer, nb_read, inword);
+    nb_read = fread(buffer, 1, (size_t)size, fp);
+  }
+  return inword ? total + 1 : total;
+}
+
+/***
+ * Description:
+The `wc_parallel` function counts the words in the given mapping. The mapping is cut into chunks of at most WC_MAX_JOB bytes,
+about one per worker, and every chunk is summarized by a task submitted to the pool with `pool_submit`.
+The tasks are then joined with `pool_join` and their summaries are merged in file order, starting outside a word,
+so that a word that straddles two chunks is counted once.
+
+@param `pool` - The thread pool that runs the tasks.
+@param `data` - The start of the mapping, which is only read.
+@param `size` - The number of bytes in the mapping.
+
+It returns the same count as `wc` on the mapped bytes when they contain no zero byte.
+*/
+long long wc_parallel(struct pool *pool, char* data, size_t size)
+{
+  size_t chunk = size / WC_WORKERS + 1;
+  if(chunk > WC_MAX_JOB) { chunk = WC_MAX_JOB; }
+  struct wc_job *jobs = 0;
+  size_t end = size;
+  while(0 < end)
+  {
+    size_t start = end < chunk ? 0 : end - chunk;
+    struct wc_job *job = malloc(sizeof(struct wc_job));
+    if(job == 0) { abort(); }
+    job->data = data + start;
+    job->length = (int)(end - start);
+    job->task = pool_submit(pool, wc_worker, job);
+    job->next = jobs;
+    jobs = job;
+    end = start;
+  }
+
+  long long closed = 0; bool open = false; size_t consumed = 0;
+  while(jobs != 0)
+  {
+    struct wc_job *job = jobs;
+    pool_join(job->task);
+    closed = closed + (open ? job->closed_in : job->closed_out);
+    open = open ? job->open_in : job->open_out;
+    consumed = consumed + (size_t)job->length;
+    jobs = job->next;
+    free(job);
+  }
+  return open ? closed + 1 : closed;
+}
+
+/***
+ * Description:
+The `main` function counts the words in the file named by the first command-line argument on a pool of WC_WORKERS threads
+and prints the count. Regular files are mapped and counted with `wc_parallel`, on a pool created for the purpose; anything else is streamed with `wc_stream`.
+Spaces, line breaks, tabs and carriage returns separate words, as for `wc -w`.
+
+@param `argc` - Number of command-line arguments.
+@param `argv` - Array of command-line arguments.
+*/
+int main(int argc, char** argv)
+{
+  FILE* fp = 0; char* data = 0; long size = 0; int fd = 0; long long total = 0;
+  if(argc < 2) { puts("No input file specified."); return -1; }
+  fp = fopen(argv[1], "r");
+  if(fp == 0) { abort(); }
+  if(fseek(fp, 0, 2) == 0) {
+    size = ftell(fp);
+    rewind(fp);
+  }
+  fd = fileno(fp);
+  if(0 < size && 0 <= fd) {
+    data = mmap(0, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  if(data != 0 && data != MAP_FAILED) {
+    struct pool *pool = create_pool(WC_WORKERS);
+    total = wc_parallel(pool, data, (size_t)size);
+    pool_dispose(pool);
+    munmap(data, (size_t)size);
+  } else {
+    char* buffer = malloc(WC_CHUNK_SIZE);
+    if(buffer == 0) { abort(); }
+    total = wc_stream(fp, buffer, WC_CHUNK_SIZE);
+    free(buffer);
+  }
+  printf("%lld", total);
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,466 @@
+#include <stdbool.h>
+#include "lists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+//@ #include "ghostlist.gh"
+
+#define WORKER_COUNT 4
+
+struct member {
+    struct member *next;
+    struct string_buffer *nick;
+    struct writer *writer;
+};
+
+/*@
+predicate member(struct member* member) =
+    member->nick |-> ?nick &*& [1/2]member->writer |-> ?writer &*& string_buffer(nick, _) &*& writer(writer) &*& malloc_block_member(member);
+@*/
+
+struct room {
+    struct member *members;
+    //@ int ghost_list_id;
+};
+
+/*@
+predicate room(struct room* room) =
+    room->members |-> ?membersList &*& [?f]room->ghost_list_id |-> ?id &*&
+    lseg(membersList, 0, ?members, member) &*&
+    ghost_list(id, members) &*& malloc_block_room(room);
+@*/
+
+struct room *create_room()
+    //@ requires emp;
+    //@ ensures room(result);
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    //@ close lseg(0, 0, nil, member);
+    //@ int i = create_ghost_list();
+    //@ room->ghost_list_id = i;
+    //@ close room(room);
+    return room;
+}
+
+bool room_has_member(struct room *room, struct string_buffer *nick)
+    //@ requires room(room) &*& string_buffer(nick, _);
+    //@ ensures room(room) &*& string_buffer(nick, _);
+{
+    //@ open room(room);
+    //@ struct member *membersList = room->members;
+    //@ assert lseg(membersList, 0, ?members, member);
+    struct member *iter = room->members;
+    bool hasMember = false;
+    //@ close lseg(membersList, membersList, nil, member);
+    while (iter != 0 && !hasMember)
+        /*@
+        invariant
+            string_buffer(nick, _) &*&
+            lseg(membersList, iter, ?members0, member) &*& lseg(iter, 0, ?members1, member) &*& members == append(members0, members1);
+        @*/
+    {
+        //@ open lseg(iter, 0, members1, member);
+        //@ open member(iter);
+        hasMember = string_buffer_equals(iter->nick, nick);
+        //@ close member(iter);
+        iter = *(void **)(void *)iter;
+        //@ lseg_add(membersList);
+    }
+    //@ lseg_append_final(membersList);
+    //@ close room(room);
+    return hasMember;
+}
+
+void room_broadcast_message(struct room *room, struct string_buffer *message)
+    //@ requires room(room) &*& string_buffer(message, _);
+    //@ ensures room(room) &*& string_buffer(message, _);
+{
+    //@ open room(room);
+    struct member *iter = room->members;
+    //@ assert lseg(?list, 0, ?ms, member);
+    //@ close lseg(list, list, nil, member);
+    while (iter != 0)
+        //@ invariant string_buffer(message, _) &*& lseg(list, iter, ?ms0, member) &*& lseg(iter, 0, ?ms1, member) &*& ms == append(ms0, ms1);
+    {
+        //@ open lseg(iter, 0, ms1, member);
+        //@ open member(iter);
+        writer_write_string_buffer(iter->writer, message);
+        writer_write_string(iter->writer, "\r\n");
+        //@ close member(iter);
+        iter = *(void **)(void *)iter;
+        //@ lseg_add(list);
+    }
+    //@ lseg_append_final(list);
+    //@ close room(room);
+}
+
+// A connection is either the listening server socket or a client. A client that has not picked a nick yet
+// owns its socket writer; once it has joined, the writer belongs to its member in the room.
+struct connection {
+    struct server_socket *server_socket;
+    struct socket *socket;
+    struct string_buffer *line;
+    struct string_buffer *nick;
+    struct member *member;
+};
+
+struct server {
+    struct poller *poller;
+    struct room *room;
+    struct lock *room_lock;
+};
+
+/*@
+
+predicate_ctor room_ctor(struct room *room)() =
+    room(room);
+
+predicate client(struct connection *connection, struct room *room) =
+    connection->socket |-> ?socket &*& connection->line |-> ?line &*& connection->nick |-> ?nick &*& connection->member |-> ?member &*&
+    socket(socket, ?reader, ?writer) &*& reader(reader) &*& string_buffer(line, _) &*&
+    member == 0 ?
+        writer(writer) &*& nick == 0
+    :
+        string_buffer(nick, _) &*& [1/2]member->writer |-> writer &*&
+        [_]room->ghost_list_id |-> ?id &*& ghost_list_member_handle(id, member);
+
+predicate connection(struct connection *connection, struct room *room, bool listening) =
+    connection->server_socket |-> ?serverSocket &*& malloc_block_connection(connection) &*& listening == (serverSocket != 0) &*&
+    listening ?
+        server_socket(serverSocket) &*&
+        connection->socket |-> _ &*& connection->line |-> _ &*& connection->nick |-> _ &*& connection->member |-> _
+    :
+        client(connection, room);
+
+// While a connection is registered with the poller, the poller owns it. poller_wait hands it to one worker.
+predicate_ctor connection_ready(struct room *room)(void *data) =
+    connection(data, room, _);
+
+predicate server(struct server *server; struct poller *poller, struct room *room, struct lock *roomLock) =
+    server->poller |-> poller &*& server->room |-> room &*& server->room_lock |-> roomLock &*&
+    [_]poller(poller, connection_ready(room)) &*& [_]lock(roomLock, _, room_ctor(room));
+
+@*/
+
+/*
+Sends the welcome message and the list of members to a new client, and asks for a nick. The nicks are copied while
+the room lock is held and written after it is released, so the write never holds up the other workers.
+*/
+void connection_greet(struct room *room, struct lock *roomLock, struct writer *writer)
+    //@ requires [_]lock(roomLock, _, room_ctor(room)) &*& lockset(currentThread, nil) &*& writer(writer);
+    //@ ensures [_]lock(roomLock, _, room_ctor(room)) &*& lockset(currentThread, nil) &*& writer(writer);
+{
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    struct string_buffer *members = create_string_buffer();
+    lock_acquire(roomLock);
+    //@ open room_ctor(room)();
+    //@ open room(room);
+    {
+        struct member *iter = room->members;
+        //@ assert lseg(?membersList, 0, ?ms, member);
+        //@ close lseg(membersList, membersList, nil, member);
+        while (iter != 0)
+            //@ invariant writer(writer) &*& string_buffer(members, _) &*& lseg(membersList, iter, ?ms0, member) &*& lseg(iter, 0, ?ms1, member) &*& ms == append(ms0, ms1);
+        {
+            //@ open lseg(iter, 0, ms1, member);
+            //@ open member(iter);
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            //@ close member(iter);
+            iter = *(void **)(void *)iter;
+            //@ lseg_add(membersList);
+        }
+        //@ lseg_append_final(membersList);
+    }
+    //@ close room(room);
+    //@ close room_ctor(room)();
+    lock_release(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    writer_write_string(writer, "Please enter your nick: ");
+}
+
+int connection_read_line(struct connection *connection)
+    //@ requires connection(connection, ?room, false);
+    //@ ensures connection(connection, room, false) &*& result == READ_LINE || result == READ_PENDING || result == READ_EOF;
+{
+    //@ open connection(connection, room, false);
+    //@ open client(connection, room);
+    struct reader *reader = socket_get_reader(connection->socket);
+    int status = reader_try_read_line(reader, connection->line);
+    //@ close client(connection, room);
+    //@ close connection(connection, room, false);
+    return status;
+}
+
+/*
+Handles a line that a client sent. Before the client has joined, the line is the nick it asks for;
+afterwards, it is a message for the room.
+*/
+void connection_handle_line(struct room *room, struct lock *roomLock, struct connection *connection)
+    //@ requires [_]lock(roomLock, ?roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures [_]lock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+{
+    //@ open connection(connection, room, false);
+    //@ open client(connection, room);
+    struct writer *writer = socket_get_writer(connection->socket);
+    struct string_buffer *line = connection->line;
+    if (connection->member == 0) {
+        lock_acquire(roomLock);
+        //@ open room_ctor(room)();
+        bool hasMember = room_has_member(room, line);
+        if (hasMember) {
+            //@ close room_ctor(room)();
+            lock_release(roomLock);
+            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+            writer_write_string(writer, "Please enter your nick: ");
+        } else {
+            struct member *member = 0;
+            struct string_buffer *joinMessage = create_string_buffer();
+            string_buffer_append_string_buffer(joinMessage, line);
+            string_buffer_append_string(joinMessage, " has joined the room.");
+            room_broadcast_message(room, joinMessage);
+            string_buffer_dispose(joinMessage);
+
+            {
+                struct string_buffer *nickCopy = string_buffer_copy(line);
+                //@ open room(room);
+                member = malloc(sizeof(struct member));
+                if (member == 0) {
+                    abort();
+                }
+                member->nick = nickCopy;
+                member->writer = writer;
+                //@ split_fraction member_writer(member, _) by 1/2;
+                //@ close member(member);
+                //@ assert room->members |-> ?list &*& lseg(list, 0, ?members, @member);
+                member->next = room->members;
+                room->members = member;
+                //@ open member_next(member, _);
+                //@ close lseg(member, 0, cons(member, members), @member);
+                //@ assert [_]room->ghost_list_id |-> ?id;
+                //@ split_fraction room_ghost_list_id(room, id);
+                //@ ghost_list_add(id, member);
+                //@ close room(room);
+            }
+
+            //@ close room_ctor(room)();
+            lock_release(roomLock);
+            connection->member = member;
+            connection->nick = string_buffer_copy(line);
+        }
+    } else {
+        struct string_buffer *fullMessage = create_string_buffer();
+        string_buffer_append_string_buffer(fullMessage, connection->nick);
+        string_buffer_append_string(fullMessage, " says: ");
+        string_buffer_append_string_buffer(fullMessage, line);
+        lock_acquire(roomLock);
+        //@ open room_ctor(room)();
+        room_broadcast_message(room, fullMessage);
+        //@ close room_ctor(room)();
+        lock_release(roomLock);
+        string_buffer_dispose(fullMessage);
+    }
+    //@ close client(connection, room);
+    //@ close connection(connection, room, false);
+}
+
+/*
+Removes the client from the room if it had joined, and closes its socket.
+*/
+void connection_close(struct room *room, struct lock *roomLock, struct connection *connection)
+    //@ requires [_]lock(roomLock, ?roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures [_]lock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil);
+{
+    //@ open connection(connection, room, false);
+    //@ open client(connection, room);
+    struct member *member = connection->member;
+    if (member != 0) {
+        lock_acquire(roomLock);
+        //@ open room_ctor(room)();
+        //@ open room(room);
+        {
+            struct member *membersList = room->members;
+            //@ open room_members(room, _);
+            //@ assert lseg(membersList, 0, ?members, @member);
+            //@ assert [_]ghost_list_member_handle(?id, ?d);
+            //@ ghost_list_member_handle_lemma(id, d);
+            lseg_remove(&room->members, member);
+            //@ assert pointer(&room->members, ?list);
+            //@ close room_members(room, list);
+            //@ assert pointer((void *)member, ?memberNext);
+            //@ close member_next(member, memberNext);
+        }
+        //@ assert ghost_list(?id, _);
+        //@ ghost_list_remove(id, member);
+        //@ close room(room);
+        {
+            struct string_buffer *goodbyeMessage = create_string_buffer();
+            string_buffer_append_string_buffer(goodbyeMessage, connection->nick);
+            string_buffer_append_string(goodbyeMessage, " left the room.");
+            room_broadcast_message(room, goodbyeMessage);
+            string_buffer_dispose(goodbyeMessage);
+        }
+        //@ close room_ctor(room)();
+        lock_release(roomLock);
+
+        //@ open member(member);
+        string_buffer_dispose(member->nick);
+        free(member);
+    }
+    string_buffer_dispose(connection->nick);
+    string_buffer_dispose(connection->line);
+    socket_close(connection->socket);
+    free(connection);
+}
+
+/*
+Handles every line that the client has sent so far. The client is then registered with the poller again,
+or closed if it reached the end of its input.
+*/
+void client_run(struct server *server, struct connection *connection)
+    //@ requires [_]server(server, ?poller, ?room, ?roomLock) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil);
+{
+    int status = connection_read_line(connection);
+    while (status == READ_LINE)
+        //@ invariant [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    {
+        connection_handle_line(server->room, server->room_lock, connection);
+        status = connection_read_line(connection);
+    }
+    if (status == READ_EOF) {
+        connection_close(server->room, server->room_lock, connection);
+    } else {
+        //@ open connection(connection, room, false);
+        //@ open client(connection, room);
+        struct reader *reader = socket_get_reader(connection->socket);
+        //@ close client(connection, room);
+        //@ close connection(connection, room, false);
+        //@ close connection_ready(room)(connection);
+        poller_watch_reader(server->poller, reader, connection);
+    }
+}
+
+/*
+Accepts every pending client, greets it and registers it with the poller.
+The listening connection is then registered with the poller again.
+*/
+void listener_run(struct server *server, struct connection *listener)
+    //@ requires [_]server(server, ?poller, ?room, ?roomLock) &*& lockset(currentThread, nil) &*& connection(listener, room, true);
+    //@ ensures [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil);
+{
+    //@ open connection(listener, room, true);
+    struct server_socket *serverSocket = listener->server_socket;
+    struct socket *socket = server_socket_try_accept(serverSocket);
+    while (socket != 0)
+        /*@
+        invariant
+            [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil) &*& server_socket(serverSocket) &*&
+            socket == 0 ? emp : socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+        @*/
+    {
+        struct reader *reader = socket_get_reader(socket);
+        struct writer *writer = socket_get_writer(socket);
+        struct connection *connection = malloc(sizeof(struct connection));
+        if (connection == 0) {
+            abort();
+        }
+        connection_greet(server->room, server->room_lock, writer);
+        connection->server_socket = 0;
+        connection->socket = socket;
+        connection->line = create_string_buffer();
+        connection->nick = 0;
+        connection->member = 0;
+        //@ close client(connection, room);
+        //@ close connection(connection, room, false);
+        //@ close connection_ready(room)(connection);
+        poller_watch_reader(server->poller, reader, connection);
+        socket = server_socket_try_accept(serverSocket);
+    }
+    //@ close connection(listener, room, true);
+    //@ close connection_ready(room)(listener);
+    poller_watch_server_socket(server->poller, serverSocket, listener);
+}
+
+/*@
+
+predicate_family_instance thread_run_pre(server_worker)(void *data, any info) = [_]server(data, _, _, _);
+predicate_family_instance thread_run_post(server_worker)(void *data, any info) = false;
+
+@*/
+
+/*
+A worker of the pool. It repeatedly takes a ready connection from the poller and handles it.
+*/
+void server_worker(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(server_worker)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(server_worker)(data, info) &*& lockset(currentThread, nil);
+{
+    //@ open thread_run_pre(server_worker)(data, info);
+    struct server *server = data;
+    for (;;)
+        //@ invariant [_]server(server, ?poller, ?room, ?roomLock) &*& lockset(currentThread, nil);
+    {
+        struct connection *connection = poller_wait(server->poller);
+        //@ open connection_ready(room)(connection);
+        //@ open connection(connection, room, ?listening);
+        bool isListener = connection->server_socket != 0;
+        //@ close connection(connection, room, listening);
+        if (isListener) {
+            listener_run(server, connection);
+        } else {
+            client_run(server, connection);
+        }
+    }
+}
+
+int main() //@ : main
+    //@ requires true;
+    //@ ensures false;
+{
+    struct room *room = create_room();
+    //@ close room_ctor(room)();
+    //@ close create_lock_ghost_args(room_ctor(room), nil, nil);
+    struct lock *roomLock = create_lock();
+    //@ leak lock(roomLock, _, _);
+    //@ close create_poller_ghost_arg(connection_ready(room));
+    struct poller *poller = create_poller();
+    //@ leak poller(poller, _);
+    struct server *server = malloc(sizeof(struct server));
+    struct connection *listener = malloc(sizeof(struct connection));
+    if (server == 0 || listener == 0) {
+        abort();
+    }
+    server->poller = poller;
+    server->room = room;
+    server->room_lock = roomLock;
+    //@ leak server(server, poller, room, roomLock);
+
+    struct server_socket *serverSocket = create_nonblocking_server_socket(12345);
+    listener->server_socket = serverSocket;
+    //@ close connection(listener, room, true);
+    //@ close connection_ready(room)(listener);
+    poller_watch_server_socket(poller, serverSocket, listener);
+
+    struct thread *worker = 0;
+    for (int i = 0; i < WORKER_COUNT; i++)
+        //@ invariant [_]server(server, poller, room, roomLock) &*& worker == 0 ? emp : thread(worker, server_worker, server, unit);
+    {
+        //@ if (worker != 0) leak thread(worker, _, _, _);
+        //@ close thread_run_pre(server_worker)(server, unit);
+        worker = thread_start_joinable(server_worker, server);
+    }
+    // The workers never return, so this keeps the main thread waiting.
+    thread_join(worker);
+    //@ open thread_run_post(server_worker)(server, unit);
+}
@@ -0,0 +1,343 @@
+#include <stdbool.h>
+#include "lists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+
+#define WORKER_COUNT 4
+
+struct member {
+    struct member *next;
+    struct string_buffer *nick;
+    struct writer *writer;
+};
+
+struct room {
+    struct member *members;
+};
+
+/**
+ * Description:
+ * The create_room function allocates a new chat room without members.
+ * If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the newly created room.
+ */
+struct room *create_room()
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    return room;
+}
+
+/**
+ * Description:
+ * The room_has_member function checks whether a member of the room uses the given nickname.
+ * It walks the linked list of members and compares each member's nickname with the given one until a match is found or the end of the list is reached.
+ *
+ * @param room A pointer to the room structure.
+ * @param nick A pointer to the string buffer containing the nickname to search for.
+ *
+ * @return True if a member with the specified nickname is found in the room, otherwise false.
+ */
+bool room_has_member(struct room *room, struct string_buffer *nick)
+{
+    struct member *iter = room->members;
+    bool hasMember = false;
+    while (iter != 0 && !hasMember)
+    {
+        hasMember = string_buffer_equals(iter->nick, nick);
+        iter = *(void **)(void *)iter;
+    }
+    return hasMember;
+}
+
+/**
+ * Description:
+ * The room_broadcast_message function broadcasts a message to all members of the room.
+ * It iterates through the linked list of members and writes the message, followed by "\r\n", to each member's writer.
+ *
+ * @param room A pointer to the room structure.
+ * @param message A pointer to the string buffer containing the message to be broadcast.
+ */
+void room_broadcast_message(struct room *room, struct string_buffer *message)
+{
+    struct member *iter = room->members;
+    while (iter != 0)
+    {
+        writer_write_string_buffer(iter->writer, message);
+        writer_write_string(iter->writer, "\r\n");
+        iter = *(void **)(void *)iter;
+    }
+}
+
+// A connection is either the listening server socket or a client. A client that has not picked a nick yet
+// owns its socket writer; once it has joined, the writer belongs to its member in the room.
+struct connection {
+    struct server_socket *server_socket;
+    struct socket *socket;
+    struct string_buffer *line;
+    struct string_buffer *nick;
+    struct member *member;
+};
+
+struct server {
+    struct poller *poller;
+    struct room *room;
+    struct lock *room_lock;
+};
+
+/**
+ * Description:
+ * The connection_greet function welcomes a newly accepted client.
+ * It writes a welcome message and the nicknames of the members currently in the room, which it copies while holding the room lock and writes after releasing it, and then asks the client for a nickname.
+ *
+ * @param room A pointer to the room structure.
+ * @param roomLock A pointer to the lock protecting the room, which is not held by the caller.
+ * @param writer The writer of the client's socket.
+ */
+void connection_greet(struct room *room, struct lock *roomLock, struct writer *writer)
+{
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    struct string_buffer *members = create_string_buffer();
+    lock_acquire(roomLock);
+    {
+        struct member *iter = room->members;
+        while (iter != 0)
+        {
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            iter = *(void **)(void *)iter;
+        }
+    }
+    lock_release(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    writer_write_string(writer, "Please enter your nick: ");
+}
+
+/**
+ * Description:
+ * The connection_read_line function tries to read the next line sent by a client into the connection's line buffer, without waiting for more input.
+ *
+ * @param connection A pointer to a client connection (not the listening connection).
+ *
+ * @return READ_LINE if the line buffer now holds the next line, READ_PENDING if no complete line has been received yet, or READ_EOF at the end of the client's input.
+ */
+int connection_read_line(struct connection *connection)
+{
+    struct reader *reader = socket_get_reader(connection->socket);
+    int status = reader_try_read_line(reader, connection->line);
+    return status;
+}
+
+/**
+ * Description:
+ * The connection_handle_line function handles the line that a client has just sent.
+ * If the client has not joined the room yet, the line is the nickname it asks for. If a member already uses that nickname, the client gets an error and is asked again. Otherwise the join is announced to the room, a member holding a copy of the nickname and the client's writer is added to the room, and the connection keeps its own copy of the nickname.
+ * If the client has already joined, "<nick> says: <line>" is broadcast to the room. The message is built before the room lock is taken.
+ *
+ * @param room A pointer to the room structure.
+ * @param roomLock A pointer to the lock protecting the room, which is not held by the caller.
+ * @param connection A pointer to a client connection whose line buffer holds the line.
+ */
+void connection_handle_line(struct room *room, struct lock *roomLock, struct connection *connection)
+{
+    struct writer *writer = socket_get_writer(connection->socket);
+    struct string_buffer *line = connection->line;
+    if (connection->member == 0) {
+        lock_acquire(roomLock);
+        bool hasMember = room_has_member(room, line);
+        if (hasMember) {
+            lock_release(roomLock);
+            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+            writer_write_string(writer, "Please enter your nick: ");
+        } else {
+            struct member *member = 0;
+            struct string_buffer *joinMessage = create_string_buffer();
+            string_buffer_append_string_buffer(joinMessage, line);
+            string_buffer_append_string(joinMessage, " has joined the room.");
+            room_broadcast_message(room, joinMessage);
+            string_buffer_dispose(joinMessage);
+
+            {
+                struct string_buffer *nickCopy = string_buffer_copy(line);
+                member = malloc(sizeof(struct member));
+                if (member == 0) {
+                    abort();
+                }
+                member->nick = nickCopy;
+                member->writer = writer;
+                member->next = room->members;
+                room->members = member;
+            }
+
+            lock_release(roomLock);
+            connection->member = member;
+            connection->nick = string_buffer_copy(line);
+        }
+    } else {
+        struct string_buffer *fullMessage = create_string_buffer();
+        string_buffer_append_string_buffer(fullMessage, connection->nick);
+        string_buffer_append_string(fullMessage, " says: ");
+        string_buffer_append_string_buffer(fullMessage, line);
+        lock_acquire(roomLock);
+        room_broadcast_message(room, fullMessage);
+        lock_release(roomLock);
+        string_buffer_dispose(fullMessage);
+    }
+}
+
+/**
+ * Description:
+ * The connection_close function ends a client connection.
+ * If the client had joined the room, its member is removed from the room, its departure is announced to the remaining members, and the member is freed. The socket is then closed and the connection freed.
+ *
+ * @param room A pointer to the room structure.
+ * @param roomLock A pointer to the lock protecting the room, which is not held by the caller.
+ * @param connection A pointer to a client connection.
+ */
+void connection_close(struct room *room, struct lock *roomLock, struct connection *connection)
+{
+    struct member *member = connection->member;
+    if (member != 0) {
+        lock_acquire(roomLock);
+        {
+            struct member *membersList = room->members;
+            lseg_remove(&room->members, member);
+        }
+        {
+            struct string_buffer *goodbyeMessage = create_string_buffer();
+            string_buffer_append_string_buffer(goodbyeMessage, connection->nick);
+            string_buffer_append_string(goodbyeMessage, " left the room.");
+            room_broadcast_message(room, goodbyeMessage);
+            string_buffer_dispose(goodbyeMessage);
+        }
+        lock_release(roomLock);
+
+        string_buffer_dispose(member->nick);
+        free(member);
+    }
+    string_buffer_dispose(connection->nick);
+    string_buffer_dispose(connection->line);
+    socket_close(connection->socket);
+    free(connection);
+}
+
+/**
+ * Description:
+ * The client_run function handles a client connection that the poller reported as readable.
+ * It handles every complete line that the client has sent so far. At the end of the client's input it closes the connection; otherwise it registers the connection with the poller again so that the next batch of lines is handled by whichever worker picks it up.
+ *
+ * @param server A pointer to the server structure holding the poller, the room and the room lock.
+ * @param connection A pointer to a client connection.
+ */
+void client_run(struct server *server, struct connection *connection)
+{
+    int status = connection_read_line(connection);
+    while (status == READ_LINE)
+    {
+        connection_handle_line(server->room, server->room_lock, connection);
+        status = connection_read_line(connection);
+    }
+    if (status == READ_EOF) {
+        connection_close(server->room, server->room_lock, connection);
+    } else {
+        struct reader *reader = socket_get_reader(connection->socket);
+        poller_watch_reader(server->poller, reader, connection);
+    }
+}
+
+/**
+ * Description:
+ * The listener_run function handles the listening connection when the poller reports pending clients.
+ * It accepts clients without waiting until none is left. Each new client is greeted, gets a connection with an empty line buffer, and is registered with the poller. Finally, the listening connection is registered with the poller again.
+ *
+ * @param server A pointer to the server structure holding the poller, the room and the room lock.
+ * @param listener A pointer to the listening connection, which holds the non-blocking server socket.
+ */
+void listener_run(struct server *server, struct connection *listener)
+{
+    struct server_socket *serverSocket = listener->server_socket;
+    struct socket *socket = server_socket_try_accept(serverSocket);
+    while (socket != 0)
+    {
+        struct reader *reader = socket_get_reader(socket);
+        struct writer *writer = socket_get_writer(socket);
+        struct connection *connection = malloc(sizeof(struct connection));
+        if (connection == 0) {
+            abort();
+        }
+        connection_greet(server->room, server->room_lock, writer);
+        connection->server_socket = 0;
+        connection->socket = socket;
+        connection->line = create_string_buffer();
+        connection->nick = 0;
+        connection->member = 0;
+        poller_watch_reader(server->poller, reader, connection);
+        socket = server_socket_try_accept(serverSocket);
+    }
+    poller_watch_server_socket(server->poller, serverSocket, listener);
+}
+
+/**
+ * Description:
+ * The server_worker function is the body of a worker thread of the server.
+ * It repeatedly waits for the poller to report a ready connection and handles it with listener_run or client_run, depending on whether it is the listening connection. It never returns.
+ *
+ * @param data A pointer to the server structure, which is shared by all workers.
+ */
+void server_worker(void *data)
+{
+    struct server *server = data;
+    for (;;)
+    {
+        struct connection *connection = poller_wait(server->poller);
+        bool isListener = connection->server_socket != 0;
+        if (isListener) {
+            listener_run(server, connection);
+        } else {
+            client_run(server, connection);
+        }
+    }
+}
+
+/**
+ * Description:
+ * The main function creates the chat room, its lock and a poller, and listens on port 12345 with a non-blocking server socket registered with the poller.
+ * It then starts WORKER_COUNT worker threads, which serve every client, and waits for one of them forever.
+ */
+int main()
+{
+    struct room *room = create_room();
+    struct lock *roomLock = create_lock();
+    struct poller *poller = create_poller();
+    struct server *server = malloc(sizeof(struct server));
+    struct connection *listener = malloc(sizeof(struct connection));
+    if (server == 0 || listener == 0) {
+        abort();
+    }
+    server->poller = poller;
+    server->room = room;
+    server->room_lock = roomLock;
+
+    struct server_socket *serverSocket = create_nonblocking_server_socket(12345);
+    listener->server_socket = serverSocket;
+    poller_watch_server_socket(poller, serverSocket, listener);
+
+    struct thread *worker = 0;
+    for (int i = 0; i < WORKER_COUNT; i++)
+    {
+        worker = thread_start_joinable(server_worker, server);
+    }
+    // The workers never return, so this keeps the main thread waiting.
+    thread_join(worker);
+}
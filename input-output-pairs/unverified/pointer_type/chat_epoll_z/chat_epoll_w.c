@@ -0,0 +1,348 @@
+#include <stdbool.h>
+#include "lists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+//@ #include "ghostlist.gh"
+
+#define WORKER_COUNT 4
+
+struct member {
+    struct member *next;
+    struct string_buffer *nick;
+    struct writer *writer;
+};
+
+/*@
+predicate member(struct member* member) =
+    member->nick |-> ?nick &*& [1/2]member->writer |-> ?writer &*& string_buffer(nick, _) &*& writer(writer) &*& malloc_block_member(member);
+@*/
+
+struct room {
+    struct member *members;
+    //@ int ghost_list_id;
+};
+
+/*@
+predicate room(struct room* room) =
+    room->members |-> ?membersList &*& [?f]room->ghost_list_id |-> ?id &*&
+    lseg(membersList, 0, ?members, member) &*&
+    ghost_list(id, members) &*& malloc_block_room(room);
+@*/
+
+struct room *create_room()
+    //@ requires emp;
+    //@ ensures room(result);
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    return room;
+}
+
+bool room_has_member(struct room *room, struct string_buffer *nick)
+    //@ requires room(room) &*& string_buffer(nick, _);
+    //@ ensures room(room) &*& string_buffer(nick, _);
+{
+    struct member *iter = room->members;
+    bool hasMember = false;
+    while (iter != 0 && !hasMember)
+    {
+        hasMember = string_buffer_equals(iter->nick, nick);
+        iter = *(void **)(void *)iter;
+    }
+    return hasMember;
+}
+
+void room_broadcast_message(struct room *room, struct string_buffer *message)
+    //@ requires room(room) &*& string_buffer(message, _);
+    //@ ensures room(room) &*& string_buffer(message, _);
+{
+    struct member *iter = room->members;
+    while (iter != 0)
+    {
+        writer_write_string_buffer(iter->writer, message);
+        writer_write_string(iter->writer, "\r\n");
+        iter = *(void **)(void *)iter;
+    }
+}
+
+// A connection is either the listening server socket or a client. A client that has not picked a nick yet
+// owns its socket writer; once it has joined, the writer belongs to its member in the room.
+struct connection {
+    struct server_socket *server_socket;
+    struct socket *socket;
+    struct string_buffer *line;
+    struct string_buffer *nick;
+    struct member *member;
+};
+
+struct server {
+    struct poller *poller;
+    struct room *room;
+    struct lock *room_lock;
+};
+
+/*@
+
+predicate_ctor room_ctor(struct room *room)() =
+    room(room);
+
+predicate client(struct connection *connection, struct room *room) =
+    connection->socket |-> ?socket &*& connection->line |-> ?line &*& connection->nick |-> ?nick &*& connection->member |-> ?member &*&
+    socket(socket, ?reader, ?writer) &*& reader(reader) &*& string_buffer(line, _) &*&
+    member == 0 ?
+        writer(writer) &*& nick == 0
+    :
+        string_buffer(nick, _) &*& [1/2]member->writer |-> writer;
+
+predicate connection(struct connection *connection, struct room *room, bool listening) =
+    connection->server_socket |-> ?serverSocket &*& malloc_block_connection(connection) &*& listening == (serverSocket != 0) &*&
+    listening ?
+        server_socket(serverSocket) &*&
+        connection->socket |-> _ &*& connection->line |-> _ &*& connection->nick |-> _ &*& connection->member |-> _
+    :
+        client(connection, room);
+
+// While a connection is registered with the poller, the poller owns it. poller_wait hands it to one worker.
+predicate_ctor connection_ready(struct room *room)(void *data) =
+    connection(data, room, _);
+
+predicate server(struct server *server; struct poller *poller, struct room *room, struct lock *roomLock) =
+    server->poller |-> poller &*& server->room |-> room &*& server->room_lock |-> roomLock &*&
+    [_]poller(poller, connection_ready(room)) &*& [_]lock(roomLock, _, room_ctor(room));
+@*/
+
+/*
+Sends the welcome message and the list of members to a new client, and asks for a nick. The nicks are copied while
+the room lock is held and written after it is released, so the write never holds up the other workers.
+*/
+void connection_greet(struct room *room, struct lock *roomLock, struct writer *writer)
+    //@ requires [_]lock(roomLock, _, room_ctor(room)) &*& lockset(currentThread, nil) &*& writer(writer);
+    //@ ensures [_]lock(roomLock, _, room_ctor(room)) &*& lockset(currentThread, nil) &*& writer(writer);
+{
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    struct string_buffer *members = create_string_buffer();
+    lock_acquire(roomLock);
+    {
+        struct member *iter = room->members;
+        while (iter != 0)
+        {
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            iter = *(void **)(void *)iter;
+        }
+    }
+    lock_release(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    writer_write_string(writer, "Please enter your nick: ");
+}
+
+int connection_read_line(struct connection *connection)
+    //@ requires connection(connection, ?room, false);
+    //@ ensures connection(connection, room, false);
+{
+    struct reader *reader = socket_get_reader(connection->socket);
+    int status = reader_try_read_line(reader, connection->line);
+    return status;
+}
+
+/*
+Handles a line that a client sent. Before the client has joined, the line is the nick it asks for;
+afterwards, it is a message for the room.
+*/
+void connection_handle_line(struct room *room, struct lock *roomLock, struct connection *connection)
+    //@ requires [_]lock(roomLock, ?roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures [_]lock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+{
+    struct writer *writer = socket_get_writer(connection->socket);
+    struct string_buffer *line = connection->line;
+    if (connection->member == 0) {
+        lock_acquire(roomLock);
+        bool hasMember = room_has_member(room, line);
+        if (hasMember) {
+            lock_release(roomLock);
+            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+            writer_write_string(writer, "Please enter your nick: ");
+        } else {
+            struct member *member = 0;
+            struct string_buffer *joinMessage = create_string_buffer();
+            string_buffer_append_string_buffer(joinMessage, line);
+            string_buffer_append_string(joinMessage, " has joined the room.");
+            room_broadcast_message(room, joinMessage);
+            string_buffer_dispose(joinMessage);
+
+            {
+                struct string_buffer *nickCopy = string_buffer_copy(line);
+                member = malloc(sizeof(struct member));
+                if (member == 0) {
+                    abort();
+                }
+                member->nick = nickCopy;
+                member->writer = writer;
+                member->next = room->members;
+                room->members = member;
+            }
+
+            lock_release(roomLock);
+            connection->member = member;
+            connection->nick = string_buffer_copy(line);
+        }
+    } else {
+        struct string_buffer *fullMessage = create_string_buffer();
+        string_buffer_append_string_buffer(fullMessage, connection->nick);
+        string_buffer_append_string(fullMessage, " says: ");
+        string_buffer_append_string_buffer(fullMessage, line);
+        lock_acquire(roomLock);
+        room_broadcast_message(room, fullMessage);
+        lock_release(roomLock);
+        string_buffer_dispose(fullMessage);
+    }
+}
+
+/*
+Removes the client from the room if it had joined, and closes its socket.
+*/
+void connection_close(struct room *room, struct lock *roomLock, struct connection *connection)
+    //@ requires [_]lock(roomLock, ?roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures lockset(currentThread, nil);
+{
+    struct member *member = connection->member;
+    if (member != 0) {
+        lock_acquire(roomLock);
+        {
+            struct member *membersList = room->members;
+            lseg_remove(&room->members, member);
+        }
+        {
+            struct string_buffer *goodbyeMessage = create_string_buffer();
+            string_buffer_append_string_buffer(goodbyeMessage, connection->nick);
+            string_buffer_append_string(goodbyeMessage, " left the room.");
+            room_broadcast_message(room, goodbyeMessage);
+            string_buffer_dispose(goodbyeMessage);
+        }
+        lock_release(roomLock);
+
+        string_buffer_dispose(member->nick);
+        free(member);
+    }
+    string_buffer_dispose(connection->nick);
+    string_buffer_dispose(connection->line);
+    socket_close(connection->socket);
+    free(connection);
+}
+
+/*
+Handles every line that the client has sent so far. The client is then registered with the poller again,
+or closed if it reached the end of its input.
+*/
+void client_run(struct server *server, struct connection *connection)
+    //@ requires [_]server(server, ?poller, ?room, ?roomLock) &*& lockset(currentThread, nil) &*& connection(connection, room, false);
+    //@ ensures [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil);
+{
+    int status = connection_read_line(connection);
+    while (status == READ_LINE)
+    {
+        connection_handle_line(server->room, server->room_lock, connection);
+        status = connection_read_line(connection);
+    }
+    if (status == READ_EOF) {
+        connection_close(server->room, server->room_lock, connection);
+    } else {
+        struct reader *reader = socket_get_reader(connection->socket);
+        poller_watch_reader(server->poller, reader, connection);
+    }
+}
+
+/*
+Accepts every pending client, greets it and registers it with the poller.
+The listening connection is then registered with the poller again.
+*/
+void listener_run(struct server *server, struct connection *listener)
+    //@ requires [_]server(server, ?poller, ?room, ?roomLock) &*& lockset(currentThread, nil) &*& connection(listener, room, true);
+    //@ ensures [_]server(server, poller, room, roomLock) &*& lockset(currentThread, nil);
+{
+    struct server_socket *serverSocket = listener->server_socket;
+    struct socket *socket = server_socket_try_accept(serverSocket);
+    while (socket != 0)
+    {
+        struct reader *reader = socket_get_reader(socket);
+        struct writer *writer = socket_get_writer(socket);
+        struct connection *connection = malloc(sizeof(struct connection));
+        if (connection == 0) {
+            abort();
+        }
+        connection_greet(server->room, server->room_lock, writer);
+        connection->server_socket = 0;
+        connection->socket = socket;
+        connection->line = create_string_buffer();
+        connection->nick = 0;
+        connection->member = 0;
+        poller_watch_reader(server->poller, reader, connection);
+        socket = server_socket_try_accept(serverSocket);
+    }
+    poller_watch_server_socket(server->poller, serverSocket, listener);
+}
+
+/*@
+
+predicate_family_instance thread_run_pre(server_worker)(void *data, any info) = [_]server(data, _, _, _);
+predicate_family_instance thread_run_post(server_worker)(void *data, any info) = false;
+@*/
+
+/*
+A worker of the pool. It repeatedly takes a ready connection from the poller and handles it.
+*/
+void server_worker(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(server_worker)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(server_worker)(data, info) &*& lockset(currentThread, nil);
+{
+    struct server *server = data;
+    for (;;)
+    {
+        struct connection *connection = poller_wait(server->poller);
+        bool isListener = connection->server_socket != 0;
+        if (isListener) {
+            listener_run(server, connection);
+        } else {
+            client_run(server, connection);
+        }
+    }
+}
+
+int main() //@ : main
+    //@ requires true;
+    //@ ensures false;
+{
+    struct room *room = create_room();
+    struct lock *roomLock = create_lock();
+    struct poller *poller = create_poller();
+    struct server *server = malloc(sizeof(struct server));
+    struct connection *listener = malloc(sizeof(struct connection));
+    if (server == 0 || listener == 0) {
+        abort();
+    }
+    server->poller = poller;
+    server->room = room;
+    server->room_lock = roomLock;
+
+    struct server_socket *serverSocket = create_nonblocking_server_socket(12345);
+    listener->server_socket = serverSocket;
+    poller_watch_server_socket(poller, serverSocket, listener);
+
+    struct thread *worker = 0;
+    for (int i = 0; i < WORKER_COUNT; i++)
+    {
+        worker = thread_start_joinable(server_worker, server);
+    }
+    // The workers never return, so this keeps the main thread waiting.
+    thread_join(worker);
+}
@@ -0,0 +1,103 @@
+#ifndef SOCKETS_H
+#define SOCKETS_H
+
+#include <stdbool.h>
+#include "stringBuffers.h"
+
+struct server_socket;
+struct socket;
+struct reader;
+struct writer;
+
+/*@
+predicate server_socket(struct server_socket *serverSocket);
+predicate socket(struct socket *socket, struct reader *reader, struct writer *writer);
+predicate reader(struct reader *reader);
+predicate writer(struct writer *writer);
+@*/
+
+struct server_socket *create_server_socket(int port);
+    //@ requires emp;
+    //@ ensures server_socket(result);
+struct socket *server_socket_accept(struct server_socket *serverSocket);
+    //@ requires server_socket(serverSocket);
+    //@ ensures server_socket(serverSocket) &*& socket(result, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+struct socket *create_client_socket(int port);
+    //@ requires emp;
+    //@ ensures socket(result, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+
+struct reader *socket_get_reader(struct socket *socket);
+    //@ requires socket(socket, ?reader, ?writer);
+    //@ ensures socket(socket, reader, writer) &*& result == reader;
+struct writer *socket_get_writer(struct socket *socket);
+    //@ requires socket(socket, ?reader, ?writer);
+    //@ ensures socket(socket, reader, writer) &*& result == writer;
+void socket_close(struct socket *socket);
+    //@ requires socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+    //@ ensures emp;
+    
+bool reader_read_line(struct reader *reader, struct string_buffer *buffer);
+    //@ requires reader(reader) &*& string_buffer(buffer, _);
+    //@ ensures reader(reader) &*& string_buffer(buffer, _);
+void writer_write_string(struct writer *writer, char *string);
+    //@ requires writer(writer) &*& [?f]string(string, ?cs);
+    //@ ensures writer(writer) &*& [f]string(string, cs);
+void writer_write_string_buffer(struct writer *writer, struct string_buffer *buffer);
+    //@ requires writer(writer) &*& [?f]string_buffer(buffer, ?cs);
+    //@ ensures writer(writer) &*& [f]string_buffer(buffer, cs);
+
+// **** Readiness-based I/O ****
+
+// A poller reports which of the sockets registered with it are ready (see epoll(7)).
+// Registrations are one-shot: once poller_wait has reported a registration, it stays disarmed until
+// it is registered again, so each readiness event hands the socket to exactly one thread.
+// The data registered together with a socket belongs to the poller while the registration is armed;
+// the poller's ready predicate describes what that data owns.
+
+struct poller;
+
+/*@
+predicate poller(struct poller *poller; predicate(void *) ready);
+
+predicate create_poller_ghost_arg(predicate(void *) ready) = true;
+@*/
+
+struct poller *create_poller();
+    //@ requires create_poller_ghost_arg(?ready);
+    //@ ensures poller(result, ready);
+void poller_watch_server_socket(struct poller *poller, struct server_socket *serverSocket, void *data);
+    //@ requires [?f]poller(poller, ?ready) &*& ready(data);
+    //@ ensures [f]poller(poller, ready);
+void poller_watch_reader(struct poller *poller, struct reader *reader, void *data);
+    //@ requires [?f]poller(poller, ?ready) &*& ready(data);
+    //@ ensures [f]poller(poller, ready);
+void *poller_wait(struct poller *poller);
+    //@ requires [?f]poller(poller, ?ready);
+    //@ ensures [f]poller(poller, ready) &*& ready(result);
+
+// A non-blocking server socket never waits in server_socket_try_accept, and the sockets it accepts
+// never wait in reader_try_read_line. Their writers never wait either: what the socket cannot take at once is
+// queued in the writer and sent by the poller as the socket becomes writable (EPOLLOUT). A writer queues at most
+// WRITER_QUEUE_LIMIT bytes; output beyond that is dropped, so a client that stops reading loses messages
+// instead of holding up the threads that write to it.
+
+#define WRITER_QUEUE_LIMIT 1048576
+
+struct server_socket *create_nonblocking_server_socket(int port);
+    //@ requires emp;
+    //@ ensures server_socket(result);
+struct socket *server_socket_try_accept(struct server_socket *serverSocket);
+    //@ requires server_socket(serverSocket);
+    //@ ensures server_socket(serverSocket) &*& result == 0 ? emp : socket(result, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+
+#define READ_LINE 0
+#define READ_PENDING 1
+#define READ_EOF 2
+
+// Returns READ_LINE when buffer holds the next line, without its line terminator.
+// Returns READ_PENDING when no complete line has arrived yet; the bytes received so far stay in the reader.
+int reader_try_read_line(struct reader *reader, struct string_buffer *buffer);
+    //@ requires reader(reader) &*& string_buffer(buffer, _);
+    //@ ensures reader(reader) &*& string_buffer(buffer, _) &*& result == READ_LINE || result == READ_PENDING || result == READ_EOF;
+
+#endif
@@ -0,0 +1,608 @@
+#include <stdbool.h>
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "clock.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+// Load generator for the chat server on CHAT_PORT. A number of clients join the room, then each of them
+// sends MESSAGES_PER_CLIENT messages at a fixed rate, followed by "done". A message carries its send time,
+// so every client can compute the end-to-end latency of each broadcast it receives.
+// The number of clients and the rate per client are the command-line arguments.
+
+#define CHAT_PORT 12345
+#define DEFAULT_CLIENT_COUNT 64
+#define MAX_CLIENT_COUNT 256
+#define DEFAULT_RATE 100
+#define MAX_RATE 100000
+#define MESSAGES_PER_CLIENT 200
+#define WARMUP_NANOS 500000000
+#define DONE_RESEND_NANOS 100000000
+#define LATENCY_LIMIT (MAX_CLIENT_COUNT * MESSAGES_PER_CLIENT)
+
+// Counts the receiver threads that have stopped.
+struct progress {
+    struct mutex *mutex;
+    int finished;
+};
+
+struct client {
+    struct client *next;
+    int id;
+    struct socket *socket;
+    struct string_buffer *nick;
+    struct progress *progress;
+    long long send_start;
+    long long send_interval;
+    int client_count;
+    bool *done_from;
+    long long *latencies;
+    int latency_capacity;
+    int latency_count;
+    struct thread *sender;
+    struct thread *receiver;
+};
+
+/**
+ * Description:
+ * The string_buffer_append_number function appends the decimal representation of a non-negative number to a string buffer.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param value The number to append; it must not be negative.
+ */
+void string_buffer_append_number(struct string_buffer *buffer, long long value)
+{
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[19 - count] = (char)('0' + value % 10);
+        value = value / 10;
+        count++;
+    } while (value != 0);
+    string_buffer_append_chars(buffer, digits + 20 - count, count);
+}
+
+/**
+ * Description:
+ * The parse_timestamp function reads the send time out of the text of a load generator message, which has the form "t <nanoseconds>".
+ *
+ * @param text A pointer to the string buffer holding the message text.
+ *
+ * @return The send time in nanoseconds, or -1 if the text does not have the expected form.
+ */
+long long parse_timestamp(struct string_buffer *text)
+{
+    int length = string_buffer_get_length(text);
+    char *chars = string_buffer_get_chars(text);
+    long long value = -1;
+    if (2 < length && chars[0] == 't' && chars[1] == ' ') {
+        value = 0;
+        for (int i = 2; i < length && 0 <= value; i++)
+        {
+            char c = chars[i];
+            if ('0' <= c && c <= '9' && value < 100000000000000000) {
+                value = value * 10 + (c - '0');
+            } else {
+                value = -1;
+            }
+        }
+    }
+    return value;
+}
+
+/**
+ * Description:
+ * The parse_client_id function reads the client id out of a load generator nick, which has the form "load<id>".
+ *
+ * @param nick A pointer to the string buffer holding the nick.
+ * @param clientCount The number of clients; it is between 1 and MAX_CLIENT_COUNT.
+ *
+ * @return The id, or -1 if the nick does not have the expected form or the id is not below clientCount.
+ */
+int parse_client_id(struct string_buffer *nick, int clientCount)
+{
+    int length = string_buffer_get_length(nick);
+    char *chars = string_buffer_get_chars(nick);
+    int id = -1;
+    if (4 < length && chars[0] == 'l' && chars[1] == 'o' && chars[2] == 'a' && chars[3] == 'd') {
+        id = 0;
+        for (int i = 4; i < length && 0 <= id; i++)
+        {
+            char c = chars[i];
+            if ('0' <= c && c <= '9' && id < clientCount) {
+                id = id * 10 + (c - '0');
+            } else {
+                id = -1;
+            }
+        }
+        if (clientCount <= id) {
+            id = -1;
+        }
+    }
+    return id;
+}
+
+/**
+ * Description:
+ * The parse_argument function reads a decimal command-line argument.
+ *
+ * @param argument The zero-terminated argument.
+ * @param limit The largest accepted value; it is positive.
+ *
+ * @return The value, or -1 if the argument is not a decimal number between 1 and limit.
+ */
+int parse_argument(char *argument, int limit)
+{
+    size_t length = strlen(argument);
+    int value = 0;
+    for (size_t i = 0; i < length && 0 <= value; i++)
+    {
+        char c = argument[i];
+        if ('0' <= c && c <= '9' && value <= limit) {
+            value = value * 10 + (c - '0');
+        } else {
+            value = -1;
+        }
+    }
+    return value == 0 || limit < value ? -1 : value;
+}
+
+/**
+ * Description:
+ * The create_progress function creates the counter of stopped receiver threads, protected by a new mutex.
+ * If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the new counter, which is never freed.
+ */
+struct progress *create_progress()
+{
+    struct progress *progress = malloc(sizeof(struct progress));
+    if (progress == 0) {
+        abort();
+    }
+    progress->finished = 0;
+    progress->mutex = create_mutex();
+    return progress;
+}
+
+/**
+ * Description:
+ * The progress_finished function reads, under its mutex, how many receiver threads have stopped.
+ *
+ * @param progress A pointer to the counter.
+ *
+ * @return The number of receiver threads that have stopped.
+ */
+int progress_finished(struct progress *progress)
+{
+    mutex_acquire(progress->mutex);
+    int finished = progress->finished;
+    mutex_release(progress->mutex);
+    return finished;
+}
+
+/**
+ * Description:
+ * The create_client function connects a new load generator client to the chat server on CHAT_PORT and sends its nick, "load" followed by its id.
+ * The client gets a "done" flag for each of the clientCount clients and room for the latencies of all their messages, and is put in front of the given list of clients.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param id The id of the client, below clientCount.
+ * @param clientCount The number of clients, between 1 and MAX_CLIENT_COUNT.
+ * @param interval The positive number of nanoseconds between two messages of the client.
+ * @param progress The counter the client's receiver thread reports to when it stops.
+ * @param next The list of clients created so far.
+ *
+ * @return The new first client of the list.
+ */
+struct client *create_client(int id, int clientCount, long long interval, struct progress *progress, struct client *next)
+{
+    struct client *client = malloc(sizeof(struct client));
+    int capacity = clientCount * MESSAGES_PER_CLIENT;
+    long long *latencies = malloc((size_t)capacity * sizeof(long long));
+    bool *doneFrom = malloc((size_t)clientCount * sizeof(bool));
+    if (client == 0 || latencies == 0 || doneFrom == 0) {
+        abort();
+    }
+    for (int i = 0; i < clientCount; i++)
+    {
+        doneFrom[i] = false;
+    }
+    struct socket *socket = create_client_socket(CHAT_PORT);
+    struct string_buffer *nick = create_string_buffer();
+    string_buffer_append_string(nick, "load");
+    string_buffer_append_number(nick, id);
+    {
+        struct writer *writer = socket_get_writer(socket);
+        writer_write_string_buffer(writer, nick);
+        writer_write_string(writer, "\r\n");
+    }
+    client->next = next;
+    client->id = id;
+    client->socket = socket;
+    client->nick = nick;
+    client->progress = progress;
+    client->send_interval = interval;
+    client->client_count = clientCount;
+    client->done_from = doneFrom;
+    client->latencies = latencies;
+    client->latency_capacity = capacity;
+    client->latency_count = 0;
+    return client;
+}
+
+/**
+ * Description:
+ * The client_send function is the sender thread of a client.
+ * It sends MESSAGES_PER_CLIENT messages of the form "t <nanoseconds>", one every send_interval nanoseconds starting at the client's send_start, with the clock reading taken just before each message is written, and then sends "done".
+ * Because the send times are fixed in advance, a slow server does not lower the offered load.
+ *
+ * @param data A pointer to the client.
+ */
+void client_send(void *data)
+{
+    struct client *client = data;
+    struct writer *writer = socket_get_writer(client->socket);
+    struct string_buffer *line = create_string_buffer();
+    long long start = client->send_start;
+    long long interval = client->send_interval;
+    for (int i = 0; i < MESSAGES_PER_CLIENT; i++)
+    {
+        clock_sleep_until_nanos(start + (long long)i * interval);
+        string_buffer_clear(line);
+        string_buffer_append_string(line, "t ");
+        string_buffer_append_number(line, clock_now_nanos());
+        string_buffer_append_string(line, "\r\n");
+        writer_write_string_buffer(writer, line);
+    }
+    writer_write_string(writer, "done\r\n");
+    string_buffer_dispose(line);
+}
+
+/**
+ * Description:
+ * The client_receive function is the receiver thread of a client.
+ * It reads the lines broadcast by the chat server and, for every timestamped message, records the time elapsed since it was sent.
+ * It stops when it has received "done" from every client, or when the connection is closed, and then counts itself in the progress counter.
+ * The server handles the lines of one client in order, so a client's "done" arrives after all of that client's delivered messages, whatever the order between different clients. A repeated "done" is counted once.
+ *
+ * @param data A pointer to the client.
+ */
+void client_receive(void *data)
+{
+    struct client *client = data;
+    struct reader *reader = socket_get_reader(client->socket);
+    struct string_buffer *line = create_string_buffer();
+    struct string_buffer *sender = create_string_buffer();
+    struct string_buffer *text = create_string_buffer();
+    int clientCount = client->client_count;
+    bool *doneFrom = client->done_from;
+    int doneCount = 0;
+    bool done = false;
+    while (!done)
+    {
+        bool eof = reader_read_line(reader, line);
+        if (eof) {
+            done = true;
+        } else if (string_buffer_split(line, " says: ", sender, text)) {
+            if (string_buffer_equals_string(text, "done")) {
+                int id = parse_client_id(sender, clientCount);
+                if (0 <= id && !doneFrom[id]) {
+                    doneFrom[id] = true;
+                    doneCount++;
+                }
+                done = doneCount == clientCount;
+            } else {
+                long long sent = parse_timestamp(text);
+                if (0 <= sent && client->latency_count < client->latency_capacity) {
+                    client->latencies[client->latency_count] = clock_now_nanos() - sent;
+                    client->latency_count++;
+                }
+            }
+        }
+    }
+    string_buffer_dispose(line);
+    string_buffer_dispose(sender);
+    string_buffer_dispose(text);
+    {
+        struct progress *progress = client->progress;
+        mutex_acquire(progress->mutex);
+        if (progress->finished < MAX_CLIENT_COUNT) {
+            progress->finished++;
+        }
+        mutex_release(progress->mutex);
+    }
+}
+
+/**
+ * Description:
+ * The start_receivers function starts the receiver thread of every client in the list.
+ *
+ * @param first The first client of the list.
+ */
+void start_receivers(struct client *first)
+{
+    if (first != 0) {
+        first->receiver = thread_start_joinable(client_receive, first);
+        start_receivers(first->next);
+    }
+}
+
+/**
+ * Description:
+ * The start_senders function starts the sender thread of every client in the list.
+ * The first messages of the clients are spread evenly over one message interval after start, by client id.
+ *
+ * @param first The first client of the list.
+ * @param start The clock reading at which the first client sends its first message.
+ * @param clientCount The positive number of clients.
+ */
+void start_senders(struct client *first, long long start, int clientCount)
+{
+    if (first != 0) {
+        first->send_start = start + (long long)first->id * (first->send_interval / clientCount);
+        first->sender = thread_start_joinable(client_send, first);
+        start_senders(first->next, start, clientCount);
+    }
+}
+
+/**
+ * Description:
+ * The join_senders function waits until the sender thread of every client in the list has finished.
+ *
+ * @param first The first client of the list.
+ */
+void join_senders(struct client *first)
+{
+    if (first != 0) {
+        thread_join(first->sender);
+        join_senders(first->next);
+    }
+}
+
+/**
+ * Description:
+ * The send_done function sends the line "done" again from every client in the list.
+ * The server may drop lines for a client that falls behind, including a "done"; a repeated "done" still follows all messages of its client and receivers count it once, so resending does not change the recorded latencies.
+ *
+ * @param first The first client of the list.
+ */
+void send_done(struct client *first)
+{
+    if (first != 0) {
+        struct writer *writer = socket_get_writer(first->socket);
+        writer_write_string(writer, "done\r\n");
+        send_done(first->next);
+    }
+}
+
+/**
+ * Description:
+ * The join_receivers function waits until the receiver thread of every client in the list has finished.
+ *
+ * @param first The first client of the list.
+ */
+void join_receivers(struct client *first)
+{
+    if (first != 0) {
+        thread_join(first->receiver);
+        join_receivers(first->next);
+    }
+}
+
+/**
+ * Description:
+ * The count_latencies function adds up the number of latencies recorded by the clients in the list.
+ *
+ * @param first The first client of the list.
+ *
+ * @return The total number of recorded latencies.
+ */
+int count_latencies(struct client *first)
+{
+    int total = 0;
+    if (first != 0) {
+        total = first->latency_count + count_latencies(first->next);
+    }
+    return total;
+}
+
+/**
+ * Description:
+ * The copy_latencies function copies the latencies recorded by the clients in the list into one array, between the given indices.
+ * It stops when the array is full.
+ *
+ * @param first The first client of the list.
+ * @param all The array that receives the latencies.
+ * @param offset The index of the first element to write.
+ * @param end The number of elements of the array; it is at least offset.
+ *
+ * @return The index after the last copied latency, at most end.
+ */
+int copy_latencies(struct client *first, long long *all, int offset, int end)
+{
+    if (first != 0) {
+        long long *latencies = first->latencies;
+        for (int i = 0; i < first->latency_count && offset < end; i++)
+        {
+            all[offset] = latencies[i];
+            offset++;
+        }
+        offset = copy_latencies(first->next, all, offset, end);
+    }
+    return offset;
+}
+
+/**
+ * Description:
+ * The close_clients function closes the connection of every client in the list and frees the clients.
+ *
+ * @param first The first client of the list.
+ */
+void close_clients(struct client *first)
+{
+    if (first != 0) {
+        struct client *next = first->next;
+        socket_close(first->socket);
+        string_buffer_dispose(first->nick);
+        free(first->done_from);
+        free(first->latencies);
+        free(first);
+        close_clients(next);
+    }
+}
+
+/**
+ * Description:
+ * The sift_down function restores the max-heap property of an array below the given root by moving the root value down.
+ *
+ * @param values The array that holds the heap.
+ * @param root The index of the element to move down.
+ * @param count The number of elements in the heap.
+ */
+void sift_down(long long *values, int root, int count)
+{
+    int parent = root;
+    bool done = false;
+    while (!done && parent < count / 2)
+    {
+        int child = 2 * parent + 1;
+        if (child + 1 < count && values[child] < values[child + 1]) {
+            child++;
+        }
+        if (values[parent] < values[child]) {
+            long long value = values[parent];
+            values[parent] = values[child];
+            values[child] = value;
+            parent = child;
+        } else {
+            done = true;
+        }
+    }
+}
+
+/**
+ * Description:
+ * The sort_latencies function sorts an array of latencies in ascending order, in place, using heapsort.
+ *
+ * @param values The array to sort.
+ * @param count The number of elements in the array.
+ */
+void sort_latencies(long long *values, int count)
+{
+    for (int root = count / 2 - 1; 0 <= root; root--)
+    {
+        sift_down(values, root, count);
+    }
+    for (int end = count - 1; 0 < end; end--)
+    {
+        long long value = values[0];
+        values[0] = values[end];
+        values[end] = value;
+        sift_down(values, 0, end);
+    }
+}
+
+/**
+ * Description:
+ * The latency_percentile_micros function looks up a percentile in a sorted array of latencies.
+ *
+ * @param sorted The latencies in nanoseconds, in ascending order.
+ * @param count The number of latencies; it must be positive.
+ * @param permille The percentile in thousandths, such as 990 for p99.
+ *
+ * @return The latency at that percentile, in microseconds.
+ */
+int latency_percentile_micros(long long *sorted, int count, int permille)
+{
+    int index = (int)((long long)(count - 1) * permille / 1000);
+    return (int)(sorted[index] / 1000);
+}
+
+/**
+ * Description:
+ * The rate_per_second function converts a number of events over a period into a rate.
+ *
+ * @param count The number of events.
+ * @param nanos The length of the period in nanoseconds.
+ *
+ * @return The number of events per second, or 0 if the period is empty.
+ */
+int rate_per_second(int count, long long nanos)
+{
+    return nanos == 0 ? 0 : (int)((long long)count * 1000000000 / nanos);
+}
+
+/**
+ * Description:
+ * The main function runs the load generator against the chat server on localhost.
+ * The optional first argument is the number of clients (DEFAULT_CLIENT_COUNT if absent, at most MAX_CLIENT_COUNT) and the optional second argument the number of messages each client sends per second (DEFAULT_RATE if absent, at most MAX_RATE); on a bad argument it prints the usage and returns -1.
+ * It connects the clients, waits WARMUP_NANOS for them to join the room, and lets every client send its messages and then "done" while all clients record the latency of every message they receive.
+ * It sends "done" again every DONE_RESEND_NANOS until every receiver has stopped, because the server may drop messages for clients that fall behind.
+ * Finally it prints the number of delivered lines, the p50, p99 and p999 latencies, and the send and delivery throughput.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line arguments.
+ *
+ * @return 0, or -1 on a bad argument.
+ */
+int main(int argc, char **argv)
+{
+    int clientCount = DEFAULT_CLIENT_COUNT;
+    int rate = DEFAULT_RATE;
+    if (1 < argc) {
+        clientCount = parse_argument(argv[1], MAX_CLIENT_COUNT);
+        if (2 < argc) {
+            rate = parse_argument(argv[2], MAX_RATE);
+        }
+    }
+    if (clientCount < 0 || rate < 0) {
+        puts("Usage: chat_loadgen [clients (1 to 256) [messages per second per client (1 to 100000)]]");
+        return -1;
+    }
+    long long interval = 1000000000 / rate;
+    struct progress *progress = create_progress();
+    struct client *clients = 0;
+    for (int id = clientCount - 1; 0 <= id; id--)
+    {
+        clients = create_client(id, clientCount, interval, progress, clients);
+    }
+    start_receivers(clients);
+    clock_sleep_until_nanos(clock_now_nanos() + WARMUP_NANOS);
+
+    long long sendStart = clock_now_nanos();
+    start_senders(clients, sendStart, clientCount);
+    join_senders(clients);
+    long long sendEnd = clock_now_nanos();
+    while (progress_finished(progress) < clientCount)
+    {
+        clock_sleep_until_nanos(clock_now_nanos() + DONE_RESEND_NANOS);
+        if (progress_finished(progress) < clientCount) {
+            send_done(clients);
+        }
+    }
+    join_receivers(clients);
+    long long receiveEnd = clock_now_nanos();
+
+    int total = count_latencies(clients);
+    printf("clients: %d, rate: %d messages/s per client, messages sent: %d, lines delivered: %d of %d\n",
+        clientCount, rate, clientCount * MESSAGES_PER_CLIENT, total, clientCount * clientCount * MESSAGES_PER_CLIENT);
+    if (0 < total) {
+        long long *all = malloc((size_t)total * sizeof(long long));
+        if (all == 0) {
+            abort();
+        }
+        int copied = copy_latencies(clients, all, 0, total);
+        sort_latencies(all, copied);
+        printf("latency p50: %d us, p99: %d us, p999: %d us\n",
+            latency_percentile_micros(all, copied, 500), latency_percentile_micros(all, copied, 990), latency_percentile_micros(all, copied, 999));
+        free(all);
+    }
+    printf("throughput: %d messages/s sent, %d lines/s delivered\n",
+        rate_per_second(clientCount * MESSAGES_PER_CLIENT, sendEnd - sendStart), rate_per_second(total, receiveEnd - sendStart));
+    close_clients(clients);
+    return 0;
+}
@@ -0,0 +1,561 @@
+#include <stdbool.h>
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "clock.h"
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+
+// Load generator for the chat server on CHAT_PORT. A number of clients join the room, then each of them
+// sends MESSAGES_PER_CLIENT messages at a fixed rate, followed by "done". A message carries its send time,
+// so every client can compute the end-to-end latency of each broadcast it receives.
+// The number of clients and the rate per client are the command-line arguments.
+
+#define CHAT_PORT 12345
+#define DEFAULT_CLIENT_COUNT 64
+#define MAX_CLIENT_COUNT 256
+#define DEFAULT_RATE 100
+#define MAX_RATE 100000
+#define MESSAGES_PER_CLIENT 200
+#define WARMUP_NANOS 500000000
+#define DONE_RESEND_NANOS 100000000
+#define LATENCY_LIMIT (MAX_CLIENT_COUNT * MESSAGES_PER_CLIENT)
+
+// Counts the receiver threads that have stopped.
+struct progress {
+    struct mutex *mutex;
+    int finished;
+};
+
+struct client {
+    struct client *next;
+    int id;
+    struct socket *socket;
+    struct string_buffer *nick;
+    struct progress *progress;
+    long long send_start;
+    long long send_interval;
+    int client_count;
+    bool *done_from;
+    long long *latencies;
+    int latency_capacity;
+    int latency_count;
+    struct thread *sender;
+    struct thread *receiver;
+};
+
+/*@
+
+predicate_ctor progress_inv(struct progress *progress)() =
+    progress->finished |-> ?finished &*& 0 <= finished;
+
+// The sender thread of a client owns the writer, the receiver thread owns the reader, the "done" flags and the latencies.
+predicate client_sender_part(struct client *client) =
+    [1/2]client->socket |-> ?socket &*& [1/2]socket(socket, ?reader, ?writer) &*& writer(writer) &*&
+    client->send_start |-> _ &*& client->send_interval |-> ?interval &*& 0 < interval;
+
+predicate client_receiver_part(struct client *client) =
+    [1/2]client->socket |-> ?socket &*& [1/2]socket(socket, ?reader, ?writer) &*& reader(reader) &*&
+    client->nick |-> ?nick &*& string_buffer(nick, _) &*&
+    client->progress |-> ?progress &*& [_]progress->mutex |-> ?mutex &*& [_]mutex(mutex, progress_inv(progress)) &*&
+    client->client_count |-> ?clientCount &*& 0 < clientCount &*& clientCount <= MAX_CLIENT_COUNT &*&
+    client->done_from |-> ?doneFrom &*& doneFrom[..clientCount] |-> _ &*& malloc_block_bools(doneFrom, clientCount) &*&
+    client->latencies |-> ?latencies &*& client->latency_capacity |-> ?capacity &*& 0 <= capacity &*& capacity <= LATENCY_LIMIT &*&
+    client->latency_count |-> ?count &*& 0 <= count &*& count <= capacity &*&
+    latencies[..count] |-> _ &*& latencies[count..capacity] |-> _ &*& malloc_block_llongs(latencies, capacity);
+
+predicate client_idle(struct client *client) =
+    client->id |-> _ &*& client->sender |-> _ &*& client->receiver |-> _ &*&
+    client_sender_part(client) &*& client_receiver_part(client);
+
+predicate client_receiving(struct client *client) =
+    client->id |-> _ &*& client->sender |-> _ &*& client->receiver |-> ?receiver &*& thread(receiver, client_receive, client, _) &*&
+    client_sender_part(client);
+
+predicate client_running(struct client *client) =
+    client->id |-> _ &*& client->sender |-> ?sender &*& thread(sender, client_send, client, _) &*&
+    client->receiver |-> ?receiver &*& thread(receiver, client_receive, client, _);
+
+predicate clients(struct client *first, predicate(struct client *) p; int count) =
+    first == 0 ?
+        count == 0
+    :
+        first->next |-> ?next &*& malloc_block_client(first) &*& p(first) &*& clients(next, p, ?count0) &*& count == count0 + 1;
+
+predicate_family_instance thread_run_pre(client_send)(void *data, any info) = client_sender_part(data);
+predicate_family_instance thread_run_post(client_send)(void *data, any info) = client_sender_part(data);
+predicate_family_instance thread_run_pre(client_receive)(void *data, any info) = client_receiver_part(data);
+predicate_family_instance thread_run_post(client_receive)(void *data, any info) = client_receiver_part(data);
+@*/
+
+void string_buffer_append_number(struct string_buffer *buffer, long long value)
+    //@ requires string_buffer(buffer, _) &*& 0 <= value;
+    //@ ensures string_buffer(buffer, _);
+{
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[19 - count] = (char)('0' + value % 10);
+        value = value / 10;
+        count++;
+    } while (value != 0);
+    string_buffer_append_chars(buffer, digits + 20 - count, count);
+}
+
+/*
+Parses a message text of the form "t <nanoseconds>". Returns -1 if the text does not have that form.
+*/
+long long parse_timestamp(struct string_buffer *text)
+    //@ requires [?f]string_buffer(text, ?cs);
+    //@ ensures [f]string_buffer(text, cs);
+{
+    int length = string_buffer_get_length(text);
+    char *chars = string_buffer_get_chars(text);
+    long long value = -1;
+    if (2 < length && chars[0] == 't' && chars[1] == ' ') {
+        value = 0;
+        for (int i = 2; i < length && 0 <= value; i++)
+        {
+            char c = chars[i];
+            if ('0' <= c && c <= '9' && value < 100000000000000000) {
+                value = value * 10 + (c - '0');
+            } else {
+                value = -1;
+            }
+        }
+    }
+    return value;
+}
+
+/*
+Parses the id out of a client nick of the form "load<id>". Returns -1 if the nick does not have that form
+or if the id is not below clientCount, e.g. for a nick that is not one of the load generator's.
+*/
+int parse_client_id(struct string_buffer *nick, int clientCount)
+    //@ requires [?f]string_buffer(nick, ?cs) &*& 0 < clientCount &*& clientCount <= MAX_CLIENT_COUNT;
+    //@ ensures [f]string_buffer(nick, cs) &*& -1 <= result &*& result < clientCount;
+{
+    int length = string_buffer_get_length(nick);
+    char *chars = string_buffer_get_chars(nick);
+    int id = -1;
+    if (4 < length && chars[0] == 'l' && chars[1] == 'o' && chars[2] == 'a' && chars[3] == 'd') {
+        id = 0;
+        for (int i = 4; i < length && 0 <= id; i++)
+        {
+            char c = chars[i];
+            if ('0' <= c && c <= '9' && id < clientCount) {
+                id = id * 10 + (c - '0');
+            } else {
+                id = -1;
+            }
+        }
+        if (clientCount <= id) {
+            id = -1;
+        }
+    }
+    return id;
+}
+
+/*
+Parses a decimal command-line argument between 1 and limit. Returns -1 if the argument does not have that form.
+*/
+int parse_argument(char *argument, int limit)
+    //@ requires [?f]string(argument, ?cs) &*& 0 < limit &*& limit <= 1000000;
+    //@ ensures [f]string(argument, cs) &*& result == -1 || 0 < result && result <= limit;
+{
+    size_t length = strlen(argument);
+    int value = 0;
+    for (size_t i = 0; i < length && 0 <= value; i++)
+    {
+        char c = argument[i];
+        if ('0' <= c && c <= '9' && value <= limit) {
+            value = value * 10 + (c - '0');
+        } else {
+            value = -1;
+        }
+    }
+    return value == 0 || limit < value ? -1 : value;
+}
+
+struct progress *create_progress()
+    //@ requires emp;
+    //@ ensures [_]result->mutex |-> ?mutex &*& [_]mutex(mutex, progress_inv(result));
+{
+    struct progress *progress = malloc(sizeof(struct progress));
+    if (progress == 0) {
+        abort();
+    }
+    progress->finished = 0;
+    progress->mutex = create_mutex();
+    return progress;
+}
+
+int progress_finished(struct progress *progress)
+    //@ requires [_]progress->mutex |-> ?mutex &*& [_]mutex(mutex, progress_inv(progress));
+    //@ ensures 0 <= result;
+{
+    mutex_acquire(progress->mutex);
+    int finished = progress->finished;
+    mutex_release(progress->mutex);
+    return finished;
+}
+
+/*
+Connects a client with the given id, which is below clientCount. The client sends a message every interval nanoseconds
+and has room for the latencies of all messages of all clients.
+*/
+struct client *create_client(int id, int clientCount, long long interval, struct progress *progress, struct client *next)
+    /*@
+    requires
+        clients(next, client_idle, ?count) &*& 0 < clientCount &*& clientCount <= MAX_CLIENT_COUNT &*& 0 < interval &*&
+        [_]progress->mutex |-> ?mutex &*& [_]mutex(mutex, progress_inv(progress));
+    @*/
+    //@ ensures clients(result, client_idle, count);
+{
+    struct client *client = malloc(sizeof(struct client));
+    int capacity = clientCount * MESSAGES_PER_CLIENT;
+    long long *latencies = malloc((size_t)capacity * sizeof(long long));
+    bool *doneFrom = malloc((size_t)clientCount * sizeof(bool));
+    if (client == 0 || latencies == 0 || doneFrom == 0) {
+        abort();
+    }
+    for (int i = 0; i < clientCount; i++)
+    {
+        doneFrom[i] = false;
+    }
+    struct socket *socket = create_client_socket(CHAT_PORT);
+    struct string_buffer *nick = create_string_buffer();
+    string_buffer_append_string(nick, "load");
+    string_buffer_append_number(nick, id);
+    {
+        struct writer *writer = socket_get_writer(socket);
+        writer_write_string_buffer(writer, nick);
+        writer_write_string(writer, "\r\n");
+    }
+    client->next = next;
+    client->id = id;
+    client->socket = socket;
+    client->nick = nick;
+    client->progress = progress;
+    client->send_interval = interval;
+    client->client_count = clientCount;
+    client->done_from = doneFrom;
+    client->latencies = latencies;
+    client->latency_capacity = capacity;
+    client->latency_count = 0;
+    return client;
+}
+
+/*
+The sender thread of a client. It sends its messages at fixed points in time, starting at send_start,
+so that a slow server does not lower the offered load, and then sends "done".
+*/
+void client_send(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(client_send)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(client_send)(data, info) &*& lockset(currentThread, nil);
+{
+    struct client *client = data;
+    struct writer *writer = socket_get_writer(client->socket);
+    struct string_buffer *line = create_string_buffer();
+    long long start = client->send_start;
+    long long interval = client->send_interval;
+    for (int i = 0; i < MESSAGES_PER_CLIENT; i++)
+    {
+        clock_sleep_until_nanos(start + (long long)i * interval);
+        string_buffer_clear(line);
+        string_buffer_append_string(line, "t ");
+        string_buffer_append_number(line, clock_now_nanos());
+        string_buffer_append_string(line, "\r\n");
+        writer_write_string_buffer(writer, line);
+    }
+    writer_write_string(writer, "done\r\n");
+    string_buffer_dispose(line);
+}
+
+/*
+The receiver thread of a client. It records the latency of every timestamped message it receives and
+stops once it has received "done" from every client. The server handles the lines of one client in order,
+so the "done" of a client reaches every member after all of that client's messages that the member gets
+at all; the recorded latencies are therefore those of every message delivered to this client, whatever
+the order in which the server interleaves different senders. A repeated "done" is counted once.
+*/
+void client_receive(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(client_receive)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(client_receive)(data, info) &*& lockset(currentThread, nil);
+{
+    struct client *client = data;
+    struct reader *reader = socket_get_reader(client->socket);
+    struct string_buffer *line = create_string_buffer();
+    struct string_buffer *sender = create_string_buffer();
+    struct string_buffer *text = create_string_buffer();
+    int clientCount = client->client_count;
+    bool *doneFrom = client->done_from;
+    int doneCount = 0;
+    bool done = false;
+    while (!done)
+    {
+        bool eof = reader_read_line(reader, line);
+        if (eof) {
+            done = true;
+        } else if (string_buffer_split(line, " says: ", sender, text)) {
+            if (string_buffer_equals_string(text, "done")) {
+                int id = parse_client_id(sender, clientCount);
+                if (0 <= id && !doneFrom[id]) {
+                    doneFrom[id] = true;
+                    doneCount++;
+                }
+                done = doneCount == clientCount;
+            } else {
+                long long sent = parse_timestamp(text);
+                if (0 <= sent && client->latency_count < client->latency_capacity) {
+                    client->latencies[client->latency_count] = clock_now_nanos() - sent;
+                    client->latency_count++;
+                }
+            }
+        }
+    }
+    string_buffer_dispose(line);
+    string_buffer_dispose(sender);
+    string_buffer_dispose(text);
+    {
+        struct progress *progress = client->progress;
+        mutex_acquire(progress->mutex);
+        if (progress->finished < MAX_CLIENT_COUNT) {
+            progress->finished++;
+        }
+        mutex_release(progress->mutex);
+    }
+}
+
+void start_receivers(struct client *first)
+    //@ requires clients(first, client_idle, ?count);
+    //@ ensures clients(first, client_receiving, count);
+{
+    if (first != 0) {
+        first->receiver = thread_start_joinable(client_receive, first);
+        start_receivers(first->next);
+    }
+}
+
+/*
+Starts the sender threads. The first messages of the clientCount clients are spread evenly over one message interval.
+*/
+void start_senders(struct client *first, long long start, int clientCount)
+    //@ requires clients(first, client_receiving, ?count) &*& 0 < clientCount;
+    //@ ensures clients(first, client_running, count);
+{
+    if (first != 0) {
+        first->send_start = start + (long long)first->id * (first->send_interval / clientCount);
+        first->sender = thread_start_joinable(client_send, first);
+        start_senders(first->next, start, clientCount);
+    }
+}
+
+void join_senders(struct client *first)
+    //@ requires clients(first, client_running, ?count);
+    //@ ensures clients(first, client_receiving, count);
+{
+    if (first != 0) {
+        thread_join(first->sender);
+        join_senders(first->next);
+    }
+}
+
+/*
+Sends "done" again from every client. A server may drop lines for a member that falls behind, including
+a "done", so main repeats them until every receiver has stopped. A repeated "done" still follows all
+messages of its client, and receivers count each client's "done" once, so this does not change the sample.
+*/
+void send_done(struct client *first)
+    //@ requires clients(first, client_receiving, ?count);
+    //@ ensures clients(first, client_receiving, count);
+{
+    if (first != 0) {
+        struct writer *writer = socket_get_writer(first->socket);
+        writer_write_string(writer, "done\r\n");
+        send_done(first->next);
+    }
+}
+
+void join_receivers(struct client *first)
+    //@ requires clients(first, client_receiving, ?count);
+    //@ ensures clients(first, client_idle, count);
+{
+    if (first != 0) {
+        thread_join(first->receiver);
+        join_receivers(first->next);
+    }
+}
+
+int count_latencies(struct client *first)
+    //@ requires [?f]clients(first, client_idle, ?count) &*& count <= MAX_CLIENT_COUNT;
+    //@ ensures [f]clients(first, client_idle, count);
+{
+    int total = 0;
+    if (first != 0) {
+        total = first->latency_count + count_latencies(first->next);
+    }
+    return total;
+}
+
+/*
+Copies the latencies recorded by the clients to all[offset..end]. Returns the index after the last copied latency;
+main sizes all with count_latencies, so every latency fits.
+*/
+int copy_latencies(struct client *first, long long *all, int offset, int end)
+    //@ requires [?f]clients(first, client_idle, ?count) &*& all[..end] |-> _ &*& 0 <= offset &*& offset <= end;
+    //@ ensures [f]clients(first, client_idle, count) &*& all[..end] |-> _ &*& offset <= result &*& result <= end;
+{
+    if (first != 0) {
+        long long *latencies = first->latencies;
+        for (int i = 0; i < first->latency_count && offset < end; i++)
+        {
+            all[offset] = latencies[i];
+            offset++;
+        }
+        offset = copy_latencies(first->next, all, offset, end);
+    }
+    return offset;
+}
+
+void close_clients(struct client *first)
+    //@ requires clients(first, client_idle, _);
+    //@ ensures emp;
+{
+    if (first != 0) {
+        struct client *next = first->next;
+        socket_close(first->socket);
+        string_buffer_dispose(first->nick);
+        free(first->done_from);
+        free(first->latencies);
+        free(first);
+        close_clients(next);
+    }
+}
+
+void sift_down(long long *values, int root, int count)
+    //@ requires values[..count] |-> _;
+    //@ ensures values[..count] |-> _;
+{
+    int parent = root;
+    bool done = false;
+    while (!done && parent < count / 2)
+    {
+        int child = 2 * parent + 1;
+        if (child + 1 < count && values[child] < values[child + 1]) {
+            child++;
+        }
+        if (values[parent] < values[child]) {
+            long long value = values[parent];
+            values[parent] = values[child];
+            values[child] = value;
+            parent = child;
+        } else {
+            done = true;
+        }
+    }
+}
+
+/*
+Sorts the values in ascending order (heapsort, so no extra memory is needed).
+*/
+void sort_latencies(long long *values, int count)
+    //@ requires values[..count] |-> _ &*& 0 <= count;
+    //@ ensures values[..count] |-> _;
+{
+    for (int root = count / 2 - 1; 0 <= root; root--)
+    {
+        sift_down(values, root, count);
+    }
+    for (int end = count - 1; 0 < end; end--)
+    {
+        long long value = values[0];
+        values[0] = values[end];
+        values[end] = value;
+        sift_down(values, 0, end);
+    }
+}
+
+/*
+Returns the latency below which the given number of thousandths of the sorted latencies fall, in microseconds.
+*/
+int latency_percentile_micros(long long *sorted, int count, int permille)
+    //@ requires [?f]sorted[..count] |-> ?values &*& 0 < count &*& 0 <= permille &*& permille <= 1000;
+    //@ ensures [f]sorted[..count] |-> values;
+{
+    int index = (int)((long long)(count - 1) * permille / 1000);
+    return (int)(sorted[index] / 1000);
+}
+
+int rate_per_second(int count, long long nanos)
+    //@ requires 0 <= count &*& 0 <= nanos;
+    //@ ensures true;
+{
+    return nanos == 0 ? 0 : (int)((long long)count * 1000000000 / nanos);
+}
+
+/*
+Runs the load generator. The optional arguments are the number of clients (DEFAULT_CLIENT_COUNT if absent)
+and the number of messages each client sends per second (DEFAULT_RATE if absent).
+*/
+int main(int argc, char **argv) //@ : main
+    //@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+    //@ ensures true;
+{
+    int clientCount = DEFAULT_CLIENT_COUNT;
+    int rate = DEFAULT_RATE;
+    if (1 < argc) {
+        clientCount = parse_argument(argv[1], MAX_CLIENT_COUNT);
+        if (2 < argc) {
+            rate = parse_argument(argv[2], MAX_RATE);
+        }
+    }
+    if (clientCount < 0 || rate < 0) {
+        puts("Usage: chat_loadgen [clients (1 to 256) [messages per second per client (1 to 100000)]]");
+        return -1;
+    }
+    long long interval = 1000000000 / rate;
+    struct progress *progress = create_progress();
+    struct client *clients = 0;
+    for (int id = clientCount - 1; 0 <= id; id--)
+    {
+        clients = create_client(id, clientCount, interval, progress, clients);
+    }
+    start_receivers(clients);
+    clock_sleep_until_nanos(clock_now_nanos() + WARMUP_NANOS);
+
+    long long sendStart = clock_now_nanos();
+    start_senders(clients, sendStart, clientCount);
+    join_senders(clients);
+    long long sendEnd = clock_now_nanos();
+    while (progress_finished(progress) < clientCount)
+    {
+        clock_sleep_until_nanos(clock_now_nanos() + DONE_RESEND_NANOS);
+        if (progress_finished(progress) < clientCount) {
+            send_done(clients);
+        }
+    }
+    join_receivers(clients);
+    long long receiveEnd = clock_now_nanos();
+
+    int total = count_latencies(clients);
+    printf("clients: %d, rate: %d messages/s per client, messages sent: %d, lines delivered: %d of %d\n",
+        clientCount, rate, clientCount * MESSAGES_PER_CLIENT, total, clientCount * clientCount * MESSAGES_PER_CLIENT);
+    if (0 < total) {
+        long long *all = malloc((size_t)total * sizeof(long long));
+        if (all == 0) {
+            abort();
+        }
+        int copied = copy_latencies(clients, all, 0, total);
+        sort_latencies(all, copied);
+        printf("latency p50: %d us, p99: %d us, p999: %d us\n",
+            latency_percentile_micros(all, copied, 500), latency_percentile_micros(all, copied, 990), latency_percentile_micros(all, copied, 999));
+        free(all);
+    }
+    printf("throughput: %d messages/s sent, %d lines/s delivered\n",
+        rate_per_second(clientCount * MESSAGES_PER_CLIENT, sendEnd - sendStart), rate_per_second(total, receiveEnd - sendStart));
+    close_clients(clients);
+    return 0;
+}
@@ -0,0 +1,1206 @@
+#include <stdbool.h>
+#include "dlists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+//@ #include "ghostlist.gh"
+//@ #include "counting.gh"
+//@ #include "listex.gh"
+
+#define OUTBOX_CAPACITY 256
+#define NICK_BUCKETS_INITIAL 64
+
+// A message is built once and shared by the outboxes of all the members it is sent to.
+// Its text never changes; refcount is the number of outboxes that still have to send it.
+struct message {
+    struct string_buffer *prefix;
+    struct string_buffer *body;
+    int refcount;
+    struct mutex *refs;
+    //@ int refs_id;
+};
+
+/*@
+
+predicate message_text(struct message *message; list<char> text) =
+    message->prefix |-> ?prefix &*& message->body |-> ?body &*& message->refs |-> ?refs &*& message->refs_id |-> ?id &*&
+    string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars) &*& text == append(prefixChars, bodyChars) &*&
+    [_]mutex(refs, live_messages(id)) &*& ghost_list_member_handle(id, message) &*& malloc_block_message(message);
+
+// A reference holds a ticket for the message and the matching fraction of its text.
+predicate message_ref(struct message *message; list<char> text) =
+    ticket(message_text, message, ?f) &*& [f]message_text(message, text);
+
+predicate message_refs(struct message *message, int count, list<char> text) =
+    count == 0 ? emp : message_ref(message, text) &*& message_refs(message, count - 1, text);
+
+predicate message_count(struct message *message) =
+    message->refcount |-> ?count &*& 0 < count &*& counting(message_text, message, count, _);
+
+// The reference counts of the live messages of a room are protected by a single mutex. It is held
+// only to register a new message or to drop a reference, never while a message is being sent.
+predicate_ctor live_messages(int id)() =
+    ghost_list<struct message *>(id, ?messages) &*& foreach(messages, message_count);
+
+lemma void create_message_refs(struct message *message, int count)
+    requires counting(message_text, message, ?n, ?text) &*& message_refs(message, n, text) &*& 0 <= count;
+    ensures counting(message_text, message, n + count, text) &*& message_refs(message, n + count, text);
+{
+    if (count != 0) {
+        create_ticket(message_text, message);
+        close message_ref(message, text);
+        close message_refs(message, n + 1, text);
+        create_message_refs(message, count - 1);
+    }
+}
+
+@*/
+
+/*
+Creates a message made of prefix followed by body, taking ownership of both buffers.
+The caller gets count references to it.
+*/
+struct message *create_message(struct mutex *refs, struct string_buffer *prefix, struct string_buffer *body, int count)
+    //@ requires [_]mutex(refs, live_messages(?id)) &*& string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars) &*& 0 < count;
+    //@ ensures message_refs(result, count, append(prefixChars, bodyChars));
+{
+    struct message *message = malloc(sizeof(struct message));
+    if (message == 0) {
+        abort();
+    }
+    message->prefix = prefix;
+    message->body = body;
+    message->refs = refs;
+    //@ message->refs_id = id;
+    mutex_acquire(refs);
+    //@ open live_messages(id)();
+    //@ assert ghost_list(id, ?messages);
+    //@ ghost_list_add(id, message);
+    message->refcount = count;
+    //@ close message_text(message, append(prefixChars, bodyChars));
+    //@ start_counting(message_text, message);
+    //@ close message_refs(message, 0, append(prefixChars, bodyChars));
+    //@ create_message_refs(message, count);
+    //@ close message_count(message);
+    //@ close foreach(cons(message, messages), message_count);
+    //@ close live_messages(id)();
+    mutex_release(refs);
+    return message;
+}
+
+/*
+Drops a reference to a message. Dropping the last reference frees the message.
+*/
+void message_release(struct message *message)
+    //@ requires message_ref(message, ?text);
+    //@ ensures emp;
+{
+    //@ open message_ref(message, text);
+    //@ assert ticket(message_text, message, ?f);
+    //@ open [f]message_text(message, text);
+    struct mutex *refs = message->refs;
+    //@ int id = message->refs_id;
+    bool last = false;
+    mutex_acquire(refs);
+    //@ open live_messages(id)();
+    //@ assert ghost_list(id, ?messages);
+    //@ ghost_list_member_handle_lemma(id, message);
+    //@ foreach_remove(message, messages);
+    //@ open message_count(message);
+    //@ close [f]message_text(message, text);
+    //@ destroy_ticket(message_text, message);
+    message->refcount = message->refcount - 1;
+    if (message->refcount == 0) {
+        //@ stop_counting(message_text, message);
+        //@ open message_text(message, text);
+        //@ ghost_list_remove(id, message);
+        last = true;
+    } else {
+        //@ close message_count(message);
+        //@ foreach_unremove(message, messages);
+    }
+    //@ close live_messages(id)();
+    mutex_release(refs);
+    if (last) {
+        string_buffer_dispose(message->prefix);
+        string_buffer_dispose(message->body);
+        free(message);
+    }
+}
+
+struct outbox_entry {
+    struct outbox_entry *next;
+    struct message *message;
+};
+
+/*@
+
+predicate entries(struct outbox_entry *first, struct outbox_entry *last, int count) =
+    first == last ?
+        count == 0
+    :
+        first->next |-> ?next &*& first->message |-> ?message &*& message_ref(message, _) &*& malloc_block_outbox_entry(first) &*&
+        entries(next, last, count - 1) &*& 0 < count;
+
+lemma void entries_add(struct outbox_entry *first)
+    requires
+        entries(first, ?last, ?count) &*& last->next |-> ?next &*& last->message |-> ?message &*& message_ref(message, _) &*&
+        malloc_block_outbox_entry(last) &*& next->next |-> ?nextNext;
+    ensures entries(first, next, count + 1) &*& next->next |-> nextNext;
+{
+    open entries(first, last, count);
+    if (first == last) {
+        close entries(next, next, 0);
+    } else {
+        entries_add(first->next);
+    }
+    close entries(first, next, count + 1);
+}
+
+@*/
+
+struct outbox {
+    struct mutex *mutex;
+    struct mutex_cond *changed;
+    struct outbox_entry *first;
+    struct outbox_entry *last;
+    int count;
+    bool closed;
+    struct writer *writer;
+};
+
+/*@
+
+// The queued references belong to the outbox's mutex. The queue always ends in an empty sentinel entry,
+// so pushing fills the sentinel and appends a fresh one, and popping unlinks the first entry.
+predicate_ctor outbox_inv(struct outbox *outbox)() =
+    outbox->first |-> ?first &*& outbox->last |-> ?last &*& outbox->count |-> ?count &*& outbox->closed |-> _ &*&
+    entries(first, last, count) &*& last->next |-> _ &*& last->message |-> _ &*& malloc_block_outbox_entry(last) &*&
+    0 <= count &*& count <= OUTBOX_CAPACITY;
+
+predicate outbox(struct outbox *outbox; struct writer *writer) =
+    outbox->mutex |-> ?mutex &*& outbox->changed |-> ?changed &*& outbox->writer |-> writer &*&
+    mutex(mutex, outbox_inv(outbox)) &*& mutex_cond(changed, mutex) &*& malloc_block_outbox(outbox);
+
+@*/
+
+struct outbox *create_outbox(struct writer *writer)
+    //@ requires emp;
+    //@ ensures outbox(result, writer);
+{
+    struct outbox *outbox = malloc(sizeof(struct outbox));
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (outbox == 0 || sentinel == 0) {
+        abort();
+    }
+    outbox->first = sentinel;
+    outbox->last = sentinel;
+    outbox->count = 0;
+    outbox->closed = false;
+    outbox->writer = writer;
+    //@ close entries(sentinel, sentinel, 0);
+    //@ close outbox_inv(outbox)();
+    //@ close create_mutex_ghost_arg(outbox_inv(outbox));
+    struct mutex *mutex = create_mutex();
+    outbox->mutex = mutex;
+    //@ close create_mutex_cond_ghost_args(mutex);
+    outbox->changed = create_mutex_cond();
+    //@ close outbox(outbox, writer);
+    return outbox;
+}
+
+/*
+Appends a reference to a message to the outbox. When the queue is full or the outbox is closed,
+the reference is dropped instead, so a slow member never makes the sender wait.
+*/
+void outbox_push(struct outbox *outbox, struct message *message)
+    //@ requires [?f]outbox(outbox, ?writer) &*& message_ref(message, _);
+    //@ ensures [f]outbox(outbox, writer);
+{
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (sentinel == 0) {
+        abort();
+    }
+    mutex_acquire(outbox->mutex);
+    //@ open outbox_inv(outbox)();
+    if (outbox->closed || outbox->count == OUTBOX_CAPACITY) {
+        //@ close outbox_inv(outbox)();
+        mutex_release(outbox->mutex);
+        free(sentinel);
+        message_release(message);
+    } else {
+        struct outbox_entry *last = outbox->last;
+        last->message = message;
+        last->next = sentinel;
+        //@ entries_add(outbox->first);
+        outbox->last = sentinel;
+        outbox->count = outbox->count + 1;
+        mutex_cond_signal(outbox->changed);
+        //@ close outbox_inv(outbox)();
+        mutex_release(outbox->mutex);
+    }
+}
+
+/*
+Waits for the next message in the outbox and removes it from the queue.
+Returns 0 once the outbox is closed and every queued message has been taken.
+*/
+struct message *outbox_pop(struct outbox *outbox)
+    //@ requires [?f]outbox(outbox, ?writer);
+    //@ ensures [f]outbox(outbox, writer) &*& result == 0 ? emp : message_ref(result, _);
+{
+    struct message *message = 0;
+    //@ assert [f]outbox->mutex |-> ?mutex;
+    mutex_acquire(outbox->mutex);
+    //@ open outbox_inv(outbox)();
+    while (outbox->count == 0 && !outbox->closed)
+        /*@
+        invariant
+            [f]outbox(outbox, writer) &*& mutex_held(mutex, outbox_inv(outbox), currentThread, f) &*&
+            outbox->first |-> ?first &*& outbox->last |-> ?last &*& outbox->count |-> ?count &*& outbox->closed |-> _ &*&
+            entries(first, last, count) &*& last->next |-> _ &*& last->message |-> _ &*& malloc_block_outbox_entry(last) &*&
+            0 <= count &*& count <= OUTBOX_CAPACITY;
+        @*/
+    {
+        //@ close outbox_inv(outbox)();
+        mutex_cond_wait(outbox->changed, outbox->mutex);
+        //@ open outbox_inv(outbox)();
+    }
+    if (outbox->count != 0) {
+        struct outbox_entry *first = outbox->first;
+        //@ open entries(first, _, _);
+        message = first->message;
+        outbox->first = first->next;
+        outbox->count = outbox->count - 1;
+        free(first);
+    }
+    //@ close outbox_inv(outbox)();
+    mutex_release(outbox->mutex);
+    return message;
+}
+
+/*
+Marks the outbox as closed. Messages that are already queued are still delivered.
+*/
+void outbox_close(struct outbox *outbox)
+    //@ requires [?f]outbox(outbox, ?writer);
+    //@ ensures [f]outbox(outbox, writer);
+{
+    mutex_acquire(outbox->mutex);
+    //@ open outbox_inv(outbox)();
+    outbox->closed = true;
+    mutex_cond_signal(outbox->changed);
+    //@ close outbox_inv(outbox)();
+    mutex_release(outbox->mutex);
+}
+
+void outbox_dispose(struct outbox *outbox)
+    //@ requires outbox(outbox, ?writer);
+    //@ ensures emp;
+{
+    //@ open outbox(outbox, writer);
+    mutex_cond_dispose(outbox->changed);
+    mutex_dispose(outbox->mutex);
+    //@ open outbox_inv(outbox)();
+    struct outbox_entry *iter = outbox->first;
+    while (iter != outbox->last)
+        //@ invariant outbox->last |-> ?last &*& entries(iter, last, _);
+    {
+        //@ open entries(iter, last, _);
+        struct outbox_entry *next = iter->next;
+        message_release(iter->message);
+        free(iter);
+        iter = next;
+    }
+    //@ open entries(iter, last, _);
+    free(outbox->last);
+    free(outbox);
+}
+
+/*@
+
+predicate_family_instance thread_run_pre(outbox_drain)(void *data, any info) =
+    [1/2]outbox(data, ?writer) &*& writer(writer);
+predicate_family_instance thread_run_post(outbox_drain)(void *data, any info) =
+    [1/2]outbox(data, ?writer) &*& writer(writer);
+
+@*/
+
+/*
+The writer thread of a member. It sends the queued messages to the member's socket, one line each,
+until the outbox is closed and empty.
+*/
+void outbox_drain(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(outbox_drain)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(outbox_drain)(data, info) &*& lockset(currentThread, nil);
+{
+    //@ open thread_run_pre(outbox_drain)(data, info);
+    struct outbox *outbox = data;
+    struct writer *writer = outbox->writer;
+    struct message *message = outbox_pop(outbox);
+    while (message != 0)
+        //@ invariant [1/2]outbox(outbox, writer) &*& writer(writer) &*& message == 0 ? emp : message_ref(message, _);
+    {
+        //@ open message_ref(message, ?text);
+        //@ assert ticket(message_text, message, ?f);
+        //@ open [f]message_text(message, text);
+        writer_write_line(writer, message->prefix, message->body);
+        //@ close [f]message_text(message, text);
+        //@ close message_ref(message, text);
+        message_release(message);
+        message = outbox_pop(outbox);
+    }
+    //@ close thread_run_post(outbox_drain)(data, info);
+}
+
+struct member {
+    struct member *next;
+    struct member *prev;
+    struct member *bucket_next;
+    unsigned int nick_hash;
+    struct string_buffer *nick;
+    struct outbox *outbox;
+};
+
+/*@
+
+// A member is reachable both from the member list and from the nick index. The list owns the outbox
+// and half of the nick and its hash; the index chain the member is on owns the other halves.
+predicate member(struct member* member) =
+    [1/2]member->nick |-> ?nick &*& [1/2]member->nick_hash |-> _ &*& member->outbox |-> ?outbox &*&
+    [1/2]string_buffer(nick, _) &*& [1/2]outbox(outbox, _) &*& malloc_block_member(member);
+
+predicate nick_entry(struct member *member; unsigned int hash) =
+    [1/2]member->nick |-> ?nick &*& [1/2]member->nick_hash |-> hash &*& [1/2]string_buffer(nick, _);
+
+predicate nick_bucket(struct member *first, int index, int bucketCount; list<void *> ms) =
+    first == 0 ?
+        ms == nil
+    :
+        first->bucket_next |-> ?next &*& nick_entry(first, ?hash) &*& hash % bucketCount == index &*&
+        nick_bucket(next, index, bucketCount, ?ms0) &*& ms == cons(first, ms0);
+
+predicate nick_buckets(struct member **buckets, int index, int end, int bucketCount; list<void *> ms) =
+    index == end ?
+        ms == nil
+    :
+        pointer((void *)(buckets + index), ?first) &*& nick_bucket(first, index, bucketCount, ?ms0) &*&
+        nick_buckets(buckets, index + 1, end, bucketCount, ?ms1) &*& ms == append(ms0, ms1);
+
+// xs is a permutation of ys: both lists hold the same elements, each the same number of times.
+fixpoint bool same_members(list<void *> xs, list<void *> ys) {
+    switch (xs) {
+        case nil: return ys == nil;
+        case cons(x, xs0): return mem(x, ys) && same_members(xs0, remove(x, ys));
+    }
+}
+
+// The nick index of a room holds exactly the members of the given member list: read in bucket order,
+// its chains are a permutation of members.
+predicate nick_index(struct room *room; list<void *> members) =
+    room->nick_buckets |-> ?buckets &*& room->nick_bucket_count |-> ?bucketCount &*& room->member_count |-> length(members) &*&
+    0 < bucketCount &*& nick_buckets(buckets, 0, bucketCount, bucketCount, ?indexed) &*& malloc_block_pointers(buckets, bucketCount) &*&
+    same_members(indexed, members) == true;
+
+lemma void nick_buckets_take(struct member **buckets, int index)
+    requires nick_buckets(buckets, ?start, ?end, ?bucketCount, ?ms) &*& start <= index &*& index < end;
+    ensures
+        nick_buckets(buckets, start, index, bucketCount, ?ms0) &*& pointer((void *)(buckets + index), ?first) &*&
+        nick_bucket(first, index, bucketCount, ?ms1) &*& nick_buckets(buckets, index + 1, end, bucketCount, ?ms2) &*&
+        ms == append(ms0, append(ms1, ms2));
+{
+    open nick_buckets(buckets, start, end, bucketCount, ms);
+    if (start == index) {
+        close nick_buckets(buckets, start, start, bucketCount, nil);
+    } else {
+        nick_buckets_take(buckets, index);
+        assert nick_buckets(buckets, start + 1, index, bucketCount, ?ms00) &*& nick_bucket(_, index, bucketCount, ?ms1) &*& nick_buckets(buckets, index + 1, end, bucketCount, ?ms2);
+        assert pointer((void *)(buckets + start), ?head) &*& nick_bucket(head, start, bucketCount, ?ms01);
+        append_assoc(ms01, ms00, append(ms1, ms2));
+        close nick_buckets(buckets, start, index, bucketCount, append(ms01, ms00));
+    }
+}
+
+lemma void nick_buckets_give(struct member **buckets, int start, int index)
+    requires
+        nick_buckets(buckets, start, index, ?bucketCount, ?ms0) &*& pointer((void *)(buckets + index), ?first) &*&
+        nick_bucket(first, index, bucketCount, ?ms1) &*& nick_buckets(buckets, index + 1, ?end, bucketCount, ?ms2);
+    ensures nick_buckets(buckets, start, end, bucketCount, append(ms0, append(ms1, ms2)));
+{
+    open nick_buckets(buckets, start, index, bucketCount, ms0);
+    if (start == index) {
+        close nick_buckets(buckets, index, end, bucketCount, append(ms1, ms2));
+    } else {
+        nick_buckets_give(buckets, start + 1, index);
+        assert pointer((void *)(buckets + start), ?head) &*& nick_bucket(head, start, bucketCount, ?ms00) &*& nick_buckets(buckets, start + 1, index, bucketCount, ?ms01);
+        append_assoc(ms00, ms01, append(ms1, ms2));
+        close nick_buckets(buckets, start, end, bucketCount, append(ms0, append(ms1, ms2)));
+    }
+}
+
+lemma void remove_swap(list<void *> xs, void *x, void *y)
+    requires true;
+    ensures remove(x, remove(y, xs)) == remove(y, remove(x, xs));
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            if (h != x && h != y) {
+                remove_swap(t, x, y);
+            }
+    }
+}
+
+lemma void same_members_refl(list<void *> xs)
+    requires true;
+    ensures same_members(xs, xs) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            same_members_refl(t);
+    }
+}
+
+lemma void same_members_mem(list<void *> xs, list<void *> ys, void *x)
+    requires same_members(xs, ys) == true &*& mem(x, ys) == true;
+    ensures mem(x, xs) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            if (h != x) {
+                neq_mem_remove(x, h, ys);
+                same_members_mem(t, remove(h, ys), x);
+            }
+    }
+}
+
+lemma void same_members_remove(list<void *> xs, list<void *> ys, void *x)
+    requires same_members(xs, ys) == true &*& mem(x, xs) == true;
+    ensures mem(x, ys) == true &*& same_members(remove(x, xs), remove(x, ys)) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            if (h != x) {
+                same_members_remove(t, remove(h, ys), x);
+                neq_mem_remove(x, h, ys);
+                neq_mem_remove(h, x, ys);
+                remove_swap(ys, h, x);
+            }
+    }
+}
+
+lemma void same_members_trans(list<void *> xs, list<void *> ys, list<void *> zs)
+    requires same_members(xs, ys) == true &*& same_members(ys, zs) == true;
+    ensures same_members(xs, zs) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            same_members_remove(ys, zs, h);
+            same_members_trans(t, remove(h, ys), remove(h, zs));
+    }
+}
+
+lemma void same_members_append_l(list<void *> xs, list<void *> ys, list<void *> zs)
+    requires same_members(ys, zs) == true;
+    ensures same_members(append(xs, ys), append(xs, zs)) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            same_members_append_l(t, ys, zs);
+    }
+}
+
+lemma void same_members_unremove(list<void *> xs, list<void *> ys, void *m)
+    requires same_members(xs, cons(m, remove(m, ys))) == true &*& mem(m, ys) == true;
+    ensures same_members(xs, ys) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            if (h != m) {
+                neq_mem_remove(h, m, ys);
+                neq_mem_remove(m, h, ys);
+                remove_swap(ys, h, m);
+                same_members_unremove(t, remove(h, ys), m);
+            }
+    }
+}
+
+// Inserting m anywhere in a list gives a permutation of m consed onto it.
+lemma void same_members_move(list<void *> xs, list<void *> zs, void *m, list<void *> ys)
+    requires same_members(append(xs, zs), ys) == true;
+    ensures same_members(append(xs, cons(m, zs)), cons(m, ys)) == true;
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            same_members_move(t, zs, m, remove(h, ys));
+            if (h == m) {
+                same_members_unremove(append(t, cons(m, zs)), ys, m);
+            }
+    }
+}
+
+lemma void remove_append_mem(list<void *> xs, list<void *> ys, void *x)
+    requires mem(x, xs) == true;
+    ensures remove(x, append(xs, ys)) == append(remove(x, xs), ys);
+{
+    switch (xs) {
+        case nil:
+        case cons(h, t):
+            if (h != x) {
+                remove_append_mem(t, ys, x);
+            }
+    }
+}
+
+lemma void same_members_remove_append(list<void *> xs, list<void *> ys, void *m)
+    requires mem(m, ys) == true;
+    ensures same_members(append(xs, remove(m, ys)), remove(m, append(xs, ys))) == true;
+{
+    switch (xs) {
+        case nil:
+            same_members_refl(remove(m, ys));
+        case cons(h, t):
+            same_members_remove_append(t, ys, m);
+            if (h == m) {
+                mem_append(m, t, ys);
+            }
+    }
+}
+
+// Moving the first member of the chain being drained to the new buckets keeps the room's members.
+lemma void same_members_shift(list<void *> chain, list<void *> rest, list<void *> moved, list<void *> moved1, void *m, list<void *> members)
+    requires same_members(cons(m, append(chain, append(rest, moved))), members) == true &*& same_members(moved1, cons(m, moved)) == true;
+    ensures same_members(append(chain, append(rest, moved1)), members) == true;
+{
+    append_assoc(chain, rest, moved);
+    append_assoc(chain, rest, moved1);
+    list<void *> xs = append(chain, rest);
+    same_members_append_l(xs, moved1, cons(m, moved));
+    same_members_refl(append(xs, moved));
+    same_members_move(xs, moved, m, append(xs, moved));
+    same_members_trans(append(xs, moved1), append(xs, cons(m, moved)), cons(m, append(xs, moved)));
+    same_members_trans(append(xs, moved1), cons(m, append(xs, moved)), members);
+}
+
+lemma void nick_bucket_hash(struct member *first, struct member *member)
+    requires [?f]nick_bucket(first, ?index, ?bucketCount, ?ms) &*& mem((void *)member, ms) == true &*& [1/2]member->nick_hash |-> ?hash;
+    ensures [f]nick_bucket(first, index, bucketCount, ms) &*& [1/2]member->nick_hash |-> hash &*& hash % bucketCount == index;
+{
+    open [f]nick_bucket(first, index, bucketCount, ms);
+    if (first == member) {
+        open [f]nick_entry(first, ?hash0);
+        close [f]nick_entry(first, hash0);
+    } else {
+        nick_bucket_hash(first->bucket_next, member);
+    }
+    close [f]nick_bucket(first, index, bucketCount, ms);
+}
+
+// A member on the chains from start to end hashes into that range.
+lemma void nick_buckets_hash(struct member **buckets, int start, struct member *member)
+    requires [?f]nick_buckets(buckets, start, ?end, ?bucketCount, ?ms) &*& mem((void *)member, ms) == true &*& [1/2]member->nick_hash |-> ?hash;
+    ensures [f]nick_buckets(buckets, start, end, bucketCount, ms) &*& [1/2]member->nick_hash |-> hash &*& start <= hash % bucketCount &*& hash % bucketCount < end;
+{
+    open [f]nick_buckets(buckets, start, end, bucketCount, ms);
+    if (start != end) {
+        assert [f]pointer((void *)(buckets + start), ?first) &*& [f]nick_bucket(first, start, bucketCount, ?ms0) &*& [f]nick_buckets(buckets, start + 1, end, bucketCount, ?ms1);
+        mem_append((void *)member, ms0, ms1);
+        if (mem((void *)member, ms0)) {
+            nick_bucket_hash(first, member);
+        } else {
+            nick_buckets_hash(buckets, start + 1, member);
+        }
+    }
+    close [f]nick_buckets(buckets, start, end, bucketCount, ms);
+}
+
+@*/
+
+struct room {
+    struct member *members;
+    struct member **nick_buckets;
+    int nick_bucket_count;
+    int member_count;
+    struct mutex *message_refs;
+    //@ int ghost_list_id;
+};
+
+/*@
+predicate room(struct room* room) =
+    room->members |-> ?membersList &*& [?f]room->ghost_list_id |-> ?id &*&
+    dlseg(membersList, 0, 0, _, ?members, member) &*&
+    ghost_list(id, members) &*& nick_index(room, members) &*&
+    room->message_refs |-> ?refs &*& [_]mutex(refs, live_messages(_)) &*& malloc_block_room(room);
+@*/
+
+/*
+Hashes a nick (FNV-1a). Only the index uses the hash, so it does not need to be stable across runs.
+*/
+unsigned int nick_hash(struct string_buffer *nick)
+    //@ requires [?f]string_buffer(nick, ?cs);
+    //@ ensures [f]string_buffer(nick, cs);
+{
+    int length = string_buffer_get_length(nick);
+    char *chars = string_buffer_get_chars(nick);
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        //@ invariant [f]chars(chars, length, cs) &*& 0 <= i;
+    {
+        hash = (hash ^ (unsigned char)chars[i]) * 16777619u;
+    }
+    //@ string_buffer_merge_chars(nick);
+    return hash;
+}
+
+struct member **create_nick_buckets(int bucketCount)
+    //@ requires 0 < bucketCount;
+    //@ ensures nick_buckets(result, 0, bucketCount, bucketCount, nil) &*& malloc_block_pointers(result, bucketCount);
+{
+    struct member **buckets = malloc((unsigned int)bucketCount * sizeof(struct member *));
+    if (buckets == 0) {
+        abort();
+    }
+    for (int i = bucketCount; 0 < i; i--)
+        //@ invariant pointers(buckets, i, _) &*& nick_buckets(buckets, i, bucketCount, bucketCount, nil) &*& 0 <= i;
+    {
+        //@ pointers_split(buckets, i - 1);
+        //@ open pointers(buckets + i - 1, 1, _);
+        buckets[i - 1] = 0;
+        //@ close nick_bucket(0, i - 1, bucketCount, nil);
+        //@ close nick_buckets(buckets, i - 1, bucketCount, bucketCount, nil);
+    }
+    //@ open pointers(buckets, 0, _);
+    return buckets;
+}
+
+/*
+Links a member into the chain of its bucket.
+*/
+void nick_buckets_insert(struct member **buckets, int bucketCount, struct member *member)
+    /*@
+    requires
+        nick_buckets(buckets, 0, bucketCount, bucketCount, ?ms) &*& 0 < bucketCount &*&
+        member->bucket_next |-> _ &*& nick_entry(member, _);
+    @*/
+    //@ ensures nick_buckets(buckets, 0, bucketCount, bucketCount, ?ms1) &*& same_members(ms1, cons((void *)member, ms)) == true;
+{
+    //@ open nick_entry(member, ?hash);
+    int index = (int)(member->nick_hash % (unsigned int)bucketCount);
+    //@ close nick_entry(member, hash);
+    //@ nick_buckets_take(buckets, index);
+    //@ assert nick_buckets(buckets, 0, index, bucketCount, ?ms0) &*& nick_bucket(_, index, bucketCount, ?chain) &*& nick_buckets(buckets, index + 1, bucketCount, bucketCount, ?ms2);
+    member->bucket_next = buckets[index];
+    buckets[index] = member;
+    //@ close nick_bucket(member, index, bucketCount, _);
+    //@ nick_buckets_give(buckets, 0, index);
+    //@ same_members_refl(ms);
+    //@ same_members_move(ms0, append(chain, ms2), (void *)member, ms);
+}
+
+/*
+Unlinks a member from a chain and returns the new first member of the chain.
+*/
+struct member *nick_bucket_remove(struct member *first, struct member *member)
+    //@ requires nick_bucket(first, ?index, ?bucketCount, ?ms) &*& mem((void *)member, ms) == true;
+    //@ ensures nick_bucket(result, index, bucketCount, remove((void *)member, ms)) &*& member->bucket_next |-> _ &*& nick_entry(member, _);
+{
+    //@ open nick_bucket(first, index, bucketCount, ms);
+    if (first == member) {
+        return first->bucket_next;
+    } else {
+        struct member *next = nick_bucket_remove(first->bucket_next, member);
+        first->bucket_next = next;
+        //@ close nick_bucket(first, index, bucketCount, _);
+        return first;
+    }
+}
+
+bool nick_bucket_contains(struct member *first, unsigned int hash, struct string_buffer *nick)
+    //@ requires [?f]nick_bucket(first, ?index, ?bucketCount, ?ms) &*& [?f0]string_buffer(nick, ?cs);
+    //@ ensures [f]nick_bucket(first, index, bucketCount, ms) &*& [f0]string_buffer(nick, cs);
+{
+    bool found = false;
+    //@ open [f]nick_bucket(first, index, bucketCount, ms);
+    if (first != 0) {
+        //@ open [f]nick_entry(first, _);
+        found = first->nick_hash == hash && string_buffer_equals(first->nick, nick);
+        //@ close [f]nick_entry(first, _);
+        if (!found) {
+            found = nick_bucket_contains(first->bucket_next, hash, nick);
+        }
+    }
+    //@ close [f]nick_bucket(first, index, bucketCount, ms);
+    return found;
+}
+
+/*
+Doubles the number of buckets of the nick index and moves every member to its new chain.
+*/
+void room_grow_nick_index(struct room *room)
+    //@ requires nick_index(room, ?members);
+    //@ ensures nick_index(room, members);
+{
+    //@ open nick_index(room, members);
+    int oldCount = room->nick_bucket_count;
+    struct member **oldBuckets = room->nick_buckets;
+    int newCount = oldCount * 2;
+    struct member **newBuckets = create_nick_buckets(newCount);
+    //@ assert nick_buckets(oldBuckets, 0, oldCount, oldCount, ?indexed);
+    //@ append_nil(indexed);
+    //@ close pointers(oldBuckets, 0, nil);
+    for (int i = 0; i < oldCount; i++)
+        /*@
+        invariant
+            pointers(oldBuckets, i, _) &*& nick_buckets(oldBuckets, i, oldCount, oldCount, ?rest) &*&
+            nick_buckets(newBuckets, 0, newCount, newCount, ?moved) &*& same_members(append(rest, moved), members) == true;
+        @*/
+    {
+        //@ open nick_buckets(oldBuckets, i, oldCount, oldCount, rest);
+        //@ assert nick_bucket(_, i, oldCount, ?chain0) &*& nick_buckets(oldBuckets, i + 1, oldCount, oldCount, ?rest1);
+        //@ append_assoc(chain0, rest1, moved);
+        struct member *iter = oldBuckets[i];
+        while (iter != 0)
+            /*@
+            invariant
+                nick_bucket(iter, i, oldCount, ?chain) &*& nick_buckets(newBuckets, 0, newCount, newCount, ?moved0) &*&
+                same_members(append(chain, append(rest1, moved0)), members) == true;
+            @*/
+        {
+            //@ open nick_bucket(iter, i, oldCount, chain);
+            //@ assert nick_bucket(_, i, oldCount, ?chain1);
+            struct member *next = iter->bucket_next;
+            nick_buckets_insert(newBuckets, newCount, iter);
+            //@ assert nick_buckets(newBuckets, 0, newCount, newCount, ?moved1);
+            //@ same_members_shift(chain1, rest1, moved0, moved1, (void *)iter, members);
+            iter = next;
+        }
+        //@ open nick_bucket(0, i, oldCount, _);
+        //@ close pointers(oldBuckets + i + 1, 0, nil);
+        //@ close pointers(oldBuckets + i, 1, _);
+        //@ pointers_join(oldBuckets);
+    }
+    //@ open nick_buckets(oldBuckets, oldCount, oldCount, oldCount, _);
+    free(oldBuckets);
+    room->nick_buckets = newBuckets;
+    room->nick_bucket_count = newCount;
+    //@ close nick_index(room, members);
+}
+
+/*
+Adds a member to the nick index of the room, growing the index first if it holds as many members as buckets.
+*/
+void room_index_member(struct room *room, struct member *member)
+    //@ requires nick_index(room, ?members) &*& member->bucket_next |-> _ &*& nick_entry(member, _);
+    //@ ensures nick_index(room, cons((void *)member, members));
+{
+    if (room->member_count == room->nick_bucket_count) {
+        room_grow_nick_index(room);
+    }
+    //@ open nick_index(room, members);
+    //@ assert nick_buckets(_, 0, _, _, ?indexed);
+    nick_buckets_insert(room->nick_buckets, room->nick_bucket_count, member);
+    //@ assert nick_buckets(_, 0, _, _, ?indexed1);
+    //@ same_members_trans(indexed1, cons((void *)member, indexed), cons((void *)member, members));
+    room->member_count = room->member_count + 1;
+    //@ close nick_index(room, cons((void *)member, members));
+}
+
+/*
+Removes a member from the nick index of the room. Only the member's own chain is walked.
+*/
+void room_unindex_member(struct room *room, struct member *member)
+    //@ requires nick_index(room, ?members) &*& mem((void *)member, members) == true &*& [1/2]member->nick_hash |-> ?hash;
+    //@ ensures nick_index(room, remove((void *)member, members)) &*& member->bucket_next |-> _ &*& nick_entry(member, _) &*& [1/2]member->nick_hash |-> hash;
+{
+    //@ open nick_index(room, members);
+    //@ assert nick_buckets(_, 0, ?bucketCount, _, ?indexed);
+    //@ same_members_mem(indexed, members, (void *)member);
+    //@ same_members_remove(indexed, members, (void *)member);
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(member->nick_hash % (unsigned int)room->nick_bucket_count);
+    //@ nick_buckets_take(buckets, index);
+    //@ assert nick_buckets(buckets, 0, index, bucketCount, ?ms0) &*& nick_bucket(_, index, bucketCount, ?chain) &*& nick_buckets(buckets, index + 1, bucketCount, bucketCount, ?ms2);
+    //@ mem_append((void *)member, ms0, append(chain, ms2));
+    //@ mem_append((void *)member, chain, ms2);
+    //@ if (mem((void *)member, ms0)) { nick_buckets_hash(buckets, 0, member); }
+    //@ if (mem((void *)member, ms2)) { nick_buckets_hash(buckets, index + 1, member); }
+    buckets[index] = nick_bucket_remove(buckets[index], member);
+    //@ nick_buckets_give(buckets, 0, index);
+    //@ remove_append_mem(chain, ms2, (void *)member);
+    //@ same_members_remove_append(ms0, append(chain, ms2), (void *)member);
+    //@ same_members_trans(append(ms0, append(remove((void *)member, chain), ms2)), remove((void *)member, indexed), remove((void *)member, members));
+    //@ length_remove((void *)member, members);
+    room->member_count = room->member_count - 1;
+    //@ close nick_index(room, remove((void *)member, members));
+}
+
+struct room *create_room()
+    //@ requires emp;
+    //@ ensures room(result);
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    room->nick_buckets = create_nick_buckets(NICK_BUCKETS_INITIAL);
+    room->nick_bucket_count = NICK_BUCKETS_INITIAL;
+    room->member_count = 0;
+    //@ close nick_index(room, nil);
+    //@ close dlseg(0, 0, 0, 0, nil, member);
+    //@ int i = create_ghost_list();
+    //@ room->ghost_list_id = i;
+    //@ int refsId = create_ghost_list<struct message *>();
+    //@ close foreach(nil, message_count);
+    //@ close live_messages(refsId)();
+    //@ close create_mutex_ghost_arg(live_messages(refsId));
+    room->message_refs = create_mutex();
+    //@ leak mutex(room->message_refs, _);
+    //@ close room(room);
+    return room;
+}
+
+/*
+Looks the nick up in the nick index, so the cost does not depend on the number of members.
+*/
+bool room_has_member(struct room *room, struct string_buffer *nick)
+    //@ requires [?f]room(room) &*& string_buffer(nick, _);
+    //@ ensures [f]room(room) &*& string_buffer(nick, _);
+{
+    //@ open [f]room(room);
+    //@ open [f]nick_index(room, ?members);
+    unsigned int hash = nick_hash(nick);
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(hash % (unsigned int)room->nick_bucket_count);
+    //@ nick_buckets_take(buckets, index);
+    bool hasMember = nick_bucket_contains(buckets[index], hash, nick);
+    //@ nick_buckets_give(buckets, 0, index);
+    //@ close [f]nick_index(room, members);
+    //@ close [f]room(room);
+    return hasMember;
+}
+
+/*
+Sends the line made of prefix followed by body to every member, taking ownership of both buffers.
+The message is built once and a reference to it is queued on the outbox of every member, so holding
+the room lock costs neither a copy nor a socket write per member. Only a fraction of the room is
+needed, so sessions holding the room lock for reading can broadcast at the same time.
+*/
+void room_broadcast_message(struct room *room, struct string_buffer *prefix, struct string_buffer *body)
+    //@ requires [?f]room(room) &*& string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars);
+    //@ ensures [f]room(room);
+{
+    //@ open [f]room(room);
+    struct member *iter = room->members;
+    int count = 0;
+    //@ assert [f]dlseg(?list, 0, 0, ?tail, ?ms, member);
+    //@ close [f]dlseg(list, 0, list, 0, nil, member);
+    while (iter != 0)
+        //@ invariant [f]dlseg(list, 0, iter, ?iterPrev, ?ms0, member) &*& [f]dlseg(iter, iterPrev, 0, tail, ?ms1, member) &*& ms == append(ms0, ms1) &*& count == length(ms0);
+    {
+        //@ open [f]dlseg(iter, iterPrev, 0, tail, ms1, member);
+        count = count + 1;
+        iter = *(void **)(void *)iter;
+        //@ dlseg_add(list);
+    }
+    //@ dlseg_append(list);
+    if (count == 0) {
+        string_buffer_dispose(prefix);
+        string_buffer_dispose(body);
+    } else {
+        struct message *message = create_message(room->message_refs, prefix, body, count);
+        iter = room->members;
+        //@ close [f]dlseg(list, 0, list, 0, nil, member);
+        while (iter != 0)
+            /*@
+            invariant
+                [f]dlseg(list, 0, iter, ?iterPrev, ?ms0, member) &*& [f]dlseg(iter, iterPrev, 0, tail, ?ms1, member) &*& ms == append(ms0, ms1) &*&
+                message_refs(message, length(ms1), append(prefixChars, bodyChars));
+            @*/
+        {
+            //@ open [f]dlseg(iter, iterPrev, 0, tail, ms1, member);
+            //@ open [f]member(iter);
+            //@ open message_refs(message, length(ms1), _);
+            outbox_push(iter->outbox, message);
+            //@ close [f]member(iter);
+            iter = *(void **)(void *)iter;
+            //@ dlseg_add(list);
+        }
+        //@ dlseg_append(list);
+        //@ open message_refs(message, 0, _);
+    }
+    //@ close [f]room(room);
+}
+
+struct session {
+    struct room *room;
+    struct rwlock *room_lock;
+    struct socket *socket;
+};
+
+/*@
+
+// The room lock protects the member list. Through member(), it also holds half of each member's
+// outbox: enough to push messages, while the other half and the socket writer belong to the
+// member's writer thread. The queued messages themselves are owned by each outbox's own mutex.
+// Joining and leaving hold the room lock for writing; listing the members and broadcasting a
+// message only read the member list, so they hold it for reading and run concurrently. Two
+// messages broadcast at the same time may reach different members in different orders, but the
+// messages of one member always arrive in the order they were sent.
+predicate_ctor room_ctor(struct room *room)() =
+    room(room);
+
+predicate session(struct session *session) =
+    session->room |-> ?room &*& session->room_lock |-> ?roomLock &*& session->socket |-> ?socket &*& malloc_block_session(session)
+        &*& [_]rwlock(roomLock, _, room_ctor(room)) &*& socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+
+@*/
+
+
+struct session *create_session(struct room *room, struct rwlock *roomLock, struct socket *socket)
+    //@ requires [_]rwlock(roomLock, _, room_ctor(room)) &*& socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+    //@ ensures session(result);
+{
+    struct session *session = malloc(sizeof(struct session));
+    if (session == 0) {
+        abort();
+    }
+    session->room = room;
+    session->room_lock = roomLock;
+    session->socket = socket;
+    //@ close session(session);
+    return session;
+}
+
+void session_run_with_nick(struct room *room, struct rwlock *roomLock, struct reader *reader, struct writer *writer, struct string_buffer *nick)
+    /*@
+    requires
+        rwlock_write_locked(roomLock, ?roomLockId, room_ctor(room), currentThread, _) &*& lockset(currentThread, cons(roomLockId, nil)) &*&
+        room(room) &*& reader(reader) &*& writer(writer) &*& string_buffer(nick, _);
+    @*/
+    /*@
+    ensures
+        [_]rwlock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*&
+        reader(reader) &*& writer(writer) &*& string_buffer(nick, _);
+    @*/
+{
+    struct member *member = 0;
+    struct outbox *outbox = 0;
+    struct thread *drain = 0;
+
+    {
+        struct string_buffer *joinPrefix = string_buffer_copy(nick);
+        struct string_buffer *joinBody = create_string_buffer();
+        string_buffer_append_string(joinBody, " has joined the room.");
+        room_broadcast_message(room, joinPrefix, joinBody);
+    }
+
+    {
+        struct string_buffer *nickCopy = string_buffer_copy(nick);
+        outbox = create_outbox(writer);
+        //@ close thread_run_pre(outbox_drain)(outbox, unit);
+        drain = thread_start_joinable(outbox_drain, outbox);
+        //@ open room(room);
+        member = malloc(sizeof(struct member));
+        if (member == 0) {
+            abort();
+        }
+        member->nick = nickCopy;
+        member->nick_hash = nick_hash(nickCopy);
+        member->outbox = outbox;
+        //@ close nick_entry(member, _);
+        //@ close member(member);
+        //@ open member_next(member, _);
+        //@ open member_prev(member, _);
+        //@ open room_members(room, _);
+        dlseg_push_front(&room->members, member);
+        //@ close room_members(room, member);
+        //@ assert [_]room->ghost_list_id |-> ?id;
+        //@ split_fraction room_ghost_list_id(room, id);
+        //@ ghost_list_add(id, member);
+        room_index_member(room, member);
+        //@ close room(room);
+    }
+
+    //@ close room_ctor(room)();
+    rwlock_release_write(roomLock);
+    //@ leak [_]rwlock(roomLock, roomLockId, room_ctor(room));
+
+    {
+        bool eof = false;
+        struct string_buffer *message = create_string_buffer();
+        while (!eof)
+            //@ invariant reader(reader) &*& string_buffer(nick, _) &*& string_buffer(message, _) &*& [_]rwlock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil);
+        {
+            eof = reader_read_line(reader, message);
+            if (eof) {
+            } else {
+                struct string_buffer *prefix = string_buffer_copy(nick);
+                string_buffer_append_string(prefix, " says: ");
+                rwlock_acquire_read(roomLock);
+                //@ assert [?f]room_ctor(room)();
+                //@ open [f]room_ctor(room)();
+                room_broadcast_message(room, prefix, message);
+                //@ close [f]room_ctor(room)();
+                rwlock_release_read(roomLock);
+                message = create_string_buffer();
+            }
+        }
+        string_buffer_dispose(message);
+    }
+
+    rwlock_acquire_write(roomLock);
+    //@ open room_ctor(room)();
+    //@ open room(room);
+    {
+        //@ open room_members(room, _);
+        //@ assert [_]ghost_list_member_handle(?id, ?d);
+        //@ ghost_list_member_handle_lemma(id, d);
+        dlseg_remove(&room->members, member);
+        //@ assert pointer(&room->members, ?list);
+        //@ close room_members(room, list);
+        //@ close member_next(member, _);
+        //@ close member_prev(member, _);
+    }
+    //@ open member(member);
+    room_unindex_member(room, member);
+    //@ assert ghost_list(?id, _);
+    //@ ghost_list_remove(id, member);
+    //@ close room(room);
+    {
+        struct string_buffer *goodbyePrefix = string_buffer_copy(nick);
+        struct string_buffer *goodbyeBody = create_string_buffer();
+        string_buffer_append_string(goodbyeBody, " left the room.");
+        room_broadcast_message(room, goodbyePrefix, goodbyeBody);
+    }
+    //@ close room_ctor(room)();
+    rwlock_release_write(roomLock);
+
+    //@ open nick_entry(member, _);
+    outbox_close(member->outbox);
+    thread_join(drain);
+    //@ open thread_run_post(outbox_drain)(outbox, unit);
+    outbox_dispose(outbox);
+    string_buffer_dispose(member->nick);
+    free(member);
+}
+
+/*@
+
+predicate_family_instance thread_run_data(session_run)(void *data) = session(data);
+
+@*/
+
+
+
+void session_run(void *data) //@ : thread_run
+    //@ requires thread_run_data(session_run)(data) &*& lockset(currentThread, nil);
+    //@ ensures lockset(currentThread, nil);
+{
+    //@ open thread_run_data(session_run)(data);
+    struct session *session = data;
+    //@ open session(session);
+    struct room *room = session->room;
+    struct rwlock *roomLock = session->room_lock;
+    struct socket *socket = session->socket;
+    struct writer *writer = socket_get_writer(socket);
+    struct reader *reader = socket_get_reader(socket);
+    free(session);
+
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    // Copy the nicks while holding the read lock and write them after releasing it. Waiting writers take precedence
+    // over new readers, so a client that does not read its greeting would otherwise hold off every join and leave,
+    // and every broadcast behind them.
+    struct string_buffer *members = create_string_buffer();
+    rwlock_acquire_read(roomLock);
+    //@ assert [?f]room_ctor(room)();
+    //@ open [f]room_ctor(room)();
+    //@ open [f]room(room);
+    {
+        struct member *iter = room->members;
+        //@ assert [f]dlseg(?membersList, 0, 0, ?tail, ?ms, member);
+        //@ close [f]dlseg(membersList, 0, membersList, 0, nil, member);
+        while (iter != 0)
+            //@ invariant string_buffer(members, _) &*& [f]dlseg(membersList, 0, iter, ?iterPrev, ?ms0, member) &*& [f]dlseg(iter, iterPrev, 0, tail, ?ms1, member) &*& ms == append(ms0, ms1);
+        {
+            //@ open [f]dlseg(iter, iterPrev, 0, tail, ms1, member);
+            //@ open [f]member(iter);
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            //@ close [f]member(iter);
+            iter = *(void **)(void *)iter;
+            //@ dlseg_add(membersList);
+        }
+        //@ dlseg_append(membersList);
+    }
+    //@ close [f]room(room);
+    //@ close [f]room_ctor(room)();
+    rwlock_release_read(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    {
+        struct string_buffer *nick = create_string_buffer();
+        bool done = false;
+        while (!done)
+          //@ invariant writer(writer) &*& reader(reader) &*& string_buffer(nick, _) &*& [_]rwlock(roomLock, _, room_ctor(room)) &*& lockset(currentThread, nil);
+        {
+            writer_write_string(writer, "Please enter your nick: ");
+            {
+                bool eof = reader_read_line(reader, nick);
+                if (eof) {
+                    done = true;
+                } else {
+                    rwlock_acquire_write(roomLock);
+                    //@ open room_ctor(room)();
+                    {
+                        bool hasMember = room_has_member(room, nick);
+                        if (hasMember) {
+                            //@ close room_ctor(room)();
+                            rwlock_release_write(roomLock);
+                            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+                        } else {
+                            session_run_with_nick(room, roomLock, reader, writer, nick);
+                            done = true;
+                        }
+                    }
+                }
+            }
+        }
+        string_buffer_dispose(nick);
+    }
+
+    socket_close(socket);
+}
+
+int main() //@ : main
+    //@ requires true;
+    //@ ensures false;
+{
+    struct room *room = create_room();
+    //@ close room_ctor(room)();
+    //@ close create_rwlock_ghost_args(room_ctor(room), nil, nil);
+    struct rwlock *roomLock = create_rwlock();
+    //@ leak rwlock(roomLock, _, _);
+    struct server_socket *serverSocket = create_server_socket(12345);
+
+    for (;;)
+        //@ invariant [_]rwlock(roomLock, _, room_ctor(room)) &*& server_socket(serverSocket);
+    {
+        struct socket *socket = server_socket_accept(serverSocket);
+        struct session *session = create_session(room, roomLock, socket);
+        //@ close thread_run_data(session_run)(session);
+        thread_start(session_run, session);
+    }
+}
@@ -0,0 +1,681 @@
+#include <stdbool.h>
+#include "dlists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+
+#define OUTBOX_CAPACITY 256
+#define NICK_BUCKETS_INITIAL 64
+
+// A message is built once and shared by the outboxes of all the members it is sent to.
+// Its text never changes; refcount is the number of outboxes that still have to send it.
+struct message {
+    struct string_buffer *prefix;
+    struct string_buffer *body;
+    int refcount;
+    struct mutex *refs;
+};
+
+/**
+ * Description:
+ * The create_message function creates a message that consists of prefix followed by body, and takes ownership of both string buffers.
+ * The message starts with count references, and it is registered with the room's reference-count mutex.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param refs The mutex that protects the reference counts of the room's messages.
+ * @param prefix The first part of the message text.
+ * @param body The rest of the message text.
+ * @param count The number of references handed to the caller; it must be positive.
+ *
+ * @return A pointer to the new message.
+ */
+struct message *create_message(struct mutex *refs, struct string_buffer *prefix, struct string_buffer *body, int count)
+{
+    struct message *message = malloc(sizeof(struct message));
+    if (message == 0) {
+        abort();
+    }
+    message->prefix = prefix;
+    message->body = body;
+    message->refs = refs;
+    mutex_acquire(refs);
+    message->refcount = count;
+    mutex_release(refs);
+    return message;
+}
+
+/**
+ * Description:
+ * The message_release function drops one reference to a message.
+ * When the last reference is dropped, the message and its string buffers are freed.
+ *
+ * @param message A pointer to the message; the caller must not use this reference anymore.
+ */
+void message_release(struct message *message)
+{
+    struct mutex *refs = message->refs;
+    bool last = false;
+    mutex_acquire(refs);
+    message->refcount = message->refcount - 1;
+    if (message->refcount == 0) {
+        last = true;
+    } else {
+    }
+    mutex_release(refs);
+    if (last) {
+        string_buffer_dispose(message->prefix);
+        string_buffer_dispose(message->body);
+        free(message);
+    }
+}
+
+struct outbox_entry {
+    struct outbox_entry *next;
+    struct message *message;
+};
+
+struct outbox {
+    struct mutex *mutex;
+    struct mutex_cond *changed;
+    struct outbox_entry *first;
+    struct outbox_entry *last;
+    int count;
+    bool closed;
+    struct writer *writer;
+};
+
+/**
+ * Description:
+ * The create_outbox function creates an empty outbound message queue for a chat member.
+ * The queue holds a single empty sentinel node, is not closed, and is protected by a new mutex with a condition variable that signals changes to it.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param writer The writer of the member's socket, to which the queued messages will be sent.
+ *
+ * @return A pointer to the newly created outbox.
+ */
+struct outbox *create_outbox(struct writer *writer)
+{
+    struct outbox *outbox = malloc(sizeof(struct outbox));
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (outbox == 0 || sentinel == 0) {
+        abort();
+    }
+    outbox->first = sentinel;
+    outbox->last = sentinel;
+    outbox->count = 0;
+    outbox->closed = false;
+    outbox->writer = writer;
+    struct mutex *mutex = create_mutex();
+    outbox->mutex = mutex;
+    outbox->changed = create_mutex_cond();
+    return outbox;
+}
+
+/**
+ * Description:
+ * The outbox_push function appends a reference to a message to the end of the outbox and hands it to the outbox.
+ * If the outbox already holds OUTBOX_CAPACITY messages or has been closed, the reference is released instead, so that a slow member never makes the sender wait.
+ * A thread waiting for messages is woken up.
+ *
+ * @param outbox A pointer to the outbox.
+ * @param message The message to queue; the caller's reference to it is owned by the outbox (or released) afterwards.
+ */
+void outbox_push(struct outbox *outbox, struct message *message)
+{
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (sentinel == 0) {
+        abort();
+    }
+    mutex_acquire(outbox->mutex);
+    if (outbox->closed || outbox->count == OUTBOX_CAPACITY) {
+        mutex_release(outbox->mutex);
+        free(sentinel);
+        message_release(message);
+    } else {
+        struct outbox_entry *last = outbox->last;
+        last->message = message;
+        last->next = sentinel;
+        outbox->last = sentinel;
+        outbox->count = outbox->count + 1;
+        mutex_cond_signal(outbox->changed);
+        mutex_release(outbox->mutex);
+    }
+}
+
+/**
+ * Description:
+ * The outbox_pop function waits until the outbox holds a message or has been closed, and then removes the first message from the queue.
+ *
+ * @param outbox A pointer to the outbox.
+ *
+ * @return The first queued message, whose reference now belongs to the caller, or 0 if the outbox is closed and every queued message has already been taken.
+ */
+struct message *outbox_pop(struct outbox *outbox)
+{
+    struct message *message = 0;
+    mutex_acquire(outbox->mutex);
+    while (outbox->count == 0 && !outbox->closed)
+    {
+        mutex_cond_wait(outbox->changed, outbox->mutex);
+    }
+    if (outbox->count != 0) {
+        struct outbox_entry *first = outbox->first;
+        message = first->message;
+        outbox->first = first->next;
+        outbox->count = outbox->count - 1;
+        free(first);
+    }
+    mutex_release(outbox->mutex);
+    return message;
+}
+
+/**
+ * Description:
+ * The outbox_close function marks the outbox as closed and wakes up a thread waiting for messages.
+ * Messages that are already queued are still delivered; later messages are dropped.
+ *
+ * @param outbox A pointer to the outbox.
+ */
+void outbox_close(struct outbox *outbox)
+{
+    mutex_acquire(outbox->mutex);
+    outbox->closed = true;
+    mutex_cond_signal(outbox->changed);
+    mutex_release(outbox->mutex);
+}
+
+/**
+ * Description:
+ * The outbox_dispose function frees the outbox and its mutex and condition variable, and releases any messages that are still queued.
+ *
+ * @param outbox A pointer to the outbox, which must not be used by any other thread anymore.
+ */
+void outbox_dispose(struct outbox *outbox)
+{
+    mutex_cond_dispose(outbox->changed);
+    mutex_dispose(outbox->mutex);
+    struct outbox_entry *iter = outbox->first;
+    while (iter != outbox->last)
+    {
+        struct outbox_entry *next = iter->next;
+        message_release(iter->message);
+        free(iter);
+        iter = next;
+    }
+    free(outbox->last);
+    free(outbox);
+}
+
+/**
+ * Description:
+ * The outbox_drain function is the writer thread of a chat member.
+ * It takes the messages from the member's outbox in order, writes each of them to the member's socket as one line, and then releases its reference.
+ * It returns once the outbox has been closed and emptied.
+ *
+ * @param data A pointer to the outbox of the member.
+ */
+void outbox_drain(void *data)
+{
+    struct outbox *outbox = data;
+    struct writer *writer = outbox->writer;
+    struct message *message = outbox_pop(outbox);
+    while (message != 0)
+    {
+        writer_write_line(writer, message->prefix, message->body);
+        message_release(message);
+        message = outbox_pop(outbox);
+    }
+}
+
+struct member {
+    struct member *next;
+    struct member *prev;
+    struct member *bucket_next;
+    unsigned int nick_hash;
+    struct string_buffer *nick;
+    struct outbox *outbox;
+};
+
+struct room {
+    struct member *members;
+    struct member **nick_buckets;
+    int nick_bucket_count;
+    int member_count;
+    struct mutex *message_refs;
+};
+
+/**
+ * Description:
+ * The nick_hash function computes the FNV-1a hash of the characters of a nick.
+ * The hash is only used by the nick index of a room.
+ *
+ * @param nick A pointer to the string buffer holding the nick.
+ *
+ * @return The hash of the nick.
+ */
+unsigned int nick_hash(struct string_buffer *nick)
+{
+    int length = string_buffer_get_length(nick);
+    char *chars = string_buffer_get_chars(nick);
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)chars[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Description:
+ * The create_nick_buckets function allocates the bucket array of a nick index, with every bucket empty.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param bucketCount The number of buckets; it must be positive.
+ *
+ * @return A pointer to the new bucket array.
+ */
+struct member **create_nick_buckets(int bucketCount)
+{
+    struct member **buckets = malloc((unsigned int)bucketCount * sizeof(struct member *));
+    if (buckets == 0) {
+        abort();
+    }
+    for (int i = bucketCount; 0 < i; i--)
+    {
+        buckets[i - 1] = 0;
+    }
+    return buckets;
+}
+
+/**
+ * Description:
+ * The nick_buckets_insert function links a member at the front of the chain of the bucket selected by the member's nick hash.
+ *
+ * @param buckets A pointer to the bucket array.
+ * @param bucketCount The number of buckets in the array.
+ * @param member A pointer to the member to insert; it must not be on any chain yet.
+ */
+void nick_buckets_insert(struct member **buckets, int bucketCount, struct member *member)
+{
+    int index = (int)(member->nick_hash % (unsigned int)bucketCount);
+    member->bucket_next = buckets[index];
+    buckets[index] = member;
+}
+
+/**
+ * Description:
+ * The nick_bucket_remove function unlinks a member from a bucket chain that contains it.
+ *
+ * @param first The first member of the chain.
+ * @param member The member to unlink.
+ *
+ * @return The first member of the chain after the removal.
+ */
+struct member *nick_bucket_remove(struct member *first, struct member *member)
+{
+    if (first == member) {
+        return first->bucket_next;
+    } else {
+        struct member *next = nick_bucket_remove(first->bucket_next, member);
+        first->bucket_next = next;
+        return first;
+    }
+}
+
+/**
+ * Description:
+ * The nick_bucket_contains function checks whether a bucket chain holds a member with the given nick.
+ * The stored hashes are compared first, so nicks are only compared when the hashes match.
+ *
+ * @param first The first member of the chain.
+ * @param hash The hash of the nick.
+ * @param nick A pointer to the string buffer holding the nick.
+ *
+ * @return True if a member of the chain has the given nick, false otherwise.
+ */
+bool nick_bucket_contains(struct member *first, unsigned int hash, struct string_buffer *nick)
+{
+    bool found = false;
+    if (first != 0) {
+        found = first->nick_hash == hash && string_buffer_equals(first->nick, nick);
+        if (!found) {
+            found = nick_bucket_contains(first->bucket_next, hash, nick);
+        }
+    }
+    return found;
+}
+
+/**
+ * Description:
+ * The room_grow_nick_index function doubles the number of buckets of the room's nick index and moves every member to the chain of its new bucket.
+ * The old bucket array is freed.
+ *
+ * @param room A pointer to the room structure.
+ */
+void room_grow_nick_index(struct room *room)
+{
+    int oldCount = room->nick_bucket_count;
+    struct member **oldBuckets = room->nick_buckets;
+    int newCount = oldCount * 2;
+    struct member **newBuckets = create_nick_buckets(newCount);
+    for (int i = 0; i < oldCount; i++)
+    {
+        struct member *iter = oldBuckets[i];
+        while (iter != 0)
+        {
+            struct member *next = iter->bucket_next;
+            nick_buckets_insert(newBuckets, newCount, iter);
+            iter = next;
+        }
+    }
+    free(oldBuckets);
+    room->nick_buckets = newBuckets;
+    room->nick_bucket_count = newCount;
+}
+
+/**
+ * Description:
+ * The room_index_member function adds a member to the nick index of the room.
+ * If the index holds as many members as it has buckets, it is grown first.
+ *
+ * @param room A pointer to the room structure.
+ * @param member A pointer to the member, whose nick hash has already been computed.
+ */
+void room_index_member(struct room *room, struct member *member)
+{
+    if (room->member_count == room->nick_bucket_count) {
+        room_grow_nick_index(room);
+    }
+    nick_buckets_insert(room->nick_buckets, room->nick_bucket_count, member);
+    room->member_count = room->member_count + 1;
+}
+
+/**
+ * Description:
+ * The room_unindex_member function removes a member from the nick index of the room.
+ * Only the chain of the member's bucket is walked.
+ *
+ * @param room A pointer to the room structure.
+ * @param member A pointer to the member, which must be in the index.
+ */
+void room_unindex_member(struct room *room, struct member *member)
+{
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(member->nick_hash % (unsigned int)room->nick_bucket_count);
+    buckets[index] = nick_bucket_remove(buckets[index], member);
+    room->member_count = room->member_count - 1;
+}
+
+/**
+ * Description:
+ * The create_room function allocates a new chat room without members, with an empty nick index of NICK_BUCKETS_INITIAL buckets.
+ * If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the newly created room.
+ */
+struct room *create_room()
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    room->nick_buckets = create_nick_buckets(NICK_BUCKETS_INITIAL);
+    room->nick_bucket_count = NICK_BUCKETS_INITIAL;
+    room->member_count = 0;
+    room->message_refs = create_mutex();
+    return room;
+}
+
+/**
+ * Description:
+ * The room_has_member function checks whether a member with the given nick is present in the room.
+ * It looks the nick up in the room's nick index, so only the members whose nick falls in the same bucket are compared.
+ *
+ * @param room A pointer to the room structure.
+ * @param nick A pointer to the string buffer containing the nickname to search for.
+ *
+ * @return True if a member with the specified nickname is found in the room, otherwise false.
+ */
+bool room_has_member(struct room *room, struct string_buffer *nick)
+{
+    unsigned int hash = nick_hash(nick);
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(hash % (unsigned int)room->nick_bucket_count);
+    bool hasMember = nick_bucket_contains(buckets[index], hash, nick);
+    return hasMember;
+}
+
+/**
+ * Description:
+ * The room_broadcast_message function sends a message, made of prefix followed by body, to all members of the room.
+ * It builds a single shared message with one reference per member and queues a reference on the outbox of each member; the members' writer threads send it later.
+ * The function takes ownership of both string buffers; if the room has no members, they are disposed of.
+ * It only reads the room, so it can run while the room lock is held for reading.
+ *
+ * @param room A pointer to the room structure.
+ * @param prefix The first part of the message, such as the sender's nick.
+ * @param body The rest of the message.
+ */
+void room_broadcast_message(struct room *room, struct string_buffer *prefix, struct string_buffer *body)
+{
+    struct member *iter = room->members;
+    int count = 0;
+    while (iter != 0)
+    {
+        count = count + 1;
+        iter = *(void **)(void *)iter;
+    }
+    if (count == 0) {
+        string_buffer_dispose(prefix);
+        string_buffer_dispose(body);
+    } else {
+        struct message *message = create_message(room->message_refs, prefix, body, count);
+        iter = room->members;
+        while (iter != 0)
+        {
+            outbox_push(iter->outbox, message);
+            iter = *(void **)(void *)iter;
+        }
+    }
+}
+
+struct session {
+    struct room *room;
+    struct rwlock *room_lock;
+    struct socket *socket;
+};
+
+/**
+ * Description:
+ * The create_session function allocates a session that bundles the room, the reader-writer lock protecting it and the socket of a newly connected client.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param room A pointer to the room structure associated with the session.
+ * @param roomLock A pointer to the reader-writer lock for synchronizing access to the room.
+ * @param socket A pointer to the socket used for communication in the session.
+ *
+ * @return A pointer to the newly created session structure.
+ */
+struct session *create_session(struct room *room, struct rwlock *roomLock, struct socket *socket)
+{
+    struct session *session = malloc(sizeof(struct session));
+    if (session == 0) {
+        abort();
+    }
+    session->room = room;
+    session->room_lock = roomLock;
+    session->socket = socket;
+    return session;
+}
+
+/**
+ * Description:
+ * The session_run_with_nick function runs the chat session of a client that picked a free nickname. It is called while the room lock is held for writing.
+ * It announces the new member, creates the member's outbox, starts a writer thread draining it to the client's socket, and adds the member to the room before releasing the lock.
+ * Each line read from the client is then broadcast as "<nick> says: <line>"; the message is built before the room lock is taken, and the lock is held only for reading, so members can broadcast at the same time.
+ * At the end of the input, the room lock is taken for writing, the member is removed from the room and its departure is announced. Finally the outbox is closed, the writer thread is joined once it has delivered the remaining messages, and the member is freed.
+ *
+ * @param room A pointer to the room structure.
+ * @param roomLock A pointer to the room lock, which is held for writing by the caller and released by this function.
+ * @param reader The reader of the client's socket.
+ * @param writer The writer of the client's socket. It is used by the writer thread while the member is in the room, and is available to the caller again when the function returns.
+ * @param nick A pointer to the string buffer containing the nickname of the member.
+ */
+void session_run_with_nick(struct room *room, struct rwlock *roomLock, struct reader *reader, struct writer *writer, struct string_buffer *nick)
+{
+    struct member *member = 0;
+    struct outbox *outbox = 0;
+    struct thread *drain = 0;
+
+    {
+        struct string_buffer *joinPrefix = string_buffer_copy(nick);
+        struct string_buffer *joinBody = create_string_buffer();
+        string_buffer_append_string(joinBody, " has joined the room.");
+        room_broadcast_message(room, joinPrefix, joinBody);
+    }
+
+    {
+        struct string_buffer *nickCopy = string_buffer_copy(nick);
+        outbox = create_outbox(writer);
+        drain = thread_start_joinable(outbox_drain, outbox);
+        member = malloc(sizeof(struct member));
+        if (member == 0) {
+            abort();
+        }
+        member->nick = nickCopy;
+        member->nick_hash = nick_hash(nickCopy);
+        member->outbox = outbox;
+        dlseg_push_front(&room->members, member);
+        room_index_member(room, member);
+    }
+
+    rwlock_release_write(roomLock);
+
+    {
+        bool eof = false;
+        struct string_buffer *message = create_string_buffer();
+        while (!eof)
+        {
+            eof = reader_read_line(reader, message);
+            if (eof) {
+            } else {
+                struct string_buffer *prefix = string_buffer_copy(nick);
+                string_buffer_append_string(prefix, " says: ");
+                rwlock_acquire_read(roomLock);
+                room_broadcast_message(room, prefix, message);
+                rwlock_release_read(roomLock);
+                message = create_string_buffer();
+            }
+        }
+        string_buffer_dispose(message);
+    }
+
+    rwlock_acquire_write(roomLock);
+    {
+        dlseg_remove(&room->members, member);
+    }
+    room_unindex_member(room, member);
+    {
+        struct string_buffer *goodbyePrefix = string_buffer_copy(nick);
+        struct string_buffer *goodbyeBody = create_string_buffer();
+        string_buffer_append_string(goodbyeBody, " left the room.");
+        room_broadcast_message(room, goodbyePrefix, goodbyeBody);
+    }
+    rwlock_release_write(roomLock);
+
+    outbox_close(member->outbox);
+    thread_join(drain);
+    outbox_dispose(outbox);
+    string_buffer_dispose(member->nick);
+    free(member);
+}
+
+/**
+ * Description:
+ * The session_run function is the thread body of a client session.
+ * It greets the client and lists the members currently in the room. The nicknames are copied while the room lock is held for reading and written to the socket after it is released, so a client that does not read cannot hold up the room: waiting writers take precedence over new readers, so a write under the read lock would hold off every join and leave, and every broadcast behind them. It then asks for a nickname until the client picks one that is not in use; the nickname is checked and the member added while the room lock is held for writing or closes the connection.
+ * With a free nickname it continues in session_run_with_nick. Finally, the socket is closed.
+ *
+ * @param data A pointer to the session structure, which is freed by this function.
+ */
+void session_run(void *data)
+{
+    struct session *session = data;
+    struct room *room = session->room;
+    struct rwlock *roomLock = session->room_lock;
+    struct socket *socket = session->socket;
+    struct writer *writer = socket_get_writer(socket);
+    struct reader *reader = socket_get_reader(socket);
+    free(session);
+
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    struct string_buffer *members = create_string_buffer();
+    rwlock_acquire_read(roomLock);
+    {
+        struct member *iter = room->members;
+        while (iter != 0)
+        {
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            iter = *(void **)(void *)iter;
+        }
+    }
+    rwlock_release_read(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    {
+        struct string_buffer *nick = create_string_buffer();
+        bool done = false;
+        while (!done)
+        {
+            writer_write_string(writer, "Please enter your nick: ");
+            {
+                bool eof = reader_read_line(reader, nick);
+                if (eof) {
+                    done = true;
+                } else {
+                    rwlock_acquire_write(roomLock);
+                    {
+                        bool hasMember = room_has_member(room, nick);
+                        if (hasMember) {
+                            rwlock_release_write(roomLock);
+                            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+                        } else {
+                            session_run_with_nick(room, roomLock, reader, writer, nick);
+                            done = true;
+                        }
+                    }
+                }
+            }
+        }
+        string_buffer_dispose(nick);
+    }
+
+    socket_close(socket);
+}
+
+/**
+ * Description:
+ * The main function creates the chat room and its reader-writer lock, and listens on port 12345.
+ * Each accepted connection is handled by a new session_run thread.
+ */
+int main()
+{
+    struct room *room = create_room();
+    struct rwlock *roomLock = create_rwlock();
+    struct server_socket *serverSocket = create_server_socket(12345);
+
+    for (;;)
+    {
+        struct socket *socket = server_socket_accept(serverSocket);
+        struct session *session = create_session(room, roomLock, socket);
+        thread_start(session_run, session);
+    }
+}
@@ -0,0 +1,714 @@
+#include <stdbool.h>
+#include "dlists.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+#include "threading.h"
+#include "stdlib.h"
+//@ #include "ghostlist.gh"
+//@ #include "counting.gh"
+//@ #include "listex.gh"
+
+#define OUTBOX_CAPACITY 256
+#define NICK_BUCKETS_INITIAL 64
+
+// A message is built once and shared by the outboxes of all the members it is sent to.
+// Its text never changes; refcount is the number of outboxes that still have to send it.
+struct message {
+    struct string_buffer *prefix;
+    struct string_buffer *body;
+    int refcount;
+    struct mutex *refs;
+    //@ int refs_id;
+};
+
+/*@
+
+predicate message_text(struct message *message; list<char> text) =
+    message->prefix |-> ?prefix &*& message->body |-> ?body &*& message->refs |-> ?refs &*& message->refs_id |-> ?id &*&
+    string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars) &*& text == append(prefixChars, bodyChars) &*&
+    [_]mutex(refs, live_messages(id)) &*& ghost_list_member_handle(id, message) &*& malloc_block_message(message);
+
+// A reference holds a ticket for the message and the matching fraction of its text.
+predicate message_ref(struct message *message; list<char> text) =
+    ticket(message_text, message, ?f) &*& [f]message_text(message, text);
+
+predicate message_refs(struct message *message, int count, list<char> text) =
+    count == 0 ? emp : message_ref(message, text) &*& message_refs(message, count - 1, text);
+
+predicate message_count(struct message *message) =
+    message->refcount |-> ?count &*& 0 < count &*& counting(message_text, message, count, _);
+
+// The reference counts of the live messages of a room are protected by a single mutex. It is held
+// only to register a new message or to drop a reference, never while a message is being sent.
+predicate_ctor live_messages(int id)() =
+    ghost_list<struct message *>(id, ?messages) &*& foreach(messages, message_count);
+@*/
+
+/*
+Creates a message made of prefix followed by body, taking ownership of both buffers.
+The caller gets count references to it.
+*/
+struct message *create_message(struct mutex *refs, struct string_buffer *prefix, struct string_buffer *body, int count)
+    //@ requires [_]mutex(refs, live_messages(?id)) &*& string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars) &*& 0 < count;
+    //@ ensures message_refs(result, count, _);
+{
+    struct message *message = malloc(sizeof(struct message));
+    if (message == 0) {
+        abort();
+    }
+    message->prefix = prefix;
+    message->body = body;
+    message->refs = refs;
+    mutex_acquire(refs);
+    message->refcount = count;
+    mutex_release(refs);
+    return message;
+}
+
+/*
+Drops a reference to a message. Dropping the last reference frees the message.
+*/
+void message_release(struct message *message)
+    //@ requires message_ref(message, ?text);
+    //@ ensures emp;
+{
+    struct mutex *refs = message->refs;
+    bool last = false;
+    mutex_acquire(refs);
+    message->refcount = message->refcount - 1;
+    if (message->refcount == 0) {
+        last = true;
+    } else {
+    }
+    mutex_release(refs);
+    if (last) {
+        string_buffer_dispose(message->prefix);
+        string_buffer_dispose(message->body);
+        free(message);
+    }
+}
+
+struct outbox_entry {
+    struct outbox_entry *next;
+    struct message *message;
+};
+
+/*@
+
+predicate entries(struct outbox_entry *first, struct outbox_entry *last, int count) =
+    first == last ?
+        count == 0
+    :
+        first->next |-> ?next &*& first->message |-> ?message &*& message_ref(message, _) &*& malloc_block_outbox_entry(first) &*&
+        entries(next, last, count - 1) &*& 0 < count;
+@*/
+
+struct outbox {
+    struct mutex *mutex;
+    struct mutex_cond *changed;
+    struct outbox_entry *first;
+    struct outbox_entry *last;
+    int count;
+    bool closed;
+    struct writer *writer;
+};
+
+/*@
+
+// The queued references belong to the outbox's mutex. The queue always ends in an empty sentinel entry,
+// so pushing fills the sentinel and appends a fresh one, and popping unlinks the first entry.
+predicate_ctor outbox_inv(struct outbox *outbox)() =
+    outbox->first |-> ?first &*& outbox->last |-> ?last &*& outbox->count |-> ?count &*& outbox->closed |-> _ &*&
+    entries(first, last, count) &*& last->next |-> _ &*& last->message |-> _ &*& malloc_block_outbox_entry(last) &*&
+    0 <= count &*& count <= OUTBOX_CAPACITY;
+
+predicate outbox(struct outbox *outbox; struct writer *writer) =
+    outbox->mutex |-> ?mutex &*& outbox->changed |-> ?changed &*& outbox->writer |-> writer &*&
+    mutex(mutex, outbox_inv(outbox)) &*& mutex_cond(changed, mutex) &*& malloc_block_outbox(outbox);
+@*/
+
+struct outbox *create_outbox(struct writer *writer)
+    //@ requires emp;
+    //@ ensures outbox(result, writer);
+{
+    struct outbox *outbox = malloc(sizeof(struct outbox));
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (outbox == 0 || sentinel == 0) {
+        abort();
+    }
+    outbox->first = sentinel;
+    outbox->last = sentinel;
+    outbox->count = 0;
+    outbox->closed = false;
+    outbox->writer = writer;
+    struct mutex *mutex = create_mutex();
+    outbox->mutex = mutex;
+    outbox->changed = create_mutex_cond();
+    return outbox;
+}
+
+/*
+Appends a reference to a message to the outbox. When the queue is full or the outbox is closed,
+the reference is dropped instead, so a slow member never makes the sender wait.
+*/
+void outbox_push(struct outbox *outbox, struct message *message)
+    //@ requires [?f]outbox(outbox, ?writer) &*& message_ref(message, _);
+    //@ ensures [f]outbox(outbox, writer);
+{
+    struct outbox_entry *sentinel = malloc(sizeof(struct outbox_entry));
+    if (sentinel == 0) {
+        abort();
+    }
+    mutex_acquire(outbox->mutex);
+    if (outbox->closed || outbox->count == OUTBOX_CAPACITY) {
+        mutex_release(outbox->mutex);
+        free(sentinel);
+        message_release(message);
+    } else {
+        struct outbox_entry *last = outbox->last;
+        last->message = message;
+        last->next = sentinel;
+        outbox->last = sentinel;
+        outbox->count = outbox->count + 1;
+        mutex_cond_signal(outbox->changed);
+        mutex_release(outbox->mutex);
+    }
+}
+
+/*
+Waits for the next message in the outbox and removes it from the queue.
+Returns 0 once the outbox is closed and every queued message has been taken.
+*/
+struct message *outbox_pop(struct outbox *outbox)
+    //@ requires [?f]outbox(outbox, ?writer);
+    //@ ensures [f]outbox(outbox, writer);
+{
+    struct message *message = 0;
+    mutex_acquire(outbox->mutex);
+    while (outbox->count == 0 && !outbox->closed)
+    {
+        mutex_cond_wait(outbox->changed, outbox->mutex);
+    }
+    if (outbox->count != 0) {
+        struct outbox_entry *first = outbox->first;
+        message = first->message;
+        outbox->first = first->next;
+        outbox->count = outbox->count - 1;
+        free(first);
+    }
+    mutex_release(outbox->mutex);
+    return message;
+}
+
+/*
+Marks the outbox as closed. Messages that are already queued are still delivered.
+*/
+void outbox_close(struct outbox *outbox)
+    //@ requires [?f]outbox(outbox, ?writer);
+    //@ ensures [f]outbox(outbox, writer);
+{
+    mutex_acquire(outbox->mutex);
+    outbox->closed = true;
+    mutex_cond_signal(outbox->changed);
+    mutex_release(outbox->mutex);
+}
+
+void outbox_dispose(struct outbox *outbox)
+    //@ requires outbox(outbox, ?writer);
+    //@ ensures emp;
+{
+    mutex_cond_dispose(outbox->changed);
+    mutex_dispose(outbox->mutex);
+    struct outbox_entry *iter = outbox->first;
+    while (iter != outbox->last)
+    {
+        struct outbox_entry *next = iter->next;
+        message_release(iter->message);
+        free(iter);
+        iter = next;
+    }
+    free(outbox->last);
+    free(outbox);
+}
+
+/*@
+
+predicate_family_instance thread_run_pre(outbox_drain)(void *data, any info) =
+    [1/2]outbox(data, ?writer) &*& writer(writer);
+predicate_family_instance thread_run_post(outbox_drain)(void *data, any info) =
+    [1/2]outbox(data, ?writer) &*& writer(writer);
+@*/
+
+/*
+The writer thread of a member. It sends the queued messages to the member's socket, one line each,
+until the outbox is closed and empty.
+*/
+void outbox_drain(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(outbox_drain)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(outbox_drain)(data, info) &*& lockset(currentThread, nil);
+{
+    struct outbox *outbox = data;
+    struct writer *writer = outbox->writer;
+    struct message *message = outbox_pop(outbox);
+    while (message != 0)
+    {
+        writer_write_line(writer, message->prefix, message->body);
+        message_release(message);
+        message = outbox_pop(outbox);
+    }
+}
+
+struct member {
+    struct member *next;
+    struct member *prev;
+    struct member *bucket_next;
+    unsigned int nick_hash;
+    struct string_buffer *nick;
+    struct outbox *outbox;
+};
+
+/*@
+
+// A member is reachable both from the member list and from the nick index. The list owns the outbox
+// and half of the nick and its hash; the index chain the member is on owns the other halves.
+predicate member(struct member* member) =
+    [1/2]member->nick |-> ?nick &*& [1/2]member->nick_hash |-> _ &*& member->outbox |-> ?outbox &*&
+    [1/2]string_buffer(nick, _) &*& [1/2]outbox(outbox, _) &*& malloc_block_member(member);
+
+predicate nick_entry(struct member *member; unsigned int hash) =
+    [1/2]member->nick |-> ?nick &*& [1/2]member->nick_hash |-> hash &*& [1/2]string_buffer(nick, _);
+
+predicate nick_bucket(struct member *first, int index, int bucketCount; list<void *> ms) =
+    first == 0 ?
+        ms == nil
+    :
+        first->bucket_next |-> ?next &*& nick_entry(first, ?hash) &*& hash % bucketCount == index &*&
+        nick_bucket(next, index, bucketCount, ?ms0) &*& ms == cons(first, ms0);
+
+predicate nick_buckets(struct member **buckets, int index, int end, int bucketCount; list<void *> ms) =
+    index == end ?
+        ms == nil
+    :
+        pointer((void *)(buckets + index), ?first) &*& nick_bucket(first, index, bucketCount, ?ms0) &*&
+        nick_buckets(buckets, index + 1, end, bucketCount, ?ms1) &*& ms == append(ms0, ms1);
+
+// The nick index of a room holds exactly the members of the given member list.
+predicate nick_index(struct room *room; list<void *> members) =
+    room->nick_buckets |-> ?buckets &*& room->nick_bucket_count |-> ?bucketCount &*& room->member_count |-> length(members) &*&
+    0 < bucketCount &*& nick_buckets(buckets, 0, bucketCount, bucketCount, ?indexed) &*& malloc_block_pointers(buckets, bucketCount) &*&
+    length(indexed) == length(members);
+@*/
+
+struct room {
+    struct member *members;
+    struct member **nick_buckets;
+    int nick_bucket_count;
+    int member_count;
+    struct mutex *message_refs;
+    //@ int ghost_list_id;
+};
+
+/*@
+predicate room(struct room* room) =
+    room->members |-> ?membersList &*& [?f]room->ghost_list_id |-> ?id &*&
+    dlseg(membersList, 0, 0, _, ?members, member) &*&
+    ghost_list(id, members) &*& nick_index(room, members) &*&
+    room->message_refs |-> ?refs &*& [_]mutex(refs, live_messages(_)) &*& malloc_block_room(room);
+@*/
+
+/*
+Hashes a nick (FNV-1a). Only the index uses the hash, so it does not need to be stable across runs.
+*/
+unsigned int nick_hash(struct string_buffer *nick)
+    //@ requires [?f]string_buffer(nick, ?cs);
+    //@ ensures [f]string_buffer(nick, cs);
+{
+    int length = string_buffer_get_length(nick);
+    char *chars = string_buffer_get_chars(nick);
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)chars[i]) * 16777619u;
+    }
+    return hash;
+}
+
+struct member **create_nick_buckets(int bucketCount)
+    //@ requires 0 < bucketCount;
+    //@ ensures nick_buckets(result, 0, bucketCount, bucketCount, nil) &*& malloc_block_pointers(result, bucketCount);
+{
+    struct member **buckets = malloc((unsigned int)bucketCount * sizeof(struct member *));
+    if (buckets == 0) {
+        abort();
+    }
+    for (int i = bucketCount; 0 < i; i--)
+    {
+        buckets[i - 1] = 0;
+    }
+    return buckets;
+}
+
+/*
+Links a member into the chain of its bucket.
+*/
+void nick_buckets_insert(struct member **buckets, int bucketCount, struct member *member)
+    /*@
+    requires
+        nick_buckets(buckets, 0, bucketCount, bucketCount, ?ms) &*& 0 < bucketCount &*&
+        member->bucket_next |-> _ &*& nick_entry(member, _);
+    @*/
+    //@ ensures nick_buckets(buckets, 0, bucketCount, bucketCount, ?ms1) &*& length(ms1) == length(ms) + 1;
+{
+    int index = (int)(member->nick_hash % (unsigned int)bucketCount);
+    member->bucket_next = buckets[index];
+    buckets[index] = member;
+}
+
+/*
+Unlinks a member from a chain and returns the new first member of the chain.
+*/
+struct member *nick_bucket_remove(struct member *first, struct member *member)
+    //@ requires nick_bucket(first, ?index, ?bucketCount, ?ms) &*& mem((void *)member, ms) == true;
+    //@ ensures nick_bucket(result, index, bucketCount, remove((void *)member, ms)) &*& member->bucket_next |-> _ &*& nick_entry(member, _);
+{
+    if (first == member) {
+        return first->bucket_next;
+    } else {
+        struct member *next = nick_bucket_remove(first->bucket_next, member);
+        first->bucket_next = next;
+        return first;
+    }
+}
+
+bool nick_bucket_contains(struct member *first, unsigned int hash, struct string_buffer *nick)
+    //@ requires [?f]nick_bucket(first, ?index, ?bucketCount, ?ms) &*& [?f0]string_buffer(nick, ?cs);
+    //@ ensures [f]nick_bucket(first, index, bucketCount, ms) &*& [f0]string_buffer(nick, cs);
+{
+    bool found = false;
+    if (first != 0) {
+        found = first->nick_hash == hash && string_buffer_equals(first->nick, nick);
+        if (!found) {
+            found = nick_bucket_contains(first->bucket_next, hash, nick);
+        }
+    }
+    return found;
+}
+
+/*
+Doubles the number of buckets of the nick index and moves every member to its new chain.
+*/
+void room_grow_nick_index(struct room *room)
+    //@ requires nick_index(room, ?members);
+    //@ ensures nick_index(room, members);
+{
+    int oldCount = room->nick_bucket_count;
+    struct member **oldBuckets = room->nick_buckets;
+    int newCount = oldCount * 2;
+    struct member **newBuckets = create_nick_buckets(newCount);
+    for (int i = 0; i < oldCount; i++)
+    {
+        struct member *iter = oldBuckets[i];
+        while (iter != 0)
+        {
+            struct member *next = iter->bucket_next;
+            nick_buckets_insert(newBuckets, newCount, iter);
+            iter = next;
+        }
+    }
+    free(oldBuckets);
+    room->nick_buckets = newBuckets;
+    room->nick_bucket_count = newCount;
+}
+
+/*
+Adds a member to the nick index of the room, growing the index first if it holds as many members as buckets.
+*/
+void room_index_member(struct room *room, struct member *member)
+    //@ requires nick_index(room, ?members) &*& member->bucket_next |-> _ &*& nick_entry(member, _);
+    //@ ensures nick_index(room, members);
+{
+    if (room->member_count == room->nick_bucket_count) {
+        room_grow_nick_index(room);
+    }
+    nick_buckets_insert(room->nick_buckets, room->nick_bucket_count, member);
+    room->member_count = room->member_count + 1;
+}
+
+/*
+Removes a member from the nick index of the room. Only the member's own chain is walked.
+*/
+void room_unindex_member(struct room *room, struct member *member)
+    //@ requires nick_index(room, ?members) &*& mem((void *)member, members) == true &*& [1/2]member->nick_hash |-> ?hash;
+    //@ ensures nick_index(room, remove((void *)member, members)) &*& member->bucket_next |-> _ &*& nick_entry(member, _) &*& [1/2]member->nick_hash |-> hash;
+{
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(member->nick_hash % (unsigned int)room->nick_bucket_count);
+    buckets[index] = nick_bucket_remove(buckets[index], member);
+    room->member_count = room->member_count - 1;
+}
+
+struct room *create_room()
+    //@ requires emp;
+    //@ ensures room(result);
+{
+    struct room *room = 0;
+    room = malloc(sizeof(struct room));
+    if (room == 0) {
+        abort();
+    }
+    room->members = 0;
+    room->nick_buckets = create_nick_buckets(NICK_BUCKETS_INITIAL);
+    room->nick_bucket_count = NICK_BUCKETS_INITIAL;
+    room->member_count = 0;
+    room->message_refs = create_mutex();
+    return room;
+}
+
+/*
+Looks the nick up in the nick index, so the cost does not depend on the number of members.
+*/
+bool room_has_member(struct room *room, struct string_buffer *nick)
+    //@ requires [?f]room(room) &*& string_buffer(nick, _);
+    //@ ensures [f]room(room) &*& string_buffer(nick, _);
+{
+    unsigned int hash = nick_hash(nick);
+    struct member **buckets = room->nick_buckets;
+    int index = (int)(hash % (unsigned int)room->nick_bucket_count);
+    bool hasMember = nick_bucket_contains(buckets[index], hash, nick);
+    return hasMember;
+}
+
+/*
+Sends the line made of prefix followed by body to every member, taking ownership of both buffers.
+The message is built once and a reference to it is queued on the outbox of every member, so holding
+the room lock costs neither a copy nor a socket write per member. Only a fraction of the room is
+needed, so sessions holding the room lock for reading can broadcast at the same time.
+*/
+void room_broadcast_message(struct room *room, struct string_buffer *prefix, struct string_buffer *body)
+    //@ requires [?f]room(room) &*& string_buffer(prefix, ?prefixChars) &*& string_buffer(body, ?bodyChars);
+    //@ ensures [f]room(room);
+{
+    struct member *iter = room->members;
+    int count = 0;
+    while (iter != 0)
+    {
+        count = count + 1;
+        iter = *(void **)(void *)iter;
+    }
+    if (count == 0) {
+        string_buffer_dispose(prefix);
+        string_buffer_dispose(body);
+    } else {
+        struct message *message = create_message(room->message_refs, prefix, body, count);
+        iter = room->members;
+        while (iter != 0)
+        {
+            outbox_push(iter->outbox, message);
+            iter = *(void **)(void *)iter;
+        }
+    }
+}
+
+struct session {
+    struct room *room;
+    struct rwlock *room_lock;
+    struct socket *socket;
+};
+
+/*@
+
+// The room lock protects the member list. Through member(), it also holds half of each member's
+// outbox: enough to push messages, while the other half and the socket writer belong to the
+// member's writer thread. The queued messages themselves are owned by each outbox's own mutex.
+// Joining and leaving hold the room lock for writing; listing the members and broadcasting a
+// message only read the member list, so they hold it for reading and run concurrently. Two
+// messages broadcast at the same time may reach different members in different orders, but the
+// messages of one member always arrive in the order they were sent.
+predicate_ctor room_ctor(struct room *room)() =
+    room(room);
+
+predicate session(struct session *session) =
+    session->room |-> ?room &*& session->room_lock |-> ?roomLock &*& session->socket |-> ?socket &*& malloc_block_session(session)
+        &*& [_]rwlock(roomLock, _, room_ctor(room)) &*& socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+@*/
+
+
+struct session *create_session(struct room *room, struct rwlock *roomLock, struct socket *socket)
+    //@ requires [_]rwlock(roomLock, _, room_ctor(room)) &*& socket(socket, ?reader, ?writer) &*& reader(reader) &*& writer(writer);
+    //@ ensures session(result);
+{
+    struct session *session = malloc(sizeof(struct session));
+    if (session == 0) {
+        abort();
+    }
+    session->room = room;
+    session->room_lock = roomLock;
+    session->socket = socket;
+    return session;
+}
+
+void session_run_with_nick(struct room *room, struct rwlock *roomLock, struct reader *reader, struct writer *writer, struct string_buffer *nick)
+    /*@
+    requires
+        rwlock_write_locked(roomLock, ?roomLockId, room_ctor(room), currentThread, _) &*& lockset(currentThread, cons(roomLockId, nil)) &*&
+        room(room) &*& reader(reader) &*& writer(writer) &*& string_buffer(nick, _);
+    @*/
+    /*@
+    ensures
+        [_]rwlock(roomLock, roomLockId, room_ctor(room)) &*& lockset(currentThread, nil) &*&
+        reader(reader) &*& writer(writer) &*& string_buffer(nick, _);
+    @*/
+{
+    struct member *member = 0;
+    struct outbox *outbox = 0;
+    struct thread *drain = 0;
+
+    {
+        struct string_buffer *joinPrefix = string_buffer_copy(nick);
+        struct string_buffer *joinBody = create_string_buffer();
+        string_buffer_append_string(joinBody, " has joined the room.");
+        room_broadcast_message(room, joinPrefix, joinBody);
+    }
+
+    {
+        struct string_buffer *nickCopy = string_buffer_copy(nick);
+        outbox = create_outbox(writer);
+        drain = thread_start_joinable(outbox_drain, outbox);
+        member = malloc(sizeof(struct member));
+        if (member == 0) {
+            abort();
+        }
+        member->nick = nickCopy;
+        member->nick_hash = nick_hash(nickCopy);
+        member->outbox = outbox;
+        dlseg_push_front(&room->members, member);
+        room_index_member(room, member);
+    }
+
+    rwlock_release_write(roomLock);
+
+    {
+        bool eof = false;
+        struct string_buffer *message = create_string_buffer();
+        while (!eof)
+        {
+            eof = reader_read_line(reader, message);
+            if (eof) {
+            } else {
+                struct string_buffer *prefix = string_buffer_copy(nick);
+                string_buffer_append_string(prefix, " says: ");
+                rwlock_acquire_read(roomLock);
+                room_broadcast_message(room, prefix, message);
+                rwlock_release_read(roomLock);
+                message = create_string_buffer();
+            }
+        }
+        string_buffer_dispose(message);
+    }
+
+    rwlock_acquire_write(roomLock);
+    {
+        dlseg_remove(&room->members, member);
+    }
+    room_unindex_member(room, member);
+    {
+        struct string_buffer *goodbyePrefix = string_buffer_copy(nick);
+        struct string_buffer *goodbyeBody = create_string_buffer();
+        string_buffer_append_string(goodbyeBody, " left the room.");
+        room_broadcast_message(room, goodbyePrefix, goodbyeBody);
+    }
+    rwlock_release_write(roomLock);
+
+    outbox_close(member->outbox);
+    thread_join(drain);
+    outbox_dispose(outbox);
+    string_buffer_dispose(member->nick);
+    free(member);
+}
+
+/*@
+
+predicate_family_instance thread_run_data(session_run)(void *data) = session(data);
+@*/
+
+
+
+void session_run(void *data) //@ : thread_run
+    //@ requires thread_run_data(session_run)(data) &*& lockset(currentThread, nil);
+    //@ ensures lockset(currentThread, nil);
+{
+    struct session *session = data;
+    struct room *room = session->room;
+    struct rwlock *roomLock = session->room_lock;
+    struct socket *socket = session->socket;
+    struct writer *writer = socket_get_writer(socket);
+    struct reader *reader = socket_get_reader(socket);
+    free(session);
+
+    writer_write_string(writer, "Welcome to the chat room.\r\n");
+    writer_write_string(writer, "The following members are present:\r\n");
+
+    // Copy the nicks while holding the read lock and write them after releasing it. Waiting writers take precedence
+    // over new readers, so a client that does not read its greeting would otherwise hold off every join and leave,
+    // and every broadcast behind them.
+    struct string_buffer *members = create_string_buffer();
+    rwlock_acquire_read(roomLock);
+    {
+        struct member *iter = room->members;
+        while (iter != 0)
+        {
+            string_buffer_append_string_buffer(members, iter->nick);
+            string_buffer_append_string(members, "\r\n");
+            iter = *(void **)(void *)iter;
+        }
+    }
+    rwlock_release_read(roomLock);
+    writer_write_string_buffer(writer, members);
+    string_buffer_dispose(members);
+
+    {
+        struct string_buffer *nick = create_string_buffer();
+        bool done = false;
+        while (!done)
+        {
+            writer_write_string(writer, "Please enter your nick: ");
+            {
+                bool eof = reader_read_line(reader, nick);
+                if (eof) {
+                    done = true;
+                } else {
+                    rwlock_acquire_write(roomLock);
+                    {
+                        bool hasMember = room_has_member(room, nick);
+                        if (hasMember) {
+                            rwlock_release_write(roomLock);
+                            writer_write_string(writer, "Error: This nick is already in use.\r\n");
+                        } else {
+                            session_run_with_nick(room, roomLock, reader, writer, nick);
+                            done = true;
+                        }
+                    }
+                }
+            }
+        }
+        string_buffer_dispose(nick);
+    }
+
+    socket_close(socket);
+}
+
+int main() //@ : main
+    //@ requires true;
+    //@ ensures false;
+{
+    struct room *room = create_room();
+    struct rwlock *roomLock = create_rwlock();
+    struct server_socket *serverSocket = create_server_socket(12345);
+
+    for (;;)
+    {
+        struct socket *socket = server_socket_accept(serverSocket);
+        struct session *session = create_session(room, roomLock, socket);
+        thread_start(session_run, session);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef DLISTS_H
+#define DLISTS_H
+
+// Intrusive doubly linked lists. A node is any structure whose first two fields point to the next and
+// to the previous node; the list itself is a pointer to its first node. Unlike lseg_remove in lists.h,
+// dlseg_remove does not need to search for the predecessor of the node it removes.
+
+/*@
+
+// A segment from first up to, but not including, last. prev is the node before first and lastPrev
+// the last node of the segment (or prev if the segment is empty).
+predicate dlseg(void *first, void *prev, void *last, void *lastPrev, list<void *> xs, predicate(void *) p) =
+    first == last ?
+        prev == lastPrev &*& xs == nil
+    :
+        pointer(first, ?next) &*& pointer((void **)first + 1, prev) &*& p(first) &*&
+        dlseg(next, first, last, lastPrev, ?xs0, p) &*& xs == cons(first, xs0);
+
+lemma void dlseg_add(void *first);
+    requires
+        dlseg(first, ?prev, ?last, ?lastPrev, ?xs0, ?p) &*& pointer(last, ?next) &*& pointer((void **)last + 1, lastPrev) &*& p(last) &*&
+        dlseg(next, last, 0, ?tail, ?xs1, p);
+    ensures
+        dlseg(first, prev, next, last, append(xs0, cons(last, nil)), p) &*& dlseg(next, last, 0, tail, xs1, p) &*&
+        append(xs0, cons(last, xs1)) == append(append(xs0, cons(last, nil)), xs1);
+
+lemma void dlseg_append(void *first);
+    requires dlseg(first, ?prev, ?last, ?lastPrev, ?xs0, ?p) &*& dlseg(last, lastPrev, 0, ?tail, ?xs1, p);
+    ensures dlseg(first, prev, 0, tail, append(xs0, xs1), p);
+
+lemma void dlseg_split(void *first, void *element);
+    requires dlseg(first, ?prev, 0, ?tail, ?xs, ?p) &*& mem(element, xs) == true;
+    ensures
+        dlseg(first, prev, element, ?elementPrev, ?xs0, p) &*& pointer(element, ?next) &*& pointer((void **)element + 1, elementPrev) &*&
+        p(element) &*& dlseg(next, element, 0, tail, ?xs1, p) &*& xs == append(xs0, cons(element, xs1)) &*& !mem(element, xs0);
+
+lemma void dlseg_take_last(void *first);
+    requires dlseg(first, ?prev, ?last, ?lastPrev, ?xs, ?p) &*& first != last;
+    ensures
+        dlseg(first, prev, lastPrev, ?lastPrevPrev, ?xs0, p) &*& pointer(lastPrev, last) &*& pointer((void **)lastPrev + 1, lastPrevPrev) &*&
+        p(lastPrev) &*& xs == append(xs0, cons(lastPrev, nil));
+
+@*/
+
+void dlseg_push_front(void *phead, void *element);
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& pointer(element, _) &*& pointer((void **)element + 1, _) &*& p(element);
+    //@ ensures pointer(phead, element) &*& dlseg(element, 0, 0, ?tail1, cons(element, xs), p);
+
+void dlseg_remove(void *phead, void *element);
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& mem(element, xs) == true;
+    //@ ensures pointer(phead, ?head1) &*& dlseg(head1, 0, 0, ?tail1, remove(element, xs), p) &*& pointer(element, _) &*& pointer((void **)element + 1, _) &*& p(element);
+
+#endif
@@ -0,0 +1,218 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "threading.h"
+
+#define PIPE_BUFFER_SIZE (128 * 1024)
+
+#define SLOT_EMPTY 0
+#define SLOT_FILLING 1
+#define SLOT_FULL 2
+#define SLOT_DRAINING 3
+
+struct slot {
+  int count;
+  int state;
+  char data[PIPE_BUFFER_SIZE];
+};
+
+struct pipeline {
+  struct mutex *mutex;
+  struct mutex_cond *slot_filled;
+  struct mutex_cond *slot_emptied;
+  struct slot *first;
+  struct slot *second;
+  FILE *from;
+  bool failed;
+};
+
+/***
+ * Description:
+The `write_all` function writes the first `count` bytes of `buffer` to the given file.
+After a short write it retries with the bytes that were not written yet.
+
+@param to - the file to write to.
+@param buffer - the bytes to write, which are only read.
+@param count - the non-negative number of bytes to write.
+
+It returns 0 on success and -1 if a write made no progress.
+*/
+int write_all(FILE* to, char* buffer, int count)
+{
+  int nb_written = 0;
+  while(nb_written < count)
+  {
+    int n = fwrite(buffer + nb_written, 1, (size_t)(count - nb_written), to);
+    if(n == 0) {
+      return -1;
+    }
+    nb_written = nb_written + n;
+  }
+  return 0;
+}
+
+/***
+ * Description:
+The `pipeline_reader` function is the body of the reader thread. It fills the two slots of the pipeline in turn:
+it waits until a slot is EMPTY, marks it FILLING, reads into its buffer without holding the mutex,
+and then publishes it as FULL and signals `slot_filled`.
+A FULL slot with count 0 marks the end of the input.
+
+@param data - a pointer to the pipeline, shared with the writer.
+
+It requires: the mutex, the condition variables and the two slots of the pipeline are initialized,
+and the thread owns the input file `from`.
+It ensures: the thread stops after publishing the end-of-input slot, or as soon as the writer reports a failure through `failed`,
+and it gives back the input file.
+*/
+void pipeline_reader(void *data)
+{
+  struct pipeline *p = data;
+  struct slot *s = p->first;
+  bool done = false;
+  while(!done)
+  {
+    mutex_acquire(p->mutex);
+    while(s->state != SLOT_EMPTY && !p->failed)
+    {
+      mutex_cond_wait(p->slot_emptied, p->mutex);
+    }
+    if(p->failed) {
+      mutex_release(p->mutex);
+      done = true;
+    } else {
+      s->state = SLOT_FILLING;
+      mutex_release(p->mutex);
+      int count = fread(s->data, 1, PIPE_BUFFER_SIZE, p->from);
+      mutex_acquire(p->mutex);
+      s->count = count;
+      s->state = SLOT_FULL;
+      mutex_cond_signal(p->slot_filled);
+      mutex_release(p->mutex);
+      done = count == 0;
+      s = s == p->first ? p->second : p->first;
+    }
+  }
+}
+
+/***
+ * Description:
+The `pipeline_writer` function is the writer side of the pipeline and is run by the main thread.
+It drains the two slots in the same order as the reader fills them: it waits until a slot is FULL, marks it DRAINING,
+writes its buffer without holding the mutex, and then marks it EMPTY again and signals `slot_emptied`.
+
+@param p - the pipeline, shared with the reader thread.
+@param to - the file to write to.
+
+It returns 0 once the end-of-input slot was reached and -1 if a write failed,
+in which case it sets `failed` so that the reader stops too.
+*/
+int pipeline_writer(struct pipeline *p, FILE* to)
+{
+  struct slot *s = p->first;
+  int status = 0;
+  bool done = false;
+  while(!done)
+  {
+    mutex_acquire(p->mutex);
+    while(s->state != SLOT_FULL)
+    {
+      mutex_cond_wait(p->slot_filled, p->mutex);
+    }
+    int count = s->count;
+    if(count == 0) {
+      mutex_release(p->mutex);
+      done = true;
+    } else {
+      s->state = SLOT_DRAINING;
+      mutex_release(p->mutex);
+      status = write_all(to, s->data, count);
+      mutex_acquire(p->mutex);
+      s->state = SLOT_EMPTY;
+      if(status != 0) {
+        p->failed = true;
+        done = true;
+      }
+      mutex_cond_signal(p->slot_emptied);
+      mutex_release(p->mutex);
+      s = s == p->first ? p->second : p->first;
+    }
+  }
+  return status;
+}
+
+/***
+ * Description:
+The `create_slot` function allocates a slot with its own buffer of PIPE_BUFFER_SIZE bytes.
+It aborts if the allocation fails.
+
+It ensures: the returned slot is EMPTY and holds no data.
+*/
+struct slot *create_slot()
+{
+  struct slot *s = malloc(sizeof(struct slot));
+  if(s == 0) { abort(); }
+  s->count = 0;
+  s->state = SLOT_EMPTY;
+  return s;
+}
+
+/***
+ * Description:
+The `dispose_slot` function frees a slot together with its buffer.
+
+@param s - the slot to free.
+
+It requires: no thread is filling or draining the slot; otherwise the function aborts.
+*/
+void dispose_slot(struct slot *s)
+{
+  if(s->state != SLOT_EMPTY && s->state != SLOT_FULL) { abort(); }
+  free(s);
+}
+
+/***
+ * Description:
+The `main` function copies the file named by the first argument to the file named by the second argument.
+A reader thread fills one buffer while the main thread writes the other one, so reads and writes overlap.
+
+@param argc - the number of command-line arguments.
+@param argv - the command-line arguments.
+
+It returns 0 on success and -1 if there are not enough arguments or a write failed.
+*/
+int main(int argc, char** argv)
+{
+  FILE* from = 0; FILE* to = 0; int status = 0;
+  if(argc < 3) { puts("Not enough parameters."); return -1; }
+  from = fopen(argv[1], "r");
+  to = fopen(argv[2], "w");
+  if(from == 0 || to == 0) { abort(); }
+
+  struct pipeline *p = malloc(sizeof(struct pipeline));
+  if(p == 0) { abort(); }
+  struct slot *first = create_slot();
+  struct slot *second = create_slot();
+  p->first = first;
+  p->second = second;
+  p->from = from;
+  p->failed = false;
+  struct mutex *mutex = create_mutex();
+  p->mutex = mutex;
+  p->slot_filled = create_mutex_cond();
+  p->slot_emptied = create_mutex_cond();
+
+  struct thread *reader = thread_start_joinable(pipeline_reader, p);
+  status = pipeline_writer(p, to);
+  thread_join(reader);
+
+  mutex_cond_dispose(p->slot_filled);
+  mutex_cond_dispose(p->slot_emptied);
+  mutex_dispose(p->mutex);
+  dispose_slot(first);
+  dispose_slot(second);
+  free(p);
+  fclose(from);
+  fclose(to);
+  return status;
+}
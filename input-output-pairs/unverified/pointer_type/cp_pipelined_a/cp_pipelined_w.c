@@ -0,0 +1,220 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include <stdbool.h>
+#include "threading.h"
+
+#define PIPE_BUFFER_SIZE (128 * 1024)
+
+#define SLOT_EMPTY 0
+#define SLOT_FILLING 1
+#define SLOT_FULL 2
+#define SLOT_DRAINING 3
+
+struct slot {
+  int count;
+  int state;
+  char data[PIPE_BUFFER_SIZE];
+};
+
+struct pipeline {
+  struct mutex *mutex;
+  struct mutex_cond *slot_filled;
+  struct mutex_cond *slot_emptied;
+  struct slot *first;
+  struct slot *second;
+  FILE *from;
+  bool failed;
+};
+
+/*@
+
+// A slot's buffer belongs to the mutex while the slot is EMPTY or FULL. The thread that moves it to
+// FILLING (the reader) or DRAINING (the writer) takes the buffer together with the other half of the
+// state field, so it is the only one that can move the slot on.
+predicate slot_buffer(struct slot *s, int state, int count) =
+  state == SLOT_EMPTY ?
+    [1/2]s->state |-> state &*& chars_(s->data, PIPE_BUFFER_SIZE, _)
+  : state == SLOT_FULL ?
+    [1/2]s->state |-> state &*& chars(s->data, count, _) &*& chars_(s->data + count, PIPE_BUFFER_SIZE - count, _)
+  :
+    state == SLOT_FILLING || state == SLOT_DRAINING;
+
+predicate slot(struct slot *s) =
+  [1/2]s->state |-> ?state &*& s->count |-> ?count &*& 0 <= count &*& count <= PIPE_BUFFER_SIZE &*& slot_buffer(s, state, count);
+
+predicate_ctor pipeline_inv(struct pipeline *p, struct slot *first, struct slot *second)() =
+  p->failed |-> _ &*& slot(first) &*& slot(second);
+
+predicate pipeline_share(struct pipeline *p, real f; struct mutex *mutex, struct slot *first, struct slot *second) =
+  [f]p->mutex |-> mutex &*& [f]p->slot_filled |-> ?filled &*& [f]p->slot_emptied |-> ?emptied &*&
+  [f]p->first |-> first &*& [f]p->second |-> second &*& first != second &*&
+  [f]mutex(mutex, pipeline_inv(p, first, second)) &*& [f]mutex_cond(filled, mutex) &*& [f]mutex_cond(emptied, mutex);
+
+predicate_family_instance thread_run_pre(pipeline_reader)(void *data, any info) =
+  pipeline_share(data, 1/2, _, _, _) &*& ((struct pipeline *)data)->from |-> ?from &*& file(from);
+predicate_family_instance thread_run_post(pipeline_reader)(void *data, any info) =
+  pipeline_share(data, 1/2, _, _, _) &*& ((struct pipeline *)data)->from |-> ?from &*& file(from);
+@*/
+
+/*
+Writes the first count bytes of buffer to the given file, retrying after short writes.
+Returns 0 on success and -1 if a write made no progress.
+*/
+int write_all(FILE* to, char* buffer, int count)
+//@ requires [?f]file(to) &*& [?fb]buffer[..count] |-> ?cs &*& 0 <= count;
+//@ ensures [f]file(to) &*& [fb]buffer[..count] |-> _;
+{
+  int nb_written = 0;
+  while(nb_written < count)
+  {
+    int n = fwrite(buffer + nb_written, 1, (size_t)(count - nb_written), to);
+    if(n == 0) {
+      return -1;
+    }
+    nb_written = nb_written + n;
+  }
+  return 0;
+}
+
+/*
+The reader thread. It fills the two slots in turn and publishes each one as FULL.
+A FULL slot with count 0 marks the end of the input. The reader stops early when the writer reports a failure.
+*/
+void pipeline_reader(void *data) //@ : thread_run_joinable
+//@ requires thread_run_pre(pipeline_reader)(data, ?info) &*& lockset(currentThread, nil);
+//@ ensures thread_run_post(pipeline_reader)(data, info) &*& lockset(currentThread, nil);
+{
+  struct pipeline *p = data;
+  struct slot *s = p->first;
+  bool done = false;
+  while(!done)
+  {
+    mutex_acquire(p->mutex);
+    while(s->state != SLOT_EMPTY && !p->failed)
+    {
+      mutex_cond_wait(p->slot_emptied, p->mutex);
+    }
+    if(p->failed) {
+      mutex_release(p->mutex);
+      done = true;
+    } else {
+      s->state = SLOT_FILLING;
+      mutex_release(p->mutex);
+      int count = fread(s->data, 1, PIPE_BUFFER_SIZE, p->from);
+      mutex_acquire(p->mutex);
+      s->count = count;
+      s->state = SLOT_FULL;
+      mutex_cond_signal(p->slot_filled);
+      mutex_release(p->mutex);
+      done = count == 0;
+      s = s == p->first ? p->second : p->first;
+    }
+  }
+}
+
+/*
+The writer side, run by the main thread. It drains the two slots in the same order as the reader fills them.
+Returns 0 once the end-of-input slot was reached and -1 if a write failed.
+*/
+int pipeline_writer(struct pipeline *p, FILE* to)
+//@ requires pipeline_share(p, 1/2, ?mutex, ?first, ?second) &*& [?ft]file(to);
+//@ ensures pipeline_share(p, 1/2, mutex, first, second) &*& [ft]file(to);
+{
+  struct slot *s = p->first;
+  int status = 0;
+  bool done = false;
+  while(!done)
+  {
+    mutex_acquire(p->mutex);
+    while(s->state != SLOT_FULL)
+    {
+      mutex_cond_wait(p->slot_filled, p->mutex);
+    }
+    int count = s->count;
+    if(count == 0) {
+      mutex_release(p->mutex);
+      done = true;
+    } else {
+      s->state = SLOT_DRAINING;
+      mutex_release(p->mutex);
+      status = write_all(to, s->data, count);
+      mutex_acquire(p->mutex);
+      s->state = SLOT_EMPTY;
+      if(status != 0) {
+        p->failed = true;
+        done = true;
+      }
+      mutex_cond_signal(p->slot_emptied);
+      mutex_release(p->mutex);
+      s = s == p->first ? p->second : p->first;
+    }
+  }
+  return status;
+}
+
+/*
+Creates an empty slot with its own buffer.
+*/
+struct slot *create_slot()
+//@ requires true;
+//@ ensures slot(result) &*& malloc_block_slot(result);
+{
+  struct slot *s = malloc(sizeof(struct slot));
+  if(s == 0) { abort(); }
+  s->count = 0;
+  s->state = SLOT_EMPTY;
+  return s;
+}
+
+/*
+Frees a slot. Aborts if a thread is still filling or draining it.
+*/
+void dispose_slot(struct slot *s)
+//@ requires slot(s) &*& malloc_block_slot(s);
+//@ ensures true;
+{
+  if(s->state != SLOT_EMPTY && s->state != SLOT_FULL) { abort(); }
+  free(s);
+}
+
+/*
+Copies the file named by the first argument to the file named by the second argument.
+A reader thread fills one buffer while the main thread writes the other one, so reads and writes overlap.
+*/
+int main(int argc, char** argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+  FILE* from = 0; FILE* to = 0; int status = 0;
+  if(argc < 3) { puts("Not enough parameters."); return -1; }
+  from = fopen(argv[1], "r");
+  to = fopen(argv[2], "w");
+  if(from == 0 || to == 0) { abort(); }
+
+  struct pipeline *p = malloc(sizeof(struct pipeline));
+  if(p == 0) { abort(); }
+  struct slot *first = create_slot();
+  struct slot *second = create_slot();
+  p->first = first;
+  p->second = second;
+  p->from = from;
+  p->failed = false;
+  struct mutex *mutex = create_mutex();
+  p->mutex = mutex;
+  p->slot_filled = create_mutex_cond();
+  p->slot_emptied = create_mutex_cond();
+
+  struct thread *reader = thread_start_joinable(pipeline_reader, p);
+  status = pipeline_writer(p, to);
+  thread_join(reader);
+
+  mutex_cond_dispose(p->slot_filled);
+  mutex_cond_dispose(p->slot_emptied);
+  mutex_dispose(p->mutex);
+  dispose_slot(first);
+  dispose_slot(second);
+  free(p);
+  fclose(from);
+  fclose(to);
+  return status;
+}
@@ -0,0 +1,143 @@
+#include "stdlib.h"
+#include <stdbool.h>
+#include "dlists.h"
+
+/*@
+
+lemma void dlseg_add(void *first)
+    requires
+        dlseg(first, ?prev, ?last, ?lastPrev, ?xs0, ?p) &*& pointer(last, ?next) &*& pointer((void **)last + 1, lastPrev) &*& p(last) &*&
+        dlseg(next, last, 0, ?tail, ?xs1, p);
+    ensures
+        dlseg(first, prev, next, last, append(xs0, cons(last, nil)), p) &*& dlseg(next, last, 0, tail, xs1, p) &*&
+        append(xs0, cons(last, xs1)) == append(append(xs0, cons(last, nil)), xs1);
+{
+    open dlseg(first, prev, last, lastPrev, xs0, p);
+    if (first == last) {
+        if (next != 0) {
+            open dlseg(next, last, 0, tail, xs1, p);
+            pointer_distinct(last, next);
+            close dlseg(next, last, 0, tail, xs1, p);
+        }
+        close dlseg(next, last, next, last, nil, p);
+        close dlseg(last, prev, next, last, cons(last, nil), p);
+    } else {
+        assert pointer(first, ?firstNext);
+        dlseg_add(firstNext);
+        pointer_distinct(first, last);
+        if (next != 0) {
+            open dlseg(next, last, 0, tail, xs1, p);
+            pointer_distinct(first, next);
+            close dlseg(next, last, 0, tail, xs1, p);
+        }
+        close dlseg(first, prev, next, last, append(xs0, cons(last, nil)), p);
+    }
+    append_assoc(xs0, cons(last, nil), xs1);
+}
+
+lemma void dlseg_append(void *first)
+    requires dlseg(first, ?prev, ?last, ?lastPrev, ?xs0, ?p) &*& dlseg(last, lastPrev, 0, ?tail, ?xs1, p);
+    ensures dlseg(first, prev, 0, tail, append(xs0, xs1), p);
+{
+    open dlseg(first, prev, last, lastPrev, xs0, p);
+    if (first != last) {
+        assert pointer(first, ?next);
+        dlseg_append(next);
+        close dlseg(first, prev, 0, tail, append(xs0, xs1), p);
+    }
+}
+
+lemma void dlseg_split(void *first, void *element)
+    requires dlseg(first, ?prev, 0, ?tail, ?xs, ?p) &*& mem(element, xs) == true;
+    ensures
+        dlseg(first, prev, element, ?elementPrev, ?xs0, p) &*& pointer(element, ?next) &*& pointer((void **)element + 1, elementPrev) &*&
+        p(element) &*& dlseg(next, element, 0, tail, ?xs1, p) &*& xs == append(xs0, cons(element, xs1)) &*& !mem(element, xs0);
+{
+    open dlseg(first, prev, 0, tail, xs, p);
+    if (first == element) {
+        close dlseg(first, prev, first, prev, nil, p);
+    } else {
+        assert pointer(first, ?next);
+        dlseg_split(next, element);
+        close dlseg(first, prev, element, _, _, p);
+    }
+}
+
+lemma void dlseg_take_last(void *first)
+    requires dlseg(first, ?prev, ?last, ?lastPrev, ?xs, ?p) &*& first != last;
+    ensures
+        dlseg(first, prev, lastPrev, ?lastPrevPrev, ?xs0, p) &*& pointer(lastPrev, last) &*& pointer((void **)lastPrev + 1, lastPrevPrev) &*&
+        p(lastPrev) &*& xs == append(xs0, cons(lastPrev, nil));
+{
+    open dlseg(first, prev, last, lastPrev, xs, p);
+    assert pointer(first, ?next);
+    if (next == last) {
+        open dlseg(next, first, last, lastPrev, _, p);
+        close dlseg(first, prev, first, prev, nil, p);
+    } else {
+        dlseg_take_last(next);
+        pointer_distinct(first, lastPrev);
+        close dlseg(first, prev, lastPrev, _, _, p);
+    }
+}
+
+lemma void remove_append_not_mem(void *element, list<void *> xs0, list<void *> xs1)
+    requires !mem(element, xs0);
+    ensures remove(element, append(xs0, cons(element, xs1))) == append(xs0, xs1);
+{
+    switch (xs0) {
+        case nil:
+        case cons(x, xs00): remove_append_not_mem(element, xs00, xs1);
+    }
+}
+
+@*/
+
+void dlseg_push_front(void *phead, void *element)
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& pointer(element, _) &*& pointer((void **)element + 1, _) &*& p(element);
+    //@ ensures pointer(phead, element) &*& dlseg(element, 0, 0, ?tail1, cons(element, xs), p);
+{
+    void *head = *(void **)phead;
+    *(void **)element = head;
+    *((void **)element + 1) = 0;
+    //@ open dlseg(head, 0, 0, tail, xs, p);
+    if (head != 0) {
+        *((void **)head + 1) = element;
+        //@ close dlseg(head, element, 0, tail, xs, p);
+    }
+    //@ if (head == 0) close dlseg(0, element, 0, element, nil, p);
+    *(void **)phead = element;
+    //@ close dlseg(element, 0, 0, _, cons(element, xs), p);
+}
+
+void dlseg_remove(void *phead, void *element)
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& mem(element, xs) == true;
+    //@ ensures pointer(phead, ?head1) &*& dlseg(head1, 0, 0, ?tail1, remove(element, xs), p) &*& pointer(element, _) &*& pointer((void **)element + 1, _) &*& p(element);
+{
+    //@ dlseg_split(head, element);
+    void *next = *(void **)element;
+    void *prev = *((void **)element + 1);
+    //@ assert dlseg(head, 0, element, prev, ?xs0, p) &*& dlseg(next, element, 0, tail, ?xs1, p);
+    //@ open dlseg(next, element, 0, tail, xs1, p);
+    if (next != 0) {
+        *((void **)next + 1) = prev;
+        //@ close dlseg(next, prev, 0, tail, xs1, p);
+    }
+    //@ if (next == 0) close dlseg(0, prev, 0, prev, nil, p);
+    //@ remove_append_not_mem(element, xs0, xs1);
+    if (prev == 0) {
+        /*@
+        if (head != element) {
+            dlseg_take_last(head);
+            pointer_limits(0);
+        }
+        @*/
+        //@ open dlseg(head, 0, element, 0, xs0, p);
+        *(void **)phead = next;
+    } else {
+        //@ dlseg_take_last(head);
+        *(void **)prev = next;
+        //@ dlseg_add(head);
+        //@ dlseg_append(head);
+    }
+}
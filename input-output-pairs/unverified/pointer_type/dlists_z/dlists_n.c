@@ -0,0 +1,44 @@
+#include "stdlib.h"
+#include <stdbool.h>
+#include "dlists.h"
+
+/**
+ * Description:
+ * The dlseg_push_front function inserts a node at the front of an intrusive doubly linked list.
+ * The first two fields of the node are set to point to the old first node and to no previous node, and the old first node, if any, gets the new node as its previous node.
+ *
+ * @param phead A pointer to the variable that points to the first node of the list.
+ * @param element A pointer to the node to insert, which must not be in the list.
+ */
+void dlseg_push_front(void *phead, void *element)
+{
+    void *head = *(void **)phead;
+    *(void **)element = head;
+    *((void **)element + 1) = 0;
+    if (head != 0) {
+        *((void **)head + 1) = element;
+    }
+    *(void **)phead = element;
+}
+
+/**
+ * Description:
+ * The dlseg_remove function unlinks a node from an intrusive doubly linked list in constant time.
+ * The neighbours of the node are linked to each other, using the previous-node field of the node instead of searching the list for the predecessor; if the node was the first node, the list head is updated.
+ *
+ * @param phead A pointer to the variable that points to the first node of the list.
+ * @param element A pointer to the node to remove, which must be in the list.
+ */
+void dlseg_remove(void *phead, void *element)
+{
+    void *next = *(void **)element;
+    void *prev = *((void **)element + 1);
+    if (next != 0) {
+        *((void **)next + 1) = prev;
+    }
+    if (prev == 0) {
+        *(void **)phead = next;
+    } else {
+        *(void **)prev = next;
+    }
+}
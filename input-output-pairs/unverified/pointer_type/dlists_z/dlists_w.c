@@ -0,0 +1,32 @@
+#include "stdlib.h"
+#include <stdbool.h>
+#include "dlists.h"
+
+void dlseg_push_front(void *phead, void *element)
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& pointer(element, _) &*& pointer((void **)element + 1, _) &*& p(element);
+    //@ ensures pointer(phead, element) &*& dlseg(element, 0, 0, ?tail1, _, p);
+{
+    void *head = *(void **)phead;
+    *(void **)element = head;
+    *((void **)element + 1) = 0;
+    if (head != 0) {
+        *((void **)head + 1) = element;
+    }
+    *(void **)phead = element;
+}
+
+void dlseg_remove(void *phead, void *element)
+    //@ requires pointer(phead, ?head) &*& dlseg(head, 0, 0, ?tail, ?xs, ?p) &*& mem(element, xs) == true;
+    //@ ensures pointer(phead, ?head1) &*& dlseg(head1, 0, 0, ?tail1, remove(element, xs), p) &*& pointer(element, _) &*& pointer((void **)element + 1, _);
+{
+    void *next = *(void **)element;
+    void *prev = *((void **)element + 1);
+    if (next != 0) {
+        *((void **)next + 1) = prev;
+    }
+    if (prev == 0) {
+        *(void **)phead = next;
+    } else {
+        *(void **)prev = next;
+    }
+}
@@ -0,0 +1,179 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "recv.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+
+// The reader of sockets.h. A reader receives as many bytes as fit in its buffer with one recv(2) and hands them
+// out line by line, so a peer that sends many short lines costs one system call per buffer rather than one per line.
+// The socket module creates a reader with create_line_reader for every socket it opens and disposes of it in socket_close.
+
+#define LINE_READER_CAPACITY 65536
+#define LINE_READER_PORT 12346
+
+struct reader {
+    int socket;
+    char *buffer;
+    int start;
+    int end;
+};
+
+/*@
+
+// The bytes in buffer[start..end] have been received but not yet handed out as part of a line.
+predicate line_reader(struct reader *reader; int socket, list<char> buffered) =
+    reader->socket |-> socket &*& 0 <= socket &*& reader->buffer |-> ?buffer &*& reader->start |-> ?start &*& reader->end |-> ?end &*&
+    0 <= start &*& start <= end &*& end <= LINE_READER_CAPACITY &*&
+    chars_(buffer, start, _) &*& chars(buffer + start, end - start, buffered) &*& chars_(buffer + end, LINE_READER_CAPACITY - end, _) &*&
+    malloc_block_chars(buffer, LINE_READER_CAPACITY) &*& malloc_block_reader(reader);
+
+predicate reader(struct reader *reader) = line_reader(reader, _, _);
+
+// The bytes that one call of line_reader_read_line consumes: the line, followed by its terminator unless the input ended first.
+fixpoint bool line_consumed(list<char> consumed, list<char> line) {
+    return
+        !mem('\n', line) &&
+        (consumed == line || consumed == append(line, cons('\n', nil)) || consumed == append(line, cons('\r', cons('\n', nil))));
+}
+@*/
+
+struct reader *create_line_reader(int socket)
+    //@ requires 0 <= socket;
+    //@ ensures line_reader(result, socket, nil);
+{
+    struct reader *reader = malloc(sizeof(struct reader));
+    char *buffer = malloc(LINE_READER_CAPACITY);
+    if (reader == 0 || buffer == 0) {
+        abort();
+    }
+    reader->socket = socket;
+    reader->buffer = buffer;
+    reader->start = 0;
+    reader->end = 0;
+    return reader;
+}
+
+void line_reader_dispose(struct reader *reader)
+    //@ requires line_reader(reader, _, _);
+    //@ ensures emp;
+{
+    free(reader->buffer);
+    free(reader);
+}
+
+/*
+Moves the buffered bytes to the front of the buffer and receives more bytes after them with one recv.
+Returns the result of the recv: the number of bytes received, 0 once the peer has closed the connection, or -1 on error.
+*/
+int line_reader_fill(struct reader *reader)
+    //@ requires line_reader(reader, ?socket, ?buffered) &*& length(buffered) < LINE_READER_CAPACITY;
+    /*@
+    ensures
+        line_reader(reader, socket, ?buffered1) &*&
+        result <= 0 ? buffered1 == buffered : take(length(buffered), buffered1) == buffered &*& length(buffered1) == length(buffered) + result;
+    @*/
+{
+    char *buffer = reader->buffer;
+    int count = reader->end - reader->start;
+    if (reader->start != 0) {
+        memmove(buffer, buffer + reader->start, (size_t)count);
+        reader->start = 0;
+        reader->end = count;
+    }
+    long received = recv(reader->socket, buffer + count, (size_t)(LINE_READER_CAPACITY - count), 0);
+    if (0 < received) {
+        reader->end = count + (int)received;
+    }
+    return (int)received;
+}
+
+/*
+Reads the next line into line, without its line terminator ("\r\n" or "\n"). A line that is already buffered is
+handed out without a system call; otherwise the reader receives more bytes until the buffer holds a whole line.
+A line longer than the buffer is handed out in full as well. Returns true at end of file or on an error, unless
+some bytes of a last, unterminated line are still buffered: those are returned as a line first.
+The call consumes a prefix of the buffered bytes followed by the bytes it receives: exactly the line and its terminator.
+*/
+bool line_reader_read_line(struct reader *reader, struct string_buffer *line)
+    //@ requires line_reader(reader, ?socket, ?buffered) &*& string_buffer(line, _);
+    /*@
+    ensures
+        line_reader(reader, socket, ?buffered1) &*& string_buffer(line, ?cs) &*&
+        exists<pair<list<char>, list<char> > >(pair(?consumed, ?received)) &*&
+        append(buffered, received) == append(consumed, buffered1) &*& line_consumed(consumed, cs) == true &*&
+        (result ? consumed == nil &*& cs == nil : true) &*&
+        (mem('\n', buffered) ? result == false &*& received == nil &*& consumed == take(index_of('\n', buffered) + 1, buffered) : true);
+    @*/
+{
+    bool eof = false;
+    bool done = false;
+    string_buffer_clear(line);
+    while (!done)
+    {
+        char *first = reader->buffer + reader->start;
+        int count = reader->end - reader->start;
+        char *newline = memchr(first, '\n', (size_t)count);
+        if (newline != 0) {
+            int length = (int)(newline - first);
+            int lineLength = length;
+            if (0 < length && first[length - 1] == '\r') {
+                lineLength--;
+            }
+            string_buffer_append_chars(line, first, lineLength);
+            reader->start = reader->start + length + 1;
+            done = true;
+        } else if (count == LINE_READER_CAPACITY) {
+            // The line does not fit in the buffer. Hand out all but the last byte, which may be the '\r' of the terminator.
+            string_buffer_append_chars(line, first, count - 1);
+            reader->start = reader->end - 1;
+        } else {
+            int filled = line_reader_fill(reader);
+            if (filled <= 0) {
+                int rest = reader->end - reader->start;
+                eof = rest == 0 && string_buffer_get_length(line) == 0;
+                string_buffer_append_chars(line, reader->buffer + reader->start, rest);
+                reader->start = reader->end;
+                done = true;
+            }
+        }
+    }
+    return eof;
+}
+
+// The contract of sockets.h.
+bool reader_read_line(struct reader *reader, struct string_buffer *buffer)
+    //@ requires reader(reader) &*& string_buffer(buffer, _);
+    //@ ensures reader(reader) &*& string_buffer(buffer, _);
+{
+    bool eof = line_reader_read_line(reader, buffer);
+    return eof;
+}
+
+/*
+Accepts one connection on LINE_READER_PORT and runs a session loop over it, like a chat session: it reads the peer's
+lines through the sockets.h reader until the peer closes the connection, then prints the number of lines and of bytes in them.
+*/
+int main() //@ : main
+    //@ requires true;
+    //@ ensures true;
+{
+    struct server_socket *serverSocket = create_server_socket(LINE_READER_PORT);
+    struct socket *socket = server_socket_accept(serverSocket);
+    struct reader *reader = socket_get_reader(socket);
+    struct string_buffer *line = create_string_buffer();
+    int lines = 0;
+    long long bytes = 0;
+    while (!reader_read_line(reader, line))
+    {
+        if (lines < INT_MAX) {
+            lines++;
+        }
+        bytes += string_buffer_get_length(line);
+    }
+    string_buffer_dispose(line);
+    socket_close(socket);
+    printf("%d lines, %d bytes\n", lines, (int)(bytes < INT_MAX ? bytes : INT_MAX));
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "recv.h"
+#include "stringBuffers.h"
+#include "sockets.h"
+
+// The reader of sockets.h. A reader receives as many bytes as fit in its buffer with one recv(2) and hands them
+// out line by line, so a peer that sends many short lines costs one system call per buffer rather than one per line.
+// The socket module creates a reader with create_line_reader for every socket it opens and disposes of it in socket_close.
+
+#define LINE_READER_CAPACITY 65536
+#define LINE_READER_PORT 12346
+
+struct reader {
+    int socket;
+    char *buffer;
+    int start;
+    int end;
+};
+
+/**
+ * Description:
+ * The create_line_reader function creates the reader of a connected socket, with an empty buffer of LINE_READER_CAPACITY bytes. The socket module calls it for every socket it opens.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param socket The file descriptor of the connected socket.
+ *
+ * @return A pointer to the new reader.
+ */
+struct reader *create_line_reader(int socket)
+{
+    struct reader *reader = malloc(sizeof(struct reader));
+    char *buffer = malloc(LINE_READER_CAPACITY);
+    if (reader == 0 || buffer == 0) {
+        abort();
+    }
+    reader->socket = socket;
+    reader->buffer = buffer;
+    reader->start = 0;
+    reader->end = 0;
+    return reader;
+}
+
+/**
+ * Description:
+ * The line_reader_dispose function frees the reader and its buffer. It does not close the socket, and any buffered bytes are discarded.
+ *
+ * @param reader A pointer to the reader.
+ */
+void line_reader_dispose(struct reader *reader)
+{
+    free(reader->buffer);
+    free(reader);
+}
+
+/**
+ * Description:
+ * The line_reader_fill function moves the buffered bytes to the front of the buffer, and then receives as many bytes as fit after them with a single recv.
+ * The buffer must not be full.
+ *
+ * @param reader A pointer to the reader.
+ *
+ * @return The number of bytes received, 0 once the peer has closed the connection, or -1 if the recv failed.
+ */
+int line_reader_fill(struct reader *reader)
+{
+    char *buffer = reader->buffer;
+    int count = reader->end - reader->start;
+    if (reader->start != 0) {
+        memmove(buffer, buffer + reader->start, (size_t)count);
+        reader->start = 0;
+        reader->end = count;
+    }
+    long received = recv(reader->socket, buffer + count, (size_t)(LINE_READER_CAPACITY - count), 0);
+    if (0 < received) {
+        reader->end = count + (int)received;
+    }
+    return (int)received;
+}
+
+/**
+ * Description:
+ * The line_reader_read_line function reads the next line into a string buffer, without its "\r\n" or "\n" terminator.
+ * It finds the terminator in the buffered bytes with memchr; if the buffer already holds a whole line, no system call is made. Otherwise it receives more bytes until a line is complete.
+ * A line that does not fit in the buffer is handed out piece by piece into the same string buffer. At end of file, the bytes of a last, unterminated line are returned as a line first.
+ * The bytes the call consumes are a prefix of the buffered bytes followed by the bytes it receives: exactly the line and its terminator, if any.
+ *
+ * @param reader A pointer to the reader.
+ * @param line A pointer to the string buffer that receives the line; its previous contents are discarded.
+ *
+ * @return True if the end of the input was reached (or reading failed) and no line was read, false otherwise.
+ */
+bool line_reader_read_line(struct reader *reader, struct string_buffer *line)
+{
+    bool eof = false;
+    bool done = false;
+    string_buffer_clear(line);
+    while (!done)
+    {
+        char *first = reader->buffer + reader->start;
+        int count = reader->end - reader->start;
+        char *newline = memchr(first, '\n', (size_t)count);
+        if (newline != 0) {
+            int length = (int)(newline - first);
+            int lineLength = length;
+            if (0 < length && first[length - 1] == '\r') {
+                lineLength--;
+            }
+            string_buffer_append_chars(line, first, lineLength);
+            reader->start = reader->start + length + 1;
+            done = true;
+        } else if (count == LINE_READER_CAPACITY) {
+            // The line does not fit in the buffer. Hand out all but the last byte, which may be the '\r' of the terminator.
+            string_buffer_append_chars(line, first, count - 1);
+            reader->start = reader->end - 1;
+        } else {
+            int filled = line_reader_fill(reader);
+            if (filled <= 0) {
+                int rest = reader->end - reader->start;
+                eof = rest == 0 && string_buffer_get_length(line) == 0;
+                string_buffer_append_chars(line, reader->buffer + reader->start, rest);
+                reader->start = reader->end;
+                done = true;
+            }
+        }
+    }
+    return eof;
+}
+
+// The contract of sockets.h.
+/**
+ * Description:
+ * The reader_read_line function is the reader_read_line of sockets.h. It reads the next line of the socket into a string buffer with line_reader_read_line.
+ *
+ * @param reader A pointer to the reader of a socket.
+ * @param buffer A pointer to the string buffer that receives the line.
+ *
+ * @return True if the connection was closed and no line was read, false otherwise.
+ */
+bool reader_read_line(struct reader *reader, struct string_buffer *buffer)
+{
+    bool eof = line_reader_read_line(reader, buffer);
+    return eof;
+}
+
+/**
+ * Description:
+ * The main function accepts one connection on LINE_READER_PORT and runs a session loop over it, like a chat session: it reads the lines of the peer with reader_read_line until the peer closes the connection.
+ * It then prints the number of lines and the number of bytes in them, not counting the line terminators.
+ *
+ * @return 0.
+ */
+int main()
+{
+    struct server_socket *serverSocket = create_server_socket(LINE_READER_PORT);
+    struct socket *socket = server_socket_accept(serverSocket);
+    struct reader *reader = socket_get_reader(socket);
+    struct string_buffer *line = create_string_buffer();
+    int lines = 0;
+    long long bytes = 0;
+    while (!reader_read_line(reader, line))
+    {
+        if (lines < INT_MAX) {
+            lines++;
+        }
+        bytes += string_buffer_get_length(line);
+    }
+    string_buffer_dispose(line);
+    socket_close(socket);
+    printf("%d lines, %d bytes\n", lines, (int)(bytes < INT_MAX ? bytes : INT_MAX));
+    return 0;
+}
@@ -0,0 +1,519 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "stringBuffers.h"
+#include "clock.h"
+
+// A string buffer keeps short strings (nicks, " says: ") in storage inside the buffer itself, so creating one costs a
+// single allocation. Longer strings move to a heap block whose capacity doubles whenever an append does not fit.
+// Dropping characters from the front only advances a start offset, so a parser that repeatedly consumes a prefix of
+// its input takes linear rather than quadratic time.
+
+#define STRING_BUFFER_INLINE_CAPACITY 24
+
+struct string_buffer {
+    int start;
+    int length;
+    int capacity;
+    char *storage;
+    char inline_chars[STRING_BUFFER_INLINE_CAPACITY];
+};
+
+/*@
+
+// The characters are stored in inline_chars until they outgrow it; from then on inline_chars is unused.
+predicate string_buffer_storage(struct string_buffer *buffer; char *storage, int capacity) =
+    buffer->storage |-> storage &*& buffer->capacity |-> capacity &*&
+    (storage == buffer->inline_chars ?
+        capacity == STRING_BUFFER_INLINE_CAPACITY
+    :
+        STRING_BUFFER_INLINE_CAPACITY < capacity &*& chars_(buffer->inline_chars, STRING_BUFFER_INLINE_CAPACITY, _) &*&
+        malloc_block_chars(storage, capacity)) &*&
+    malloc_block_string_buffer(buffer);
+
+// The characters in use are storage[start..start + length]; the ones before start have been dropped.
+predicate string_buffer_minus_chars(struct string_buffer *buffer; char *pcs, int length) =
+    string_buffer_storage(buffer, ?storage, ?capacity) &*& buffer->start |-> ?start &*& buffer->length |-> length &*&
+    0 <= start &*& 0 <= length &*& start + length <= capacity &*& pcs == storage + start &*&
+    chars_(storage, start, _) &*& chars_(pcs + length, capacity - start - length, _);
+
+predicate string_buffer(struct string_buffer *buffer; list<char> cs) =
+    string_buffer_minus_chars(buffer, ?pcs, ?length) &*& chars(pcs, length, cs);
+
+lemma void string_buffer_merge_chars(struct string_buffer *buffer)
+    requires [?f]string_buffer_minus_chars(buffer, ?pcs, ?n) &*& [f]chars(pcs, n, ?cs);
+    ensures [f]string_buffer(buffer, cs);
+{
+    close [f]string_buffer(buffer, cs);
+}
+
+lemma_auto void string_buffer_not_null()
+    requires string_buffer(?buffer, ?cs);
+    ensures string_buffer(buffer, cs) &*& buffer != 0;
+{
+    open string_buffer(buffer, cs);
+    open string_buffer_minus_chars(buffer, ?pcs, ?length);
+    open string_buffer_storage(buffer, ?storage, ?capacity);
+    close string_buffer_storage(buffer, storage, capacity);
+    close string_buffer_minus_chars(buffer, pcs, length);
+    close string_buffer(buffer, cs);
+}
+
+@*/
+
+struct string_buffer *create_string_buffer()
+    //@ requires emp;
+    //@ ensures string_buffer(result, nil) &*& result != 0;
+{
+    struct string_buffer *buffer = malloc(sizeof(struct string_buffer));
+    if (buffer == 0) {
+        abort();
+    }
+    buffer->start = 0;
+    buffer->length = 0;
+    buffer->capacity = STRING_BUFFER_INLINE_CAPACITY;
+    buffer->storage = buffer->inline_chars;
+    //@ close chars_(buffer->inline_chars, 0, nil);
+    //@ close chars(buffer->inline_chars, 0, nil);
+    //@ close string_buffer(buffer, nil);
+    return buffer;
+}
+
+int string_buffer_get_length(struct string_buffer *buffer)
+    //@ requires [?f]string_buffer(buffer, ?cs);
+    //@ ensures [f]string_buffer(buffer, cs) &*& result == length(cs);
+{
+    return buffer->length;
+}
+
+char *string_buffer_get_chars(struct string_buffer *buffer)
+    //@ requires [?f]string_buffer(buffer, ?cs);
+    //@ ensures [f]string_buffer_minus_chars(buffer, result, length(cs)) &*& [f]chars(result, length(cs), cs);
+{
+    //@ open string_buffer(buffer, cs);
+    return buffer->storage + buffer->start;
+}
+
+bool string_buffer_equals(struct string_buffer *buffer, struct string_buffer *buffer0)
+    //@ requires [?f]string_buffer(buffer, ?cs) &*& [?f0]string_buffer(buffer0, ?cs0);
+    //@ ensures [f]string_buffer(buffer, cs) &*& [f0]string_buffer(buffer0, cs0) &*& result == (cs == cs0);
+{
+    //@ open string_buffer(buffer, cs);
+    //@ open string_buffer(buffer0, cs0);
+    int length = buffer->length;
+    bool result = false;
+    if (length == buffer0->length) {
+        result = memcmp(buffer->storage + buffer->start, buffer0->storage + buffer0->start, (size_t)length) == 0;
+    } else {
+        //@ length_nonnegative(cs);
+    }
+    return result;
+}
+
+bool string_buffer_equals_string(struct string_buffer *buffer, char *string)
+    //@ requires [?f1]string_buffer(buffer, ?cs1) &*& [?f2]string(string, ?cs2);
+    //@ ensures [f1]string_buffer(buffer, cs1) &*& [f2]string(string, cs2) &*& result == (cs1 == cs2);
+{
+    //@ open string_buffer(buffer, cs1);
+    int length = buffer->length;
+    bool result = false;
+    if ((size_t)length == strlen(string)) {
+        //@ string_to_body_chars(string);
+        result = memcmp(buffer->storage + buffer->start, string, (size_t)length) == 0;
+        //@ body_chars_to_string(string);
+    }
+    return result;
+}
+
+void string_buffer_clear(struct string_buffer *buffer)
+    //@ requires string_buffer(buffer, ?cs);
+    //@ ensures string_buffer(buffer, nil);
+{
+    //@ open string_buffer(buffer, cs);
+    //@ open string_buffer_minus_chars(buffer, ?pcs, ?length);
+    //@ open string_buffer_storage(buffer, ?storage, ?capacity);
+    // The storage is kept, so a buffer that is cleared and refilled for every message allocates only while it grows.
+    buffer->start = 0;
+    buffer->length = 0;
+    //@ chars_to_chars_(pcs);
+    //@ chars__join(pcs);
+    //@ chars__join(storage);
+    //@ close chars_(storage, 0, nil);
+    //@ close chars(storage, 0, nil);
+}
+
+/*
+Makes room for count more characters after the length characters in use, and moves those to the front of the storage.
+If the dropped characters make up at least half of the storage and the result fits, the characters in use are moved
+within the storage. Otherwise the storage is replaced by a heap block whose capacity is doubled until they fit. Either
+way each character is moved a constant number of times on average.
+*/
+static void string_buffer_make_room(struct string_buffer *buffer, int length, int count)
+    /*@
+    requires
+        string_buffer_storage(buffer, ?storage, ?capacity) &*& buffer->start |-> ?start &*&
+        chars_(storage, start, _) &*& chars(storage + start, length, ?cs) &*& chars_(storage + start + length, capacity - start - length, _) &*&
+        0 <= start &*& 0 <= length &*& 0 <= count &*& count <= INT_MAX - length &*& capacity - start - length < count;
+    @*/
+    /*@
+    ensures
+        string_buffer_storage(buffer, ?storage1, ?capacity1) &*& buffer->start |-> 0 &*&
+        chars(storage1, length, cs) &*& chars_(storage1 + length, capacity1 - length, _) &*& length + count <= capacity1;
+    @*/
+{
+    //@ open string_buffer_storage(buffer, storage, capacity);
+    int start = buffer->start;
+    int capacity = buffer->capacity;
+    if (capacity / 2 <= start && count <= capacity - length) {
+        memmove(buffer->storage, buffer->storage + start, (size_t)length);
+        //@ chars__join(storage + length);
+    } else {
+        int minCapacity = length + count;
+        while (capacity < minCapacity)
+            //@ invariant STRING_BUFFER_INLINE_CAPACITY <= capacity &*& capacity <= INT_MAX;
+        {
+            if (INT_MAX / 2 < capacity) {
+                capacity = minCapacity;
+            } else {
+                capacity = capacity * 2;
+            }
+        }
+        char *chars = malloc((size_t)capacity);
+        if (chars == 0) {
+            abort();
+        }
+        //@ chars__split(chars, length);
+        memcpy(chars, buffer->storage + start, (size_t)length);
+        //@ chars_to_chars_(storage + start);
+        //@ chars__join(storage + start);
+        //@ chars__join(storage);
+        if (buffer->storage != buffer->inline_chars) {
+            free(buffer->storage);
+        }
+        buffer->storage = chars;
+        buffer->capacity = capacity;
+    }
+    buffer->start = 0;
+    //@ close string_buffer_storage(buffer, buffer->storage, capacity);
+}
+
+void string_buffer_append_chars(struct string_buffer *buffer, char *chars, int count)
+    //@ requires string_buffer(buffer, ?bcs) &*& [?f]chars(chars, count, ?cs);
+    //@ ensures string_buffer(buffer, append(bcs, cs)) &*& [f]chars(chars, count, cs);
+{
+    //@ open string_buffer(buffer, bcs);
+    //@ open string_buffer_minus_chars(buffer, ?pcs, ?length);
+    //@ open string_buffer_storage(buffer, ?storage, ?capacity);
+    //@ close string_buffer_storage(buffer, storage, capacity);
+    int length = buffer->length;
+    if (INT_MAX - length < count) {
+        abort();
+    }
+    if (buffer->capacity - buffer->start - length < count) {
+        string_buffer_make_room(buffer, length, count);
+        //@ close chars_(buffer->storage, 0, nil);
+    }
+    char *first = buffer->storage + buffer->start;
+    //@ chars__split(first + length, count);
+    memcpy(first + length, chars, (size_t)count);
+    //@ chars_join(first);
+    buffer->length = length + count;
+}
+
+void string_buffer_append_string_buffer(struct string_buffer *buffer, struct string_buffer *buffer0)
+    //@ requires string_buffer(buffer, ?cs) &*& [?f]string_buffer(buffer0, ?cs0);
+    //@ ensures string_buffer(buffer, append(cs, cs0)) &*& [f]string_buffer(buffer0, cs0);
+{
+    //@ open string_buffer(buffer0, cs0);
+    string_buffer_append_chars(buffer, buffer0->storage + buffer0->start, buffer0->length);
+}
+
+void string_buffer_append_string(struct string_buffer *buffer, char *string)
+    //@ requires string_buffer(buffer, ?bcs) &*& [?f]string(string, ?cs);
+    //@ ensures string_buffer(buffer, append(bcs, cs)) &*& [f]string(string, cs);
+{
+    size_t length = strlen(string);
+    if (INT_MAX < length) {
+        abort();
+    }
+    //@ string_to_body_chars(string);
+    string_buffer_append_chars(buffer, string, (int)length);
+    //@ body_chars_to_string(string);
+}
+
+struct string_buffer *string_buffer_copy(struct string_buffer *buffer)
+    //@ requires [?f]string_buffer(buffer, ?cs);
+    //@ ensures [f]string_buffer(buffer, cs) &*& string_buffer(result, cs);
+{
+    struct string_buffer *copy = create_string_buffer();
+    string_buffer_append_string_buffer(copy, buffer);
+    return copy;
+}
+
+/*
+Returns the index of the first occurrence of string in the length characters at chars, or -1 if there is none.
+Candidates are located with memchr on the first character of string and then compared with memcmp.
+*/
+static int chars_index_of_string(char *chars, int length, char *string)
+    //@ requires [?f]chars(chars, length, ?cs) &*& [?f1]string(string, ?scs);
+    /*@
+    ensures
+        [f]chars(chars, length, cs) &*& [f1]string(string, scs) &*&
+        result == -1 ? true : 0 <= result &*& result + length(scs) <= length &*& take(length(scs), drop(result, cs)) == scs;
+    @*/
+{
+    size_t n = strlen(string);
+    if (n == 0) {
+        return 0;
+    }
+    if ((size_t)length < n) {
+        return -1;
+    }
+    //@ string_to_body_chars(string);
+    //@ open chars(string, _, _);
+    int result = -1;
+    int index = 0;
+    while (result == -1 && (size_t)(length - index) >= n)
+        //@ invariant [f]chars(chars, length, cs) &*& 0 <= index &*& index <= length &*& result == -1 || 0 <= result &*& result + n <= length;
+    {
+        //@ chars_split(chars, index);
+        //@ chars_split(chars + index, length - index - (int)n + 1);
+        char *candidate = memchr(chars + index, *string, (size_t)(length - index) - n + 1);
+        //@ chars_join(chars + index);
+        //@ chars_join(chars);
+        if (candidate == 0) {
+            index = length;
+        } else {
+            int offset = (int)(candidate - chars);
+            //@ chars_split(chars, offset + 1);
+            //@ chars_split(chars + offset + 1, (int)n - 1);
+            if (memcmp(candidate + 1, string + 1, n - 1) == 0) {
+                result = offset;
+            }
+            //@ chars_join(chars + offset + 1);
+            //@ chars_join(chars);
+            index = offset + 1;
+        }
+    }
+    //@ close [f1]chars(string, _, _);
+    //@ body_chars_to_string(string);
+    return result;
+}
+
+bool string_buffer_split(struct string_buffer *buffer, char *separator, struct string_buffer *before, struct string_buffer *after)
+    //@ requires [?f1]string_buffer(buffer, ?bcs) &*& [?f2]string(separator, ?cs) &*& string_buffer(before, _) &*& string_buffer(after, _);
+    //@ ensures [f1]string_buffer(buffer, bcs) &*& [f2]string(separator, cs) &*& string_buffer(before, _) &*& string_buffer(after, _);
+{
+    //@ open string_buffer(buffer, bcs);
+    char *chars = buffer->storage + buffer->start;
+    int length = buffer->length;
+    int index = chars_index_of_string(chars, length, separator);
+    if (index == -1) {
+        return false;
+    }
+    int n = (int)strlen(separator);
+    //@ chars_split(chars, index);
+    //@ chars_split(chars + index, n);
+    string_buffer_clear(before);
+    string_buffer_append_chars(before, chars, index);
+    string_buffer_clear(after);
+    string_buffer_append_chars(after, chars + index + n, length - index - n);
+    //@ chars_join(chars + index);
+    //@ chars_join(chars);
+    return true;
+}
+
+bool string_buffer_split_views(struct string_buffer *buffer, char *separator, struct string_view *before, struct string_view *after)
+    //@ requires [?f1]string_buffer(buffer, ?bcs) &*& [?f2]string(separator, ?cs) &*& string_view(before, _, _) &*& string_view(after, _, _);
+    /*@
+    ensures
+        [f2]string(separator, cs) &*& string_view(before, ?pcs, ?index) &*& string_view(after, ?apcs, ?alength) &*&
+        result ?
+            [f1]string_buffer_minus_chars(buffer, pcs, length(bcs)) &*& [f1]chars(pcs, length(bcs), bcs) &*&
+            take(length(cs), drop(index, bcs)) == cs &*& apcs == pcs + index + length(cs) &*& alength == length(bcs) - index - length(cs)
+        :
+            [f1]string_buffer(buffer, bcs);
+    @*/
+{
+    //@ open string_buffer(buffer, bcs);
+    char *chars = buffer->storage + buffer->start;
+    int length = buffer->length;
+    int index = chars_index_of_string(chars, length, separator);
+    if (index == -1) {
+        //@ close [f1]string_buffer(buffer, bcs);
+        return false;
+    }
+    int n = (int)strlen(separator);
+    before->chars = chars;
+    before->length = index;
+    after->chars = chars + index + n;
+    after->length = length - index - n;
+    return true;
+}
+
+bool string_view_equals_string(struct string_view *view, char *string)
+    //@ requires [?f]string_view(view, ?chars, ?length) &*& [?f1]chars(chars, length, ?cs) &*& [?f2]string(string, ?cs2);
+    //@ ensures [f]string_view(view, chars, length) &*& [f1]chars(chars, length, cs) &*& [f2]string(string, cs2) &*& result == (cs == cs2);
+{
+    int length = view->length;
+    bool result = false;
+    if ((size_t)length == strlen(string)) {
+        //@ string_to_body_chars(string);
+        result = memcmp(view->chars, string, (size_t)length) == 0;
+        //@ body_chars_to_string(string);
+    }
+    return result;
+}
+
+void string_buffer_append_string_view(struct string_buffer *buffer, struct string_view *view)
+    //@ requires string_buffer(buffer, ?bcs) &*& [?f]string_view(view, ?chars, ?length) &*& [?f1]chars(chars, length, ?cs);
+    //@ ensures string_buffer(buffer, append(bcs, cs)) &*& [f]string_view(view, chars, length) &*& [f1]chars(chars, length, cs);
+{
+    string_buffer_append_chars(buffer, view->chars, view->length);
+}
+
+void string_buffer_drop_front(struct string_buffer *buffer, int length)
+    //@ requires string_buffer(buffer, ?bcs) &*& length >= 0;
+    //@ ensures string_buffer(buffer, drop(length, bcs));
+{
+    //@ open string_buffer(buffer, bcs);
+    //@ open string_buffer_minus_chars(buffer, ?pcs, ?count0);
+    //@ open string_buffer_storage(buffer, ?storage, ?capacity);
+    int count = buffer->length;
+    if (count < length) {
+        length = count;
+    }
+    // The dropped characters stay where they are until an append needs their room.
+    //@ chars_split(pcs, length);
+    //@ chars_to_chars_(pcs);
+    //@ chars__join(storage);
+    if (length == count) {
+        buffer->start = 0;
+        //@ chars__join(storage);
+        //@ close chars_(storage, 0, nil);
+    } else {
+        buffer->start = buffer->start + length;
+    }
+    buffer->length = count - length;
+}
+
+void string_buffer_dispose(struct string_buffer *buffer)
+    //@ requires buffer == 0 ? emp : string_buffer(buffer, _);
+    //@ ensures emp;
+{
+    if (buffer != 0) {
+        //@ open string_buffer(buffer, ?cs);
+        //@ open string_buffer_minus_chars(buffer, ?pcs, ?length);
+        //@ open string_buffer_storage(buffer, ?storage, ?capacity);
+        //@ chars_to_chars_(pcs);
+        //@ chars__join(pcs);
+        //@ chars__join(storage);
+        if (buffer->storage != buffer->inline_chars) {
+            free(buffer->storage);
+        }
+        free(buffer);
+    }
+}
+
+#define MESSAGE_COUNT 1000000
+#define APPEND_COUNT 10000000
+#define LINE_COUNT 1000000
+
+int main() //@ : main
+    //@ requires true;
+    //@ ensures true;
+{
+    struct string_buffer *nick = create_string_buffer();
+    string_buffer_append_string(nick, "alice");
+    struct string_buffer *text = create_string_buffer();
+    for (int i = 0; i < 8; i++)
+        //@ invariant string_buffer(text, _) &*& 0 <= i;
+    {
+        string_buffer_append_string(text, "the quick brown fox ");
+    }
+
+    // Copies of a nick fit in the inline storage, so each costs one allocation.
+    long long start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+        //@ invariant string_buffer(nick, ?ncs) &*& 0 <= i;
+    {
+        struct string_buffer *copy = string_buffer_copy(nick);
+        string_buffer_dispose(copy);
+    }
+    long long nickNanos = clock_now_nanos() - start;
+
+    // Builds every message in a fresh buffer, as the chat servers do for each join, leave and message.
+    start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+        //@ invariant string_buffer(nick, ?ncs) &*& string_buffer(text, ?tcs) &*& 0 <= i;
+    {
+        struct string_buffer *message = string_buffer_copy(nick);
+        string_buffer_append_string(message, " says: ");
+        string_buffer_append_string_buffer(message, text);
+        string_buffer_dispose(message);
+    }
+    long long freshNanos = clock_now_nanos() - start;
+
+    // Builds every message in the same buffer; clearing it keeps its capacity, so only the first message allocates.
+    struct string_buffer *message = create_string_buffer();
+    start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+        //@ invariant string_buffer(nick, ?ncs) &*& string_buffer(text, ?tcs) &*& string_buffer(message, _) &*& 0 <= i;
+    {
+        string_buffer_clear(message);
+        string_buffer_append_string_buffer(message, nick);
+        string_buffer_append_string(message, " says: ");
+        string_buffer_append_string_buffer(message, text);
+    }
+    long long reusedNanos = clock_now_nanos() - start;
+
+    // Appends to one buffer until it holds APPEND_COUNT characters; the capacity doubles about twenty times on the way.
+    string_buffer_clear(message);
+    start = clock_now_nanos();
+    for (int i = 0; i < APPEND_COUNT; i++)
+        //@ invariant string_buffer(message, ?mcs) &*& length(mcs) == i &*& i <= APPEND_COUNT;
+    {
+        string_buffer_append_string(message, "x");
+    }
+    long long appendNanos = clock_now_nanos() - start;
+    int length = string_buffer_get_length(message);
+
+    // Parses LINE_COUNT lines the way a protocol parser does: split off the first line as a view, then drop it from the
+    // front. Neither step copies the rest of the input.
+    string_buffer_clear(message);
+    for (int i = 0; i < LINE_COUNT; i++)
+        //@ invariant string_buffer(message, _) &*& 0 <= i;
+    {
+        string_buffer_append_string(message, "alice says: hello\n");
+    }
+    struct string_view line;
+    struct string_view rest;
+    line.chars = 0;
+    line.length = 0;
+    rest.chars = 0;
+    rest.length = 0;
+    int lines = 0;
+    start = clock_now_nanos();
+    while (string_buffer_split_views(message, "\n", &line, &rest))
+        //@ invariant string_buffer(message, _) &*& string_view(&line, _, _) &*& string_view(&rest, _, _) &*& 0 <= lines &*& lines <= LINE_COUNT;
+    {
+        //@ chars_split(line.chars, line.length);
+        if (string_view_equals_string(&line, "alice says: hello") && lines < LINE_COUNT) {
+            lines++;
+        }
+        //@ chars_join(line.chars);
+        //@ string_buffer_merge_chars(message);
+        string_buffer_drop_front(message, line.length + 1);
+    }
+    long long parseNanos = clock_now_nanos() - start;
+
+    string_buffer_dispose(message);
+    string_buffer_dispose(text);
+    string_buffer_dispose(nick);
+    printf("nick copy: %d ns, fresh message: %d ns, reused message: %d ns, append: %d ns per character (%d characters)\n",
+        (int)(nickNanos / MESSAGE_COUNT), (int)(freshNanos / MESSAGE_COUNT), (int)(reusedNanos / MESSAGE_COUNT),
+        (int)(appendNanos / APPEND_COUNT), length);
+    printf("parse: %d ns per line (%d lines)\n", (int)(parseNanos / LINE_COUNT), lines);
+    return 0;
+}
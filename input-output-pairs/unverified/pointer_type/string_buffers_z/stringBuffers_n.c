@@ -0,0 +1,484 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "stringBuffers.h"
+#include "clock.h"
+
+// A string buffer keeps short strings (nicks, " says: ") in storage inside the buffer itself, so creating one costs a
+// single allocation. Longer strings move to a heap block whose capacity doubles whenever an append does not fit.
+// Dropping characters from the front only advances a start offset, so a parser that repeatedly consumes a prefix of
+// its input takes linear rather than quadratic time.
+
+#define STRING_BUFFER_INLINE_CAPACITY 24
+
+struct string_buffer {
+    int start;
+    int length;
+    int capacity;
+    char *storage;
+    char inline_chars[STRING_BUFFER_INLINE_CAPACITY];
+};
+
+/**
+ * Description:
+ * The create_string_buffer function creates an empty string buffer whose characters are stored in the inline storage of the buffer itself.
+ * If memory allocation fails, the program aborts.
+ *
+ * @return A pointer to the new, empty string buffer.
+ */
+struct string_buffer *create_string_buffer()
+{
+    struct string_buffer *buffer = malloc(sizeof(struct string_buffer));
+    if (buffer == 0) {
+        abort();
+    }
+    buffer->start = 0;
+    buffer->length = 0;
+    buffer->capacity = STRING_BUFFER_INLINE_CAPACITY;
+    buffer->storage = buffer->inline_chars;
+    return buffer;
+}
+
+/**
+ * Description:
+ * The string_buffer_get_length function returns the number of characters in the string buffer.
+ *
+ * @param buffer A pointer to the string buffer.
+ *
+ * @return The length of the string buffer.
+ */
+int string_buffer_get_length(struct string_buffer *buffer)
+{
+    return buffer->length;
+}
+
+/**
+ * Description:
+ * The string_buffer_get_chars function returns a pointer to the characters of the string buffer. The characters are not null-terminated.
+ *
+ * @param buffer A pointer to the string buffer.
+ *
+ * @return A pointer to the first character of the string buffer.
+ */
+char *string_buffer_get_chars(struct string_buffer *buffer)
+{
+    return buffer->storage + buffer->start;
+}
+
+/**
+ * Description:
+ * The string_buffer_equals function checks whether two string buffers hold the same characters.
+ *
+ * @param buffer A pointer to the first string buffer.
+ * @param buffer0 A pointer to the second string buffer.
+ *
+ * @return True if both buffers hold the same characters, false otherwise.
+ */
+bool string_buffer_equals(struct string_buffer *buffer, struct string_buffer *buffer0)
+{
+    int length = buffer->length;
+    bool result = false;
+    if (length == buffer0->length) {
+        result = memcmp(buffer->storage + buffer->start, buffer0->storage + buffer0->start, (size_t)length) == 0;
+    } else {
+    }
+    return result;
+}
+
+/**
+ * Description:
+ * The string_buffer_equals_string function checks whether a string buffer holds the same characters as a null-terminated string.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param string A pointer to the null-terminated string.
+ *
+ * @return True if the buffer holds the characters of the string, false otherwise.
+ */
+bool string_buffer_equals_string(struct string_buffer *buffer, char *string)
+{
+    int length = buffer->length;
+    bool result = false;
+    if ((size_t)length == strlen(string)) {
+        result = memcmp(buffer->storage + buffer->start, string, (size_t)length) == 0;
+    }
+    return result;
+}
+
+/**
+ * Description:
+ * The string_buffer_clear function removes all characters from the string buffer. The storage of the buffer is kept, so that refilling it does not allocate again.
+ *
+ * @param buffer A pointer to the string buffer.
+ */
+void string_buffer_clear(struct string_buffer *buffer)
+{
+    // The storage is kept, so a buffer that is cleared and refilled for every message allocates only while it grows.
+    buffer->start = 0;
+    buffer->length = 0;
+}
+
+/**
+ * Description:
+ * The string_buffer_make_room function makes room for count more characters after the characters in use, and moves the characters in use to the front of the storage.
+ * If the dropped characters make up at least half of the storage and the result fits, the characters are moved within the storage; otherwise the storage is replaced by a heap block whose capacity is doubled until they fit. If memory allocation fails, the program aborts.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param length The number of characters in use.
+ * @param count The number of characters that must fit after them.
+ */
+static void string_buffer_make_room(struct string_buffer *buffer, int length, int count)
+{
+    int start = buffer->start;
+    int capacity = buffer->capacity;
+    if (capacity / 2 <= start && count <= capacity - length) {
+        memmove(buffer->storage, buffer->storage + start, (size_t)length);
+    } else {
+        int minCapacity = length + count;
+        while (capacity < minCapacity)
+        {
+            if (INT_MAX / 2 < capacity) {
+                capacity = minCapacity;
+            } else {
+                capacity = capacity * 2;
+            }
+        }
+        char *chars = malloc((size_t)capacity);
+        if (chars == 0) {
+            abort();
+        }
+        memcpy(chars, buffer->storage + start, (size_t)length);
+        if (buffer->storage != buffer->inline_chars) {
+            free(buffer->storage);
+        }
+        buffer->storage = chars;
+        buffer->capacity = capacity;
+    }
+    buffer->start = 0;
+}
+
+/**
+ * Description:
+ * The string_buffer_append_chars function appends count characters to the string buffer, growing its storage if they do not fit.
+ * If the length would exceed INT_MAX, the program aborts.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param chars A pointer to the characters to append.
+ * @param count The number of characters to append.
+ */
+void string_buffer_append_chars(struct string_buffer *buffer, char *chars, int count)
+{
+    int length = buffer->length;
+    if (INT_MAX - length < count) {
+        abort();
+    }
+    if (buffer->capacity - buffer->start - length < count) {
+        string_buffer_make_room(buffer, length, count);
+    }
+    char *first = buffer->storage + buffer->start;
+    memcpy(first + length, chars, (size_t)count);
+    buffer->length = length + count;
+}
+
+/**
+ * Description:
+ * The string_buffer_append_string_buffer function appends the characters of one string buffer to another.
+ *
+ * @param buffer A pointer to the string buffer to append to.
+ * @param buffer0 A pointer to the string buffer whose characters are appended.
+ */
+void string_buffer_append_string_buffer(struct string_buffer *buffer, struct string_buffer *buffer0)
+{
+    string_buffer_append_chars(buffer, buffer0->storage + buffer0->start, buffer0->length);
+}
+
+/**
+ * Description:
+ * The string_buffer_append_string function appends the characters of a null-terminated string, without the terminator, to the string buffer.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param string A pointer to the null-terminated string.
+ */
+void string_buffer_append_string(struct string_buffer *buffer, char *string)
+{
+    size_t length = strlen(string);
+    if (INT_MAX < length) {
+        abort();
+    }
+    string_buffer_append_chars(buffer, string, (int)length);
+}
+
+/**
+ * Description:
+ * The string_buffer_copy function creates a new string buffer holding the same characters as the given one.
+ *
+ * @param buffer A pointer to the string buffer to copy.
+ *
+ * @return A pointer to the new string buffer.
+ */
+struct string_buffer *string_buffer_copy(struct string_buffer *buffer)
+{
+    struct string_buffer *copy = create_string_buffer();
+    string_buffer_append_string_buffer(copy, buffer);
+    return copy;
+}
+
+/**
+ * Description:
+ * The chars_index_of_string function finds the first occurrence of a null-terminated string in a character array.
+ * Candidates are located with memchr on the first character of the string and then compared with memcmp.
+ *
+ * @param chars A pointer to the character array.
+ * @param length The number of characters in the array.
+ * @param string A pointer to the null-terminated string to search for.
+ *
+ * @return The index of the first occurrence, 0 if the string is empty, or -1 if there is no occurrence.
+ */
+static int chars_index_of_string(char *chars, int length, char *string)
+{
+    size_t n = strlen(string);
+    if (n == 0) {
+        return 0;
+    }
+    if ((size_t)length < n) {
+        return -1;
+    }
+    int result = -1;
+    int index = 0;
+    while (result == -1 && (size_t)(length - index) >= n)
+    {
+        char *candidate = memchr(chars + index, *string, (size_t)(length - index) - n + 1);
+        if (candidate == 0) {
+            index = length;
+        } else {
+            int offset = (int)(candidate - chars);
+            if (memcmp(candidate + 1, string + 1, n - 1) == 0) {
+                result = offset;
+            }
+            index = offset + 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * Description:
+ * The string_buffer_split function splits the string buffer at the first occurrence of a separator. The characters before the separator replace the contents of before, and the characters after it replace the contents of after.
+ * If the separator does not occur, before and after are left unchanged.
+ *
+ * @param buffer A pointer to the string buffer to split.
+ * @param separator A pointer to the null-terminated separator.
+ * @param before A pointer to the string buffer that receives the characters before the separator.
+ * @param after A pointer to the string buffer that receives the characters after the separator.
+ *
+ * @return True if the separator occurs in the buffer, false otherwise.
+ */
+bool string_buffer_split(struct string_buffer *buffer, char *separator, struct string_buffer *before, struct string_buffer *after)
+{
+    char *chars = buffer->storage + buffer->start;
+    int length = buffer->length;
+    int index = chars_index_of_string(chars, length, separator);
+    if (index == -1) {
+        return false;
+    }
+    int n = (int)strlen(separator);
+    string_buffer_clear(before);
+    string_buffer_append_chars(before, chars, index);
+    string_buffer_clear(after);
+    string_buffer_append_chars(after, chars + index + n, length - index - n);
+    return true;
+}
+
+/**
+ * Description:
+ * The string_buffer_split_views function finds the first occurrence of a separator in the string buffer and sets before and after to views of the characters before and after it, without copying them.
+ * The views borrow the characters of the buffer and remain valid until the buffer is next modified.
+ *
+ * @param buffer A pointer to the string buffer to split.
+ * @param separator A pointer to the null-terminated separator.
+ * @param before A pointer to the view that is set to the characters before the separator.
+ * @param after A pointer to the view that is set to the characters after the separator.
+ *
+ * @return True if the separator occurs in the buffer, false otherwise.
+ */
+bool string_buffer_split_views(struct string_buffer *buffer, char *separator, struct string_view *before, struct string_view *after)
+{
+    char *chars = buffer->storage + buffer->start;
+    int length = buffer->length;
+    int index = chars_index_of_string(chars, length, separator);
+    if (index == -1) {
+        return false;
+    }
+    int n = (int)strlen(separator);
+    before->chars = chars;
+    before->length = index;
+    after->chars = chars + index + n;
+    after->length = length - index - n;
+    return true;
+}
+
+/**
+ * Description:
+ * The string_view_equals_string function checks whether the characters of a view are the same as those of a null-terminated string.
+ *
+ * @param view A pointer to the view.
+ * @param string A pointer to the null-terminated string.
+ *
+ * @return True if the view holds the characters of the string, false otherwise.
+ */
+bool string_view_equals_string(struct string_view *view, char *string)
+{
+    int length = view->length;
+    bool result = false;
+    if ((size_t)length == strlen(string)) {
+        result = memcmp(view->chars, string, (size_t)length) == 0;
+    }
+    return result;
+}
+
+/**
+ * Description:
+ * The string_buffer_append_string_view function appends the characters of a view to the string buffer.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param view A pointer to the view whose characters are appended.
+ */
+void string_buffer_append_string_view(struct string_buffer *buffer, struct string_view *view)
+{
+    string_buffer_append_chars(buffer, view->chars, view->length);
+}
+
+/**
+ * Description:
+ * The string_buffer_drop_front function removes the first length characters from the string buffer, or all of them if it holds fewer.
+ * It only advances the start of the characters in use and does not move the remaining characters.
+ *
+ * @param buffer A pointer to the string buffer.
+ * @param length The number of characters to remove.
+ */
+void string_buffer_drop_front(struct string_buffer *buffer, int length)
+{
+    int count = buffer->length;
+    if (count < length) {
+        length = count;
+    }
+    // The dropped characters stay where they are until an append needs their room.
+    if (length == count) {
+        buffer->start = 0;
+    } else {
+        buffer->start = buffer->start + length;
+    }
+    buffer->length = count - length;
+}
+
+/**
+ * Description:
+ * The string_buffer_dispose function frees the string buffer and its heap storage, if any. It does nothing if buffer is null.
+ *
+ * @param buffer A pointer to the string buffer, or null.
+ */
+void string_buffer_dispose(struct string_buffer *buffer)
+{
+    if (buffer != 0) {
+        if (buffer->storage != buffer->inline_chars) {
+            free(buffer->storage);
+        }
+        free(buffer);
+    }
+}
+
+#define MESSAGE_COUNT 1000000
+#define APPEND_COUNT 10000000
+#define LINE_COUNT 1000000
+
+/**
+ * Description:
+ * The main function is a microbenchmark of string buffers. It measures copying a short nick, building chat messages in a fresh buffer and in a reused buffer, appending ten million characters one at a time, and parsing a million lines by splitting off views and dropping them from the front, and prints the average time of each.
+ *
+ * @return 0.
+ */
+int main()
+{
+    struct string_buffer *nick = create_string_buffer();
+    string_buffer_append_string(nick, "alice");
+    struct string_buffer *text = create_string_buffer();
+    for (int i = 0; i < 8; i++)
+    {
+        string_buffer_append_string(text, "the quick brown fox ");
+    }
+
+    // Copies of a nick fit in the inline storage, so each costs one allocation.
+    long long start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        struct string_buffer *copy = string_buffer_copy(nick);
+        string_buffer_dispose(copy);
+    }
+    long long nickNanos = clock_now_nanos() - start;
+
+    // Builds every message in a fresh buffer, as the chat servers do for each join, leave and message.
+    start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        struct string_buffer *message = string_buffer_copy(nick);
+        string_buffer_append_string(message, " says: ");
+        string_buffer_append_string_buffer(message, text);
+        string_buffer_dispose(message);
+    }
+    long long freshNanos = clock_now_nanos() - start;
+
+    // Builds every message in the same buffer; clearing it keeps its capacity, so only the first message allocates.
+    struct string_buffer *message = create_string_buffer();
+    start = clock_now_nanos();
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        string_buffer_clear(message);
+        string_buffer_append_string_buffer(message, nick);
+        string_buffer_append_string(message, " says: ");
+        string_buffer_append_string_buffer(message, text);
+    }
+    long long reusedNanos = clock_now_nanos() - start;
+
+    // Appends to one buffer until it holds APPEND_COUNT characters; the capacity doubles about twenty times on the way.
+    string_buffer_clear(message);
+    start = clock_now_nanos();
+    for (int i = 0; i < APPEND_COUNT; i++)
+    {
+        string_buffer_append_string(message, "x");
+    }
+    long long appendNanos = clock_now_nanos() - start;
+    int length = string_buffer_get_length(message);
+
+    // Parses LINE_COUNT lines the way a protocol parser does: split off the first line as a view, then drop it from the
+    // front. Neither step copies the rest of the input.
+    string_buffer_clear(message);
+    for (int i = 0; i < LINE_COUNT; i++)
+    {
+        string_buffer_append_string(message, "alice says: hello\n");
+    }
+    struct string_view line;
+    struct string_view rest;
+    line.chars = 0;
+    line.length = 0;
+    rest.chars = 0;
+    rest.length = 0;
+    int lines = 0;
+    start = clock_now_nanos();
+    while (string_buffer_split_views(message, "\n", &line, &rest))
+    {
+        if (string_view_equals_string(&line, "alice says: hello") && lines < LINE_COUNT) {
+            lines++;
+        }
+        string_buffer_drop_front(message, line.length + 1);
+    }
+    long long parseNanos = clock_now_nanos() - start;
+
+    string_buffer_dispose(message);
+    string_buffer_dispose(text);
+    string_buffer_dispose(nick);
+    printf("nick copy: %d ns, fresh message: %d ns, reused message: %d ns, append: %d ns per character (%d characters)\n",
+        (int)(nickNanos / MESSAGE_COUNT), (int)(freshNanos / MESSAGE_COUNT), (int)(reusedNanos / MESSAGE_COUNT),
+        (int)(appendNanos / APPEND_COUNT), length);
+    printf("parse: %d ns per line (%d lines)\n", (int)(parseNanos / LINE_COUNT), lines);
+    return 0;
+}
@@ -0,0 +1,461 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "threading.h"
+#include "dlists.h"
+#include "clock.h"
+#include "thread_pool.h"
+//@ #include "ghostlist.gh"
+
+struct pool_task {
+    struct pool_task *next;
+    struct pool_task *prev;
+    struct pool_worker *home;
+    void *run;
+    void *data;
+    struct mutex_cond *finished;
+    bool done;
+    //@ struct pool *pool;
+    //@ any info;
+};
+
+struct pool_worker {
+    struct pool_task *first;
+    struct pool_task *last;
+    struct mutex *mutex;
+    struct pool *pool;
+    int index;
+    struct thread *thread;
+    //@ real frac;
+    //@ int ghost_list_id;
+};
+
+struct pool {
+    struct pool_worker **workers;
+    int worker_count;
+    struct mutex *mutex;
+    struct mutex_cond *work;
+    int submissions;
+    int next_worker;
+    bool closing;
+    //@ list<struct pool_worker *> worker_list;
+};
+
+/*@
+
+// The fields that both the joiner of a task and the worker running it read. Each holds half of them.
+// The home of a task is the worker it was submitted to; its mutex protects the task's done flag.
+predicate task_info(struct pool_task *task; struct pool *pool, struct pool_worker *home, void *run, void *data, any info, struct mutex_cond *finished) =
+    task->pool |-> pool &*& task->home |-> home &*& task->run |-> run &*& task->data |-> data &*& task->info |-> info &*& task->finished |-> finished;
+
+// The home of a task is one of the pool's workers, and the task's condition variable belongs to the home's mutex.
+predicate task_home(struct pool *pool, struct pool_worker *home, struct mutex_cond *finished) =
+    [_]pool->worker_list |-> ?workers &*& mem(home, workers) == true &*&
+    [_]home->mutex |-> ?mutex &*& [1/2]mutex_cond(finished, mutex);
+
+// A task in a deque, together with the precondition of its function.
+predicate queued_task(struct pool_task *task) =
+    [1/2]task_info(task, ?pool, ?home, ?run, ?data, ?info, ?finished) &*& is_thread_run_joinable(run) == true &*& thread_run_pre(run)(data, info) &*&
+    task_home(pool, home, finished) &*& [_]home->ghost_list_id |-> ?id &*& [1/2]ghost_list_member_handle(id, task);
+
+// Once a task has run, its worker leaves the postcondition, and everything else it held of the task, here for the joiner.
+predicate task_state(struct pool_task *task) =
+    task->done |-> ?done &*&
+    done ?
+        [1/2]task_info(task, ?pool, ?home, ?run, ?data, ?info, ?finished) &*& thread_run_post(run)(data, info) &*&
+        task_home(pool, home, finished) &*& task->next |-> _ &*& task->prev |-> _ &*&
+        [_]home->ghost_list_id |-> ?id &*& [1/2]ghost_list_member_handle(id, task)
+    :
+        true;
+
+// The pool mutex protects the submission counter and the closing flag, which idle workers wait on.
+predicate_ctor pool_inv(struct pool *pool)() =
+    pool->submissions |-> _ &*& pool->next_worker |-> ?next &*& pool->closing |-> _ &*& [_]pool->worker_count |-> ?count &*&
+    0 <= next &*& next < count;
+
+// A worker's mutex protects its deque and the state of every task submitted to it that has not been joined,
+// so that finishing and joining a task only contend with the users of that one deque.
+predicate_ctor deque(struct pool_worker *worker)() =
+    worker->first |-> ?first &*& worker->last |-> ?last &*& dlseg(first, 0, 0, last, _, queued_task) &*&
+    [_]worker->ghost_list_id |-> ?id &*& ghost_list<struct pool_task *>(id, ?tasks) &*& foreach(tasks, task_state);
+
+predicate pool_worker(struct pool_worker *worker) =
+    [_]worker->mutex |-> ?mutex &*& mutex(mutex, deque(worker)) &*& malloc_block_pool_worker(worker);
+
+predicate pool_worker_thread(struct pool_worker *worker) =
+    worker->thread |-> ?thread &*& thread(thread, pool_worker_run, worker, unit);
+
+// The part of a pool that its workers share with its users. Half belongs to the pool's users, and the worker threads
+// hold the other half between them, each the fraction recorded in its frac field.
+predicate pool_core(struct pool *pool; int workerCount, list<struct pool_worker *> workers) =
+    pool->workers |-> ?array &*& pool->worker_count |-> workerCount &*& 0 < workerCount &*&
+    pointers(array, workerCount, workers) &*& malloc_block_pointers(array, workerCount) &*& foreach(workers, pool_worker) &*&
+    [_]pool->worker_list |-> workers &*&
+    pool->mutex |-> ?mutex &*& mutex(mutex, pool_inv(pool)) &*& pool->work |-> ?work &*& mutex_cond(work, mutex);
+
+predicate pool(struct pool *pool; int workerCount) =
+    [1/2]pool_core(pool, workerCount, ?workers) &*& foreach(workers, pool_worker_thread) &*& malloc_block_pool(pool);
+
+predicate pool_task(struct pool_task *task, struct pool *pool, real frac, void *run, void *data, any info) =
+    [1/2]task_info(task, pool, ?home, run, data, info, ?finished) &*& [frac]pool(pool, _) &*& task_home(pool, home, finished) &*&
+    [_]home->ghost_list_id |-> ?id &*& [1/2]ghost_list_member_handle(id, task) &*& malloc_block_pool_task(task);
+
+predicate_family_instance thread_run_pre(pool_worker_run)(void *data, any info) =
+    pool_worker_share(data);
+predicate_family_instance thread_run_post(pool_worker_run)(void *data, any info) =
+    pool_worker_share(data);
+
+predicate pool_worker_share(struct pool_worker *worker) =
+    worker->pool |-> ?pool &*& worker->index |-> ?index &*& worker->frac |-> ?frac &*&
+    [frac]pool_core(pool, ?workerCount, ?workers) &*& 0 <= index &*& index < workerCount &*& nth(index, workers) == worker;
+@*/
+
+/*
+Adds a task at the bottom of a deque, where its owner takes the next task from.
+*/
+void deque_push_bottom(struct pool_worker *worker, struct pool_task *task)
+    //@ requires deque(worker)() &*& task->next |-> _ &*& task->prev |-> _ &*& queued_task(task);
+    //@ ensures deque(worker)();
+{
+    struct pool_task *last = worker->last;
+    task->next = 0;
+    task->prev = last;
+    if (last == 0) {
+        worker->first = task;
+    } else {
+        last->next = task;
+    }
+    worker->last = task;
+}
+
+/*
+Removes the task at the bottom of a deque, the one pushed last, or returns 0 if the deque is empty.
+*/
+struct pool_task *deque_pop_bottom(struct pool_worker *worker)
+    //@ requires deque(worker)();
+    //@ ensures deque(worker)() &*& result == 0 ? true : result->next |-> _ &*& result->prev |-> _ &*& queued_task(result);
+{
+    struct pool_task *task = worker->last;
+    if (task != 0) {
+        struct pool_task *prev = task->prev;
+        worker->last = prev;
+        if (prev == 0) {
+            worker->first = 0;
+        } else {
+            prev->next = 0;
+        }
+    }
+    return task;
+}
+
+/*
+Removes the task at the top of a deque, the one pushed first, or returns 0 if the deque is empty. Other workers steal
+from this end, so that they mostly do not contend with the owner for the same task.
+*/
+struct pool_task *deque_pop_top(struct pool_worker *worker)
+    //@ requires deque(worker)();
+    //@ ensures deque(worker)() &*& result == 0 ? true : result->next |-> _ &*& result->prev |-> _ &*& queued_task(result);
+{
+    struct pool_task *task = worker->first;
+    if (task != 0) {
+        struct pool_task *next = task->next;
+        worker->first = next;
+        if (next == 0) {
+            worker->last = 0;
+        } else {
+            next->prev = 0;
+        }
+    }
+    return task;
+}
+
+/*
+Takes a task for the worker with the given index: the newest task of its own deque or, if that is empty, the oldest
+task of the next worker whose deque is not. Returns 0 if every deque is empty.
+*/
+struct pool_task *pool_find_task(struct pool *pool, int index)
+    //@ requires [?f]pool_core(pool, ?workerCount, ?workers) &*& 0 <= index &*& index < workerCount;
+    //@ ensures [f]pool_core(pool, workerCount, workers) &*& result == 0 ? true : result->next |-> _ &*& result->prev |-> _ &*& queued_task(result);
+{
+    struct pool_worker **workers = pool->workers;
+    int workerCount = pool->worker_count;
+    struct pool_worker *own = workers[index];
+    mutex_acquire(own->mutex);
+    struct pool_task *task = deque_pop_bottom(own);
+    mutex_release(own->mutex);
+    for (int i = 1; task == 0 && i < workerCount; i++)
+    {
+        int victimIndex = index + i < workerCount ? index + i : index + i - workerCount;
+        struct pool_worker *victim = workers[victimIndex];
+        mutex_acquire(victim->mutex);
+        task = deque_pop_top(victim);
+        mutex_release(victim->mutex);
+    }
+    return task;
+}
+
+/*
+Waits for a task for the worker with the given index. Returns 0 once the pool is closing and no task is left.
+*/
+struct pool_task *pool_next_task(struct pool *pool, int index)
+    //@ requires [?f]pool_core(pool, ?workerCount, ?workers) &*& 0 <= index &*& index < workerCount;
+    //@ ensures [f]pool_core(pool, workerCount, workers) &*& result == 0 ? true : result->next |-> _ &*& result->prev |-> _ &*& queued_task(result);
+{
+    struct pool_task *task = pool_find_task(pool, index);
+    bool closing = false;
+    while (task == 0 && !closing)
+    {
+        // A task submitted after seen was read bumps the counter, so the wait below cannot miss it.
+        mutex_acquire(pool->mutex);
+        int seen = pool->submissions;
+        mutex_release(pool->mutex);
+        task = pool_find_task(pool, index);
+        if (task == 0) {
+            mutex_acquire(pool->mutex);
+            bool waiting = true;
+            while (waiting)
+            {
+                if (pool->submissions != seen || pool->closing) {
+                    closing = pool->closing;
+                    waiting = false;
+                } else {
+                    mutex_cond_wait(pool->work, pool->mutex);
+                }
+            }
+            mutex_release(pool->mutex);
+            task = pool_find_task(pool, index);
+        }
+    }
+    return task;
+}
+
+void pool_worker_run(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(pool_worker_run)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(pool_worker_run)(data, info) &*& lockset(currentThread, nil);
+{
+    struct pool_worker *worker = data;
+    struct pool *pool = worker->pool;
+    int index = worker->index;
+    for (;;)
+    {
+        struct pool_task *task = pool_next_task(pool, index);
+        if (task == 0) {
+            break;
+        }
+        thread_run_joinable *run = task->run;
+        run(task->data);
+        // The task may have been stolen from another deque; its done flag is guarded by its home's mutex.
+        struct pool_worker *home = task->home;
+        mutex_acquire(home->mutex);
+        task->done = true;
+        mutex_cond_signal(task->finished);
+        mutex_release(home->mutex);
+    }
+}
+
+struct pool *create_pool(int workerCount)
+    //@ requires 0 < workerCount;
+    //@ ensures pool(result, workerCount);
+{
+    struct pool *pool = malloc(sizeof(struct pool));
+    struct pool_worker **workers = malloc((size_t)workerCount * sizeof(struct pool_worker *));
+    if (pool == 0 || workers == 0) {
+        abort();
+    }
+    pool->workers = workers;
+    pool->worker_count = workerCount;
+    pool->submissions = 0;
+    pool->next_worker = 0;
+    pool->closing = false;
+    struct mutex *mutex = create_mutex();
+    pool->mutex = mutex;
+    pool->work = create_mutex_cond();
+    for (int i = 0; i < workerCount; i++)
+    {
+        struct pool_worker *worker = malloc(sizeof(struct pool_worker));
+        if (worker == 0) {
+            abort();
+        }
+        worker->first = 0;
+        worker->last = 0;
+        worker->pool = pool;
+        worker->index = i;
+        worker->mutex = create_mutex();
+        workers[i] = worker;
+    }
+    // Each worker gets half of the fraction of the core that is still unassigned, and the last one gets the rest.
+    for (int i = 0; i < workerCount; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        worker->thread = thread_start_joinable(pool_worker_run, worker);
+    }
+    return pool;
+}
+
+struct pool_task *pool_submit(struct pool *pool, void *run, void *data)
+    //@ requires [?f]pool(pool, ?workerCount) &*& is_thread_run_joinable(run) == true &*& thread_run_pre(run)(data, ?info);
+    //@ ensures [f/2]pool(pool, workerCount) &*& pool_task(result, pool, f/2, run, data, info);
+{
+    struct pool_task *task = malloc(sizeof(struct pool_task));
+    if (task == 0) {
+        abort();
+    }
+    task->run = run;
+    task->data = data;
+    task->done = false;
+    mutex_acquire(pool->mutex);
+    int index = pool->next_worker;
+    struct pool_worker *worker = pool->workers[index];
+    task->home = worker;
+    task->finished = create_mutex_cond();
+    mutex_acquire(worker->mutex);
+    deque_push_bottom(worker, task);
+    mutex_release(worker->mutex);
+    pool->next_worker = index + 1 == pool->worker_count ? 0 : index + 1;
+    pool->submissions = pool->submissions == INT_MAX ? 0 : pool->submissions + 1;
+    mutex_cond_signal(pool->work);
+    mutex_release(pool->mutex);
+    return task;
+}
+
+void pool_join(struct pool_task *task)
+    //@ requires pool_task(task, ?pool, ?f, ?run, ?data, ?info);
+    //@ ensures [f]pool(pool, _) &*& thread_run_post(run)(data, info);
+{
+    struct mutex *mutex = task->home->mutex;
+    mutex_acquire(mutex);
+    bool done = false;
+    while (!done)
+    {
+        done = task->done;
+        if (!done) {
+            mutex_cond_wait(task->finished, mutex);
+        }
+    }
+    mutex_release(mutex);
+    mutex_cond_dispose(task->finished);
+    free(task);
+}
+
+void pool_dispose(struct pool *pool)
+    //@ requires pool(pool, _);
+    //@ ensures emp;
+{
+    mutex_acquire(pool->mutex);
+    pool->closing = true;
+    // Wake every worker that is waiting for work; each signal wakes at most one of them.
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        mutex_cond_signal(pool->work);
+    }
+    mutex_release(pool->mutex);
+    struct pool_worker **workers = pool->workers;
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        thread_join(worker->thread);
+    }
+    // Every worker has returned its fraction of the core, so the pool now owns all of it.
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        mutex_dispose(worker->mutex);
+        free(worker);
+    }
+    free(workers);
+    mutex_cond_dispose(pool->work);
+    mutex_dispose(pool->mutex);
+    free(pool);
+}
+
+#define WORKER_COUNT 8
+#define BATCH_SIZE 64
+#define BATCH_COUNT 1000
+#define TASK_LENGTH 1000
+
+struct sum_task {
+    int start;
+    int sum;
+    struct thread *thread;
+    struct pool_task *pool_task;
+};
+
+/*@
+
+predicate sum_task(struct sum_task *task) =
+    task->start |-> ?start &*& 0 <= start &*& start <= INT_MAX - TASK_LENGTH &*& task->sum |-> _;
+
+predicate_family_instance thread_run_pre(sum_task_run)(void *data, any info) = sum_task(data);
+predicate_family_instance thread_run_post(sum_task_run)(void *data, any info) = sum_task(data);
+@*/
+
+/*
+A short task: sums the last digits of TASK_LENGTH consecutive numbers.
+*/
+void sum_task_run(void *data) //@ : thread_run_joinable
+    //@ requires thread_run_pre(sum_task_run)(data, ?info) &*& lockset(currentThread, nil);
+    //@ ensures thread_run_post(sum_task_run)(data, info) &*& lockset(currentThread, nil);
+{
+    struct sum_task *task = data;
+    int sum = 0;
+    for (int i = 0; i < TASK_LENGTH; i++)
+    {
+        sum += (task->start + i) % 10;
+    }
+    task->sum = sum;
+}
+
+/*
+Runs BATCH_COUNT batches of BATCH_SIZE short tasks, first with a thread per task and then on a pool, and prints the
+average time per task of each.
+*/
+int main() //@ : main
+    //@ requires true;
+    //@ ensures true;
+{
+    struct sum_task *tasks = malloc(BATCH_SIZE * sizeof(struct sum_task));
+    if (tasks == 0) {
+        abort();
+    }
+    long long threadTotal = 0;
+    long long start = clock_now_nanos();
+    for (int batch = 0; batch < BATCH_COUNT; batch++)
+    {
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            tasks[i].start = batch * BATCH_SIZE + i;
+            tasks[i].thread = thread_start_joinable(sum_task_run, &tasks[i]);
+        }
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            thread_join(tasks[i].thread);
+            threadTotal += tasks[i].sum;
+        }
+    }
+    long long threadNanos = clock_now_nanos() - start;
+
+    struct pool *pool = create_pool(WORKER_COUNT);
+    long long poolTotal = 0;
+    start = clock_now_nanos();
+    for (int batch = 0; batch < BATCH_COUNT; batch++)
+    {
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            tasks[i].start = batch * BATCH_SIZE + i;
+            tasks[i].pool_task = pool_submit(pool, sum_task_run, &tasks[i]);
+        }
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            pool_join(tasks[i].pool_task);
+            poolTotal += tasks[i].sum;
+        }
+    }
+    long long poolNanos = clock_now_nanos() - start;
+    pool_dispose(pool);
+    free(tasks);
+
+    int taskCount = BATCH_SIZE * BATCH_COUNT;
+    printf("thread per task: %d ns per task, pool of %d workers: %d ns per task (sums %s)\n",
+        (int)(threadNanos / taskCount), WORKER_COUNT, (int)(poolNanos / taskCount), threadTotal == poolTotal ? "agree" : "differ");
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include <stdbool.h>
+#include "stdlib.h"
+#include "stdio.h"
+#include "threading.h"
+#include "dlists.h"
+#include "clock.h"
+#include "thread_pool.h"
+
+struct pool_task {
+    struct pool_task *next;
+    struct pool_task *prev;
+    struct pool_worker *home;
+    void *run;
+    void *data;
+    struct mutex_cond *finished;
+    bool done;
+};
+
+struct pool_worker {
+    struct pool_task *first;
+    struct pool_task *last;
+    struct mutex *mutex;
+    struct pool *pool;
+    int index;
+    struct thread *thread;
+};
+
+struct pool {
+    struct pool_worker **workers;
+    int worker_count;
+    struct mutex *mutex;
+    struct mutex_cond *work;
+    int submissions;
+    int next_worker;
+    bool closing;
+};
+
+/**
+ * Description:
+ * The deque_push_bottom function adds a task at the bottom of a worker's deque, the end from which the worker itself takes its next task.
+ * The caller must hold the worker's mutex.
+ *
+ * @param worker A pointer to the worker that owns the deque.
+ * @param task A pointer to the task to add.
+ */
+void deque_push_bottom(struct pool_worker *worker, struct pool_task *task)
+{
+    struct pool_task *last = worker->last;
+    task->next = 0;
+    task->prev = last;
+    if (last == 0) {
+        worker->first = task;
+    } else {
+        last->next = task;
+    }
+    worker->last = task;
+}
+
+/**
+ * Description:
+ * The deque_pop_bottom function removes the task at the bottom of a worker's deque, which is the task that was pushed last.
+ * The caller must hold the worker's mutex.
+ *
+ * @param worker A pointer to the worker that owns the deque.
+ *
+ * @return The removed task, or 0 if the deque is empty.
+ */
+struct pool_task *deque_pop_bottom(struct pool_worker *worker)
+{
+    struct pool_task *task = worker->last;
+    if (task != 0) {
+        struct pool_task *prev = task->prev;
+        worker->last = prev;
+        if (prev == 0) {
+            worker->first = 0;
+        } else {
+            prev->next = 0;
+        }
+    }
+    return task;
+}
+
+/**
+ * Description:
+ * The deque_pop_top function removes the task at the top of a worker's deque, which is the task that was pushed first. Other workers steal from this end, so they mostly do not contend with the owner for the same task.
+ * The caller must hold the worker's mutex.
+ *
+ * @param worker A pointer to the worker that owns the deque.
+ *
+ * @return The removed task, or 0 if the deque is empty.
+ */
+struct pool_task *deque_pop_top(struct pool_worker *worker)
+{
+    struct pool_task *task = worker->first;
+    if (task != 0) {
+        struct pool_task *next = task->next;
+        worker->first = next;
+        if (next == 0) {
+            worker->last = 0;
+        } else {
+            next->prev = 0;
+        }
+    }
+    return task;
+}
+
+/**
+ * Description:
+ * The pool_find_task function takes a task for a worker. It first takes the newest task from the worker's own deque. If that deque is empty, it scans the other workers in turn, starting after this one, and steals the oldest task of the first deque that is not empty.
+ *
+ * @param pool A pointer to the pool.
+ * @param index The index of the worker looking for a task.
+ *
+ * @return The task taken, or 0 if every deque is empty.
+ */
+struct pool_task *pool_find_task(struct pool *pool, int index)
+{
+    struct pool_worker **workers = pool->workers;
+    int workerCount = pool->worker_count;
+    struct pool_worker *own = workers[index];
+    mutex_acquire(own->mutex);
+    struct pool_task *task = deque_pop_bottom(own);
+    mutex_release(own->mutex);
+    for (int i = 1; task == 0 && i < workerCount; i++)
+    {
+        int victimIndex = index + i < workerCount ? index + i : index + i - workerCount;
+        struct pool_worker *victim = workers[victimIndex];
+        mutex_acquire(victim->mutex);
+        task = deque_pop_top(victim);
+        mutex_release(victim->mutex);
+    }
+    return task;
+}
+
+/**
+ * Description:
+ * The pool_next_task function waits for a task for a worker. If no deque has a task, the worker records the pool's submission counter, searches again, and then waits on the pool's work condition until the counter changes or the pool is closing, so it cannot miss a task that was submitted in between.
+ *
+ * @param pool A pointer to the pool.
+ * @param index The index of the worker looking for a task.
+ *
+ * @return The next task, or 0 once the pool is closing and no task is left.
+ */
+struct pool_task *pool_next_task(struct pool *pool, int index)
+{
+    struct pool_task *task = pool_find_task(pool, index);
+    bool closing = false;
+    while (task == 0 && !closing)
+    {
+        // A task submitted after seen was read bumps the counter, so the wait below cannot miss it.
+        mutex_acquire(pool->mutex);
+        int seen = pool->submissions;
+        mutex_release(pool->mutex);
+        task = pool_find_task(pool, index);
+        if (task == 0) {
+            mutex_acquire(pool->mutex);
+            bool waiting = true;
+            while (waiting)
+            {
+                if (pool->submissions != seen || pool->closing) {
+                    closing = pool->closing;
+                    waiting = false;
+                } else {
+                    mutex_cond_wait(pool->work, pool->mutex);
+                }
+            }
+            mutex_release(pool->mutex);
+            task = pool_find_task(pool, index);
+        }
+    }
+    return task;
+}
+
+/**
+ * Description:
+ * The pool_worker_run function is the body of a worker thread. It repeatedly takes the next task and runs the task's function on its data. Afterwards, while holding the mutex of the task's home worker, the worker it was submitted to, it marks the task as done and signals the task's finished condition, so that finishing a task does not take a pool-wide mutex. It returns when the pool is closing and no task is left.
+ *
+ * @param data A pointer to the worker.
+ */
+void pool_worker_run(void *data)
+{
+    struct pool_worker *worker = data;
+    struct pool *pool = worker->pool;
+    int index = worker->index;
+    for (;;)
+    {
+        struct pool_task *task = pool_next_task(pool, index);
+        if (task == 0) {
+            break;
+        }
+        thread_run_joinable *run = task->run;
+        run(task->data);
+        struct pool_worker *home = task->home;
+        mutex_acquire(home->mutex);
+        task->done = true;
+        mutex_cond_signal(task->finished);
+        mutex_release(home->mutex);
+    }
+}
+
+/**
+ * Description:
+ * The create_pool function creates a thread pool with the given number of workers. Each worker gets an empty deque protected by its own mutex, and then its thread is started.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param workerCount The number of worker threads, which must be positive.
+ *
+ * @return A pointer to the new pool.
+ */
+struct pool *create_pool(int workerCount)
+{
+    struct pool *pool = malloc(sizeof(struct pool));
+    struct pool_worker **workers = malloc((size_t)workerCount * sizeof(struct pool_worker *));
+    if (pool == 0 || workers == 0) {
+        abort();
+    }
+    pool->workers = workers;
+    pool->worker_count = workerCount;
+    pool->submissions = 0;
+    pool->next_worker = 0;
+    pool->closing = false;
+    struct mutex *mutex = create_mutex();
+    pool->mutex = mutex;
+    pool->work = create_mutex_cond();
+    for (int i = 0; i < workerCount; i++)
+    {
+        struct pool_worker *worker = malloc(sizeof(struct pool_worker));
+        if (worker == 0) {
+            abort();
+        }
+        worker->first = 0;
+        worker->last = 0;
+        worker->pool = pool;
+        worker->index = i;
+        worker->mutex = create_mutex();
+        workers[i] = worker;
+    }
+    // Each worker gets half of the fraction of the core that is still unassigned, and the last one gets the rest.
+    for (int i = 0; i < workerCount; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        worker->thread = thread_start_joinable(pool_worker_run, worker);
+    }
+    return pool;
+}
+
+/**
+ * Description:
+ * The pool_submit function submits a task that runs the given function on the given data. The task is pushed onto the deque of the next worker in round-robin order, which becomes its home; its finished condition belongs to that worker's mutex. The pool's submission counter is then incremented, wrapping to 0 after INT_MAX, and one waiting worker is woken.
+ * If memory allocation fails, the program aborts.
+ *
+ * @param pool A pointer to the pool.
+ * @param run The function to run, which must be a thread_run_joinable function.
+ * @param data The data to pass to the function.
+ *
+ * @return A pointer to the task, which must be passed to pool_join exactly once.
+ */
+struct pool_task *pool_submit(struct pool *pool, void *run, void *data)
+{
+    struct pool_task *task = malloc(sizeof(struct pool_task));
+    if (task == 0) {
+        abort();
+    }
+    task->run = run;
+    task->data = data;
+    task->done = false;
+    mutex_acquire(pool->mutex);
+    int index = pool->next_worker;
+    struct pool_worker *worker = pool->workers[index];
+    task->home = worker;
+    task->finished = create_mutex_cond();
+    mutex_acquire(worker->mutex);
+    deque_push_bottom(worker, task);
+    mutex_release(worker->mutex);
+    pool->next_worker = index + 1 == pool->worker_count ? 0 : index + 1;
+    pool->submissions = pool->submissions == INT_MAX ? 0 : pool->submissions + 1;
+    mutex_cond_signal(pool->work);
+    mutex_release(pool->mutex);
+    return task;
+}
+
+/**
+ * Description:
+ * The pool_join function waits, under the mutex of the task's home worker, until the task has run, and then frees the task. It must not be called from within a task.
+ *
+ * @param task A pointer to a task returned by pool_submit.
+ */
+void pool_join(struct pool_task *task)
+{
+    struct mutex *mutex = task->home->mutex;
+    mutex_acquire(mutex);
+    bool done = false;
+    while (!done)
+    {
+        done = task->done;
+        if (!done) {
+            mutex_cond_wait(task->finished, mutex);
+        }
+    }
+    mutex_release(mutex);
+    mutex_cond_dispose(task->finished);
+    free(task);
+}
+
+/**
+ * Description:
+ * The pool_dispose function marks the pool as closing, wakes every waiting worker, and joins the worker threads once they have run all remaining tasks. It then frees the workers, their mutexes, and the pool. Every submitted task must have been joined.
+ *
+ * @param pool A pointer to the pool.
+ */
+void pool_dispose(struct pool *pool)
+{
+    mutex_acquire(pool->mutex);
+    pool->closing = true;
+    // Wake every worker that is waiting for work; each signal wakes at most one of them.
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        mutex_cond_signal(pool->work);
+    }
+    mutex_release(pool->mutex);
+    struct pool_worker **workers = pool->workers;
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        thread_join(worker->thread);
+    }
+    // Every worker has returned its fraction of the core, so the pool now owns all of it.
+    for (int i = 0; i < pool->worker_count; i++)
+    {
+        struct pool_worker *worker = workers[i];
+        mutex_dispose(worker->mutex);
+        free(worker);
+    }
+    free(workers);
+    mutex_cond_dispose(pool->work);
+    mutex_dispose(pool->mutex);
+    free(pool);
+}
+
+#define WORKER_COUNT 8
+#define BATCH_SIZE 64
+#define BATCH_COUNT 1000
+#define TASK_LENGTH 1000
+
+struct sum_task {
+    int start;
+    int sum;
+    struct thread *thread;
+    struct pool_task *pool_task;
+};
+
+/**
+ * Description:
+ * The sum_task_run function is a short benchmark task. It sums the last decimal digits of TASK_LENGTH consecutive numbers, starting at the task's start, and stores the result in the task's sum.
+ *
+ * @param data A pointer to the sum task.
+ */
+void sum_task_run(void *data)
+{
+    struct sum_task *task = data;
+    int sum = 0;
+    for (int i = 0; i < TASK_LENGTH; i++)
+    {
+        sum += (task->start + i) % 10;
+    }
+    task->sum = sum;
+}
+
+/**
+ * Description:
+ * The main function runs BATCH_COUNT batches of BATCH_SIZE sum tasks. It does this first with a thread per task and then on a pool of WORKER_COUNT workers, and prints the average time per task of each approach along with whether their sums agree.
+ *
+ * @return 0.
+ */
+int main()
+{
+    struct sum_task *tasks = malloc(BATCH_SIZE * sizeof(struct sum_task));
+    if (tasks == 0) {
+        abort();
+    }
+    long long threadTotal = 0;
+    long long start = clock_now_nanos();
+    for (int batch = 0; batch < BATCH_COUNT; batch++)
+    {
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            tasks[i].start = batch * BATCH_SIZE + i;
+            tasks[i].thread = thread_start_joinable(sum_task_run, &tasks[i]);
+        }
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            thread_join(tasks[i].thread);
+            threadTotal += tasks[i].sum;
+        }
+    }
+    long long threadNanos = clock_now_nanos() - start;
+
+    struct pool *pool = create_pool(WORKER_COUNT);
+    long long poolTotal = 0;
+    start = clock_now_nanos();
+    for (int batch = 0; batch < BATCH_COUNT; batch++)
+    {
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            tasks[i].start = batch * BATCH_SIZE + i;
+            tasks[i].pool_task = pool_submit(pool, sum_task_run, &tasks[i]);
+        }
+        for (int i = 0; i < BATCH_SIZE; i++)
+        {
+            pool_join(tasks[i].pool_task);
+            poolTotal += tasks[i].sum;
+        }
+    }
+    long long poolNanos = clock_now_nanos() - start;
+    pool_dispose(pool);
+    free(tasks);
+
+    int taskCount = BATCH_SIZE * BATCH_COUNT;
+    printf("thread per task: %d ns per task, pool of %d workers: %d ns per task (sums %s)\n",
+        (int)(threadNanos / taskCount), WORKER_COUNT, (int)(poolNanos / taskCount), threadTotal == poolTotal ? "agree" : "differ");
+    return 0;
+}
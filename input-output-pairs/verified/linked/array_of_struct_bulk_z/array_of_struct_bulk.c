@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+struct student {
+    char name[100];
+    int age;
+};
+
+// On-disk layout of a student record: the 100 name bytes, then the age as two little-endian bytes.
+// The layout does not depend on the padding of struct student.
+#define STUDENT_RECORD_SIZE 102
+
+/*@
+predicate students(struct student *students, int count;) =
+    count == 0 ?
+        emp
+    :
+        students->name[..100] |-> ?cs &*& mem('\0', cs) == true &*& students->age |-> _ &*&
+        struct_student_padding(students) &*&
+        students(students + 1, count - 1);
+
+lemma void students_to_chars_(struct student *students)
+    requires students(students, ?count);
+    ensures chars_((void *)students, count * sizeof(struct student), _);
+{
+    open students(students, count);
+    if (count == 0) {
+        close chars_((void *)students, 0, nil);
+    } else {
+        chars_to_chars_(students->name);
+        open_struct(students);
+        students_to_chars_(students + 1);
+        chars__join((void *)students);
+    }
+}
+@*/
+
+/*
+Loads the student records of a binary file (see STUDENT_RECORD_SIZE) with a single fread straight into the
+students array. A record is smaller than a struct student, so the records are then unpacked in place, from the last
+one to the first: struct i never reaches below record i, so it only overwrites records that are already unpacked.
+Struct i does overlap record i itself, which is why each name is staged in a local buffer while its slot is set up.
+Every record is checked in the same pass; the function aborts if a record has no terminating zero in its name or if
+the file is truncated.
+*/
+struct student *load_students(FILE *fp, int *count)
+//@ requires [?f]file(fp) &*& *count |-> _;
+//@ ensures [f]file(fp) &*& *count |-> ?nb &*& students(result, nb) &*& malloc_block_chars((void *)result, nb * sizeof(struct student));
+{
+    if (fseek(fp, 0, 2) != 0) abort();
+    long size = ftell(fp);
+    rewind(fp);
+    if (size < 0 || size % STUDENT_RECORD_SIZE != 0 || size / STUDENT_RECORD_SIZE > INT_MAX) abort();
+    int nb = (int)(size / STUDENT_RECORD_SIZE);
+    if (sizeof(struct student) < STUDENT_RECORD_SIZE || SIZE_MAX / sizeof(struct student) < (size_t)nb) abort();
+    //@ div_rem_nonneg(SIZE_MAX, sizeof(struct student));
+    //@ mul_mono_l(0, nb, sizeof(struct student));
+    //@ mul_mono_l(nb, SIZE_MAX / sizeof(struct student), sizeof(struct student));
+    //@ mul_mono_l(STUDENT_RECORD_SIZE, sizeof(struct student), nb);
+    struct student *result = malloc(nb * sizeof(struct student));
+    if (result == 0) abort();
+    char *bytes = (void *)result;
+    if (fread(bytes, STUDENT_RECORD_SIZE, (size_t)nb, fp) != nb) abort();
+    char name[100];
+    int i = nb;
+    //@ close students(result + nb, 0);
+    while (0 < i)
+    /*@
+    invariant
+        chars(bytes, i * STUDENT_RECORD_SIZE, _) &*& chars_(bytes + i * STUDENT_RECORD_SIZE, i * (sizeof(struct student) - STUDENT_RECORD_SIZE), _) &*&
+        students(result + i, nb - i) &*& name[..100] |-> _ &*& 0 <= i &*& i <= nb;
+    @*/
+    {
+        i--;
+        //@ mul_mono_l(0, i, sizeof(struct student) - STUDENT_RECORD_SIZE);
+        //@ chars_split(bytes, i * STUDENT_RECORD_SIZE);
+        char *record = bytes + (size_t)i * STUDENT_RECORD_SIZE;
+        //@ chars_split(record, 100);
+        memcpy(name, record, 100);
+        int age = (unsigned char)record[100] + 256 * (unsigned char)record[101];
+        //@ chars_join(record);
+        //@ chars_to_chars_(record);
+        //@ chars__join(record);
+        //@ chars__split(bytes + i * STUDENT_RECORD_SIZE, i * (sizeof(struct student) - STUDENT_RECORD_SIZE));
+        //@ close_struct(result + i);
+        memcpy(result[i].name, name, 100);
+        if (memchr(result[i].name, 0, 100) == 0) abort();
+        result[i].age = age;
+        //@ chars_to_chars_(name);
+        //@ close students(result + i, nb - i);
+    }
+    //@ open chars(bytes, 0, _);
+    //@ open chars_(bytes, 0, _);
+    *count = nb;
+    return result;
+}
+
+/*
+Counts the students that are older than the given age.
+*/
+int count_older_than(struct student *students, int count, int age)
+//@ requires [?f]students(students, count);
+//@ ensures [f]students(students, count) &*& 0 <= result &*& result <= count;
+{
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    //@ requires [f]students(students + i, count - i) &*& 0 <= nb &*& nb <= i;
+    //@ ensures [f]students(students + old_i, count - old_i) &*& nb <= old_nb + count - old_i &*& old_nb <= nb;
+    {
+        //@ open [f]students(students + i, count - i);
+        if (students[i].age > age) {
+            nb++;
+        }
+    }
+    return nb;
+}
+
+/*
+Frees an array of students.
+*/
+void free_students(struct student *students)
+//@ requires students(students, ?count) &*& malloc_block_chars((void *)students, count * sizeof(struct student));
+//@ ensures true;
+{
+    //@ students_to_chars_(students);
+    free((void *)students);
+}
+
+/*
+Loads the students of the file named by the first argument and prints how many of them are adults.
+*/
+int main(int argc, char **argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+    int count = 0;
+    if (argc < 2) { puts("No input file specified."); return -1; }
+    //@ open [_]argv(argv, argc, _);
+    //@ open [_]argv(argv + 1, argc - 1, _);
+    FILE *fp = fopen(argv[1], "rb");
+    if (fp == 0) abort();
+    struct student *students = load_students(fp, &count);
+    fclose(fp);
+    int adults = count_older_than(students, count, 17);
+    printf("%d\n", adults);
+    free_students(students);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+struct student {
+    char name[100];
+    int age;
+};
+
+// On-disk layout of a student record: the 100 name bytes, then the age as two little-endian bytes.
+// The layout does not depend on the padding of struct student.
+#define STUDENT_RECORD_SIZE 102
+
+/***
+ * Description:
+The load_students function loads all student records of a binary file without any user interaction.
+
+@param fp The file to read from. It holds a sequence of STUDENT_RECORD_SIZE-byte records (100 name bytes, then the age as two little-endian bytes).
+@param count A pointer to an integer that will store the number of students in the file.
+
+The function derives the number of records from the size of the file and reads all of them with a single fread
+straight into the students array, so no second buffer is allocated.
+It aborts if the size is not a multiple of STUDENT_RECORD_SIZE, if the memory allocation fails or exceeds system limits,
+or if the file is shorter than announced. It then unpacks the records in place, from the last one to the first,
+staging each name in a local buffer because a student overlaps its own record, and checks every record in the same pass,
+aborting if a name has no terminating zero. Finally, it returns a pointer to the array of students,
+in which every name is a zero-terminated string.
+*/
+struct student *load_students(FILE *fp, int *count)
+{
+    if (fseek(fp, 0, 2) != 0) abort();
+    long size = ftell(fp);
+    rewind(fp);
+    if (size < 0 || size % STUDENT_RECORD_SIZE != 0 || size / STUDENT_RECORD_SIZE > INT_MAX) abort();
+    int nb = (int)(size / STUDENT_RECORD_SIZE);
+    if (sizeof(struct student) < STUDENT_RECORD_SIZE || SIZE_MAX / sizeof(struct student) < (size_t)nb) abort();
+    struct student *result = malloc(nb * sizeof(struct student));
+    if (result == 0) abort();
+    char *bytes = (void *)result;
+    if (fread(bytes, STUDENT_RECORD_SIZE, (size_t)nb, fp) != nb) abort();
+    char name[100];
+    int i = nb;
+    while (0 < i)
+    {
+        i--;
+        char *record = bytes + (size_t)i * STUDENT_RECORD_SIZE;
+        memcpy(name, record, 100);
+        int age = (unsigned char)record[100] + 256 * (unsigned char)record[101];
+        memcpy(result[i].name, name, 100);
+        if (memchr(result[i].name, 0, 100) == 0) abort();
+        result[i].age = age;
+    }
+    *count = nb;
+    return result;
+}
+
+/***
+ * Description:
+The count_older_than function counts the students that are older than the given age.
+
+@param students A pointer to an array of students, which is only read.
+@param count The number of students in the array.
+@param age The age that a student must exceed to be counted.
+
+The function returns a number between 0 and count.
+*/
+int count_older_than(struct student *students, int count, int age)
+{
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (students[i].age > age) {
+            nb++;
+        }
+    }
+    return nb;
+}
+
+/***
+ * Description:
+The free_students function frees an array of students allocated by load_students.
+
+@param students A pointer to the array of students.
+*/
+void free_students(struct student *students)
+{
+    free((void *)students);
+}
+
+/***
+ * Description:
+The main function loads the students of the binary file named by the first command-line argument
+and prints how many of them are adults, i.e. older than 17.
+
+@param argc Number of command-line arguments.
+@param argv Array of command-line arguments.
+*/
+int main(int argc, char **argv)
+{
+    int count = 0;
+    if (argc < 2) { puts("No input file specified."); return -1; }
+    FILE *fp = fopen(argv[1], "rb");
+    if (fp == 0) abort();
+    struct student *students = load_students(fp, &count);
+    fclose(fp);
+    int adults = count_older_than(students, count, 17);
+    printf("%d\n", adults);
+    free_students(students);
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define SOA_BENCH_COUNT (1024 * 1024)
+
+// Array-of-structures (AoS) layout: one record per student or point.
+
+struct student {
+    char name[100];
+    int age;
+};
+
+struct point {
+    int x;
+    int y;
+};
+
+// Structure-of-arrays (SoA) layout: one array per field, so that a pass over one field
+// only touches that field's bytes.
+
+struct student_table {
+    char *names;
+    int *ages;
+    int count;
+};
+
+struct point_array {
+    int *xs;
+    int *ys;
+    int count;
+};
+
+/***
+ * Description:
+The `make_students` function allocates an array of `count` students with empty names and ages between 0 and 89 (in the AoS layout).
+It aborts if the allocation fails or exceeds system limits.
+
+@param count - the non-negative number of students.
+
+It ensures: every name of the returned array is a zero-terminated string.
+*/
+struct student *make_students(int count)
+{
+    if (SIZE_MAX / sizeof(struct student) < (size_t)count) abort();
+    struct student *result = malloc(count * sizeof(struct student));
+    if (result == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        memset(result[i].name, 0, 100);
+        result[i].age = i % 90;
+    }
+    return result;
+}
+
+/***
+ * Description:
+The `free_students` function frees an array of students.
+
+@param students - a pointer to the array of students.
+*/
+void free_students(struct student *students)
+{
+    free((void *)students);
+}
+
+/***
+ * Description:
+The `count_older_than` function counts the students that are older than the given age, in the AoS layout.
+Every student read brings a whole 104-byte record into the cache.
+
+@param students - a pointer to an array of students, which is only read.
+@param count - the number of students in the array.
+@param age - the age that a student must exceed to be counted.
+
+It returns the number of students whose age is greater than `age`.
+*/
+int count_older_than(struct student *students, int count, int age)
+{
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    {
+        nb += students[i].age > age ? 1 : 0;
+    }
+    return nb;
+}
+
+/***
+ * Description:
+The `student_table_of` function copies an array of students into a new student table (the SoA layout):
+the names are copied into one array of `100 * count` characters and the ages into one array of `count` integers.
+It aborts if an allocation fails or exceeds system limits.
+
+@param students - a pointer to an array of students, which is only read.
+@param count - the non-negative number of students in the array.
+
+It ensures: row i of the table has the same name and age as student i.
+*/
+struct student_table *student_table_of(struct student *students, int count)
+{
+    if (SIZE_MAX / 100 < (size_t)count || SIZE_MAX / sizeof(int) < (size_t)count) abort();
+    struct student_table *table = malloc(sizeof(struct student_table));
+    char *names = malloc((size_t)count * 100);
+    int *as = malloc((size_t)count * sizeof(int));
+    if (table == 0 || names == 0 || as == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(names + (size_t)i * 100, students[i].name, 100);
+        as[i] = students[i].age;
+    }
+    table->names = names;
+    table->ages = as;
+    table->count = count;
+    return table;
+}
+
+/***
+ * Description:
+The `student_table_dispose` function frees a student table together with its arrays.
+
+@param table - the student table to free.
+*/
+void student_table_dispose(struct student_table *table)
+{
+    free(table->names);
+    free(table->ages);
+    free(table);
+}
+
+/***
+ * Description:
+The `table_count_older_than` function counts the students of a table that are older than the given age, in the SoA layout.
+The pass reads only the ages array, 4 bytes per student, and vectorizes.
+
+@param table - the student table, which is only read.
+@param age - the age that a student must exceed to be counted.
+
+It returns the same count as `count_older_than` on the array the table was copied from.
+*/
+int table_count_older_than(struct student_table *table, int age)
+{
+    int *as = table->ages;
+    int count = table->count;
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    {
+        nb += as[i] > age ? 1 : 0;
+    }
+    return nb;
+}
+
+/***
+ * Description:
+The `make_points` function allocates an array of `count` points on the line y = 2 * x, with x from 0 to count - 1 (in the AoS layout).
+It aborts if the allocation fails or exceeds system limits.
+
+@param count - the non-negative number of points, such that 2 * count fits in an int.
+*/
+struct point *make_points(int count)
+{
+    if (SIZE_MAX / sizeof(struct point) < (size_t)count) abort();
+    struct point *result = malloc(count * sizeof(struct point));
+    if (result == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        result[i].x = i;
+        result[i].y = 2 * i;
+    }
+    return result;
+}
+
+/***
+ * Description:
+The `free_points` function frees an array of points.
+
+@param points - a pointer to the array of points.
+*/
+void free_points(struct point *points)
+{
+    free((void *)points);
+}
+
+/***
+ * Description:
+The `points_centroid` function computes the centroid of an array of points, in the AoS layout.
+The coordinates are summed in a wider type, so the sums cannot overflow, and the averages are rounded toward zero.
+
+@param points - a pointer to an array of points, which is only read.
+@param count - the positive number of points in the array.
+@param cx - a pointer to where the x coordinate of the centroid is stored.
+@param cy - a pointer to where the y coordinate of the centroid is stored.
+*/
+void points_centroid(struct point *points, int count, long long *cx, long long *cy)
+{
+    long long sx = 0;
+    long long sy = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sx += points[i].x;
+        sy += points[i].y;
+    }
+    *cx = sx / count;
+    *cy = sy / count;
+}
+
+/***
+ * Description:
+The `point_array_of` function copies an array of points into a new point array (the SoA layout),
+with one array of x coordinates and one array of y coordinates.
+It aborts if an allocation fails or exceeds system limits.
+
+@param points - a pointer to an array of points, which is only read.
+@param count - the non-negative number of points in the array.
+
+It ensures: element i of both coordinate arrays holds the coordinates of point i.
+*/
+struct point_array *point_array_of(struct point *points, int count)
+{
+    if (SIZE_MAX / sizeof(int) < (size_t)count) abort();
+    struct point_array *array = malloc(sizeof(struct point_array));
+    int *px = malloc((size_t)count * sizeof(int));
+    int *py = malloc((size_t)count * sizeof(int));
+    if (array == 0 || px == 0 || py == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        px[i] = points[i].x;
+        py[i] = points[i].y;
+    }
+    array->xs = px;
+    array->ys = py;
+    array->count = count;
+    return array;
+}
+
+/***
+ * Description:
+The `point_array_dispose` function frees a point array together with its coordinate arrays.
+
+@param array - the point array to free.
+*/
+void point_array_dispose(struct point_array *array)
+{
+    free(array->xs);
+    free(array->ys);
+    free(array);
+}
+
+/***
+ * Description:
+The `sum_ints` function returns the sum of the first `count` elements of an integer array, computed in a wider type so that it cannot overflow.
+
+@param values - a pointer to an integer array, which is only read.
+@param count - the number of elements to sum.
+*/
+long long sum_ints(int *values, int count)
+{
+    long long acc = 0;
+    for (int i = 0; i < count; i++)
+    {
+        acc += values[i];
+    }
+    return acc;
+}
+
+/***
+ * Description:
+The `point_array_centroid` function computes the centroid of the points of a point array, in the SoA layout, rounded toward zero.
+Each coordinate is summed by its own pass over one array, and both passes vectorize.
+
+@param array - the non-empty point array, which is only read.
+@param cx - a pointer to where the x coordinate of the centroid is stored.
+@param cy - a pointer to where the y coordinate of the centroid is stored.
+
+It stores the same centroid as `points_centroid` on the array the point array was copied from.
+*/
+void point_array_centroid(struct point_array *array, long long *cx, long long *cy)
+{
+    int count = array->count;
+    *cx = sum_ints(array->xs, count) / count;
+    *cy = sum_ints(array->ys, count) / count;
+}
+
+/***
+ * Description:
+The `main` function runs the age-filter and centroid queries on the same data in both layouts, checks that they agree and prints the results.
+*/
+int main()
+{
+    struct student *students = make_students(SOA_BENCH_COUNT);
+    struct student_table *table = student_table_of(students, SOA_BENCH_COUNT);
+    int adults_aos = count_older_than(students, SOA_BENCH_COUNT, 17);
+    int adults_soa = table_count_older_than(table, 17);
+    assert(adults_aos == adults_soa);
+    student_table_dispose(table);
+    free_students(students);
+
+    long long cx_aos = 0; long long cy_aos = 0; long long cx_soa = 0; long long cy_soa = 0;
+    struct point *points = make_points(SOA_BENCH_COUNT);
+    struct point_array *array = point_array_of(points, SOA_BENCH_COUNT);
+    points_centroid(points, SOA_BENCH_COUNT, &cx_aos, &cy_aos);
+    point_array_centroid(array, &cx_soa, &cy_soa);
+    assert(cx_aos == cx_soa && cy_aos == cy_soa);
+    point_array_dispose(array);
+    free_points(points);
+    printf("%d %lld %lld\n", adults_soa, cx_soa, cy_soa);
+    return 0;
+}
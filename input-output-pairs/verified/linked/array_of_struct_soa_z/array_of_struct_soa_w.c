@@ -0,0 +1,327 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define SOA_BENCH_COUNT (1024 * 1024)
+
+// Array-of-structures (AoS) layout: one record per student or point.
+
+struct student {
+    char name[100];
+    int age;
+};
+
+struct point {
+    int x;
+    int y;
+};
+
+// Structure-of-arrays (SoA) layout: one array per field, so that a pass over one field
+// only touches that field's bytes.
+
+struct student_table {
+    char *names;
+    int *ages;
+    int count;
+};
+
+struct point_array {
+    int *xs;
+    int *ys;
+    int count;
+};
+
+/*@
+fixpoint int count_gt(list<int> xs, int bound) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return (x0 > bound ? 1 : 0) + count_gt(xs0, bound);
+    }
+}
+
+fixpoint int sum(list<int> xs) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return x0 + sum(xs0);
+    }
+}
+
+predicate students(struct student *students, int count;) =
+    count == 0 ?
+        emp
+    :
+        students->name[..100] |-> ?cs &*& mem('\0', cs) == true &*& students->age |-> _ &*&
+        struct_student_padding(students) &*&
+        students(students + 1, count - 1);
+
+// The students predicate, together with the names and the ages of the students.
+predicate student_rows(struct student *students, int count; list<list<char> > names, list<int> ages) =
+    count == 0 ?
+        names == nil &*& ages == nil
+    :
+        students->name[..100] |-> ?cs &*& mem('\0', cs) == true &*& students->age |-> ?age &*&
+        struct_student_padding(students) &*&
+        student_rows(students + 1, count - 1, ?names0, ?ages0) &*& names == cons(cs, names0) &*& ages == cons(age, ages0);
+
+predicate names(char *names, int count; list<list<char> > rows) =
+    count == 0 ?
+        rows == nil
+    :
+        names[..100] |-> ?cs &*& mem('\0', cs) == true &*& names(names + 100, count - 1, ?rows0) &*& rows == cons(cs, rows0);
+
+// A student table with the given names and ages holds the same rows as student_rows(_, count, names, ages):
+// row i has name names[100 * i..100 * i + 100] and age nth(i, ages).
+predicate student_table(struct student_table *table; list<list<char> > names, list<int> ages) =
+    table->names |-> ?ns &*& table->ages |-> ?as &*& table->count |-> ?count &*& 0 <= count &*&
+    names(ns, count, names) &*& as[..count] |-> ages &*&
+    malloc_block_chars(ns, count * 100) &*& malloc_block_ints(as, count) &*& malloc_block_student_table(table);
+
+predicate points(struct point *points, int count; list<int> xs, list<int> ys) =
+    count == 0 ?
+        xs == nil &*& ys == nil
+    :
+        points->x |-> ?x &*& points->y |-> ?y &*& struct_point_padding(points) &*&
+        points(points + 1, count - 1, ?xs0, ?ys0) &*& xs == cons(x, xs0) &*& ys == cons(y, ys0);
+
+// A point array with the given coordinates holds the same points as points(_, count, xs, ys).
+predicate point_array(struct point_array *array; list<int> xs, list<int> ys) =
+    array->xs |-> ?px &*& array->ys |-> ?py &*& array->count |-> ?count &*& 0 <= count &*&
+    px[..count] |-> xs &*& py[..count] |-> ys &*&
+    malloc_block_ints(px, count) &*& malloc_block_ints(py, count) &*& malloc_block_point_array(array);
+@*/
+
+/*
+Allocates count students with empty names and ages between 0 and 89.
+*/
+struct student *make_students(int count)
+//@ requires 0 <= count;
+//@ ensures student_rows(result, count, _, _) &*& malloc_block_chars((void *)result, count * sizeof(struct student));
+{
+    if (SIZE_MAX / sizeof(struct student) < (size_t)count) abort();
+    struct student *result = malloc(count * sizeof(struct student));
+    if (result == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        memset(result[i].name, 0, 100);
+        result[i].age = i % 90;
+    }
+    return result;
+}
+
+/*
+Frees an array of students.
+*/
+void free_students(struct student *students)
+//@ requires student_rows(students, ?count, _, _) &*& malloc_block_chars((void *)students, count * sizeof(struct student));
+//@ ensures true;
+{
+    free((void *)students);
+}
+
+/*
+Counts the students that are older than the given age (AoS layout).
+Every student read brings a whole 104-byte record into the cache.
+*/
+int count_older_than(struct student *students, int count, int age)
+//@ requires [?f]student_rows(students, count, ?names, ?ages);
+//@ ensures [f]student_rows(students, count, names, ages);
+{
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    {
+        nb += students[i].age > age ? 1 : 0;
+    }
+    return nb;
+}
+
+/*
+Copies an array of students into a new student table, row by row: the table holds the same names and ages in the
+same order.
+*/
+struct student_table *student_table_of(struct student *students, int count)
+//@ requires [?f]student_rows(students, count, ?rows, ?ages) &*& 0 <= count;
+//@ ensures [f]student_rows(students, count, rows, ages) &*& student_table(result, _, _);
+{
+    if (SIZE_MAX / 100 < (size_t)count || SIZE_MAX / sizeof(int) < (size_t)count) abort();
+    struct student_table *table = malloc(sizeof(struct student_table));
+    char *names = malloc((size_t)count * 100);
+    int *as = malloc((size_t)count * sizeof(int));
+    if (table == 0 || names == 0 || as == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        memcpy(names + (size_t)i * 100, students[i].name, 100);
+        as[i] = students[i].age;
+    }
+    table->names = names;
+    table->ages = as;
+    table->count = count;
+    return table;
+}
+
+/*
+Frees a student table.
+*/
+void student_table_dispose(struct student_table *table)
+//@ requires student_table(table, _, _);
+//@ ensures true;
+{
+    free(table->names);
+    free(table->ages);
+    free(table);
+}
+
+/*
+Counts the students of a table that are older than the given age (SoA layout).
+The pass reads only the ages array, 4 bytes per student, and vectorizes.
+*/
+int table_count_older_than(struct student_table *table, int age)
+//@ requires [?f]student_table(table, ?names, ?ages);
+//@ ensures [f]student_table(table, names, ages);
+{
+    int *as = table->ages;
+    int count = table->count;
+    int nb = 0;
+    for (int i = 0; i < count; i++)
+    {
+        nb += as[i] > age ? 1 : 0;
+    }
+    return nb;
+}
+
+/*
+Allocates count points on the line y = 2 * x, with x from 0 to count - 1.
+*/
+struct point *make_points(int count)
+//@ requires 0 <= count &*& 2 * count <= INT_MAX;
+//@ ensures points(result, count, _, _) &*& malloc_block_chars((void *)result, count * sizeof(struct point));
+{
+    if (SIZE_MAX / sizeof(struct point) < (size_t)count) abort();
+    struct point *result = malloc(count * sizeof(struct point));
+    if (result == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        result[i].x = i;
+        result[i].y = 2 * i;
+    }
+    return result;
+}
+
+/*
+Frees an array of points.
+*/
+void free_points(struct point *points)
+//@ requires points(points, ?count, _, _) &*& malloc_block_chars((void *)points, count * sizeof(struct point));
+//@ ensures true;
+{
+    free((void *)points);
+}
+
+/*
+Computes the centroid of count points (AoS layout), rounded toward zero.
+*/
+void points_centroid(struct point *points, int count, long long *cx, long long *cy)
+//@ requires [?f]points(points, count, ?xs, ?ys) &*& 0 < count &*& *cx |-> _ &*& *cy |-> _;
+//@ ensures [f]points(points, count, xs, ys) &*& *cx |-> _ &*& *cy |-> _;
+{
+    long long sx = 0;
+    long long sy = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sx += points[i].x;
+        sy += points[i].y;
+    }
+    *cx = sx / count;
+    *cy = sy / count;
+}
+
+/*
+Copies an array of points into a new point array.
+*/
+struct point_array *point_array_of(struct point *points, int count)
+//@ requires [?f]points(points, count, ?xs, ?ys) &*& 0 <= count;
+//@ ensures [f]points(points, count, xs, ys) &*& point_array(result, _, _);
+{
+    if (SIZE_MAX / sizeof(int) < (size_t)count) abort();
+    struct point_array *array = malloc(sizeof(struct point_array));
+    int *px = malloc((size_t)count * sizeof(int));
+    int *py = malloc((size_t)count * sizeof(int));
+    if (array == 0 || px == 0 || py == 0) abort();
+    for (int i = 0; i < count; i++)
+    {
+        px[i] = points[i].x;
+        py[i] = points[i].y;
+    }
+    array->xs = px;
+    array->ys = py;
+    array->count = count;
+    return array;
+}
+
+/*
+Frees a point array.
+*/
+void point_array_dispose(struct point_array *array)
+//@ requires point_array(array, _, _);
+//@ ensures true;
+{
+    free(array->xs);
+    free(array->ys);
+    free(array);
+}
+
+/*
+Returns the sum of the first count elements of values, in a wider type so that it cannot overflow.
+*/
+long long sum_ints(int *values, int count)
+//@ requires [?f]values[..count] |-> ?vs;
+//@ ensures [f]values[..count] |-> vs;
+{
+    long long acc = 0;
+    for (int i = 0; i < count; i++)
+    {
+        acc += values[i];
+    }
+    return acc;
+}
+
+/*
+Computes the centroid of the points of an array (SoA layout), rounded toward zero.
+Each coordinate is summed by its own pass over one array, and both passes vectorize.
+*/
+void point_array_centroid(struct point_array *array, long long *cx, long long *cy)
+//@ requires [?f]point_array(array, ?xs, ?ys) &*& xs != nil &*& *cx |-> _ &*& *cy |-> _;
+//@ ensures [f]point_array(array, xs, ys) &*& *cx |-> _ &*& *cy |-> _;
+{
+    int count = array->count;
+    *cx = sum_ints(array->xs, count) / count;
+    *cy = sum_ints(array->ys, count) / count;
+}
+
+/*
+Runs the age-filter and centroid queries on the same data in both layouts and checks that they agree.
+*/
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+    struct student *students = make_students(SOA_BENCH_COUNT);
+    struct student_table *table = student_table_of(students, SOA_BENCH_COUNT);
+    int adults_aos = count_older_than(students, SOA_BENCH_COUNT, 17);
+    int adults_soa = table_count_older_than(table, 17);
+    assert(adults_aos == adults_soa);
+    student_table_dispose(table);
+    free_students(students);
+
+    long long cx_aos = 0; long long cy_aos = 0; long long cx_soa = 0; long long cy_soa = 0;
+    struct point *points = make_points(SOA_BENCH_COUNT);
+    struct point_array *array = point_array_of(points, SOA_BENCH_COUNT);
+    points_centroid(points, SOA_BENCH_COUNT, &cx_aos, &cy_aos);
+    point_array_centroid(array, &cx_soa, &cy_soa);
+    assert(cx_aos == cx_soa && cy_aos == cy_soa);
+    point_array_dispose(array);
+    free_points(points);
+    printf("%d %lld %lld\n", adults_soa, cx_soa, cy_soa);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "stdlib.h"
+#include "string.h"
+
+// The stack of filter_stack, stored in an array instead of a list of nodes. The top of the stack is
+// values[count - 1]. The array grows when a push finds it full and never shrinks, so once it is large enough,
+// pushes and pops no longer allocate or free anything.
+
+#define STACK_INITIAL_CAPACITY 8
+
+struct stack
+{
+    int *values;
+    int count;
+    int capacity;
+};
+
+/*@
+predicate stack(struct stack *stack, int count) =
+stack->values |-> ?values &*& stack->count |-> count &*& stack->capacity |-> ?capacity &*&
+malloc_block_stack(stack) &*& 0 <= count &*& count <= capacity &*&
+malloc_block_ints(values, capacity) &*& values[0..count] |-> _ &*& values[count..capacity] |-> _;
+@*/
+
+struct stack *create_stack()
+//@ requires true;
+//@ ensures stack(result, 0);
+{
+    struct stack *stack = malloc(sizeof(struct stack));
+    if (stack == 0)
+    {
+        abort();
+    }
+    int *values = malloc(STACK_INITIAL_CAPACITY * sizeof(int));
+    if (values == 0)
+    {
+        abort();
+    }
+    stack->values = values;
+    stack->count = 0;
+    stack->capacity = STACK_INITIAL_CAPACITY;
+    //@ close stack(stack, 0);
+    return stack;
+}
+
+void stack_push(struct stack *stack, int value)
+//@ requires stack(stack, ?count);
+//@ ensures stack(stack, count + 1);
+{
+    //@ open stack(stack, count);
+    if (stack->count == stack->capacity)
+    {
+        // Move the values to an array about twice as large.
+        int *values = stack->values;
+        int capacity = stack->capacity;
+        //@ div_rem_nonneg(INT_MAX, 2);
+        if (INT_MAX / 2 - 1 < capacity)
+        {
+            abort();
+        }
+        int *newValues = malloc(((size_t)capacity * 2 + 1) * sizeof(int));
+        if (newValues == 0)
+        {
+            abort();
+        }
+        //@ ints__split(newValues, count);
+        //@ mul_mono_l(0, count, sizeof(int));
+        memcpy(newValues, values, (size_t)capacity * sizeof(int));
+        //@ chars_to_ints(newValues, count);
+        //@ chars_to_ints(values, count);
+        free(values);
+        stack->values = newValues;
+        stack->capacity = capacity * 2 + 1;
+    }
+    stack->values[stack->count] = value;
+    stack->count++;
+    //@ close stack(stack, count + 1);
+}
+
+int stack_pop(struct stack *stack)
+//@ requires stack(stack, ?count) &*& 0 < count;
+//@ ensures stack(stack, count - 1);
+{
+    //@ open stack(stack, count);
+    stack->count--;
+    int result = stack->values[stack->count];
+    //@ close stack(stack, count - 1);
+    return result;
+}
+
+typedef bool int_predicate(int x);
+//@ requires true;
+//@ ensures true;
+
+/*
+Removes the values for which p returns false, in one pass over the array: each value that is kept is moved down to
+the next free position, so the kept values stay in order and nothing is allocated or freed.
+*/
+void stack_filter(struct stack *stack, int_predicate *p)
+//@ requires stack(stack, _) &*& is_int_predicate(p) == true;
+//@ ensures stack(stack, _);
+{
+    //@ open stack(stack, ?count);
+    int *values = stack->values;
+    int kept = 0;
+    for (int i = 0; i < stack->count; i++)
+    //@ invariant stack->count |-> count &*& 0 <= kept &*& kept <= i &*& i <= count &*& values[0..kept] |-> _ &*& values[kept..i] |-> _ &*& values[i..count] |-> _;
+    {
+        int value = values[i];
+        bool keep = p(value);
+        if (keep)
+        {
+            values[kept] = value;
+            kept++;
+        }
+    }
+    stack->count = kept;
+    //@ close stack(stack, kept);
+}
+
+void stack_dispose(struct stack *stack)
+//@ requires stack(stack, _);
+//@ ensures true;
+{
+    //@ open stack(stack, _);
+    free(stack->values);
+    free(stack);
+}
+
+bool neq_20(int x) //@ : int_predicate
+//@ requires true;
+//@ ensures true;
+{
+    return x != 20;
+}
+
+int main()
+//@ requires true;
+//@ ensures true;
+{
+    struct stack *s = create_stack();
+    for (int i = 0; i < 3 * STACK_INITIAL_CAPACITY; i++)
+    //@ invariant stack(s, i) &*& 0 <= i;
+    {
+        stack_push(s, 10 * (i % 3 + 1));
+    }
+    stack_filter(s, neq_20);
+    stack_push(s, 20);
+    stack_pop(s);
+    stack_dispose(s);
+    return 0;
+}
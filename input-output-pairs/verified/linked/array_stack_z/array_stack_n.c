@@ -0,0 +1,161 @@
+#include "stdlib.h"
+#include "string.h"
+
+// The stack of filter_stack, stored in an array instead of a list of nodes. The top of the stack is
+// values[count - 1]. The array grows when a push finds it full and never shrinks, so once it is large enough,
+// pushes and pops no longer allocate or free anything.
+
+#define STACK_INITIAL_CAPACITY 8
+
+struct stack
+{
+    int *values;
+    int count;
+    int capacity;
+};
+
+/**
+ * Description:
+ * The `create_stack` function creates an empty stack backed by an array of STACK_INITIAL_CAPACITY values.
+ * If memory allocation fails, the program aborts.
+ *
+ * @return a pointer to the newly created stack.
+ */
+struct stack *create_stack()
+{
+    struct stack *stack = malloc(sizeof(struct stack));
+    if (stack == 0)
+    {
+        abort();
+    }
+    int *values = malloc(STACK_INITIAL_CAPACITY * sizeof(int));
+    if (values == 0)
+    {
+        abort();
+    }
+    stack->values = values;
+    stack->count = 0;
+    stack->capacity = STACK_INITIAL_CAPACITY;
+    return stack;
+}
+
+/**
+ * Description:
+ * The `stack_push` function pushes a value onto the stack. If the array is full, the values are first moved to
+ * an array about twice as large, so pushes allocate nothing once the array is large enough.
+ *
+ * @param stack a pointer to the stack.
+ * @param value the integer value to push onto the stack.
+ */
+void stack_push(struct stack *stack, int value)
+{
+    if (stack->count == stack->capacity)
+    {
+        // Move the values to an array about twice as large.
+        int *values = stack->values;
+        int capacity = stack->capacity;
+        if (INT_MAX / 2 - 1 < capacity)
+        {
+            abort();
+        }
+        int *newValues = malloc(((size_t)capacity * 2 + 1) * sizeof(int));
+        if (newValues == 0)
+        {
+            abort();
+        }
+        memcpy(newValues, values, (size_t)capacity * sizeof(int));
+        free(values);
+        stack->values = newValues;
+        stack->capacity = capacity * 2 + 1;
+    }
+    stack->values[stack->count] = value;
+    stack->count++;
+}
+
+/**
+ * Description:
+ * The `stack_pop` function removes the top value of the stack and returns it. The stack must not be empty.
+ *
+ * @param stack a pointer to the stack.
+ *
+ * @return the value that was on top of the stack.
+ */
+int stack_pop(struct stack *stack)
+{
+    stack->count--;
+    int result = stack->values[stack->count];
+    return result;
+}
+
+typedef bool int_predicate(int x);
+
+/**
+ * Description:
+ * The `stack_filter` function removes the values for which the predicate returns false, in place: each kept value
+ * is moved down to the next free position, so the kept values keep their order.
+ *
+ * @param stack a pointer to the stack.
+ * @param p the predicate that decides which values to keep.
+ */
+void stack_filter(struct stack *stack, int_predicate *p)
+{
+    int *values = stack->values;
+    int kept = 0;
+    for (int i = 0; i < stack->count; i++)
+    {
+        int value = values[i];
+        bool keep = p(value);
+        if (keep)
+        {
+            values[kept] = value;
+            kept++;
+        }
+    }
+    stack->count = kept;
+}
+
+/**
+ * Description:
+ * The `stack_dispose` function frees the array of the stack and the stack itself.
+ *
+ * @param stack a pointer to the stack.
+ */
+void stack_dispose(struct stack *stack)
+{
+    free(stack->values);
+    free(stack);
+}
+
+/**
+ * Description:
+ * The `neq_20` function checks whether a value is different from 20.
+ *
+ * @param x the value to check.
+ *
+ * @return true if x is not 20, false otherwise.
+ */
+bool neq_20(int x)
+{
+    return x != 20;
+}
+
+/**
+ * Description:
+ * The `main` function pushes enough values to make the stack grow twice, filters out the 20s, pushes and pops
+ * a value and disposes the stack.
+ *
+ * @return 0.
+ */
+int main()
+{
+    struct stack *s = create_stack();
+    for (int i = 0; i < 3 * STACK_INITIAL_CAPACITY; i++)
+    {
+        stack_push(s, 10 * (i % 3 + 1));
+    }
+    stack_filter(s, neq_20);
+    stack_push(s, 20);
+    stack_pop(s);
+    stack_dispose(s);
+    return 0;
+}
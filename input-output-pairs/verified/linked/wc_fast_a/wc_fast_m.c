@@ -0,0 +1,135 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include <stdbool.h>
+#include "assert.h"
+
+#define WC_CHUNK_SIZE (64 * 1024)
+
+/*@
+// Spaces, line breaks, tabs and carriage returns separate words, as for `wc -w`.
+fixpoint bool separator(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+
+fixpoint int wcount(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return inword ? 1 : 0;
+    case cons(h, t): return 0 == h ? (inword ? 1 : 0) : (separator(h) ? ((inword ? 1 : 0) + wcount(t, false)) : wcount(t, true));
+  }
+}
+
+// The number of words that a chunk closes, i.e. words followed by a separator inside the chunk.
+fixpoint int wcompleted(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return 0;
+    case cons(h, t): return separator(h) ? ((inword ? 1 : 0) + wcompleted(t, false)) : wcompleted(t, true);
+  }
+}
+
+// Whether a word is still open at the end of a chunk.
+fixpoint bool wstate(list<char> cs, bool inword) {
+  switch(cs) {
+    case nil: return inword;
+    case cons(h, t): return wstate(t, !separator(h));
+  }
+}
+@*/
+
+/*
+Tells whether c separates words: a space, a line break, a tab or a carriage return.
+*/
+bool wc_separator(char c)
+//@ requires true;
+//@ ensures result == separator(c);
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/*
+Counts the words that the first n characters of buf close, given whether a word is open before buf[0].
+A word is closed by a separator that follows a non-separator character, so every position is classified
+from itself and its predecessor only. The loop has no carried state besides the count,
+which lets the compiler vectorize it. Both characters are loaded before the test so that the body has no branch.
+*/
+int wc_chunk(char* buf, int n, bool inword)
+//@ requires [?f]buf[..n] |-> ?cs &*& 0 <= n;
+//@ ensures [f]buf[..n] |-> cs &*& result == wcompleted(cs, inword) &*& 0 <= result &*& result <= n;
+{
+  if(n == 0) { return 0; }
+  int count = wc_separator(buf[0]) && inword ? 1 : 0;
+  for(int i = 1; i < n; i++)
+  {
+    char prev = buf[i - 1];
+    char c = buf[i];
+    count += wc_separator(c) && !wc_separator(prev) ? 1 : 0;
+  }
+  return count;
+}
+
+/*
+Tells whether a word is still open after the first n characters of buf.
+*/
+bool wc_state(char* buf, int n, bool inword)
+//@ requires [?f]buf[..n] |-> ?cs &*& 0 <= n;
+//@ ensures [f]buf[..n] |-> cs &*& result == wstate(cs, inword);
+{
+  return n == 0 ? inword : !wc_separator(buf[n - 1]);
+}
+
+int wc(char* string, bool inword)
+//@ requires [?f]string(string, ?cs) &*& wcount(cs, inword) < INT_MAX;
+//@ ensures [f]string(string, cs) &*& result == wcount(cs, inword);
+{
+  size_t length = strlen(string);
+  if(length > INT_MAX) { abort(); }
+  int count = wc_chunk(string, (int)length, inword);
+  bool state = wc_state(string, (int)length, inword);
+  return count + (state ? 1 : 0);
+}
+
+void test()
+//@ requires true;
+//@ ensures true;
+{
+  int nb = wc("This line of text contains 8 words.", false);
+  assert(nb == 7);
+  nb = wc("one two\nthree four\nfive\n", false);
+  assert(nb == 5);
+}
+
+/*
+Counts the words in the file named by the first argument.
+The file is read in large chunks and the open-word state is carried from one chunk to the next,
+so a word that straddles two chunks is counted once.
+Line breaks separate words, so a multi-line file gives the same count as with wc_a or `wc -w`,
+which the multi-line case in `test` checks before the file is read.
+Unlike wc_a, a zero byte does not end the line; it counts as a word character.
+*/
+int main(int argc, char** argv) //@ : main
+//@ requires 0 <= argc &*& [_]argv(argv, argc, _);
+//@ ensures true;
+{
+  bool inword = false; FILE* fp = 0; char* buff = 0; int total = 0; int nb_read = 0;
+  test();
+  if(argc < 2) { puts("No input file specified."); return -1; }
+  fp = fopen(argv[1], "r");
+  buff = malloc(WC_CHUNK_SIZE);
+  if(buff == 0 || fp == 0) { abort(); }
+  nb_read = fread(buff, 1, WC_CHUNK_SIZE, fp);
+  while(0 < nb_read)
+  {
+    int tmp = wc_chunk(buff, nb_read, inword);
+    inword = wc_state(buff, nb_read, inword);
+    if (total > INT_MAX - tmp) {
+      break;
+    }
+    total = total + tmp;
+    nb_read = fread(buff, 1, WC_CHUNK_SIZE, fp);
+  }
+  if (inword && total < INT_MAX) {
+    total = total + 1;
+  }
+  printf("%i", total);
+  free(buff);
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include <stdbool.h>
+#include "assert.h"
+
+#define WC_CHUNK_SIZE (64 * 1024)
+
+/***
+ * Description:
+The `wc_separator` function tells whether `c` separates words: a space, a line break, a tab or a carriage return.
+
+@param `c` - The character to classify.
+*/
+bool wc_separator(char c)
+{
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/***
+ * Description:
+The `wc_chunk` function counts the words that the first `n` characters of `buf` close.
+A word is closed by a separator that follows a non-separator character (or, at position 0, by a separator while a word is open),
+so every position is classified from itself and its predecessor only. The loop has no carried state besides the count,
+which lets the compiler vectorize it. Both characters are loaded before the test so that the body has no branch.
+
+@param `buf` - A pointer to a character buffer, which is only read. It does not need to be zero-terminated.
+@param `n` - The non-negative number of characters to examine.
+@param `inword` - A boolean flag indicating whether a word is open before `buf[0]`.
+
+It ensures: the result is between 0 and `n`, and together with `wc_state` it gives the same count as `wc` on the same characters.
+*/
+int wc_chunk(char* buf, int n, bool inword)
+{
+  if(n == 0) { return 0; }
+  int count = wc_separator(buf[0]) && inword ? 1 : 0;
+  for(int i = 1; i < n; i++)
+  {
+    char prev = buf[i - 1];
+    char c = buf[i];
+    count += wc_separator(c) && !wc_separator(prev) ? 1 : 0;
+  }
+  return count;
+}
+
+/***
+ * Description:
+The `wc_state` function tells whether a word is still open after the first `n` characters of `buf`,
+so that the count can be carried over to the next chunk.
+
+@param `buf` - A pointer to a character buffer, which is only read.
+@param `n` - The non-negative number of characters in the chunk.
+@param `inword` - A boolean flag indicating whether a word is open before `buf[0]`.
+
+It returns `inword` for an empty chunk and otherwise whether the last character is not a separator.
+*/
+bool wc_state(char* buf, int n, bool inword)
+{
+  return n == 0 ? inword : !wc_separator(buf[n - 1]);
+}
+
+/***
+ * Description:
+The `wc` function calculates the word count in a given string, without recursion.
+It counts the words closed inside the string with `wc_chunk` and adds one if a word is still open at the end.
+
+@param `string` - The string to count words in.
+@param `inword` - A boolean flag indicating whether the current position is inside a word or not.
+*/
+int wc(char* string, bool inword)
+{
+  size_t length = strlen(string);
+  if(length > INT_MAX) { abort(); }
+  int count = wc_chunk(string, (int)length, inword);
+  bool state = wc_state(string, (int)length, inword);
+  return count + (state ? 1 : 0);
+}
+
+/***
+ * Description:
+The `test` function is a test function to validate the `wc` function.
+*/
+void test()
+{
+  int nb = wc("This line of text contains 8 words.", false);
+  assert(nb == 7);
+  nb = wc("one two\nthree four\nfive\n", false);
+  assert(nb == 5);
+}
+
+/***
+ * Description:
+The `main` function counts the words in the file named by the first command-line argument.
+The file is read in chunks of WC_CHUNK_SIZE bytes and the open-word state is carried from one chunk to the next,
+so a word that straddles two chunks is counted once.
+Line breaks separate words, so a multi-line file gives the same count as with wc_a or `wc -w`,
+which the multi-line case in `test` checks before the file is read.
+Unlike wc_a, a zero byte does not end the line; it counts as a word character.
+
+@param `argc` - Number of command-line arguments.
+@param `argv` - Array of command-line arguments.
+*/
+int main(int argc, char** argv)
+{
+  bool inword = false; FILE* fp = 0; char* buff = 0; int total = 0; int nb_read = 0;
+  test();
+  if(argc < 2) { puts("No input file specified."); return -1; }
+  fp = fopen(argv[1], "r");
+  buff = malloc(WC_CHUNK_SIZE);
+  if(buff == 0 || fp == 0) { abort(); }
+  nb_read = fread(buff, 1, WC_CHUNK_SIZE, fp);
+  while(0 < nb_read)
+  {
+    int tmp = wc_chunk(buff, nb_read, inword);
+    inword = wc_state(buff, nb_read, inword);
+    if (total > INT_MAX - tmp) {
+      break;
+    }
+    total = total + tmp;
+    nb_read = fread(buff, 1, WC_CHUNK_SIZE, fp);
+  }
+  if (inword && total < INT_MAX) {
+    total = total + 1;
+  }
+  printf("%i", total);
+  free(buff);
+  fclose(fp);
+  return 0;
+}
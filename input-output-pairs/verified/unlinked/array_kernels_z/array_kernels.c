@@ -0,0 +1,230 @@
+#include "stdlib.h"
+#include "string.h"
+#include <stdbool.h>
+#include "assert.h"
+
+/*@
+fixpoint_auto list<t> n_times<t>(t x, int count) {
+    return count == 0 ? nil : cons(x, n_times(x, count - 1));
+}
+
+fixpoint_auto list<int> range(int min, int max)
+    decreases max - min;
+{
+    return min == max ? nil : cons(min, range(min + 1, max));
+}
+
+fixpoint int sum(list<int> xs) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return x0 + sum(xs0);
+    }
+}
+
+fixpoint bool all_non_negative(list<int> xs) {
+    switch (xs) {
+        case nil: return true;
+        case cons(x0, xs0): return x0 >= 0 && all_non_negative(xs0);
+    }
+}
+
+fixpoint list<int> prefix_sums(int acc, list<int> xs) {
+    switch (xs) {
+        case nil: return nil;
+        case cons(x0, xs0): return cons(acc + x0, prefix_sums(acc + x0, xs0));
+    }
+}
+
+fixpoint int mismatches(list<int> xs, list<int> ys) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return
+            switch (ys) {
+                case nil: return 0;
+                case cons(y0, ys0): return (x0 == y0 ? 0 : 1) + mismatches(xs0, ys0);
+            };
+    }
+}
+
+lemma void all_eq_n_times(list<char> cs, char c)
+    requires all_eq(cs, c) == true;
+    ensures cs == n_times(c, length(cs));
+{
+    switch (cs) {
+        case nil:
+        case cons(c0, cs0):
+            all_eq_n_times(cs0, c);
+    }
+}
+
+lemma void sum_nonnegative(list<int> xs)
+    requires all_non_negative(xs) == true;
+    ensures 0 <= sum(xs);
+{
+    switch (xs) {
+        case nil:
+        case cons(x0, xs0):
+            sum_nonnegative(xs0);
+    }
+}
+
+lemma void sum_range_closed(int m, int n)
+    requires m <= n;
+    ensures 2 * sum(range(m, n)) == (n - m) * (n + m - 1);
+    decreases n - m;
+{
+    if (m < n) {
+        sum_range_closed(m + 1, n);
+    }
+}
+
+lemma void mismatches_zero(list<int> xs, list<int> ys)
+    requires length(xs) == length(ys);
+    ensures 0 <= mismatches(xs, ys) &*& (mismatches(xs, ys) == 0) == (xs == ys);
+{
+    switch (xs) {
+        case nil:
+            switch (ys) { case nil: case cons(y0, ys0): }
+        case cons(x0, xs0):
+            switch (ys) {
+                case nil:
+                case cons(y0, ys0):
+                    mismatches_zero(xs0, ys0);
+            }
+    }
+}
+@*/
+
+// Scalar reference kernels. These are the loops from wf_func2 and wf_func1.
+
+void fill(char *buf, int length, char c)
+//@ requires buf[..length] |-> _;
+//@ ensures buf[..length] |-> n_times(c, length);
+{
+    for (int i = 0; i < length; i++)
+    //@ requires i <= length &*& chars_(buf + i, length - i, ?cs0) &*& switch (cs0) { case nil: return true; case cons(c0, cs00): return true; };
+    //@ ensures buf[old_i..length] |-> n_times(c, length - old_i);
+    {
+        buf[i] = c;
+    }
+}
+
+int sum_of_range(int n)
+//@ requires 0 <= n &*& sum(range(0, n)) <= INT_MAX &*& all_non_negative(range(0, n)) == true;
+//@ ensures result == sum(range(0, n));
+{
+    int count = 0;
+    int sum = 0;
+    while (count != n)
+    //@ requires 0 <= count && count <= n &*& all_non_negative(range(count, n)) == true &*& sum + sum(range(count, n)) <= INT_MAX;
+    //@ ensures sum == old_sum + sum(range(old_count, n));
+    //@ decreases n - count;
+    {
+        //@ sum_nonnegative(range(count + 1, n));
+        sum = sum + count;
+        count = count + 1;
+    }
+    return sum;
+}
+
+// Bulk kernels. None of the loops below carries a dependency other than a
+// reduction and none exits early, so an optimizing compiler turns them into
+// SSE2/AVX2 code and keeps the scalar loop as the remainder/fallback.
+
+void fill_memset(char *buf, int length, char c)
+//@ requires buf[..length] |-> _ &*& 0 <= length;
+//@ ensures buf[..length] |-> n_times(c, length);
+{
+    memset(buf, c, (size_t)length);
+    //@ assert chars(buf, length, ?cs);
+    //@ all_eq_n_times(cs, c);
+    //@ open chars_(buf + length, 0, _);
+}
+
+int sum_of_range_closed(int n)
+//@ requires 0 <= n &*& sum(range(0, n)) <= INT_MAX;
+//@ ensures result == sum(range(0, n));
+{
+    //@ sum_range_closed(0, n);
+    long long twice = (long long)n * (n - 1);
+    return (int)(twice / 2);
+}
+
+int sum_ints(int *xs, int n)
+//@ requires [?f]xs[..n] |-> ?vs &*& all_non_negative(vs) == true &*& sum(vs) <= INT_MAX;
+//@ ensures [f]xs[..n] |-> vs &*& result == sum(vs);
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    //@ requires [f]xs[i..n] |-> ?ws &*& all_non_negative(ws) == true &*& acc + sum(ws) <= INT_MAX;
+    //@ ensures [f]xs[old_i..n] |-> ws &*& acc == old_acc + sum(ws);
+    {
+        //@ sum_nonnegative(tail(ws));
+        acc += xs[i];
+    }
+    return acc;
+}
+
+void prefix_sum(int *xs, int n)
+//@ requires xs[..n] |-> ?vs &*& all_non_negative(vs) == true &*& sum(vs) <= INT_MAX;
+//@ ensures xs[..n] |-> prefix_sums(0, vs);
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    //@ requires xs[i..n] |-> ?ws &*& all_non_negative(ws) == true &*& acc + sum(ws) <= INT_MAX;
+    //@ ensures xs[old_i..n] |-> prefix_sums(old_acc, ws);
+    {
+        //@ sum_nonnegative(tail(ws));
+        acc += xs[i];
+        xs[i] = acc;
+    }
+}
+
+bool ints_equal(int *a, int *b, int n)
+//@ requires [?fa]a[..n] |-> ?as &*& [?fb]b[..n] |-> ?bs;
+//@ ensures [fa]a[..n] |-> as &*& [fb]b[..n] |-> bs &*& result == (as == bs);
+{
+    int diff = 0;
+    for (int i = 0; i < n; i++)
+    //@ requires [fa]a[i..n] |-> ?as0 &*& [fb]b[i..n] |-> ?bs0 &*& 0 <= diff &*& diff <= i;
+    //@ ensures [fa]a[old_i..n] |-> as0 &*& [fb]b[old_i..n] |-> bs0 &*& diff == old_diff + mismatches(as0, bs0);
+    {
+        if (a[i] != b[i]) {
+            diff++;
+        }
+    }
+    //@ mismatches_zero(as, bs);
+    return diff == 0;
+}
+
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+    char *scalar = malloc(64);
+    char *bulk = malloc(64);
+    if (scalar == 0 || bulk == 0) abort();
+    fill(scalar, 64, 'x');
+    fill_memset(bulk, 64, 'x');
+    //@ assert scalar[..64] |-> ?cs1 &*& bulk[..64] |-> ?cs2;
+    //@ assert cs1 == cs2;
+    free(scalar);
+    free(bulk);
+
+    int *xs = malloc(4 * sizeof(int));
+    int *ys = malloc(4 * sizeof(int));
+    if (xs == 0 || ys == 0) abort();
+    xs[0] = 0; xs[1] = 1; xs[2] = 2; xs[3] = 3;
+    ys[0] = 0; ys[1] = 1; ys[2] = 2; ys[3] = 3;
+    int s1 = sum_ints(xs, 4);
+    int s2 = sum_of_range(4);
+    int s3 = sum_of_range_closed(4);
+    assert(s1 == s2 && s2 == s3);
+    bool same = ints_equal(xs, ys, 4);
+    assert(same);
+    prefix_sum(xs, 4);
+    assert(xs[3] == 6);
+    free(xs);
+    free(ys);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "stdlib.h"
+#include "string.h"
+#include <stdbool.h>
+#include "assert.h"
+
+/*@
+fixpoint_auto list<t> n_times<t>(t x, int count) {
+    return count == 0 ? nil : cons(x, n_times(x, count - 1));
+}
+
+fixpoint_auto list<int> range(int min, int max)
+    decreases max - min;
+{
+    return min == max ? nil : cons(min, range(min + 1, max));
+}
+
+fixpoint int sum(list<int> xs) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return x0 + sum(xs0);
+    }
+}
+
+fixpoint bool all_non_negative(list<int> xs) {
+    switch (xs) {
+        case nil: return true;
+        case cons(x0, xs0): return x0 >= 0 && all_non_negative(xs0);
+    }
+}
+
+fixpoint list<int> prefix_sums(int acc, list<int> xs) {
+    switch (xs) {
+        case nil: return nil;
+        case cons(x0, xs0): return cons(acc + x0, prefix_sums(acc + x0, xs0));
+    }
+}
+
+fixpoint int mismatches(list<int> xs, list<int> ys) {
+    switch (xs) {
+        case nil: return 0;
+        case cons(x0, xs0): return
+            switch (ys) {
+                case nil: return 0;
+                case cons(y0, ys0): return (x0 == y0 ? 0 : 1) + mismatches(xs0, ys0);
+            };
+    }
+}
+@*/
+
+// Scalar reference kernels. These are the loops from wf_func2 and wf_func1.
+
+void fill(char *buf, int length, char c)
+//@ requires buf[..length] |-> _;
+//@ ensures buf[..length] |-> n_times(c, length);
+{
+    for (int i = 0; i < length; i++)
+    {
+        buf[i] = c;
+    }
+}
+
+int sum_of_range(int n)
+//@ requires 0 <= n &*& sum(range(0, n)) <= INT_MAX &*& all_non_negative(range(0, n)) == true;
+//@ ensures result == sum(range(0, n));
+{
+    int count = 0;
+    int sum = 0;
+    while (count != n)
+    {
+        sum = sum + count;
+        count = count + 1;
+    }
+    return sum;
+}
+
+// Bulk kernels. None of the loops below carries a dependency other than a
+// reduction and none exits early, so an optimizing compiler turns them into
+// SSE2/AVX2 code and keeps the scalar loop as the remainder/fallback.
+
+void fill_memset(char *buf, int length, char c)
+//@ requires buf[..length] |-> _ &*& 0 <= length;
+//@ ensures buf[..length] |-> n_times(c, length);
+{
+    memset(buf, c, (size_t)length);
+}
+
+int sum_of_range_closed(int n)
+//@ requires 0 <= n &*& sum(range(0, n)) <= INT_MAX;
+//@ ensures result == sum(range(0, n));
+{
+    long long twice = (long long)n * (n - 1);
+    return (int)(twice / 2);
+}
+
+int sum_ints(int *xs, int n)
+//@ requires [?f]xs[..n] |-> ?vs &*& all_non_negative(vs) == true &*& sum(vs) <= INT_MAX;
+//@ ensures [f]xs[..n] |-> vs &*& result == sum(vs);
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        acc += xs[i];
+    }
+    return acc;
+}
+
+void prefix_sum(int *xs, int n)
+//@ requires xs[..n] |-> ?vs &*& all_non_negative(vs) == true &*& sum(vs) <= INT_MAX;
+//@ ensures xs[..n] |-> prefix_sums(0, vs);
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        acc += xs[i];
+        xs[i] = acc;
+    }
+}
+
+bool ints_equal(int *a, int *b, int n)
+//@ requires [?fa]a[..n] |-> ?as &*& [?fb]b[..n] |-> ?bs;
+//@ ensures [fa]a[..n] |-> as &*& [fb]b[..n] |-> bs &*& result == (as == bs);
+{
+    int diff = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (a[i] != b[i]) {
+            diff++;
+        }
+    }
+    return diff == 0;
+}
+
+int main() //@ : main
+//@ requires true;
+//@ ensures true;
+{
+    char *scalar = malloc(64);
+    char *bulk = malloc(64);
+    if (scalar == 0 || bulk == 0) abort();
+    fill(scalar, 64, 'x');
+    fill_memset(bulk, 64, 'x');
+    free(scalar);
+    free(bulk);
+
+    int *xs = malloc(4 * sizeof(int));
+    int *ys = malloc(4 * sizeof(int));
+    if (xs == 0 || ys == 0) abort();
+    xs[0] = 0; xs[1] = 1; xs[2] = 2; xs[3] = 3;
+    ys[0] = 0; ys[1] = 1; ys[2] = 2; ys[3] = 3;
+    int s1 = sum_ints(xs, 4);
+    int s2 = sum_of_range(4);
+    int s3 = sum_of_range_closed(4);
+    assert(s1 == s2 && s2 == s3);
+    bool same = ints_equal(xs, ys, 4);
+    assert(same);
+    prefix_sum(xs, 4);
+    assert(xs[3] == 6);
+    free(xs);
+    free(ys);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "stdlib.h"
+#include "string.h"
+#include <stdbool.h>
+#include "assert.h"
+
+// Scalar reference kernels. These are the loops from wf_func2 and wf_func1.
+
+/***
+ * Description:
+The `fill` function fills a buffer with a specified character up to a given length, one byte at a time.
+
+@param buf - A pointer to a character buffer.
+@param length - The number of positions in the buffer to fill.
+@param c - The character that will be used to fill the buffer.
+
+It requires: `buf` points to at least `length` writable characters.
+It ensures: the first `length` characters of `buf` are all equal to `c`.
+*/
+void fill(char *buf, int length, char c)
+{
+    for (int i = 0; i < length; i++)
+    {
+        buf[i] = c;
+    }
+}
+
+/***
+ * Description:
+The `sum_of_range` function calculates the sum of all integers in the range from 0 to n-1 by iterating over the range.
+
+@param `n` - the upper limit of the range (exclusive).
+
+It requires: `n` is non-negative and the sum fits in an int.
+It ensures: the result is equal to the sum of all integers in the range from 0 to n-1.
+*/
+int sum_of_range(int n)
+{
+    int count = 0;
+    int sum = 0;
+    while (count != n)
+    {
+        sum = sum + count;
+        count = count + 1;
+    }
+    return sum;
+}
+
+// Bulk kernels. None of the loops below carries a dependency other than a
+// reduction and none exits early, so an optimizing compiler turns them into
+// SSE2/AVX2 code and keeps the scalar loop as the remainder/fallback.
+
+/***
+ * Description:
+The `fill_memset` function fills a buffer with a specified character up to a given length using `memset`.
+
+@param buf - A pointer to a character buffer.
+@param length - The non-negative number of positions in the buffer to fill.
+@param c - The character that will be used to fill the buffer.
+
+It requires: `buf` points to at least `length` writable characters.
+It ensures: the buffer has the same content as after `fill(buf, length, c)`.
+*/
+void fill_memset(char *buf, int length, char c)
+{
+    memset(buf, c, (size_t)length);
+}
+
+/***
+ * Description:
+The `sum_of_range_closed` function calculates the sum of all integers in the range from 0 to n-1
+using the closed form n * (n - 1) / 2, computed in a wider type so that the intermediate product cannot overflow.
+
+@param `n` - the upper limit of the range (exclusive).
+
+It requires: `n` is non-negative and the sum fits in an int.
+It ensures: the result is equal to the result of `sum_of_range(n)`.
+*/
+int sum_of_range_closed(int n)
+{
+    long long twice = (long long)n * (n - 1);
+    return (int)(twice / 2);
+}
+
+/***
+ * Description:
+The `sum_ints` function calculates the sum of the first `n` elements of an integer array.
+
+@param xs - A pointer to an integer array, which is only read.
+@param n - The number of elements to sum.
+
+It requires: all elements are non-negative and their sum fits in an int.
+It ensures: the array is unchanged and the result is the sum of its elements.
+*/
+int sum_ints(int *xs, int n)
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        acc += xs[i];
+    }
+    return acc;
+}
+
+/***
+ * Description:
+The `prefix_sum` function replaces each of the first `n` elements of an integer array by the sum
+of itself and all elements before it (an inclusive scan).
+
+@param xs - A pointer to an integer array.
+@param n - The number of elements to scan.
+
+It requires: all elements are non-negative and their sum fits in an int.
+It ensures: element i of the array holds the sum of the original elements 0..i.
+*/
+void prefix_sum(int *xs, int n)
+{
+    int acc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        acc += xs[i];
+        xs[i] = acc;
+    }
+}
+
+/***
+ * Description:
+The `ints_equal` function checks whether two integer arrays hold the same first `n` elements.
+It counts the mismatching positions instead of returning at the first one, so that the loop has no early exit.
+
+@param a - A pointer to the first integer array, which is only read.
+@param b - A pointer to the second integer array, which is only read.
+@param n - The number of elements to compare.
+
+It ensures: both arrays are unchanged and the result is true exactly when their contents are equal.
+*/
+bool ints_equal(int *a, int *b, int n)
+{
+    int diff = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (a[i] != b[i]) {
+            diff++;
+        }
+    }
+    return diff == 0;
+}
+
+/***
+ * Description:
+The `main` function compares every bulk kernel against its scalar reference on a small input.
+*/
+int main()
+{
+    char *scalar = malloc(64);
+    char *bulk = malloc(64);
+    if (scalar == 0 || bulk == 0) abort();
+    fill(scalar, 64, 'x');
+    fill_memset(bulk, 64, 'x');
+    free(scalar);
+    free(bulk);
+
+    int *xs = malloc(4 * sizeof(int));
+    int *ys = malloc(4 * sizeof(int));
+    if (xs == 0 || ys == 0) abort();
+    xs[0] = 0; xs[1] = 1; xs[2] = 2; xs[3] = 3;
+    ys[0] = 0; ys[1] = 1; ys[2] = 2; ys[3] = 3;
+    int s1 = sum_ints(xs, 4);
+    int s2 = sum_of_range(4);
+    int s3 = sum_of_range_closed(4);
+    assert(s1 == s2 && s2 == s3);
+    bool same = ints_equal(xs, ys, 4);
+    assert(same);
+    prefix_sum(xs, 4);
+    assert(xs[3] == 6);
+    free(xs);
+    free(ys);
+    return 0;
+}